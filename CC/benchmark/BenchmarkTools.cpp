@@ -0,0 +1,326 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "BenchmarkTools.h"
+
+//CCLib
+#include <CCPlatform.h>
+#include <ChunkedPointCloud.h>
+#include <SimpleMesh.h>
+
+//system
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef CC_WINDOWS
+#include <Windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+namespace ccBenchmark
+{
+
+static double CurrentTimeMs()
+{
+#ifdef CC_WINDOWS
+	static LARGE_INTEGER s_frequency = { 0 };
+	if (s_frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&s_frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (1000.0 * static_cast<double>(counter.QuadPart)) / static_cast<double>(s_frequency.QuadPart);
+#else
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return static_cast<double>(tv.tv_sec) * 1000.0 + static_cast<double>(tv.tv_usec) / 1000.0;
+#endif
+}
+
+void Timer::start()
+{
+	m_startMs = CurrentTimeMs();
+}
+
+double Timer::elapsedMs() const
+{
+	return CurrentTimeMs() - m_startMs;
+}
+
+void ResultsLog::add(const Result& result)
+{
+	m_results.push_back(result);
+
+	if (result.success)
+	{
+		printf("[%s] %-28s %-24s %10u pts | best %10.2f ms | mean %10.2f ms | value %g %s\n",
+			result.suite.c_str(),
+			result.test.c_str(),
+			result.cloud.c_str(),
+			result.points,
+			result.minMs,
+			result.meanMs,
+			result.value,
+			result.parameters.c_str());
+	}
+	else
+	{
+		printf("[%s] %-28s %-24s %10u pts | FAILED %s\n",
+			result.suite.c_str(),
+			result.test.c_str(),
+			result.cloud.c_str(),
+			result.points,
+			result.parameters.c_str());
+	}
+	fflush(stdout);
+}
+
+bool ResultsLog::writeCSV(const std::string& filename) const
+{
+	bool isNew = true;
+	{
+		std::ifstream test(filename.c_str());
+		isNew = !test.good();
+	}
+
+	std::ofstream file(filename.c_str(), std::ios::out | std::ios::app);
+	if (!file.good())
+		return false;
+
+	if (isNew)
+		file << "label;suite;test;cloud;points;parameters;repetitions;status;min_ms;mean_ms;value" << std::endl;
+
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const Result& r = m_results[i];
+		file << m_label << ';'
+			<< r.suite << ';'
+			<< r.test << ';'
+			<< r.cloud << ';'
+			<< r.points << ';'
+			<< r.parameters << ';'
+			<< r.repetitions << ';'
+			<< (r.success ? "OK" : "FAILED") << ';'
+			<< r.minMs << ';'
+			<< r.meanMs << ';'
+			<< r.value << std::endl;
+	}
+
+	return file.good();
+}
+
+unsigned ResultsLog::failedCount() const
+{
+	unsigned count = 0;
+	for (size_t i = 0; i < m_results.size(); ++i)
+		if (!m_results[i].success)
+			++count;
+	return count;
+}
+
+void RunTest(	ResultsLog& log,
+				const Options& options,
+				const std::string& suite,
+				const std::string& test,
+				const std::string& cloud,
+				unsigned points,
+				const std::string& parameters,
+				TestFunc func,
+				void* context)
+{
+	Result result;
+	result.suite = suite;
+	result.test = test;
+	result.cloud = cloud;
+	result.points = points;
+	result.parameters = parameters;
+	result.success = true;
+
+	unsigned repetitions = std::max<unsigned>(options.repetitions, 1);
+	double totalMs = 0;
+	for (unsigned i = 0; i < repetitions; ++i)
+	{
+		double value = 0;
+		Timer timer;
+		bool success = func(context, value);
+		double ms = timer.elapsedMs();
+
+		if (!success)
+		{
+			result.success = false;
+			break;
+		}
+
+		result.value = value;
+		result.minMs = (i == 0 ? ms : std::min(result.minMs, ms));
+		totalMs += ms;
+		++result.repetitions;
+	}
+	if (result.repetitions)
+		result.meanMs = totalMs / result.repetitions;
+
+	log.add(result);
+}
+
+double Random::next()
+{
+	//64 bits LCG (Knuth's MMIX constants)
+	m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return static_cast<double>(m_state >> 11) / 9007199254740992.0; //2^53
+}
+
+double SyntheticHeight(double x, double y, double phase)
+{
+	return 5.0 * sin(x / 7.0 + phase) * cos(y / 11.0 - phase) + 0.05 * x;
+}
+
+CCLib::ChunkedPointCloud* CreateSyntheticCloud(unsigned count, unsigned seed, double noise, double phase)
+{
+	CCLib::ChunkedPointCloud* cloud = new CCLib::ChunkedPointCloud();
+	if (!cloud->reserve(count))
+	{
+		delete cloud;
+		return 0;
+	}
+
+	Random random(seed);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		double x = random.next(0, 100);
+		double y = random.next(0, 100);
+		double z = SyntheticHeight(x, y, phase) + random.next(-noise, noise);
+		cloud->addPoint(CCVector3(	static_cast<PointCoordinateType>(x),
+									static_cast<PointCoordinateType>(y),
+									static_cast<PointCoordinateType>(z) ));
+	}
+
+	return cloud;
+}
+
+CCLib::SimpleMesh* CreateSyntheticMesh(unsigned gridSize, double phase, CCLib::ChunkedPointCloud*& vertices)
+{
+	vertices = 0;
+	if (gridSize < 2)
+		return 0;
+
+	vertices = new CCLib::ChunkedPointCloud();
+	if (!vertices->reserve(gridSize * gridSize))
+	{
+		delete vertices;
+		vertices = 0;
+		return 0;
+	}
+
+	double step = 100.0 / (gridSize - 1);
+	for (unsigned j = 0; j < gridSize; ++j)
+	{
+		for (unsigned i = 0; i < gridSize; ++i)
+		{
+			double x = i * step;
+			double y = j * step;
+			vertices->addPoint(CCVector3(	static_cast<PointCoordinateType>(x),
+											static_cast<PointCoordinateType>(y),
+											static_cast<PointCoordinateType>(SyntheticHeight(x, y, phase)) ));
+		}
+	}
+
+	CCLib::SimpleMesh* mesh = new CCLib::SimpleMesh(vertices, false);
+	if (!mesh->reserve(2 * (gridSize - 1) * (gridSize - 1)))
+	{
+		delete mesh;
+		delete vertices;
+		vertices = 0;
+		return 0;
+	}
+
+	for (unsigned j = 0; j + 1 < gridSize; ++j)
+	{
+		for (unsigned i = 0; i + 1 < gridSize; ++i)
+		{
+			unsigned v00 = j * gridSize + i;
+			unsigned v10 = v00 + 1;
+			unsigned v01 = v00 + gridSize;
+			unsigned v11 = v01 + 1;
+			mesh->addTriangle(v00, v10, v11);
+			mesh->addTriangle(v00, v11, v01);
+		}
+	}
+
+	return mesh;
+}
+
+CCLib::ChunkedPointCloud* LoadASCIICloud(const std::string& filename)
+{
+	std::ifstream file(filename.c_str());
+	if (!file.good())
+		return 0;
+
+	CCLib::ChunkedPointCloud* cloud = new CCLib::ChunkedPointCloud();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		//accept ',' and ';' as separators as well
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::replace(line.begin(), line.end(), ';', ' ');
+
+		std::istringstream stream(line);
+		double x, y, z;
+		if (!(stream >> x >> y >> z))
+			continue; //header or comment
+
+		if (cloud->size() == cloud->capacity())
+		{
+			if (!cloud->reserve(std::max<unsigned>(1024, cloud->size() * 2)))
+			{
+				delete cloud;
+				return 0;
+			}
+		}
+		cloud->addPoint(CCVector3(	static_cast<PointCoordinateType>(x),
+									static_cast<PointCoordinateType>(y),
+									static_cast<PointCoordinateType>(z) ));
+	}
+
+	if (cloud->size() == 0)
+	{
+		delete cloud;
+		return 0;
+	}
+
+	return cloud;
+}
+
+std::string ShortName(const std::string& filename)
+{
+	size_t pos = filename.find_last_of("/\\");
+	return pos == std::string::npos ? filename : filename.substr(pos + 1);
+}
+
+std::string ToString(double value)
+{
+	std::ostringstream stream;
+	stream << value;
+	return stream.str();
+}
+
+} //namespace ccBenchmark
@@ -0,0 +1,213 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_BENCHMARK_TOOLS_HEADER
+#define CC_BENCHMARK_TOOLS_HEADER
+
+//CCLib
+#include <CCGeom.h>
+
+//system
+#include <string>
+#include <vector>
+
+namespace CCLib
+{
+	class ChunkedPointCloud;
+	class SimpleMesh;
+}
+
+namespace ccBenchmark
+{
+
+//! Benchmark options (set from the command line)
+struct Options
+{
+	//! Default constructor
+	Options()
+		: pointCount(1000000)
+		, repetitions(3)
+		, queryCount(10000)
+		, knn(12)
+		, octreeLevel(0)
+		, radius(0)
+		, outOfCoreMemoryMb(64)
+		, multiThread(true)
+		, codeOrderedPoints(false)
+		, withIO(true)
+		, seed(1)
+	{}
+
+	//! Number of points of the synthetic clouds
+	unsigned pointCount;
+	//! Number of repetitions of each test (the best and mean times are reported)
+	unsigned repetitions;
+	//! Number of random queries for the neighbourhood extraction tests
+	unsigned queryCount;
+	//! Number of neighbours for the kNN and normals tests
+	unsigned knn;
+	//! Forced octree level for the distances/subsampling tests (0 = automatic)
+	unsigned char octreeLevel;
+	//! Forced neighbourhood radius (0 = automatic, deduced from the cloud density)
+	double radius;
+	//! Memory limit of the out-of-core octree tests (in Mb)
+	unsigned outOfCoreMemoryMb;
+	//! Whether multi-threaded versions of the algorithms should be used
+	bool multiThread;
+	//! Whether the shared octree should keep a copy of the points in cell code order
+	bool codeOrderedPoints;
+	//! Whether the I/O filters should be benchmarked (if available)
+	bool withIO;
+	//! Seed of the pseudo-random generator (for reproducibility)
+	unsigned seed;
+	//! User cloud(s) (ASCII 'X Y Z' files in the standalone version)
+	std::vector<std::string> cloudFiles;
+	//! User mesh(es) (only with I/O support)
+	std::vector<std::string> meshFiles;
+	//! Output CSV file (results are appended)
+	std::string outputFile;
+	//! Label of the current run (typically the version or the machine name)
+	std::string label;
+	//! Temporary folder for I/O and out-of-core tests
+	std::string tempDir;
+};
+
+//! Wall-clock timer
+class Timer
+{
+public:
+	//! Default constructor (starts the timer)
+	Timer() { start(); }
+
+	//! (Re)starts the timer
+	void start();
+
+	//! Returns the elapsed time since the last call to start (in ms)
+	double elapsedMs() const;
+
+protected:
+	//! Start time (in ms, relatively to an arbitrary origin)
+	double m_startMs;
+};
+
+//! Result of a single test
+struct Result
+{
+	Result() : points(0), repetitions(0), minMs(0), meanMs(0), value(0), success(false) {}
+
+	std::string suite;
+	std::string test;
+	std::string cloud;
+	unsigned points;
+	std::string parameters;
+	unsigned repetitions;
+	double minMs;
+	double meanMs;
+	//! Test specific value (number of neighbours, mean distance, etc.) to check consistency across versions
+	double value;
+	bool success;
+};
+
+//! Results log
+/** Results are printed to the standard output as they come and
+	can be appended to a CSV file (one line per test) so as to track
+	them across versions/machines.
+**/
+class ResultsLog
+{
+public:
+
+	//! Default constructor
+	explicit ResultsLog(const std::string& label) : m_label(label) {}
+
+	//! Adds (and prints) a new result
+	void add(const Result& result);
+
+	//! Appends all results to a CSV file (a header is written if the file is new)
+	bool writeCSV(const std::string& filename) const;
+
+	//! Returns the number of failed tests
+	unsigned failedCount() const;
+
+protected:
+
+	std::string m_label;
+	std::vector<Result> m_results;
+};
+
+//! Test function
+/** \param context test specific context
+	\param value test specific output value (see Result::value)
+	\return success
+**/
+typedef bool (*TestFunc)(void* context, double& value);
+
+//! Runs a test several times and logs its timings
+/** The first run is not discarded (it is counted as any other repetition)
+	but the minimum time is reported along with the mean time.
+**/
+void RunTest(	ResultsLog& log,
+				const Options& options,
+				const std::string& suite,
+				const std::string& test,
+				const std::string& cloud,
+				unsigned points,
+				const std::string& parameters,
+				TestFunc func,
+				void* context);
+
+//! Deterministic pseudo-random generator (portable, so that datasets are the same everywhere)
+class Random
+{
+public:
+	explicit Random(unsigned seed) : m_state(seed * 2654435761u + 1) {}
+
+	//! Returns a value in [0,1[
+	double next();
+	//! Returns a value in [a,b[
+	double next(double a, double b) { return a + (b - a) * next(); }
+
+protected:
+	unsigned long long m_state;
+};
+
+//! Height of the synthetic surface at a given position
+double SyntheticHeight(double x, double y, double phase);
+
+//! Creates a synthetic cloud (noisy undulating surface in [0,100]x[0,100])
+CCLib::ChunkedPointCloud* CreateSyntheticCloud(unsigned count, unsigned seed, double noise, double phase);
+
+//! Creates a synthetic mesh (regular triangulation of the same undulating surface)
+/** \param gridSize number of vertices along each dimension
+	\param phase surface phase
+	\param vertices the mesh vertices (to be deleted by the caller after the mesh)
+	\return mesh (or 0 if not enough memory)
+**/
+CCLib::SimpleMesh* CreateSyntheticMesh(unsigned gridSize, double phase, CCLib::ChunkedPointCloud*& vertices);
+
+//! Loads an ASCII cloud (the first 3 values of each line are considered as X, Y and Z)
+CCLib::ChunkedPointCloud* LoadASCIICloud(const std::string& filename);
+
+//! Returns the short name of a file (without its path)
+std::string ShortName(const std::string& filename);
+
+//! Converts a number to a string
+std::string ToString(double value);
+
+} //namespace ccBenchmark
+
+#endif //CC_BENCHMARK_TOOLS_HEADER
@@ -0,0 +1,766 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "CoreBenchmarks.h"
+
+//CCLib
+#include <ChunkedPointCloud.h>
+#include <CloudSamplingTools.h>
+#include <DgmOctree.h>
+#include <DistanceComputationTools.h>
+#include <GenericIndexedMesh.h>
+#include <GeometricalAnalysisTools.h>
+#include <Neighbourhood.h>
+#include <OutOfCoreOctree.h>
+#include <ReferenceCloud.h>
+#include <ScalarField.h>
+#include <SimpleMesh.h>
+
+//system
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace CCLib;
+
+namespace ccBenchmark
+{
+
+static const char SUITE_CORE[] = "core";
+
+//! Context shared by the per-cloud tests
+struct CloudContext
+{
+	CloudContext()
+		: cloud(0)
+		, octree(0)
+		, outOfCoreOctree(0)
+		, options(0)
+		, radius(0)
+		, level(0)
+	{}
+
+	ChunkedPointCloud* cloud;
+	DgmOctree* octree;
+	OutOfCoreOctree* outOfCoreOctree;
+	const Options* options;
+	PointCoordinateType radius;
+	unsigned char level;
+	std::vector<CCVector3> queries;
+	std::vector<CCVector3> directions;
+};
+
+//! Returns the mean of the cloud current scalar field (valid values only)
+static double CurrentSFMean(ChunkedPointCloud* cloud)
+{
+	ScalarField* sf = cloud->getCurrentInScalarField();
+	if (!sf)
+		return 0;
+	ScalarType mean = 0;
+	sf->computeMeanAndVariance(mean);
+	return static_cast<double>(mean);
+}
+
+//! Returns the memory limit of the out-of-core tests (in bytes)
+static size_t OutOfCoreMemoryLimit(const Options& options)
+{
+	return static_cast<size_t>(options.outOfCoreMemoryMb) << 20;
+}
+
+//! Computes the mean of the values exported by an out-of-core octree (valid values only)
+class ValuesMean : public OutOfCoreOctree::ValuesOutput
+{
+public:
+	ValuesMean() : count(0), validCount(0), sum(0) {}
+
+	virtual bool addValue(ScalarType value)
+	{
+		if (ScalarField::ValidValue(value))
+		{
+			sum += value;
+			++validCount;
+		}
+		++count;
+		return true;
+	}
+
+	unsigned count;
+	unsigned validCount;
+	double sum;
+};
+
+//! Returns the mean of the values stored in an out-of-core octree (valid values only)
+/** The values are streamed (see OutOfCoreOctree::exportValues), as for a cloud larger than the memory.
+**/
+static bool OutOfCoreValuesMean(const OutOfCoreOctree& octree, unsigned pointCount, double& mean)
+{
+	ValuesMean output;
+	if (!octree.exportValues(output) || output.count != pointCount)
+		return false;
+
+	mean = (output.validCount ? output.sum / output.validCount : 0);
+	return true;
+}
+
+static bool TestOctreeBuild(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	DgmOctree octree(context.cloud);
+	if (octree.build() <= 0)
+		return false;
+
+	value = octree.getCellNumber(10);
+	return true;
+}
+
+static bool TestSphericalNeighbourhood(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	unsigned char level = context.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(context.radius);
+
+	DgmOctree::NeighboursSet neighbours;
+	double total = 0;
+	for (size_t i = 0; i < context.queries.size(); ++i)
+	{
+		neighbours.clear();
+		total += context.octree->getPointsInSphericalNeighbourhood(context.queries[i], context.radius, neighbours, level);
+	}
+
+	value = context.queries.empty() ? 0 : total / context.queries.size();
+	return true;
+}
+
+static bool TestCylindricalNeighbourhood(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	DgmOctree::CylindricalNeighbourhood cn;
+	cn.radius = context.radius;
+	cn.maxHalfLength = 5 * context.radius;
+	cn.level = context.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(context.radius);
+
+	double total = 0;
+	for (size_t i = 0; i < context.queries.size(); ++i)
+	{
+		cn.center = context.queries[i];
+		cn.dir = context.directions[i];
+		cn.neighbours.clear();
+		total += context.octree->getPointsInCylindricalNeighbourhood(cn);
+	}
+
+	value = context.queries.empty() ? 0 : total / context.queries.size();
+	return true;
+}
+
+//! Stores the distance to the k-th nearest neighbour of each point of the cell
+static bool ComputeKNNDistanceInCell(	const DgmOctree::octreeCell& cell,
+										void** additionalParameters,
+										NormalizedProgress* nProgress/*=0*/)
+{
+	unsigned knn = *static_cast<unsigned*>(additionalParameters[0]);
+
+	DgmOctree::NearestNeighboursSearchStruct nNSS;
+	nNSS.level = cell.level;
+	nNSS.minNumberOfNeighbors = knn;
+	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
+	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
+
+	unsigned n = cell.points->size();
+	for (unsigned i = 0; i < n; ++i)
+	{
+		cell.points->getPoint(i, nNSS.queryPoint);
+
+		ScalarType d = NAN_VALUE;
+		unsigned neighborCount = cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS);
+		if (neighborCount != 0)
+		{
+			unsigned k = std::min(neighborCount, knn);
+			d = static_cast<ScalarType>(sqrt(nNSS.pointsInNeighbourhood[k - 1].squareDistd));
+		}
+		cell.points->setPointScalarValue(i, d);
+
+		if (nProgress && !nProgress->oneStep())
+			return false;
+	}
+
+	return true;
+}
+
+//! Stores the (absolute) Z component of the least squares normal of each point of the cell
+static bool ComputeLSNormalInCell(	const DgmOctree::octreeCell& cell,
+									void** additionalParameters,
+									NormalizedProgress* nProgress/*=0*/)
+{
+	unsigned knn = *static_cast<unsigned*>(additionalParameters[0]);
+	GenericIndexedCloudPersist* cloud = cell.parentOctree->associatedCloud();
+
+	DgmOctree::NearestNeighboursSearchStruct nNSS;
+	nNSS.level = cell.level;
+	nNSS.minNumberOfNeighbors = knn;
+	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
+	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
+
+	ReferenceCloud neighbours(cloud);
+	if (!neighbours.reserve(knn))
+		return false;
+
+	unsigned n = cell.points->size();
+	for (unsigned i = 0; i < n; ++i)
+	{
+		cell.points->getPoint(i, nNSS.queryPoint);
+
+		ScalarType nz = NAN_VALUE;
+		unsigned neighborCount = std::min(cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS), knn);
+		if (neighborCount >= 3)
+		{
+			neighbours.clear(false);
+			for (unsigned j = 0; j < neighborCount; ++j)
+				neighbours.addPointIndex(nNSS.pointsInNeighbourhood[j].pointIndex);
+
+			Neighbourhood Z(&neighbours);
+			const CCVector3* N = Z.getLSPlaneNormal();
+			if (N)
+				nz = static_cast<ScalarType>(fabs(N->z));
+		}
+		cell.points->setPointScalarValue(i, nz);
+
+		if (nProgress && !nProgress->oneStep())
+			return false;
+	}
+
+	return true;
+}
+
+static bool TestKNN(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	unsigned knn = context.options->knn;
+	void* additionalParameters[1] = { reinterpret_cast<void*>(&knn) };
+	unsigned char level = context.octree->findBestLevelForAGivenPopulationPerCell(knn);
+	if (context.octree->executeFunctionForAllCellsAtLevel(	level,
+															ComputeKNNDistanceInCell,
+															additionalParameters,
+															context.options->multiThread) == 0)
+	{
+		return false;
+	}
+
+	value = CurrentSFMean(context.cloud);
+	return true;
+}
+
+static bool TestLSNormals(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	unsigned knn = context.options->knn;
+	void* additionalParameters[1] = { reinterpret_cast<void*>(&knn) };
+	unsigned char level = context.octree->findBestLevelForAGivenPopulationPerCell(knn);
+	if (context.octree->executeFunctionForAllCellsAtLevel(	level,
+															ComputeLSNormalInCell,
+															additionalParameters,
+															context.options->multiThread) == 0)
+	{
+		return false;
+	}
+
+	value = CurrentSFMean(context.cloud);
+	return true;
+}
+
+static bool TestDensity(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	if (GeometricalAnalysisTools::computeLocalDensity(context.cloud, GeometricalAnalysisTools::DENSITY_KNN, context.radius, 0, context.octree) != 0)
+		return false;
+
+	value = CurrentSFMean(context.cloud);
+	return true;
+}
+
+static bool TestRoughness(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	if (GeometricalAnalysisTools::computeRoughness(context.cloud, context.radius, 0, context.octree) != 0)
+		return false;
+
+	value = CurrentSFMean(context.cloud);
+	return true;
+}
+
+static bool TestOutOfCoreOctreeBuild(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	OutOfCoreOctree octree(context.options->tempDir.c_str(), OutOfCoreMemoryLimit(*context.options));
+	if (octree.build(context.cloud) <= 0)
+		return false;
+
+	value = octree.getCellNumber(10);
+	return true;
+}
+
+static bool TestOutOfCoreDensity(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	if (GeometricalAnalysisTools::computeLocalDensity(context.outOfCoreOctree, GeometricalAnalysisTools::DENSITY_KNN, context.radius) != 0)
+		return false;
+
+	return OutOfCoreValuesMean(*context.outOfCoreOctree, context.cloud->size(), value);
+}
+
+static bool TestOutOfCoreRoughness(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	if (GeometricalAnalysisTools::computeRoughness(context.outOfCoreOctree, context.radius) != 0)
+		return false;
+
+	return OutOfCoreValuesMean(*context.outOfCoreOctree, context.cloud->size(), value);
+}
+
+static bool TestRandomSubsampling(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	ReferenceCloud* sampled = CloudSamplingTools::subsampleCloudRandomly(context.cloud, context.cloud->size() / 2);
+	if (!sampled)
+		return false;
+
+	value = sampled->size();
+	delete sampled;
+	return true;
+}
+
+static bool TestSpatialSubsampling(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	CloudSamplingTools::SFModulationParams modParams;
+	ReferenceCloud* sampled = CloudSamplingTools::resampleCloudSpatially(context.cloud, context.radius / 2, modParams, context.octree);
+	if (!sampled)
+		return false;
+
+	value = sampled->size();
+	delete sampled;
+	return true;
+}
+
+static bool TestOctreeSubsampling(void* _context, double& value)
+{
+	CloudContext& context = *static_cast<CloudContext*>(_context);
+
+	ReferenceCloud* sampled = CloudSamplingTools::subsampleCloudWithOctreeAtLevel(	context.cloud,
+																					context.level,
+																					CloudSamplingTools::NEAREST_POINT_TO_CELL_CENTER,
+																					0,
+																					context.octree);
+	if (!sampled)
+		return false;
+
+	value = sampled->size();
+	delete sampled;
+	return true;
+}
+
+void RunCloudBenchmarks(ChunkedPointCloud* cloud,
+						const std::string& cloudName,
+						const Options& options,
+						ResultsLog& log)
+{
+	if (!cloud || cloud->size() == 0)
+		return;
+
+	CloudContext context;
+	context.cloud = cloud;
+	context.options = &options;
+
+	unsigned pointCount = cloud->size();
+
+	RunTest(log, options, SUITE_CORE, "octree_build", cloudName, pointCount, std::string(), TestOctreeBuild, &context);
+
+	//the other tests share the same octree
+	DgmOctree octree(cloud);
+	if (octree.build() <= 0)
+	{
+		fprintf(stderr, "Failed to compute octree on cloud '%s'\n", cloudName.c_str());
+		return;
+	}
+	context.octree = &octree;
+
+	if (options.codeOrderedPoints && !octree.setCodeOrderedPointsCopy(true))
+		fprintf(stderr, "Not enough memory to copy the points in cell code order\n");
+
+	if (!cloud->enableScalarField())
+	{
+		fprintf(stderr, "Not enough memory to benchmark cloud '%s'\n", cloudName.c_str());
+		return;
+	}
+
+	//neighbourhood radius: by default, the size of the cells containing ~knn points
+	context.radius = options.radius > 0
+		? static_cast<PointCoordinateType>(options.radius)
+		: octree.getCellSize(octree.findBestLevelForAGivenPopulationPerCell(std::max<unsigned>(options.knn, 1)));
+	context.level = options.octreeLevel != 0 ? options.octreeLevel : octree.findBestLevelForAGivenCellNumber(std::max<unsigned>(pointCount / 10, 1));
+
+	//random queries (same ones for each repetition)
+	try
+	{
+		Random random(options.seed);
+		context.queries.resize(options.queryCount);
+		context.directions.resize(options.queryCount);
+		for (unsigned i = 0; i < options.queryCount; ++i)
+		{
+			unsigned index = std::min(static_cast<unsigned>(random.next() * pointCount), pointCount - 1);
+			context.queries[i] = *cloud->getPoint(index);
+
+			CCVector3 dir(	static_cast<PointCoordinateType>(random.next(-1, 1)),
+							static_cast<PointCoordinateType>(random.next(-1, 1)),
+							static_cast<PointCoordinateType>(random.next(-1, 1)) );
+			if (dir.norm2() < ZERO_TOLERANCE)
+				dir = CCVector3(0, 0, 1);
+			dir.normalize();
+			context.directions[i] = dir;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		fprintf(stderr, "Not enough memory to benchmark cloud '%s'\n", cloudName.c_str());
+		return;
+	}
+
+	std::string radiusParam = "radius=" + ToString(context.radius) + " queries=" + ToString(options.queryCount);
+	std::string knnParam = "knn=" + ToString(options.knn) + (options.multiThread ? " mt" : " st");
+
+	RunTest(log, options, SUITE_CORE, "spherical_neighbourhood", cloudName, pointCount, radiusParam, TestSphericalNeighbourhood, &context);
+	RunTest(log, options, SUITE_CORE, "cylindrical_neighbourhood", cloudName, pointCount, radiusParam, TestCylindricalNeighbourhood, &context);
+	RunTest(log, options, SUITE_CORE, "knn", cloudName, pointCount, knnParam, TestKNN, &context);
+	RunTest(log, options, SUITE_CORE, "ls_normals", cloudName, pointCount, knnParam, TestLSNormals, &context);
+	RunTest(log, options, SUITE_CORE, "subsampling_random", cloudName, pointCount, "count=50%", TestRandomSubsampling, &context);
+	RunTest(log, options, SUITE_CORE, "subsampling_spatial", cloudName, pointCount, "min_dist=" + ToString(context.radius / 2), TestSpatialSubsampling, &context);
+	RunTest(log, options, SUITE_CORE, "subsampling_octree", cloudName, pointCount, "level=" + ToString(context.level), TestOctreeSubsampling, &context);
+
+	std::string kernelParam = "radius=" + ToString(context.radius);
+	RunTest(log, options, SUITE_CORE, "density", cloudName, pointCount, kernelParam, TestDensity, &context);
+	RunTest(log, options, SUITE_CORE, "roughness", cloudName, pointCount, kernelParam, TestRoughness, &context);
+
+	//out-of-core versions (with a limited amount of memory)
+	std::string memoryParam = " memory=" + ToString(options.outOfCoreMemoryMb) + "Mb";
+	RunTest(log, options, SUITE_CORE, "ooc_octree_build", cloudName, pointCount, memoryParam.substr(1), TestOutOfCoreOctreeBuild, &context);
+	OutOfCoreOctree outOfCoreOctree(options.tempDir.c_str(), OutOfCoreMemoryLimit(options));
+	if (outOfCoreOctree.build(cloud) > 0)
+	{
+		context.outOfCoreOctree = &outOfCoreOctree;
+		RunTest(log, options, SUITE_CORE, "ooc_density", cloudName, pointCount, kernelParam + memoryParam, TestOutOfCoreDensity, &context);
+		RunTest(log, options, SUITE_CORE, "ooc_roughness", cloudName, pointCount, kernelParam + memoryParam, TestOutOfCoreRoughness, &context);
+	}
+	else
+	{
+		fprintf(stderr, "Failed to compute the out-of-core octree on cloud '%s'\n", cloudName.c_str());
+	}
+}
+
+//! Context of the distances tests
+struct DistancesContext
+{
+	DistancesContext()
+		: compared(0)
+		, reference(0)
+		, mesh(0)
+		, corePoints(0)
+		, options(0)
+		, level(0)
+		, localModel(NO_MODEL)
+		, radius(0)
+	{}
+
+	ChunkedPointCloud* compared;
+	ChunkedPointCloud* reference;
+	GenericIndexedMesh* mesh;
+	ReferenceCloud* corePoints;
+	const Options* options;
+	unsigned char level;
+	CC_LOCAL_MODEL_TYPES localModel;
+	PointCoordinateType radius;
+};
+
+static bool TestCloud2Cloud(void* _context, double& value)
+{
+	DistancesContext& context = *static_cast<DistancesContext*>(_context);
+
+	DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+	params.octreeLevel = context.options->octreeLevel; //0 = automatic
+	params.multiThread = context.options->multiThread;
+
+	if (DistanceComputationTools::computeCloud2CloudDistance(context.compared, context.reference, params) < 0)
+		return false;
+
+	value = CurrentSFMean(context.compared);
+	return true;
+}
+
+static bool TestCloud2CloudWithLocalModel(void* _context, double& value)
+{
+	DistancesContext& context = *static_cast<DistancesContext*>(_context);
+
+	DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+	params.octreeLevel = context.options->octreeLevel; //0 = automatic
+	params.multiThread = context.options->multiThread;
+	params.localModel = context.localModel;
+	params.kNNForLocalModel = 12;
+	params.reuseExistingLocalModels = false;
+
+	if (DistanceComputationTools::computeCloud2CloudDistance(context.compared, context.reference, params) < 0)
+		return false;
+
+	value = CurrentSFMean(context.compared);
+	return true;
+}
+
+static bool TestM3C2(void* _context, double& value)
+{
+	DistancesContext& context = *static_cast<DistancesContext*>(_context);
+
+	DistanceComputationTools::M3C2Params params;
+	params.normalScales.push_back(2 * context.radius);
+	params.normalScales.push_back(4 * context.radius);
+	params.projectionScale = 2 * context.radius;
+	params.maxDepth = 10 * context.radius;
+	params.multiThread = context.options->multiThread;
+
+	if (DistanceComputationTools::computeM3C2Distances(context.corePoints, context.compared, context.reference, params) < 0)
+		return false;
+
+	//mean of the valid distances
+	double sum = 0;
+	unsigned count = 0;
+	for (unsigned i = 0; i < context.corePoints->size(); ++i)
+	{
+		ScalarType d = context.corePoints->getPointScalarValue(i);
+		if (ScalarField::ValidValue(d))
+		{
+			sum += d;
+			++count;
+		}
+	}
+	value = (count ? sum / count : 0);
+	return true;
+}
+
+static bool TestOutOfCoreCloud2Cloud(void* _context, double& value)
+{
+	DistancesContext& context = *static_cast<DistancesContext*>(_context);
+
+	OutOfCoreOctree comparedOctree(context.options->tempDir.c_str(), OutOfCoreMemoryLimit(*context.options));
+	OutOfCoreOctree referenceOctree(context.options->tempDir.c_str(), OutOfCoreMemoryLimit(*context.options));
+	if (DistanceComputationTools::synchronizeOctrees(context.compared, context.reference, comparedOctree, referenceOctree) != DistanceComputationTools::SYNCHRONIZED)
+		return false;
+
+	if (DistanceComputationTools::computeCloud2CloudDistance(&comparedOctree, &referenceOctree, context.options->octreeLevel) < 0)
+		return false;
+
+	return OutOfCoreValuesMean(comparedOctree, context.compared->size(), value);
+}
+
+static bool TestCloud2Mesh(void* _context, double& value)
+{
+	DistancesContext& context = *static_cast<DistancesContext*>(_context);
+
+	if (DistanceComputationTools::computeCloud2MeshDistance(context.compared,
+															context.mesh,
+															context.level,
+															-1,
+															false,
+															false,
+															false,
+															context.options->multiThread) < 0)
+	{
+		return false;
+	}
+
+	value = CurrentSFMean(context.compared);
+	return true;
+}
+
+static bool TestCloud2MeshBVH(void* _context, double& value)
+{
+	DistancesContext& context = *static_cast<DistancesContext*>(_context);
+
+	if (DistanceComputationTools::computeCloud2MeshDistanceWithBVH(	context.compared,
+																	context.mesh,
+																	-1,
+																	false,
+																	false,
+																	context.options->multiThread) < 0)
+	{
+		return false;
+	}
+
+	value = CurrentSFMean(context.compared);
+	return true;
+}
+
+void RunCloud2CloudBenchmark(	ChunkedPointCloud* comparedCloud,
+								ChunkedPointCloud* referenceCloud,
+								const std::string& name,
+								const Options& options,
+								ResultsLog& log)
+{
+	if (!comparedCloud || !referenceCloud)
+		return;
+
+	DistancesContext context;
+	context.compared = comparedCloud;
+	context.reference = referenceCloud;
+	context.options = &options;
+
+	std::string params = "level=" + (options.octreeLevel != 0 ? ToString(options.octreeLevel) : std::string("auto")) + (options.multiThread ? " mt" : " st");
+	RunTest(log, options, SUITE_CORE, "c2c_distances", name, comparedCloud->size(), params, TestCloud2Cloud, &context);
+
+	context.localModel = LS;
+	RunTest(log, options, SUITE_CORE, "c2c_distances_ls", name, comparedCloud->size(), params + " knn=12", TestCloud2CloudWithLocalModel, &context);
+	context.localModel = QUADRIC;
+	RunTest(log, options, SUITE_CORE, "c2c_distances_quadric", name, comparedCloud->size(), params + " knn=12", TestCloud2CloudWithLocalModel, &context);
+	context.localModel = NO_MODEL;
+
+	//M3C2 distances on one point out of 10 (core points)
+	{
+		DgmOctree octree(comparedCloud);
+		ReferenceCloud corePoints(comparedCloud);
+		unsigned coreCount = (comparedCloud->size() + 9) / 10;
+		if (octree.build() > 0 && corePoints.reserve(coreCount))
+		{
+			for (unsigned i = 0; i < comparedCloud->size(); i += 10)
+				corePoints.addPointIndex(i);
+			context.corePoints = &corePoints;
+			//scale: the size of the cells containing ~knn points
+			context.radius = options.radius > 0
+				? static_cast<PointCoordinateType>(options.radius)
+				: octree.getCellSize(octree.findBestLevelForAGivenPopulationPerCell(std::max<unsigned>(options.knn, 1)));
+
+			std::string m3c2Params = "radius=" + ToString(context.radius) + " core_points=" + ToString(coreCount) + (options.multiThread ? " mt" : " st");
+			RunTest(log, options, SUITE_CORE, "m3c2_distances", name, comparedCloud->size(), m3c2Params, TestM3C2, &context);
+			context.corePoints = 0;
+		}
+	}
+
+	std::string oocParams = "level=" + (options.octreeLevel != 0 ? ToString(options.octreeLevel) : std::string("auto")) + " memory=" + ToString(options.outOfCoreMemoryMb) + "Mb";
+	RunTest(log, options, SUITE_CORE, "ooc_c2c_distances", name, comparedCloud->size(), oocParams, TestOutOfCoreCloud2Cloud, &context);
+}
+
+void RunCloud2MeshBenchmark(ChunkedPointCloud* comparedCloud,
+							GenericIndexedMesh* mesh,
+							const std::string& name,
+							const Options& options,
+							ResultsLog& log)
+{
+	if (!comparedCloud || !mesh || comparedCloud->size() == 0)
+		return;
+
+	DistancesContext context;
+	context.compared = comparedCloud;
+	context.mesh = mesh;
+	context.options = &options;
+	context.level = options.octreeLevel;
+	if (context.level == 0)
+	{
+		//roughly 16 points per cell
+		DgmOctree octree(comparedCloud);
+		if (octree.build() <= 0)
+			return;
+		context.level = octree.findBestLevelForAGivenPopulationPerCell(16);
+	}
+
+	std::string params = "level=" + ToString(context.level) + " triangles=" + ToString(mesh->size()) + (options.multiThread ? " mt" : " st");
+	RunTest(log, options, SUITE_CORE, "c2m_distances", name, comparedCloud->size(), params, TestCloud2Mesh, &context);
+
+	std::string bvhParams = "triangles=" + ToString(mesh->size()) + (options.multiThread ? " mt" : " st");
+	RunTest(log, options, SUITE_CORE, "c2m_distances_bvh", name, comparedCloud->size(), bvhParams, TestCloud2MeshBVH, &context);
+}
+
+//! Splits a cloud in two halves (even and odd points)
+static bool SplitCloud(ChunkedPointCloud* cloud, ChunkedPointCloud& even, ChunkedPointCloud& odd)
+{
+	unsigned count = cloud->size();
+	if (!even.reserve((count + 1) / 2) || !odd.reserve(count / 2))
+		return false;
+
+	for (unsigned i = 0; i < count; ++i)
+		(i % 2 == 0 ? even : odd).addPoint(*cloud->getPoint(i));
+
+	return true;
+}
+
+void RunCoreBenchmarks(const Options& options, ResultsLog& log, bool loadUserClouds)
+{
+	//synthetic datasets
+	{
+		ChunkedPointCloud* cloudA = CreateSyntheticCloud(options.pointCount, options.seed, 0.05, 0.0);
+		ChunkedPointCloud* cloudB = CreateSyntheticCloud(options.pointCount, options.seed + 1, 0.05, 0.2);
+		ChunkedPointCloud* vertices = 0;
+		unsigned gridSize = std::max<unsigned>(2, static_cast<unsigned>(sqrt(options.pointCount / 4.0)));
+		SimpleMesh* mesh = CreateSyntheticMesh(gridSize, 0.2, vertices);
+
+		if (cloudA && cloudB && mesh)
+		{
+			RunCloudBenchmarks(cloudA, "synthetic", options, log);
+			RunCloud2CloudBenchmark(cloudA, cloudB, "synthetic", options, log);
+			RunCloud2MeshBenchmark(cloudA, mesh, "synthetic", options, log);
+		}
+		else
+		{
+			fprintf(stderr, "Not enough memory to generate the synthetic datasets (%u points)\n", options.pointCount);
+		}
+
+		delete mesh;
+		delete vertices;
+		delete cloudA;
+		delete cloudB;
+	}
+
+	if (!loadUserClouds)
+		return;
+
+	for (size_t i = 0; i < options.cloudFiles.size(); ++i)
+	{
+		const std::string& filename = options.cloudFiles[i];
+		ChunkedPointCloud* cloud = LoadASCIICloud(filename);
+		if (!cloud)
+		{
+			fprintf(stderr, "Failed to load cloud '%s'\n", filename.c_str());
+			continue;
+		}
+
+		std::string name = ShortName(filename);
+		RunCloudBenchmarks(cloud, name, options, log);
+
+		//C2C: even points vs odd points
+		ChunkedPointCloud even, odd;
+		if (SplitCloud(cloud, even, odd))
+			RunCloud2CloudBenchmark(&even, &odd, name, options, log);
+
+		delete cloud;
+	}
+}
+
+} //namespace ccBenchmark
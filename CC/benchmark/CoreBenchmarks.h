@@ -0,0 +1,63 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_CORE_BENCHMARKS_HEADER
+#define CC_CORE_BENCHMARKS_HEADER
+
+#include "BenchmarkTools.h"
+
+namespace CCLib
+{
+	class ChunkedPointCloud;
+	class GenericIndexedMesh;
+}
+
+namespace ccBenchmark
+{
+
+//! Times the per-cloud algorithms of CCLib
+/** Octree build, spherical/cylindrical/kNN neighbourhood extraction,
+	least squares normals, subsampling, density and roughness (in-core
+	and out-of-core). The cloud current scalar field is overwritten.
+**/
+void RunCloudBenchmarks(CCLib::ChunkedPointCloud* cloud,
+						const std::string& cloudName,
+						const Options& options,
+						ResultsLog& log);
+
+//! Times the cloud-to-cloud distances computation (in-core and out-of-core)
+void RunCloud2CloudBenchmark(	CCLib::ChunkedPointCloud* comparedCloud,
+								CCLib::ChunkedPointCloud* referenceCloud,
+								const std::string& name,
+								const Options& options,
+								ResultsLog& log);
+
+//! Times the cloud-to-mesh distances computation
+void RunCloud2MeshBenchmark(CCLib::ChunkedPointCloud* comparedCloud,
+							CCLib::GenericIndexedMesh* mesh,
+							const std::string& name,
+							const Options& options,
+							ResultsLog& log);
+
+//! Runs all the CCLib benchmarks on the synthetic datasets and on the user clouds
+/** \param loadUserClouds whether user clouds should be loaded as ASCII files (standalone version)
+**/
+void RunCoreBenchmarks(const Options& options, ResultsLog& log, bool loadUserClouds);
+
+} //namespace ccBenchmark
+
+#endif //CC_CORE_BENCHMARKS_HEADER
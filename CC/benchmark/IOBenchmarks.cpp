@@ -0,0 +1,332 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "IOBenchmarks.h"
+#include "CoreBenchmarks.h"
+
+//CCLib
+#include <ChunkedPointCloud.h>
+#include <SimpleMesh.h>
+
+//qCC_db
+#include <ccHObjectCaster.h>
+#include <ccLog.h>
+#include <ccMesh.h>
+#include <ccPointCloud.h>
+#include <ccScalarField.h>
+
+//qCC_io
+#include <AsciiFilter.h>
+#include <BinFilter.h>
+#include <E57Filter.h>
+#include <FileIOFilter.h>
+#include <LASFilter.h>
+#include <ObjFilter.h>
+#include <PlyFilter.h>
+#include <STLFilter.h>
+
+//Qt
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+//system
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+namespace ccBenchmark
+{
+
+static const char SUITE_IO[] = "io";
+
+//! Console log (warnings and errors only, so as not to pollute the results)
+class StdOutLog : public ccLog
+{
+protected:
+	virtual void displayMessage(const QString& message, int level)
+	{
+		if (level & LOG_DEBUG)
+			return;
+		if (level & (LOG_WARNING | LOG_ERROR))
+		{
+			fprintf(stderr, "%s\n", qPrintable(message));
+		}
+	}
+};
+
+static StdOutLog s_log;
+
+void InitIO()
+{
+	ccLog::RegisterInstance(&s_log);
+	FileIOFilter::InitInternalFilters();
+}
+
+//! Returns loading parameters that never require any user interaction
+static FileIOFilter::LoadParameters SilentLoadParameters()
+{
+	FileIOFilter::LoadParameters parameters;
+	parameters.alwaysDisplayLoadDialog = false;
+	parameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG_AUTO_SHIFT;
+	parameters.autoComputeNormals = ccGriddedTools::NEVER;
+	return parameters;
+}
+
+//! Counts the points of all the clouds (or the triangles of all the meshes) in a hierarchy
+static unsigned CountElements(ccHObject* entity, bool meshes)
+{
+	ccHObject::Container children;
+	if (entity->isA(meshes ? CC_TYPES::MESH : CC_TYPES::POINT_CLOUD))
+		children.push_back(entity);
+	entity->filterChildren(children, true, meshes ? CC_TYPES::MESH : CC_TYPES::POINT_CLOUD, true);
+
+	unsigned count = 0;
+	for (size_t i = 0; i < children.size(); ++i)
+	{
+		if (meshes)
+		{
+			ccGenericMesh* mesh = ccHObjectCaster::ToGenericMesh(children[i]);
+			if (mesh)
+				count += mesh->size();
+		}
+		else
+		{
+			ccGenericPointCloud* cloud = ccHObjectCaster::ToGenericPointCloud(children[i]);
+			if (cloud)
+				count += cloud->size();
+		}
+	}
+	return count;
+}
+
+//! Context of the I/O tests
+struct IOContext
+{
+	IOContext() : entity(0), meshes(false) {}
+
+	ccHObject* entity;
+	QString filename;
+	QString fileFilter;
+	bool meshes;
+};
+
+static bool TestSave(void* _context, double& value)
+{
+	IOContext& context = *static_cast<IOContext*>(_context);
+
+	FileIOFilter::SaveParameters parameters;
+	parameters.alwaysDisplaySaveDialog = false;
+	if (FileIOFilter::SaveToFile(context.entity, context.filename, parameters, context.fileFilter) != CC_FERR_NO_ERROR)
+		return false;
+
+	value = static_cast<double>(QFileInfo(context.filename).size()) / (1 << 20); //in Mb
+	return true;
+}
+
+static bool TestLoad(void* _context, double& value)
+{
+	IOContext& context = *static_cast<IOContext*>(_context);
+
+	FileIOFilter::LoadParameters parameters = SilentLoadParameters();
+	ccHObject* loaded = FileIOFilter::LoadFromFile(context.filename, parameters, context.fileFilter);
+	if (!loaded)
+		return false;
+
+	value = CountElements(loaded, context.meshes);
+	delete loaded;
+	return true;
+}
+
+//! Saves then reloads an entity with a given filter (if available)
+static void RunSaveAndLoad(	ccHObject* entity,
+							const std::string& name,
+							unsigned points,
+							const QString& fileFilter,
+							bool meshes,
+							const Options& options,
+							ResultsLog& log)
+{
+	FileIOFilter::Shared filter = FileIOFilter::GetFilter(fileFilter, false);
+	if (!filter)
+		return; //filter not available in this build
+
+	IOContext context;
+	context.entity = entity;
+	context.fileFilter = fileFilter;
+	context.meshes = meshes;
+	context.filename = QDir(QString::fromLocal8Bit(options.tempDir.c_str())).absoluteFilePath(QString("cc_benchmark_%1.%2").arg(meshes ? "mesh" : "cloud").arg(filter->getDefaultExtension()));
+
+	std::string format = filter->getDefaultExtension().toStdString();
+	RunTest(log, options, SUITE_IO, "save_" + format, name, points, "size_mb", TestSave, &context);
+	if (QFile::exists(context.filename))
+	{
+		RunTest(log, options, SUITE_IO, "load_" + format, name, points, std::string(), TestLoad, &context);
+		QFile::remove(context.filename);
+	}
+}
+
+void RunIOBenchmarks(const Options& options, ResultsLog& log)
+{
+	//synthetic cloud (with one scalar field)
+	{
+		CCLib::ChunkedPointCloud* source = CreateSyntheticCloud(options.pointCount, options.seed, 0.05, 0.0);
+		ccPointCloud* cloud = source ? ccPointCloud::From(source) : 0;
+		delete source;
+
+		if (cloud)
+		{
+			int sfIdx = cloud->addScalarField("Height");
+			if (sfIdx >= 0)
+			{
+				CCLib::ScalarField* sf = cloud->getScalarField(sfIdx);
+				for (unsigned i = 0; i < cloud->size(); ++i)
+					sf->setValue(i, static_cast<ScalarType>(cloud->getPoint(i)->z));
+				sf->computeMinAndMax();
+				cloud->setCurrentDisplayedScalarField(sfIdx);
+			}
+
+			QStringList cloudFilters;
+			cloudFilters << BinFilter::GetFileFilter()
+						<< AsciiFilter::GetFileFilter()
+						<< PlyFilter::GetFileFilter()
+						<< LASFilter::GetFileFilter()
+						<< E57Filter::GetFileFilter();
+			for (int i = 0; i < cloudFilters.size(); ++i)
+				RunSaveAndLoad(cloud, "synthetic", cloud->size(), cloudFilters[i], false, options, log);
+
+			delete cloud;
+		}
+		else
+		{
+			fprintf(stderr, "Not enough memory to generate the synthetic cloud (%u points)\n", options.pointCount);
+		}
+	}
+
+	//synthetic mesh
+	{
+		CCLib::ChunkedPointCloud* sourceVertices = 0;
+		unsigned gridSize = std::max<unsigned>(2, static_cast<unsigned>(sqrt(options.pointCount / 2.0)));
+		CCLib::SimpleMesh* source = CreateSyntheticMesh(gridSize, 0.0, sourceVertices);
+		ccPointCloud* vertices = sourceVertices ? ccPointCloud::From(sourceVertices) : 0;
+		ccMesh* mesh = 0;
+		if (source && vertices)
+		{
+			mesh = new ccMesh(source, vertices);
+			mesh->addChild(vertices);
+			vertices = 0;
+		}
+		delete source;
+		delete sourceVertices;
+		delete vertices;
+
+		if (mesh && mesh->size() != 0)
+		{
+			QStringList meshFilters;
+			meshFilters << BinFilter::GetFileFilter()
+						<< PlyFilter::GetFileFilter()
+						<< STLFilter::GetFileFilter()
+						<< ObjFilter::GetFileFilter();
+			for (int i = 0; i < meshFilters.size(); ++i)
+				RunSaveAndLoad(mesh, "synthetic_mesh", mesh->size(), meshFilters[i], true, options, log);
+		}
+		else
+		{
+			fprintf(stderr, "Not enough memory to generate the synthetic mesh\n");
+		}
+
+		delete mesh;
+	}
+}
+
+void RunUserFilesBenchmarks(const Options& options, ResultsLog& log)
+{
+	ccHObject* firstCloudContainer = 0;
+	ccPointCloud* firstCloud = 0;
+
+	for (size_t i = 0; i < options.cloudFiles.size(); ++i)
+	{
+		IOContext context;
+		context.filename = QString::fromLocal8Bit(options.cloudFiles[i].c_str());
+		std::string name = ShortName(options.cloudFiles[i]);
+		RunTest(log, options, SUITE_IO, "load_user", name, 0, std::string(), TestLoad, &context);
+
+		FileIOFilter::LoadParameters parameters = SilentLoadParameters();
+		ccHObject* container = FileIOFilter::LoadFromFile(context.filename, parameters);
+		if (!container)
+			continue;
+
+		ccHObject::Container clouds;
+		if (container->isA(CC_TYPES::POINT_CLOUD))
+			clouds.push_back(container);
+		container->filterChildren(clouds, true, CC_TYPES::POINT_CLOUD, true);
+
+		for (size_t j = 0; j < clouds.size(); ++j)
+		{
+			ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(clouds[j]);
+			if (!cloud)
+				continue;
+
+			std::string cloudName = clouds.size() > 1 ? name + "#" + ToString(static_cast<double>(j)) : name;
+			RunCloudBenchmarks(cloud, cloudName, options, log);
+
+			if (!firstCloud)
+			{
+				firstCloud = cloud;
+				firstCloudContainer = container;
+			}
+		}
+
+		if (container != firstCloudContainer)
+			delete container;
+	}
+
+	for (size_t i = 0; i < options.meshFiles.size(); ++i)
+	{
+		IOContext context;
+		context.filename = QString::fromLocal8Bit(options.meshFiles[i].c_str());
+		context.meshes = true;
+		std::string name = ShortName(options.meshFiles[i]);
+		RunTest(log, options, SUITE_IO, "load_user_mesh", name, 0, std::string(), TestLoad, &context);
+
+		if (!firstCloud)
+			continue;
+
+		FileIOFilter::LoadParameters parameters = SilentLoadParameters();
+		ccHObject* container = FileIOFilter::LoadFromFile(context.filename, parameters);
+		if (!container)
+			continue;
+
+		ccHObject::Container meshes;
+		if (container->isA(CC_TYPES::MESH))
+			meshes.push_back(container);
+		container->filterChildren(meshes, true, CC_TYPES::MESH, true);
+
+		for (size_t j = 0; j < meshes.size(); ++j)
+		{
+			ccGenericMesh* mesh = ccHObjectCaster::ToGenericMesh(meshes[j]);
+			if (mesh && mesh->size() != 0)
+				RunCloud2MeshBenchmark(firstCloud, mesh, ShortName(options.cloudFiles.front()) + "/" + name, options, log);
+		}
+
+		delete container;
+	}
+
+	delete firstCloudContainer;
+}
+
+} //namespace ccBenchmark
@@ -0,0 +1,40 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_IO_BENCHMARKS_HEADER
+#define CC_IO_BENCHMARKS_HEADER
+
+#include "BenchmarkTools.h"
+
+namespace ccBenchmark
+{
+
+//! Initializes the qCC_io filters and redirects the CC log to the standard output
+void InitIO();
+
+//! Times the main file I/O filters (save + load) on the synthetic datasets
+void RunIOBenchmarks(const Options& options, ResultsLog& log);
+
+//! Loads the user clouds and meshes with the qCC_io filters and benchmarks them
+/** Same tests as RunCoreBenchmarks for clouds (plus the loading time),
+	and cloud-to-mesh distances between the first user cloud and each mesh.
+**/
+void RunUserFilesBenchmarks(const Options& options, ResultsLog& log);
+
+} //namespace ccBenchmark
+
+#endif //CC_IO_BENCHMARKS_HEADER
@@ -0,0 +1,240 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Headless benchmark of CCLib (and of the qCC_io filters if available)
+//
+//Usage: CCBenchmark [options]
+//	-POINTS {n}         number of points of the synthetic clouds (default: 1000000)
+//	-REPEAT {n}         number of repetitions of each test (default: 3)
+//	-QUERIES {n}        number of random queries for the neighbourhood tests (default: 10000)
+//	-KNN {n}            number of neighbours for the kNN and normals tests (default: 12)
+//	-OCTREE_LEVEL {n}   octree level for the distances/subsampling tests (default: automatic)
+//	-RADIUS {r}         neighbourhood radius (default: automatic)
+//	-SEED {n}           seed of the synthetic datasets (default: 1)
+//	-CLOUD {file}       user cloud (can be repeated - ASCII 'X Y Z' only without qCC_io)
+//	-MESH {file}        user mesh (can be repeated - only with qCC_io)
+//	-OUTPUT {file}      CSV file to which the results are appended
+//	-LABEL {text}       label of the run in the CSV file (version, machine, etc.)
+//	-OOC_MEMORY {Mb}    memory limit of the out-of-core octree tests (default: 64)
+//	-TEMP_DIR {folder}  folder for the temporary I/O and out-of-core files (default: current folder)
+//	-SINGLE_THREAD      disable multi-threading
+//	-OCTREE_POINTS_COPY keep a copy of the points in cell code order in the shared octree
+//	-NO_IO              skip the I/O filters tests
+//
+//With Qt5 on a machine without display, add '-platform offscreen' to the arguments.
+
+#include "BenchmarkTools.h"
+#include "CoreBenchmarks.h"
+
+//CCLib
+#include <DgmOctree.h>
+
+#ifdef CC_BENCHMARK_WITH_IO
+#include "IOBenchmarks.h"
+
+//Qt
+#include <QApplication>
+#endif
+
+//system
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace ccBenchmark;
+
+static bool IsCommand(const char* arg, const char* command)
+{
+	if (arg[0] != '-')
+		return false;
+#ifdef _MSC_VER
+	return _stricmp(arg + 1, command) == 0;
+#else
+	return strcasecmp(arg + 1, command) == 0;
+#endif
+}
+
+static bool ReadUnsigned(int argc, char** argv, int& i, unsigned& value)
+{
+	if (i + 1 >= argc)
+		return false;
+	char* end = 0;
+	long v = strtol(argv[++i], &end, 10);
+	if (*end != '\0' || v < 0)
+		return false;
+	value = static_cast<unsigned>(v);
+	return true;
+}
+
+static void PrintUsage()
+{
+	printf("Usage: CCBenchmark [-POINTS n] [-REPEAT n] [-QUERIES n] [-KNN n] [-OCTREE_LEVEL n] [-RADIUS r] [-SEED n] [-OOC_MEMORY Mb]\n");
+	printf("                   [-CLOUD file]* [-MESH file]* [-OUTPUT file.csv] [-LABEL text] [-TEMP_DIR folder]\n");
+	printf("                   [-SINGLE_THREAD] [-OCTREE_POINTS_COPY] [-NO_IO]\n");
+}
+
+int main(int argc, char** argv)
+{
+#ifdef CC_BENCHMARK_WITH_IO
+	//the I/O filters may need it (progress dialogs, etc.) - Qt arguments are removed from argc/argv
+	QApplication app(argc, argv);
+#endif
+
+	Options options;
+	options.label = "default";
+	options.tempDir = ".";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		bool valid = true;
+		unsigned value = 0;
+
+		if (IsCommand(arg, "POINTS"))
+		{
+			valid = ReadUnsigned(argc, argv, i, options.pointCount) && options.pointCount != 0;
+		}
+		else if (IsCommand(arg, "REPEAT"))
+		{
+			valid = ReadUnsigned(argc, argv, i, options.repetitions) && options.repetitions != 0;
+		}
+		else if (IsCommand(arg, "QUERIES"))
+		{
+			valid = ReadUnsigned(argc, argv, i, options.queryCount);
+		}
+		else if (IsCommand(arg, "KNN"))
+		{
+			valid = ReadUnsigned(argc, argv, i, options.knn) && options.knn != 0;
+		}
+		else if (IsCommand(arg, "OCTREE_LEVEL"))
+		{
+			valid = ReadUnsigned(argc, argv, i, value) && value <= 21; //see DgmOctree::MAX_OCTREE_LEVEL
+			options.octreeLevel = static_cast<unsigned char>(value);
+		}
+		else if (IsCommand(arg, "OOC_MEMORY"))
+		{
+			valid = ReadUnsigned(argc, argv, i, options.outOfCoreMemoryMb) && options.outOfCoreMemoryMb != 0;
+		}
+		else if (IsCommand(arg, "SEED"))
+		{
+			valid = ReadUnsigned(argc, argv, i, options.seed);
+		}
+		else if (IsCommand(arg, "RADIUS"))
+		{
+			valid = (i + 1 < argc);
+			if (valid)
+			{
+				options.radius = atof(argv[++i]);
+				valid = (options.radius > 0);
+			}
+		}
+		else if (IsCommand(arg, "CLOUD") || IsCommand(arg, "MESH") || IsCommand(arg, "OUTPUT") || IsCommand(arg, "LABEL") || IsCommand(arg, "TEMP_DIR"))
+		{
+			valid = (i + 1 < argc);
+			if (valid)
+			{
+				std::string param(argv[++i]);
+				if (IsCommand(arg, "CLOUD"))
+					options.cloudFiles.push_back(param);
+				else if (IsCommand(arg, "MESH"))
+					options.meshFiles.push_back(param);
+				else if (IsCommand(arg, "OUTPUT"))
+					options.outputFile = param;
+				else if (IsCommand(arg, "LABEL"))
+					options.label = param;
+				else
+					options.tempDir = param;
+			}
+		}
+		else if (IsCommand(arg, "SINGLE_THREAD"))
+		{
+			options.multiThread = false;
+		}
+		else if (IsCommand(arg, "OCTREE_POINTS_COPY"))
+		{
+			options.codeOrderedPoints = true;
+		}
+		else if (IsCommand(arg, "NO_IO"))
+		{
+			options.withIO = false;
+		}
+		else if (IsCommand(arg, "HELP") || IsCommand(arg, "H"))
+		{
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			fprintf(stderr, "Invalid or incomplete argument: '%s'\n", arg);
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	//without multi-threading support (e.g. CCLib built without Qt), all the algorithms run on a single thread anyway
+	if (options.multiThread && !CCLib::DgmOctree::MultiThreadSupport())
+	{
+		options.multiThread = false;
+	}
+
+	{
+		char dateStr[64] = { 0 };
+		time_t now = time(0);
+		strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S", localtime(&now));
+		printf("CCLib benchmark '%s' - %s - %u points - %u repetition(s) - %s\n",
+			options.label.c_str(),
+			dateStr,
+			options.pointCount,
+			options.repetitions,
+			options.multiThread ? "multi-threaded" : (CCLib::DgmOctree::MultiThreadSupport() ? "single-threaded" : "single-threaded (no multi-threading support)"));
+	}
+
+	ResultsLog log(options.label);
+
+#ifdef CC_BENCHMARK_WITH_IO
+	InitIO();
+	//user files are loaded with the qCC_io filters
+	RunCoreBenchmarks(options, log, false);
+	RunUserFilesBenchmarks(options, log);
+	if (options.withIO)
+		RunIOBenchmarks(options, log);
+#else
+	if (!options.meshFiles.empty())
+		fprintf(stderr, "User meshes are ignored (no I/O support in this build)\n");
+	RunCoreBenchmarks(options, log, true);
+#endif
+
+	if (!options.outputFile.empty())
+	{
+		if (log.writeCSV(options.outputFile))
+			printf("Results appended to '%s'\n", options.outputFile.c_str());
+		else
+			fprintf(stderr, "Failed to write results to '%s'\n", options.outputFile.c_str());
+	}
+
+	unsigned failed = log.failedCount();
+	if (failed)
+		fprintf(stderr, "%u test(s) failed\n", failed);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
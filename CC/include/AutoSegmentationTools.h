@@ -21,6 +21,7 @@
 //Local
 #include "CCCoreLib.h"
 #include "CCToolbox.h"
+#include "DgmOctree.h"
 #include "ReferenceCloud.h"
 
 namespace CCLib
@@ -28,7 +29,6 @@ namespace CCLib
 
 class GenericIndexedCloudPersist;
 class GenericProgressCallback;
-class DgmOctree;
 
 //! A standard container to store several subsets of points
 /** Several algorithms of the AutoSegmentationTools toolbox return a collection of subsets of points
@@ -60,13 +60,15 @@ public:
 		\param sixConnexity indicates if the CC's 3D connexity should be 6 (26 otherwise)
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param inputOctree the cloud octree if it has already been computed
+		\param[out] componentsInfo (optional) number of points and bounding box of each component (see DgmOctree::extractCCs)
 		\return error code (see DgmOctree::extractCCs)
 	**/
 	static int labelConnectedComponents(GenericIndexedCloudPersist* theCloud,
 										unsigned char level,
 										bool sixConnexity = false,
 										CCLib::GenericProgressCallback* progressCb = 0,
-										CCLib::DgmOctree* inputOctree = 0);
+										CCLib::DgmOctree* inputOctree = 0,
+										std::vector<DgmOctree::ConnectedComponentInfo>* componentsInfo = 0);
 
 	//! Extracts connected components from a point cloud
 	/** This method shloud only be called after the connected components have been
@@ -68,6 +68,30 @@ public:
 								size_t pointCountToUse = 0,
 								char* outputErrorStr = 0);
 
+	//! Build the Delaunay mesh on top a set of 2D points, tile by tile, and removes the triangles with too long edges
+	/** The 2D domain is split in a regular grid of tiles, and each tile is triangulated
+		separately (concurrently if possible) along with the points lying in a margin around it.
+		A tile only keeps the triangles it 'owns' (i.e. whose circumcenter, clamped to the
+		triangle bounding box, falls inside the tile) and that are not too long. Each kept
+		triangle is checked against the tile margin (its circumcircle shouldn't contain any
+		point outside the tile and its margin), otherwise the tile is triangulated again with
+		a larger margin. The result is therefore the same as buildMesh followed by
+		removeTrianglesWithEdgesLongerThan (apart from the arbitrary choices made by
+		Triangle lib. for co-circular points), but with a much smaller memory footprint.
+		If the mesh is already associated to a cloud (see linkMeshWith), the edges length is
+		measured on the (3D) points of this cloud, as in removeTrianglesWithEdgesLongerThan.
+		Otherwise the 2D points are used.
+		\param points2D a set of 2D points
+		\param maxEdgeLength max edge length of the output triangles (should be strictly positive)
+		\param tileCount approximate number of tiles (0 = automatic)
+		\param outputErrorStr error string as output by Triangle lib. (if any) [optional]
+		\return success
+	**/
+	virtual bool buildMeshByTiles(	const std::vector<CCVector2>& points2D,
+									PointCoordinateType maxEdgeLength,
+									unsigned tileCount = 0,
+									char* outputErrorStr = 0);
+
 	//! Build the Delaunay mesh from a set of 2D polylines
 	/** \param points2D a set of 2D points
 		\param segments2D constraining segments (as 2 indexes per segment)
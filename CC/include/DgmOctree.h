@@ -938,6 +938,72 @@ public:
 	**/
 	double computeMeanOctreeDensity(unsigned char level) const;
 
+	//! Default memory budget of the cells index tables (in bytes)
+	static const size_t DEFAULT_CELLS_INDEX_TABLES_MAX_MEMORY = (size_t(512) << 20);
+
+	//! Builds (if necessary) the compact cells index table of a given level of subdivision
+	/** This table (one entry per cell: code, index of the first point and number of points,
+		plus a hashed or direct-indexed lookup table) lets the neighbour cells lookups
+		(getCellIndex, and therefore the nearest neighbours, spherical and cylindrical
+		extractions) avoid a binary search over the whole octree structure. It is built
+		automatically by executeFunctionForAllCellsAtLevel. The other levels tables may be
+		released so as to respect the memory budget (see setCellsIndexTablesMaxMemory).
+		Warning: not thread-safe (no other thread should query the octree meanwhile).
+		\param level the level of subdivision
+		\return whether the table is available (it may not be if the budget is too small)
+	**/
+	bool prepareCellsIndexTable(unsigned char level);
+
+	//! Returns whether the cells index table of a given level is available
+	bool hasCellsIndexTable(unsigned char level) const { return m_cellsIndexTables[level] != 0; }
+
+	//! Releases all the cells index tables
+	/** Warning: not thread-safe (no other thread should query the octree meanwhile).
+	**/
+	void releaseCellsIndexTables();
+
+	//! Returns the memory currently used by the cells index tables (in bytes)
+	size_t getCellsIndexTablesMemoryUsage() const;
+
+	//! Sets the memory budget of the cells index tables (in bytes)
+	/** The tables are released if necessary (0 = no table at all).
+		Warning: not thread-safe (no other thread should query the octree meanwhile).
+	**/
+	void setCellsIndexTablesMaxMemory(size_t maxMemory);
+
+	//! Returns the memory budget of the cells index tables (in bytes)
+	size_t getCellsIndexTablesMaxMemory() const { return m_cellsIndexTablesMaxMemory; }
+
+	//! Enables or disables the copy of the points coordinates in cell code order
+	/** When enabled, the octree keeps a contiguous copy of the points coordinates sorted
+		like the octree structure, so that the neighbourhood extraction methods read the
+		points of a cell linearly instead of jumping across the cloud. The extracted
+		neighbours (PointDescriptor::point) then point to this copy. It costs 3 coordinates
+		per point.
+		The copy is updated each time the octree is built, but not if the cloud points are
+		modified afterwards (call this method again in this case). The scalar values are
+		always read from the cloud.
+		The cloud-to-cloud distance, local density and roughness computations enable the
+		copy for their own duration (if there's enough memory).
+		Warning: not thread-safe (no other thread should query the octree meanwhile).
+		\param state whether to keep the copy or not
+		\return false if there's not enough memory (the copy is disabled in this case)
+	**/
+	bool setCodeOrderedPointsCopy(bool state);
+
+	//! Returns whether the copy of the points coordinates in cell code order is enabled
+	inline bool codeOrderedPointsCopyEnabled() const { return m_codeOrderedPointsCopyEnabled; }
+
+	//! Returns the copy of the points coordinates in cell code order (or 0 if disabled)
+	/** The points are stored in the same order as the octree structure: for instance, the
+		points of a cell processed by executeFunctionForAllCellsAtLevel are the
+		octreeCell::points->size() ones starting at octreeCell::index.
+	**/
+	inline const CCVector3* getCodeOrderedPoints() const { return m_codeOrderedPoints.empty() ? 0 : &m_codeOrderedPoints[0]; }
+
+	//! Returns the memory used by the copy of the points in cell code order (in bytes)
+	size_t getCodeOrderedPointsCopyMemoryUsage() const;
+
 	//! Computes the minimal distance between a point and the borders (faces) of the cell (cube) in which it is included
 	/** \param queryPoint the point
 		\param cs the cell size (as cells are cubical, it's the same along every dimension)
@@ -957,15 +1023,33 @@ public:
 
 	/**** ADVANCED METHODS ****/
 
+	//! Connected component description (see DgmOctree::extractCCs)
+	struct ConnectedComponentInfo
+	{
+		//! Number of points
+		unsigned pointCount;
+		//! Number of octree cells
+		unsigned cellCount;
+		//! Bounding box (min corner)
+		CCVector3 bbMin;
+		//! Bounding box (max corner)
+		CCVector3 bbMax;
+	};
+
 	//! Computes the connected components (considering the octree cells only) for a given level of subdivision (partial)
 	/** The octree is seen as a regular 3D grid, and each cell of this grid is either set to 0
 		(if no points lies in it) or to 1 (if some points lie in it, e.g. if it is indeed a
 		cell of this octree). This version of the algorithm can be applied by considering only
 		a specified list of octree cells (ignoring the others).
+		The grid slices are labelled by slabs (concurrently if possible) and the components
+		are merged across the slabs borders with a union-find structure. The labels (stored
+		as scalar values) are numbered in the order of the components first cell, whatever
+		the number of slabs.
 		\param cellCodes the cell codes to consider for the CC computation
 		\param level the level of subdivision at which to perform the algorithm
 		\param sixConnexity indicates if the CC's 3D connexity should be 6 (26 otherwise)
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param[out] componentsInfo (optional) number of points, number of cells and bounding box of each component (component 'i' has label 'i+1')
 		\return error code:
 			- '+0' = OK
 			- '-1' = no cells (input)
@@ -975,7 +1059,8 @@ public:
 	int extractCCs(	const cellCodesContainer& cellCodes,
 					unsigned char level,
 					bool sixConnexity,
-					GenericProgressCallback* progressCb = 0) const;
+					GenericProgressCallback* progressCb = 0,
+					std::vector<ConnectedComponentInfo>* componentsInfo = 0) const;
 
 	//! Computes the connected components (considering the octree cells only) for a given level of subdivision (complete)
 	/** The octree is seen as a regular 3D grid, and each cell of this grid is either set to 0
@@ -985,6 +1070,7 @@ public:
 		\param level the level of subdivision at which to perform the algorithm
 		\param sixConnexity indicates if the CC's 3D connexity should be 6 (26 otherwise)
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param[out] componentsInfo (optional) number of points, number of cells and bounding box of each component (component 'i' has label 'i+1')
 		\return error code:
 			- '+0' = OK
 			- '-1' = no cells (input)
@@ -993,7 +1079,8 @@ public:
 	**/
 	int extractCCs(	unsigned char level,
 					bool sixConnexity,
-					GenericProgressCallback* progressCb = 0) const;
+					GenericProgressCallback* progressCb = 0,
+					std::vector<ConnectedComponentInfo>* componentsInfo = 0) const;
 
 	/**** OCTREE VISITOR ****/
 
@@ -1115,6 +1202,18 @@ protected:
 	//! Std. dev. of cell population per level of subdivision
 	double m_stdDevCellPopulation[MAX_OCTREE_LEVEL+1];
 
+	//! Compact cells index table (see prepareCellsIndexTable)
+	struct CellsIndexTable;
+	//! Cells index tables (per level of subdivision - built on demand)
+	CellsIndexTable* m_cellsIndexTables[MAX_OCTREE_LEVEL+1];
+	//! Memory budget of the cells index tables
+	size_t m_cellsIndexTablesMaxMemory;
+
+	//! Points coordinates in cell code order (see setCodeOrderedPointsCopy)
+	std::vector<CCVector3> m_codeOrderedPoints;
+	//! Whether the copy of the points in cell code order is enabled
+	bool m_codeOrderedPointsCopyEnabled;
+
 	/******************************/
 	/**         METHODS          **/
 	/******************************/
@@ -1141,6 +1240,15 @@ protected:
 	**/
 	void computeCellsStatistics(unsigned char level);
 
+	//! Releases the biggest cells index tables until 'required' more bytes fit in the memory budget
+	void trimCellsIndexTables(size_t required);
+
+	//! Updates the copy of the points in cell code order
+	bool updateCodeOrderedPointsCopy();
+
+	//! Returns the point corresponding to an element of the octree structure (reads the copy in cell code order if available)
+	inline const CCVector3* getCodeOrderedPoint(cellsContainer::const_iterator p) const;
+
 	//! Returns the indexes of the neighbourhing (existing) cells of a given cell
 	/** This function is used by the nearest neighbours search algorithms.
 		\param cellPos the query cell
@@ -1169,7 +1277,8 @@ protected:
 #endif
 
 	//! Returns the index of a given cell represented by its code
-	/** The index is found thanks to a binary search. The index of an existing cell
+	/** The index is found thanks to the cells index table of the corresponding level if
+		it has been prepared, or a binary search otherwise. The index of an existing cell
 		is between 0 and the number of points projected in the octree minus 1. If
 		the cell code cannot be found in the octree structure, then the method returns
 		an index equal to the number of projected points (m_numberOfProjectedPoints).
@@ -23,6 +23,7 @@
 #include "CCToolbox.h"
 #include "CCConst.h"
 #include "DgmOctree.h"
+#include "OutOfCoreOctree.h"
 
 namespace CCLib
 {
@@ -33,6 +34,8 @@ class GenericCloud;
 class GenericIndexedCloudPersist;
 class ReferenceCloud;
 class GenericProgressCallback;
+class ScalarField;
+class TriangleBVH;
 struct OctreeAndMeshIntersection;
 
 //! Several entity-to-entity distances computation algorithms (cloud-cloud, cloud-mesh, point-triangle, etc.)
@@ -166,6 +169,149 @@ public: //distance to clouds or meshes
 											GenericProgressCallback* progressCb = 0,
 											DgmOctree* cloudOctree = 0);
 
+	//! Computes the exact distance between a point cloud and a mesh with a Bounding Volume Hierarchy
+	/** Alternative to computeCloud2MeshDistance: instead of intersecting the mesh with the
+		octree of the compared cloud, the nearest triangle of each point is searched in a BVH
+		built over the mesh triangles (see TriangleBVH). No octree level is required, and the
+		memory consumption only depends on the number of triangles (which makes it well suited
+		to large, thin or very unevenly tessellated meshes). The points are processed by
+		batches (in parallel if multiThread is true).
+		\param pointCloud the compared cloud (the distances will be computed on these points)
+		\param theMesh the reference mesh (the distances will be computed relatively to its triangles)
+		\param maxSearchDist if greater than 0 (default value: '-1'), the points farther than this distance will get this distance as value
+		\param signedDistances if true, the computed distances will be signed (relatively to the nearest triangle normal)
+		\param flipNormals specify whether triangle normals should be computed in the 'direct' order (true) or 'indirect' (false)
+		\param multiThread specify whether to use multi-thread or single thread mode
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param bvh a pre-computed BVH of the mesh triangles (it is automatically computed if 0)
+		\return 0 if ok, a negative value otherwise
+	**/
+	static int computeCloud2MeshDistanceWithBVH(GenericIndexedCloudPersist* pointCloud,
+												GenericIndexedMesh* theMesh,
+												ScalarType maxSearchDist = -1.0,
+												bool signedDistances = false,
+												bool flipNormals = false,
+												bool multiThread = true,
+												GenericProgressCallback* progressCb = 0,
+												const TriangleBVH* bvh = 0);
+
+	//! Computes the "nearest neighbour distance" between two point clouds with out-of-core octrees
+	/** Same as computeCloud2CloudDistance (without local modeling) but the points are read from
+		the octrees files (with a bounded octree memory footprint). The reference points are
+		read by growing neighbourhoods of cells around each compared cell, until the nearest
+		neighbour of each compared point is certain to have been found. The distances are stored
+		in the compared octree (see OutOfCoreOctree::exportValues).
+		\param comparedOctree the out-of-core octree of the compared cloud
+		\param referenceOctree the out-of-core octree of the reference cloud (warning: both octrees must have the same cubical bounding-box - see synchronizeOctrees)
+		\param octreeLevel the level of subdivision at which to apply the algorithm (0 = automatic)
+		\param maxSearchDist max search distance (the points farther than this are associated to this value) or any negative value
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return 0 if ok, a negative value otherwise
+	**/
+	static int computeCloud2CloudDistance(	OutOfCoreOctree* comparedOctree,
+											OutOfCoreOctree* referenceOctree,
+											unsigned char octreeLevel = 0,
+											ScalarType maxSearchDist = -1.0,
+											GenericProgressCallback* progressCb = 0);
+
+public: //robust distances along the local normals (M3C2-like)
+
+	//! M3C2-like distance computation parameters
+	/** See D. Lague, N. Brodu and J. Leroux, "Accurate 3D comparison of complex topography
+		with terrestrial laser scanner: application to the Rangitikei canyon (N-Z)", 2013.
+	**/
+	struct M3C2Params
+	{
+		//! Normal scales (diameters of the spherical neighbourhoods used to compute the normals)
+		/** If several scales are given, the scale giving the most planar neighbourhood
+			(i.e. the smallest surface variation) is used for each core point.
+		**/
+		std::vector<PointCoordinateType> normalScales;
+
+		//! Projection scale (diameter of the cylinders)
+		PointCoordinateType projectionScale;
+
+		//! Max depth (half length of the cylinders)
+		PointCoordinateType maxDepth;
+
+		//! Preferred orientation of the normals
+		CCVector3 preferredOrientation;
+
+		//! Registration error (added to the level of detection)
+		double registrationError;
+
+		//! Min number of points in each cylinder (the distance is not computed below)
+		unsigned minPointsPerCylinder;
+
+		//! Whether to use the median and the inter-quartile range instead of the mean and the standard deviation
+		bool useMedian;
+
+		//! Whether to use multi-thread or single thread mode
+		bool multiThread;
+
+		//! Output scalar fields (optional)
+		/** Each one must have already been resized (at least) to the number of core points.
+		**/
+		ScalarField* uncertaintySF;
+		ScalarField* significantChangeSF;
+		ScalarField* stdDev1SF;
+		ScalarField* stdDev2SF;
+		ScalarField* pointCount1SF;
+		ScalarField* pointCount2SF;
+		ScalarField* normalScaleSF;
+
+		//! Output normals (optional)
+		/** Must have already been resized (at least) to the number of core points.
+		**/
+		std::vector<CCVector3>* normals;
+
+		//! Default constructor/initialization
+		M3C2Params()
+			: projectionScale(0)
+			, maxDepth(0)
+			, preferredOrientation(0,0,1)
+			, registrationError(0)
+			, minPointsPerCylinder(5)
+			, useMedian(false)
+			, multiThread(true)
+			, uncertaintySF(0)
+			, significantChangeSF(0)
+			, stdDev1SF(0)
+			, stdDev2SF(0)
+			, pointCount1SF(0)
+			, pointCount2SF(0)
+			, normalScaleSF(0)
+			, normals(0)
+		{}
+	};
+
+	//! Computes M3C2-like distances between two point clouds
+	/** For each core point, a normal is computed on the first cloud (at one or several scales - see
+		M3C2Params::normalScales). The points of both clouds falling inside a cylinder oriented along
+		this normal are then extracted and the distance is the difference between their mean (or median)
+		positions along the normal. The uncertainty is the 95% level of detection:
+		LoD = 1.96 * sqrt(s1^2/n1 + s2^2/n2) + registration error.
+		The core points are generally a (spatially) subsampled version of the first cloud, so that
+		the process scales to very large clouds.
+		\warning The distances are stored in the current scalar field of the core points (NAN_VALUE if
+		the cylinders don't contain enough points)
+		\param corePoints the points on which the distances are computed
+		\param cloud1 the first (reference) cloud
+		\param cloud2 the second (compared) cloud
+		\param params distance computation parameters
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param octree1 the pre-computed octree of the first cloud (it is automatically computed if 0)
+		\param octree2 the pre-computed octree of the second cloud (it is automatically computed if 0)
+		\return 0 if ok, a negative value otherwise
+	**/
+	static int computeM3C2Distances(GenericIndexedCloudPersist* corePoints,
+									GenericIndexedCloudPersist* cloud1,
+									GenericIndexedCloudPersist* cloud2,
+									const M3C2Params& params,
+									GenericProgressCallback* progressCb = 0,
+									DgmOctree* octree1 = 0,
+									DgmOctree* octree2 = 0);
+
 public: //approximate distances to clouds or meshes
 
 	//! Computes approximate distances between two point clouds
@@ -324,6 +470,23 @@ public: //other methods
 											PointCoordinateType maxSearchDist = -PC_ONE,
 											GenericProgressCallback* progressCb = 0);
 
+	//! Builds two out-of-core octrees with the same cubical bounding-box
+	/** The bounding-box is the union of both clouds bounding-boxes. Both clouds are read once.
+		\param comparedCloud the compared cloud (can be streamed)
+		\param referenceCloud the reference cloud (can be streamed)
+		\param comparedOctree the compared cloud octree
+		\param referenceOctree the reference cloud octree
+		\param maxSearchDist max search distance (or any negative value if no max distance is defined)
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return return code
+	**/
+	static SOReturnCode synchronizeOctrees(	GenericCloud* comparedCloud,
+											GenericCloud* referenceCloud,
+											OutOfCoreOctree& comparedOctree,
+											OutOfCoreOctree& referenceOctree,
+											PointCoordinateType maxSearchDist = -PC_ONE,
+											GenericProgressCallback* progressCb = 0);
+
 	//! Returns whether multi-threading (parallel) computation is supported or not
 	static bool MultiThreadSupport();
 
@@ -373,6 +536,19 @@ protected:
 												void** additionalParameters,
 												NormalizedProgress* nProgress = 0);
 
+	//! Computes the "nearest neighbour distance" for all points of an out-of-core octree cell
+	/** This method has the generic syntax of a "cellular function" (see OutOfCoreOctree::octreeCellFunc).
+		There are 2 additional parameters :
+		- (OutOfCoreOctree*) the reference octree
+		- (ScalarType*) the max search distance (or -1)
+		\param cell structure describing the cell on which processing is applied
+		\param additionalParameters see method description
+		\param nProgress optional (normalized) progress notification (per-point)
+	**/
+	static bool computeCellHausdorffDistanceOutOfCore(	const OutOfCoreOctree::octreeCell& cell,
+														void** additionalParameters,
+														NormalizedProgress* nProgress = 0);
+
 	//! Computes the "nearest neighbour distance" with local modeling for all points of an octree cell
 	/** This method has the generic syntax of a "cellular function" (see DgmOctree::localFunctionPtr).
 		Specific parameters are transmitted via the "additionalParameters" structure.
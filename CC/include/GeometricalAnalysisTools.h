@@ -23,6 +23,7 @@
 #include "CCToolbox.h"
 #include "Neighbourhood.h"
 #include "DgmOctree.h"
+#include "OutOfCoreOctree.h"
 #include "SquareMatrix.h"
 
 namespace CCLib
@@ -103,6 +104,34 @@ public:
 								GenericProgressCallback* progressCb = 0,
 								DgmOctree* inputOctree = 0);
 
+	//! Computes the local density (at a given scale) with an out-of-core octree
+	/** Same as computeLocalDensity, but the points are read from the octree files
+		(with a bounded octree memory footprint). The densities are stored in
+		the octree (see OutOfCoreOctree::exportValues).
+		\param octree out-of-core octree (already built)
+		\param densityType the 'type' of density to compute
+		\param kernelRadius neighbouring sphere radius
+		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success (0) or error code (<0)
+	**/
+	static int computeLocalDensity(	OutOfCoreOctree* octree,
+									Density densityType,
+									PointCoordinateType kernelRadius,
+									GenericProgressCallback* progressCb = 0);
+
+	//! Computes the local roughness with an out-of-core octree
+	/** Same as computeRoughness, but the points are read from the octree files
+		(with a bounded octree memory footprint). The roughness values are
+		stored in the octree (see OutOfCoreOctree::exportValues).
+		\param octree out-of-core octree (already built)
+		\param kernelRadius neighbouring sphere radius
+		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success (0) or error code (<0)
+	**/
+	static int computeRoughness(OutOfCoreOctree* octree,
+								PointCoordinateType kernelRadius,
+								GenericProgressCallback* progressCb = 0);
+
 	//! Computes the gravity center of a point cloud
 	/** \warning this method uses the cloud global iterator
 		\param theCloud cloud
@@ -248,6 +277,24 @@ protected:
 														void** additionalParameters,
 														NormalizedProgress* nProgress = 0);
 
+	//! Computes point density inside a cell (out-of-core version)
+	/**	\param cell structure describing the cell on which processing is applied
+		\param additionalParameters see method description
+		\param nProgress optional (normalized) progress notification (per-point)
+	**/
+	static bool computePointsDensityInAnOutOfCoreCell(	const OutOfCoreOctree::octreeCell& cell,
+														void** additionalParameters,
+														NormalizedProgress* nProgress = 0);
+
+	//! Computes point roughness inside a cell (out-of-core version)
+	/**	\param cell structure describing the cell on which processing is applied
+		\param additionalParameters see method description
+		\param nProgress optional (normalized) progress notification (per-point)
+	**/
+	static bool computePointsRoughnessInAnOutOfCoreCell(const OutOfCoreOctree::octreeCell& cell,
+														void** additionalParameters,
+														NormalizedProgress* nProgress = 0);
+
 	//! Flags duplicate points inside a cell
 	/**	\param cell structure describing the cell on which processing is applied
 		\param additionalParameters see method description
@@ -123,11 +123,7 @@ public:
 			return false;
 		}
 
-		//cell dimension
-		CCVector3 halfCellDimensions(cellLength / 2, cellLength / 2, cellLength / 2);
-
 		std::vector<CellToTest> cellsToTest(1); //initial size must be > 0
-		unsigned cellsToTestCount = 0;
 
 		//number of triangles
 		unsigned numberOfTriangles = mesh->size();
@@ -156,160 +152,197 @@ public:
 												T->_getB(),
 												T->_getC() };
 
-			CCVector3 AB = (*triPoints[1]) - (*triPoints[0]);
-			CCVector3 BC = (*triPoints[2]) - (*triPoints[1]);
-			CCVector3 CA = (*triPoints[0]) - (*triPoints[2]);
+			if (!intersectWithTriangle(triPoints, cellLength, gridMinCorner, intersectValue, cellsToTest))
+			{
+				//out of memory
+				return false;
+			}
+
+			if (progressCb && !nProgress.oneStep())
+			{
+				//cancel by user
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//! Intersects this grid with a single triangle
+	/** The intersecting cells are all set to the same value, so that several
+		triangles can be processed concurrently (as long as each thread uses
+		its own 'cellsToTest' buffer).
+		\param triPoints triangle vertices
+		\param cellLength cell size
+		\param gridMinCorner grid min corner
+		\param intersectValue value of the intersecting cells
+		\param cellsToTest working buffer (initial size must be > 0)
+		\return false if not enough memory
+	**/
+	bool intersectWithTriangle(	const CCVector3* triPoints[3],
+								PointCoordinateType cellLength,
+								const CCVector3& gridMinCorner,
+								GridElement intersectValue,
+								std::vector<CellToTest>& cellsToTest)
+	{
+		//cell dimension
+		CCVector3 halfCellDimensions(cellLength / 2, cellLength / 2, cellLength / 2);
 
-			//be sure that the triangle is not degenerate!!!
-			if (AB.norm2() > ZERO_TOLERANCE &&
-				BC.norm2() > ZERO_TOLERANCE &&
-				CA.norm2() > ZERO_TOLERANCE)
+		unsigned cellsToTestCount = 0;
+
+		CCVector3 AB = (*triPoints[1]) - (*triPoints[0]);
+		CCVector3 BC = (*triPoints[2]) - (*triPoints[1]);
+		CCVector3 CA = (*triPoints[0]) - (*triPoints[2]);
+
+		//be sure that the triangle is not degenerate!!!
+		if (AB.norm2() > ZERO_TOLERANCE &&
+			BC.norm2() > ZERO_TOLERANCE &&
+			CA.norm2() > ZERO_TOLERANCE)
+		{
+			Tuple3i cellPos[3];
 			{
-				Tuple3i cellPos[3];
+				for (int k = 0; k<3; k++)
 				{
-					for (int k = 0; k<3; k++)
-					{
-						CCVector3 P = *(triPoints[k]) - gridMinCorner;
-						cellPos[k].x = std::min(static_cast<int>(P.x / cellLength), static_cast<int>(size().x) - 1);
-						cellPos[k].y = std::min(static_cast<int>(P.y / cellLength), static_cast<int>(size().y) - 1);
-						cellPos[k].z = std::min(static_cast<int>(P.z / cellLength), static_cast<int>(size().z) - 1);
-					}
+					CCVector3 P = *(triPoints[k]) - gridMinCorner;
+					cellPos[k].x = std::min(static_cast<int>(P.x / cellLength), static_cast<int>(size().x) - 1);
+					cellPos[k].y = std::min(static_cast<int>(P.y / cellLength), static_cast<int>(size().y) - 1);
+					cellPos[k].z = std::min(static_cast<int>(P.z / cellLength), static_cast<int>(size().z) - 1);
 				}
+			}
 
-				//compute the triangle bounding-box
-				Tuple3i minPos, maxPos;
+			//compute the triangle bounding-box
+			Tuple3i minPos, maxPos;
+			{
+				for (int k = 0; k<3; k++)
 				{
-					for (int k = 0; k<3; k++)
-					{
-						minPos.u[k] = std::min(cellPos[0].u[k], std::min(cellPos[1].u[k], cellPos[2].u[k]));
-						maxPos.u[k] = std::max(cellPos[0].u[k], std::max(cellPos[1].u[k], cellPos[2].u[k]));
-					}
+					minPos.u[k] = std::min(cellPos[0].u[k], std::min(cellPos[1].u[k], cellPos[2].u[k]));
+					maxPos.u[k] = std::max(cellPos[0].u[k], std::max(cellPos[1].u[k], cellPos[2].u[k]));
 				}
+			}
 
-				//first cell
-				assert(cellsToTest.capacity() != 0);
-				cellsToTestCount = 1;
-				CellToTest* _currentCell = &cellsToTest[0/*cellsToTestCount-1*/];
+			//first cell
+			assert(cellsToTest.capacity() != 0);
+			cellsToTestCount = 1;
+			CellToTest* _currentCell = &cellsToTest[0/*cellsToTestCount-1*/];
 
-				_currentCell->pos = minPos;
-				CCVector3 distanceToMinBorder = gridMinCorner - (*triPoints[0]);
+			_currentCell->pos = minPos;
+			CCVector3 distanceToMinBorder = gridMinCorner - (*triPoints[0]);
 
-				//compute the triangle normal
-				CCVector3 N = AB.cross(BC);
+			//compute the triangle normal
+			CCVector3 N = AB.cross(BC);
 
-				//max distance (in terms of cell) between the vertices
-				int maxSize = 0;
-				{
-					Tuple3i delta = maxPos - minPos + Tuple3i(1, 1, 1);
-					maxSize = std::max(delta.x, delta.y);
-					maxSize = std::max(maxSize, delta.z);
-				}
+			//max distance (in terms of cell) between the vertices
+			int maxSize = 0;
+			{
+				Tuple3i delta = maxPos - minPos + Tuple3i(1, 1, 1);
+				maxSize = std::max(delta.x, delta.y);
+				maxSize = std::max(maxSize, delta.z);
+			}
 
-				//we deduce the smallest bounding cell
-				static const double LOG_2 = log(2.0);
-				_currentCell->cellSize = (1 << (maxSize > 1 ? static_cast<unsigned char>(ceil(log(static_cast<double>(maxSize)) / LOG_2)) : 0));
+			//we deduce the smallest bounding cell
+			const double LOG_2 = log(2.0); //not static (this method can be called concurrently)
+			_currentCell->cellSize = (1 << (maxSize > 1 ? static_cast<unsigned char>(ceil(log(static_cast<double>(maxSize)) / LOG_2)) : 0));
 
-				//now we can (recursively) find the intersecting cells
-				while (cellsToTestCount != 0)
-				{
-					_currentCell = &cellsToTest[--cellsToTestCount];
+			//now we can (recursively) find the intersecting cells
+			while (cellsToTestCount != 0)
+			{
+				_currentCell = &cellsToTest[--cellsToTestCount];
 
-					//new cells may be written over the actual one
-					//so we need to remember its position!
-					Tuple3i currentCellPos = _currentCell->pos;
+				//new cells may be written over the actual one
+				//so we need to remember its position!
+				Tuple3i currentCellPos = _currentCell->pos;
 
-					//if we have reached the maximal subdivision level
-					if (_currentCell->cellSize == 1)
-					{
-						//compute the (absolute) cell center
-						AB = gridMinCorner + CCVector3::fromArray(currentCellPos.u) * cellLength + halfCellDimensions;
+				//if we have reached the maximal subdivision level
+				if (_currentCell->cellSize == 1)
+				{
+					//compute the (absolute) cell center
+					AB = gridMinCorner + CCVector3::fromArray(currentCellPos.u) * cellLength + halfCellDimensions;
 
-						//check that the triangle does intersect the cell (box)
-						if (CCMiscTools::TriBoxOverlap(AB, halfCellDimensions, triPoints))
+					//check that the triangle does intersect the cell (box)
+					if (CCMiscTools::TriBoxOverlap(AB, halfCellDimensions, triPoints))
+					{
+						if ((currentCellPos.x >= 0 && currentCellPos.x < static_cast<int>(size().x)) &&
+							(currentCellPos.y >= 0 && currentCellPos.y < static_cast<int>(size().y)) &&
+							(currentCellPos.z >= 0 && currentCellPos.z < static_cast<int>(size().z)))
 						{
-							if ((currentCellPos.x >= 0 && currentCellPos.x < static_cast<int>(size().x)) &&
-								(currentCellPos.y >= 0 && currentCellPos.y < static_cast<int>(size().y)) &&
-								(currentCellPos.z >= 0 && currentCellPos.z < static_cast<int>(size().z)))
-							{
-								setValue(currentCellPos, intersectValue);
-							}
+							setValue(currentCellPos, intersectValue);
 						}
 					}
-					else
-					{
-						int halfCellSize = (_currentCell->cellSize >> 1);
+				}
+				else
+				{
+					int halfCellSize = (_currentCell->cellSize >> 1);
 
-						//compute the position of each neighbor cell relatively to the triangle (3*3*3 = 27, including the cell itself)
-						char pointsPosition[27];
+					//compute the position of each neighbor cell relatively to the triangle (3*3*3 = 27, including the cell itself)
+					char pointsPosition[27];
+					{
+						char* _pointsPosition = pointsPosition;
+						for (int i = 0; i<3; ++i)
 						{
-							char* _pointsPosition = pointsPosition;
-							for (int i = 0; i<3; ++i)
+							AB.x = distanceToMinBorder.x + static_cast<PointCoordinateType>(currentCellPos.x + i*halfCellSize) * cellLength;
+							for (int j = 0; j<3; ++j)
 							{
-								AB.x = distanceToMinBorder.x + static_cast<PointCoordinateType>(currentCellPos.x + i*halfCellSize) * cellLength;
-								for (int j = 0; j<3; ++j)
+								AB.y = distanceToMinBorder.y + static_cast<PointCoordinateType>(currentCellPos.y + j*halfCellSize) * cellLength;
+								for (int k = 0; k<3; ++k)
 								{
-									AB.y = distanceToMinBorder.y + static_cast<PointCoordinateType>(currentCellPos.y + j*halfCellSize) * cellLength;
-									for (int k = 0; k<3; ++k)
-									{
-										AB.z = distanceToMinBorder.z + static_cast<PointCoordinateType>(currentCellPos.z + k*halfCellSize) * cellLength;
+									AB.z = distanceToMinBorder.z + static_cast<PointCoordinateType>(currentCellPos.z + k*halfCellSize) * cellLength;
 
-										//determine on which side the triangle is
-										*_pointsPosition++/*pointsPosition[i*9+j*3+k]*/ = (AB.dot(N) < 0 ? -1 : 1);
-									}
+									//determine on which side the triangle is
+									*_pointsPosition++/*pointsPosition[i*9+j*3+k]*/ = (AB.dot(N) < 0 ? -1 : 1);
 								}
 							}
 						}
+					}
 
-						//if necessary we enlarge the queue
-						if (cellsToTestCount + 27 > cellsToTest.capacity())
+					//if necessary we enlarge the queue
+					if (cellsToTestCount + 27 > cellsToTest.capacity())
+					{
+						try
 						{
-							try
-							{
-								cellsToTest.resize(std::max(cellsToTest.capacity() + 27, 2 * cellsToTest.capacity()));
-							}
-							catch (const std::bad_alloc&)
-							{
-								//out of memory
-								return false;
-							}
+							cellsToTest.resize(std::max(cellsToTest.capacity() + 27, 2 * cellsToTest.capacity()));
 						}
+						catch (const std::bad_alloc&)
+						{
+							//out of memory
+							return false;
+						}
+					}
 
-						//the first new cell will be written over the actual one
-						CellToTest* _newCell = &cellsToTest[cellsToTestCount];
-						_newCell->cellSize = halfCellSize;
+					//the first new cell will be written over the actual one
+					CellToTest* _newCell = &cellsToTest[cellsToTestCount];
+					_newCell->cellSize = halfCellSize;
 
-						//we look at the position of the 8 sub-cells relatively to the triangle
-						for (int i = 0; i<2; ++i)
+					//we look at the position of the 8 sub-cells relatively to the triangle
+					for (int i = 0; i<2; ++i)
+					{
+						_newCell->pos.x = currentCellPos.x + i*halfCellSize;
+						//quick test to determine if the cube is potentially intersecting the triangle's bbox
+						if (	static_cast<int>(_newCell->pos.x) + halfCellSize >= minPos.x
+							&&	static_cast<int>(_newCell->pos.x) <= maxPos.x)
 						{
-							_newCell->pos.x = currentCellPos.x + i*halfCellSize;
-							//quick test to determine if the cube is potentially intersecting the triangle's bbox
-							if (	static_cast<int>(_newCell->pos.x) + halfCellSize >= minPos.x
-								&&	static_cast<int>(_newCell->pos.x) <= maxPos.x)
+							for (int j = 0; j<2; ++j)
 							{
-								for (int j = 0; j<2; ++j)
+								_newCell->pos.y = currentCellPos.y + j*halfCellSize;
+								if (	static_cast<int>(_newCell->pos.y) + halfCellSize >= minPos.y
+									&&	static_cast<int>(_newCell->pos.y) <= maxPos.y)
 								{
-									_newCell->pos.y = currentCellPos.y + j*halfCellSize;
-									if (	static_cast<int>(_newCell->pos.y) + halfCellSize >= minPos.y
-										&&	static_cast<int>(_newCell->pos.y) <= maxPos.y)
+									for (int k = 0; k<2; ++k)
 									{
-										for (int k = 0; k<2; ++k)
+										_newCell->pos.z = currentCellPos.z + k*halfCellSize;
+										if (	static_cast<int>(_newCell->pos.z) + halfCellSize >= minPos.z
+											&&	static_cast<int>(_newCell->pos.z) <= maxPos.z)
 										{
-											_newCell->pos.z = currentCellPos.z + k*halfCellSize;
-											if (	static_cast<int>(_newCell->pos.z) + halfCellSize >= minPos.z
-												&&	static_cast<int>(_newCell->pos.z) <= maxPos.z)
+											const char* _pointsPosition = pointsPosition + (i * 9 + j * 3 + k);
+											char sum =		_pointsPosition[ 0] + _pointsPosition[ 1] + _pointsPosition[ 3]
+														+	_pointsPosition[ 4] + _pointsPosition[ 9] + _pointsPosition[10]
+														+	_pointsPosition[12] + _pointsPosition[13];
+
+											//if not all the vertices of this sub-cube are on the same side, then the triangle may intersect the sub-cube
+											if (sum > -8 && sum < 8)
 											{
-												const char* _pointsPosition = pointsPosition + (i * 9 + j * 3 + k);
-												char sum =		_pointsPosition[ 0] + _pointsPosition[ 1] + _pointsPosition[ 3]
-															+	_pointsPosition[ 4] + _pointsPosition[ 9] + _pointsPosition[10]
-															+	_pointsPosition[12] + _pointsPosition[13];
-
-												//if not all the vertices of this sub-cube are on the same side, then the triangle may intersect the sub-cube
-												if (sum > -8 && sum < 8)
-												{
-													//we make newCell point on next cell in array
-													cellsToTest[++cellsToTestCount] = *_newCell;
-													_newCell = &cellsToTest[cellsToTestCount];
-												}
+												//we make newCell point on next cell in array
+												cellsToTest[++cellsToTestCount] = *_newCell;
+												_newCell = &cellsToTest[cellsToTestCount];
 											}
 										}
 									}
@@ -319,14 +352,9 @@ public:
 					}
 				}
 			}
-
-			if (progressCb && !nProgress.oneStep())
-			{
-				//cancel by user
-				return false;
-			}
 		}
 
+
 		return true;
 	}
 
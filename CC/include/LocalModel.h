@@ -22,6 +22,9 @@
 #include "CCGeom.h"
 #include "Neighbourhood.h"
 
+//system
+#include <vector>
+
 namespace CCLib
 {
 
@@ -74,6 +77,57 @@ protected:
 
 	//! Max radius (squared)
 	PointCoordinateType m_squaredRadius;
+
+	friend class LocalModelPool;
+
+	//! Creates a model either on the heap (if 'storage' is 0) or in the given storage (see LocalModelPool)
+	static LocalModel* Create(	CC_LOCAL_MODEL_TYPES type,
+								Neighbourhood& subset,
+								const CCVector3 &center,
+								PointCoordinateType squaredRadius,
+								void* storage);
+};
+
+//! Pool of local models
+/** The models are created in blocks of pre-allocated memory (instead of being
+	allocated one by one on the heap) and they are all released at once.
+	A pool is not thread-safe: each thread (or octree cell) must use its own.
+**/
+class LocalModelPool
+{
+public:
+
+	//! Default constructor
+	/** \param modelsPerBlock number of models per memory block
+	**/
+	explicit LocalModelPool(unsigned modelsPerBlock = 256);
+
+	//! Destructor
+	~LocalModelPool();
+
+	//! Creates a new model (see LocalModel::New)
+	/** \warning the model belongs to the pool (it must not be deleted)
+		\return the model, or 0 if the computation failed (or not enough memory)
+	**/
+	const LocalModel* create(	CC_LOCAL_MODEL_TYPES type,
+								Neighbourhood& subset,
+								const CCVector3 &center,
+								PointCoordinateType squaredRadius);
+
+	//! Returns the number of models
+	inline size_t size() const { return m_models.size(); }
+
+	//! Releases all the models (the memory blocks are kept for the next ones)
+	void clear();
+
+protected:
+
+	//! Memory blocks
+	std::vector<char*> m_blocks;
+	//! Number of models per block
+	unsigned m_modelsPerBlock;
+	//! Models
+	std::vector<LocalModel*> m_models;
 };
 
 }
@@ -0,0 +1,389 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef OUT_OF_CORE_OCTREE_HEADER
+#define OUT_OF_CORE_OCTREE_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "DgmOctree.h"
+
+//system
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericCloud;
+class ScalarField;
+
+//! Out-of-core version of the octree structure (with a bounded memory footprint)
+/** The cells are coded and sorted exactly as in DgmOctree, but the (sorted) points
+	and their codes are stored in temporary files instead of memory:
+	- the input cloud is only read once, sequentially (with GenericCloud::placeIteratorAtBegining
+	and GenericCloud::getNextPoint);
+	- the points are sorted by blocks (as large as the memory limit allows) then merged
+	(external sort);
+	- the sorted points are read back by fixed-size pages, on demand, through a limited
+	(LRU) cache. Cells are processed in the octree order, so that the neighbour cells are
+	generally already in the cache.
+	The per-point results of the cell functions (see executeFunctionForAllCellsAtLevel)
+	are stored in another temporary file and can be retrieved afterwards (see exportValues).
+	Clouds larger than the memory can be processed if the input cloud is streamed (e.g.
+	read from a file by its global iterator) and if the values are exported with a
+	ValuesOutput (the values are then sorted back with another external sort).
+**/
+class CC_CORE_LIB_API OutOfCoreOctree
+{
+public:
+
+	//! Type of the code of an octree cell (same as DgmOctree)
+	typedef DgmOctree::OctreeCellCodeType OctreeCellCodeType;
+
+	//! Point record (as stored in the octree files)
+	struct PointRecord
+	{
+		//! Point coordinates
+		CCVector3 P;
+		//! Point index (in the input cloud)
+		unsigned index;
+	};
+
+	//! A set of point records
+	typedef std::vector<PointRecord> PointRecords;
+
+	//! Octree cell descriptor
+	struct octreeCell
+	{
+		//! Octree to which the cell belongs
+		const OutOfCoreOctree* parentOctree;
+		//! Cell level of subdivision
+		unsigned char level;
+		//! Truncated cell code
+		OctreeCellCodeType truncatedCode;
+		//! Cell position (at the cell level of subdivision)
+		Tuple3i cellPos;
+		//! Points lying inside this cell
+		const PointRecords* points;
+		//! Per-point output values (same size as points - initialized with NAN_VALUE)
+		std::vector<ScalarType>* values;
+
+		//! Default constructor
+		octreeCell()
+			: parentOctree(0)
+			, level(0)
+			, truncatedCode(0)
+			, cellPos(0,0,0)
+			, points(0)
+			, values(0)
+		{}
+	};
+
+	//! Generic output for the per-point values (see exportValues)
+	class ValuesOutput
+	{
+	public:
+		//! Destructor
+		virtual ~ValuesOutput() {}
+
+		//! Receives the value of the next point
+		/** Values are received in the order of the input points (NAN_VALUE for the points
+			that were not projected in the octree).
+			\return success (the export is stopped otherwise)
+		**/
+		virtual bool addValue(ScalarType value) = 0;
+	};
+
+	//! Generic form of a function that can be applied automatically to all cells of the octree
+	/** See OutOfCoreOctree::executeFunctionForAllCellsAtLevel.
+		The parameters of such a function are:
+		- (octreeCell) cell descriptor
+		- (void**) table of user parameters for the function (maybe void)
+		- (NormalizedProgress*) optional (normalized) progress callback
+		- return success
+	**/
+	typedef bool (*octreeCellFunc)(const octreeCell& cell, void**, NormalizedProgress*);
+
+	//! Default memory limit (in bytes)
+	static const size_t DEFAULT_MEMORY_LIMIT = (size_t(512) << 20);
+
+	//! Default constructor
+	/** \param tempDir folder in which the temporary files are created (the current one by default)
+		\param memoryLimit maximum amount of memory used by the octree (sort buffers, cells tables and pages cache)
+	**/
+	explicit OutOfCoreOctree(const char* tempDir = 0, size_t memoryLimit = DEFAULT_MEMORY_LIMIT);
+
+	//! Destructor (removes the temporary files)
+	virtual ~OutOfCoreOctree();
+
+	//! Clears the octree (and removes the temporary files)
+	void clear();
+
+	//! Builds the structure
+	/** Octree 3D limits are deduced from the cloud bounding-box.
+		\param cloud input cloud (only read once, with the cloud global iterator)
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return the number of points projected in the octree (or a negative value if an error occurred)
+	**/
+	int build(GenericCloud* cloud, GenericProgressCallback* progressCb = 0);
+
+	//! Builds the structure with constraints
+	/** Octree spatial limits must be specified (they should be cubical). Points falling
+		outside these limits are ignored.
+		\param cloud input cloud (only read once, with the cloud global iterator)
+		\param octreeMin the lower limits for the octree cells along X, Y and Z
+		\param octreeMax the upper limits for the octree cells along X, Y and Z
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return the number of points projected in the octree (or a negative value if an error occurred)
+	**/
+	int build(	GenericCloud* cloud,
+				const CCVector3& octreeMin,
+				const CCVector3& octreeMax,
+				GenericProgressCallback* progressCb = 0);
+
+	/**** GETTERS ****/
+
+	//! Returns the number of points projected into the octree
+	inline unsigned getNumberOfProjectedPoints() const { return m_numberOfProjectedPoints; }
+
+	//! Returns the number of points of the input cloud (read when the octree was built)
+	inline unsigned getNumberOfInputPoints() const { return m_numberOfInputPoints; }
+
+	//! Returns the lower boundaries of the octree
+	inline const CCVector3& getOctreeMins() const { return m_dimMin; }
+
+	//! Returns the higher boundaries of the octree
+	inline const CCVector3& getOctreeMaxs() const { return m_dimMax; }
+
+	//! Returns the octree cells length for a given level of subdivision
+	inline const PointCoordinateType& getCellSize(unsigned char level) const { return m_cellSize[level]; }
+
+	//! Returns the number of cells for a given level of subdivision
+	inline unsigned getCellNumber(unsigned char level) const { return m_cellCount[level]; }
+
+	//! Returns the memory limit (in bytes)
+	inline size_t getMemoryLimit() const { return m_memoryLimit; }
+
+	//! Sets the memory limit (in bytes)
+	/** The cells tables and the cached pages are released if necessary.
+	**/
+	void setMemoryLimit(size_t memoryLimit);
+
+	//! Returns the amount of memory currently used by the cells tables and the pages cache (in bytes)
+	size_t memoryUsage() const;
+
+	//! Returns whether another octree has the same bounding-box (i.e. the same cells)
+	bool hasSameGridAs(const OutOfCoreOctree& other) const;
+
+	/**** CELLS POSITION HANDLING ****/
+
+	//! Returns the position for a given level of subdivision of the cell that includes a given point
+	void getTheCellPosWhichIncludesThePoint(const CCVector3& P, Tuple3i& cellPos, unsigned char level) const;
+
+	//! Returns the cell position for a given level of subdivision of a cell designated by its truncated code
+	static void GetCellPos(OctreeCellCodeType truncatedCode, unsigned char level, Tuple3i& cellPos);
+
+	//! Generates the truncated cell code of a cell given its position at a given level of subdivision
+	/** Same codes as DgmOctree::generateTruncatedCellCode.
+	**/
+	static OctreeCellCodeType GenerateTruncatedCellCode(const Tuple3i& cellPos, unsigned char level);
+
+	//! Returns the cell center for a given level of subdivision
+	void computeCellCenter(const Tuple3i& cellPos, unsigned char level, CCVector3& center) const;
+
+	//! Returns the lowest and highest (filled) cell positions along all dimensions for a given level of subdivision
+	void getFillIndexes(unsigned char level, Tuple3i& minPos, Tuple3i& maxPos) const;
+
+	//! Returns the deepest level at which the cells are larger than a given radius
+	/** At this level, all the points inside a sphere of this radius centered
+		on a point of a given cell lie in this cell or in its 26 neighbours.
+	**/
+	unsigned char findBestLevelForAGivenNeighbourhoodSizeExtraction(PointCoordinateType radius) const;
+
+	//! Returns the level for which the average number of points per cell is the closest to a given value
+	unsigned char findBestLevelForAGivenPopulationPerCell(unsigned indicativeNumberOfPointsPerCell) const;
+
+	/**** POINTS EXTRACTION ****/
+
+	//! Returns the points lying in a specific cell
+	/** \param cellPos cell position
+		\param level the level of subdivision
+		\param[out] points the points (appended)
+		\return success (false if the pages couldn't be read)
+	**/
+	bool getPointsInCell(const Tuple3i& cellPos, unsigned char level, PointRecords& points) const;
+
+	//! Returns the points lying in the neighbourhood of a cell
+	/** The neighbourhood is the cube of (2*neighbourhoodLength+1)^3 cells centered on the cell.
+		The corresponding pages are read on demand (if they are not already in the cache).
+		\param cellPos center cell position
+		\param level the level of subdivision
+		\param neighbourhoodLength the distance (in terms of cells) at which to look for neighbour cells
+		\param[out] points the points (appended)
+		\param onlyBorder whether to only consider the cells at exactly 'neighbourhoodLength' cells (incremental search)
+		\return success (false if the pages couldn't be read)
+	**/
+	bool getPointsInNeighbourCells(	const Tuple3i& cellPos,
+									unsigned char level,
+									int neighbourhoodLength,
+									PointRecords& points,
+									bool onlyBorder = false) const;
+
+	/**** PROCESSING ****/
+
+	//! Method to apply automatically a specific function to each cell of the octree
+	/** Same principle as DgmOctree::executeFunctionForAllCellsAtLevel. Cells are processed
+		sequentially (in the octree order). The values set by the function for each point of
+		the cell (see octreeCell::values) are stored in a temporary file and can be retrieved
+		afterwards with exportValues (they are replaced at each call).
+		\param level the level of subdivision
+		\param func the function to apply
+		\param additionalParameters the function parameters
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param functionTitle function title
+		\return the number of processed cells (or 0 is something went wrong)
+	**/
+	unsigned executeFunctionForAllCellsAtLevel(	unsigned char level,
+												octreeCellFunc func,
+												void** additionalParameters,
+												GenericProgressCallback* progressCb = 0,
+												const char* functionTitle = 0);
+
+	//! Returns whether per-point values are available (see executeFunctionForAllCellsAtLevel)
+	inline bool hasValues() const { return m_hasValues; }
+
+	//! Copies the per-point values in a scalar field
+	/** Values are stored at the index of the points in the input cloud.
+		\warning the scalar field must hold a value for each point of the input cloud (in memory)
+		\param sf output scalar field (must be large enough)
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool exportValues(ScalarField* sf, GenericProgressCallback* progressCb = 0) const;
+
+	//! Sends the per-point values to a generic output, in the order of the input points
+	/** The values are sorted back by point index with an external sort (in the memory limit),
+		so that the input cloud doesn't have to be in memory (see ValuesOutput::addValue).
+		\param output values output (receives one value per input point)
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool exportValues(ValuesOutput& output, GenericProgressCallback* progressCb = 0) const;
+
+protected:
+
+	//! Cell descriptor (in the per-level cells tables)
+	struct CellEntry
+	{
+		//! Truncated cell code
+		OctreeCellCodeType code;
+		//! Index of the first point of the cell
+		unsigned first;
+		//! Number of points in the cell
+		unsigned count;
+	};
+
+	//! Cells table
+	typedef std::vector<CellEntry> CellsTable;
+
+	//! Page of (sorted) points
+	struct Page
+	{
+		//! Page index
+		unsigned index;
+		//! Points
+		PointRecords records;
+		//! Last use (for LRU eviction)
+		unsigned lastUse;
+	};
+
+	//! Generic method to build the octree structure
+	int genericBuild(GenericCloud* cloud, GenericProgressCallback* progressCb);
+
+	//! Returns the cells table for a given level (built on first call)
+	const CellsTable* getCellsTable(unsigned char level) const;
+
+	//! Returns the index of a given cell in a cells table (or -1 if it doesn't exist)
+	static int FindCell(const CellsTable& table, OctreeCellCodeType truncatedCode);
+
+	//! Reads (and appends) points from the points file (through the pages cache)
+	bool readPoints(unsigned first, unsigned count, PointRecords& points) const;
+
+	//! Returns a page of points (reads it if necessary)
+	const Page* getPage(unsigned pageIndex) const;
+
+	//! Releases cells tables and cached pages so as to respect the memory limit
+	/** \param required number of bytes about to be allocated
+		\param keptLevel level of the cells table that must be kept (or 0xFF)
+		\param pagesOnly whether only cached pages can be released (the cells tables may be in use)
+	**/
+	void releaseMemory(size_t required, unsigned char keptLevel, bool pagesOnly = false) const;
+
+	//! Returns the full path of a temporary file
+	std::string tempFilename(const char* suffix) const;
+
+	//! Folder of the temporary files
+	std::string m_tempDir;
+
+	//! Unique prefix of the temporary files
+	std::string m_filePrefix;
+
+	//! Memory limit
+	size_t m_memoryLimit;
+
+	//! Sorted points file
+	mutable FILE* m_pointsFile;
+	//! Sorted codes file
+	mutable FILE* m_codesFile;
+
+	//! Number of points projected in the octree
+	unsigned m_numberOfProjectedPoints;
+	//! Number of points of the input cloud
+	unsigned m_numberOfInputPoints;
+
+	//! Min coordinates of the octree bounding-box
+	CCVector3 m_dimMin;
+	//! Max coordinates of the octree bounding-box
+	CCVector3 m_dimMax;
+
+	//! Cell dimensions for all subdivision levels
+	PointCoordinateType m_cellSize[DgmOctree::MAX_OCTREE_LEVEL+2];
+	//! Number of cells per level of subdivision
+	unsigned m_cellCount[DgmOctree::MAX_OCTREE_LEVEL+1];
+	//! Min and max occupied cells positions (at the deepest level)
+	Tuple3i m_fillMin, m_fillMax;
+
+	//! Per-level cells tables (built on demand)
+	mutable CellsTable* m_cellsTables[DgmOctree::MAX_OCTREE_LEVEL+1];
+
+	//! Pages cache
+	mutable std::vector<Page*> m_pages;
+	//! Page index to cache slot
+	mutable std::map<unsigned,size_t> m_pageSlots;
+	//! Cache usage counter
+	mutable unsigned m_cacheClock;
+
+	//! Whether per-point values are available
+	bool m_hasValues;
+};
+
+}
+
+#endif //OUT_OF_CORE_OCTREE_HEADER
@@ -126,7 +126,7 @@ public:
 		may present however several topological aberrations ;).
 		\param cloud a point cloud
 		\param type the triangulation strategy
-		\param maxEdgeLength max edge length for output triangles (0 = ignored)
+		\param maxEdgeLength max edge length for output triangles (0 = ignored). For axis-aligned meshes, the triangulation is then computed by tiles (see Delaunay2dMesh::buildMeshByTiles)
 		\param dim projection dimension (for axis-aligned meshes)
 		\param errorStr error (if any) [optional]
 		\return a mesh
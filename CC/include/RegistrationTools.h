@@ -174,6 +174,7 @@ public:
 		\param modelWeights weights for model points (optional)
 		\param dataWeights weights for data points (optional)
 		\param transformationFilters filters to be applied on the resulting transformation at each step (experimental) - see RegistrationTools::TRANSFORMATION_FILTERS flags
+		\param multiThread whether the distances computation can be multi-threaded (set to false if several registrations are run concurrently)
 		\return algorithm result
 	**/
 	static RESULT_TYPE RegisterClouds(	GenericIndexedCloudPersist* modelCloud,
@@ -191,7 +192,8 @@ public:
 										double finalOverlapRatio = 1.0,
 										ScalarField* modelWeights = 0,
 										ScalarField* dataWeights = 0,
-										int transformationFilters = SKIP_NONE);
+										int transformationFilters = SKIP_NONE,
+										bool multiThread = true);
 };
 
 
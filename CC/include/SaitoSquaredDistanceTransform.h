@@ -33,13 +33,13 @@ namespace CCLib
 		}
 
 		//! Initializes the distance transform with a mesh
-		inline bool initDT(	GenericIndexedMesh* mesh,
-							PointCoordinateType cellLength,
-							const CCVector3& gridMinCorner,
-							GenericProgressCallback* progressCb = 0)
-		{
-			return intersecthWith(mesh, cellLength, gridMinCorner, 1, progressCb);
-		}
+		/** The triangles are voxelized in parallel (if CC_CORE_LIB is compiled with Qt).
+			\warning the mesh 'getTriangleVertices' method must then be thread-safe
+		**/
+		bool initDT(GenericIndexedMesh* mesh,
+					PointCoordinateType cellLength,
+					const CCVector3& gridMinCorner,
+					GenericProgressCallback* progressCb = 0);
 
 		//! Computes the exact Squared Distance Transform on the whole grid
 		/** Propagates the distances on the whole grid.
@@ -65,8 +65,42 @@ namespace CCLib
 		static bool EDT_1D(GridElement* slice, size_t r, size_t c);
 		//! 2D Exact Squared Distance Transform
 		static bool SDT_2D(Grid3D<GridElement>& image, size_t sliceIndex, const std::vector<GridElement>& sq);
+		//! 1D Exact Squared Distance Transform along Z (for all the cells of a given row)
+		static bool SDT_1D_Z(Grid3D<GridElement>& image, size_t rowIndex, const std::vector<GridElement>& sq);
 		//! 3D Exact Squared Distance Transform
 		static bool SDT_3D(Grid3D<GridElement>& image, GenericProgressCallback* progressCb = 0);
+
+		//! Range of slices, rows or triangles processed by a single job
+		struct Job
+		{
+			Grid3D<GridElement>* grid;
+			//slices and rows
+			const std::vector<GridElement>* sq;
+			GridElement maxDistance;
+			//triangles
+			GenericIndexedMesh* mesh;
+			PointCoordinateType cellLength;
+			CCVector3 gridMinCorner;
+			//range
+			size_t first;
+			size_t last; //excluded
+			bool success;
+		};
+
+		//! Inverts and applies the 2D transform to a range of slices
+		static void SDT_2D_Job(Job& job);
+		//! Applies the 1D transform along Z to a range of rows
+		static void SDT_1D_Z_Job(Job& job);
+		//! Intersects a range of triangles with the grid
+		static void IntersectTriangles_Job(Job& job);
+		//! Splits a range of items in jobs and processes them (in parallel if possible)
+		/** \param prototype job parameters (except the range)
+			\param count number of items (slices, rows or triangles)
+			\param func job function
+			\param nProgress progress notification (one step per item)
+			\return success
+		**/
+		static bool ProcessJobs(const Job& prototype, size_t count, void (*func)(Job&), NormalizedProgress& nProgress);
 	};
 
 }
@@ -24,6 +24,9 @@
 #include "CCTypes.h"
 #include "GenericChunkedArray.h"
 
+//system
+#include <vector>
+
 namespace CCLib
 {
 
@@ -53,6 +56,43 @@ public:
 	//! Returns the specific NaN value
 	static inline ScalarType NaN() { return NAN_VALUE; }
 
+	//! Statistics of the valid values of a scalar field
+	struct Statistics
+	{
+		//! Number of valid values
+		unsigned validCount;
+		//! Min value
+		ScalarType minVal;
+		//! Max value
+		ScalarType maxVal;
+		//! Mean value
+		double mean;
+		//! Variance
+		double variance;
+
+		//! Default constructor
+		Statistics() : validCount(0), minVal(0), maxVal(0), mean(0), variance(0) {}
+	};
+
+	//! Computes the min, max, mean and variance of the valid values in a single pass
+	/** The chunks are processed in parallel if CCLib is compiled with Qt.
+		\param stats output statistics
+	**/
+	void computeStatistics(Statistics& stats) const;
+
+	//! Returns the statistics computed by the last call to computeMinAndMax
+	inline const Statistics& getStatistics() const { return m_statistics; }
+
+	//! Computes the histogram of the values inside [minVal,maxVal] (NaN values are ignored)
+	/** The chunks are processed in parallel if CCLib is compiled with Qt.
+		\param minVal lower bound of the first class
+		\param maxVal upper bound of the last class
+		\param classCount number of classes
+		\param histo output histogram
+		\return success (false if not enough memory)
+	**/
+	bool computeHistogram(ScalarType minVal, ScalarType maxVal, unsigned classCount, std::vector<unsigned>& histo) const;
+
 	//! Computes the mean value (and optionnaly the variance value) of the scalar field
 	/** \param mean a field to store the mean value
 		\param variance if not void, the variance will be computed and stored here
@@ -60,6 +100,8 @@ public:
 	void computeMeanAndVariance(ScalarType &mean, ScalarType* variance = 0) const;
 
 	//inherited from GenericChunkedArray
+	/** Updates the statistics as well (see getStatistics).
+	**/
 	virtual void computeMinAndMax();
 
 	//! Returns whether a scalar value is valid or not
@@ -77,6 +119,9 @@ protected:
 
 	//! Scalar field name
 	char m_name[256];
+
+	//! Statistics (updated by computeMinAndMax)
+	Statistics m_statistics;
 };
 
 }
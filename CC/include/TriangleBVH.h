@@ -0,0 +1,151 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef TRIANGLE_BVH_HEADER
+#define TRIANGLE_BVH_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCGeom.h"
+
+//system
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedMesh;
+class GenericProgressCallback;
+
+//! Bounding Volume Hierarchy over the triangles of a mesh (for exact nearest triangle queries)
+/** The hierarchy is built top-down with the Surface Area Heuristic (SAH, binned version).
+	Nodes are stored in a flat array (depth-first order, the left child of a node
+	always follows it) and the triangles are copied in leaf order so that the
+	triangles of a leaf are contiguous in memory.
+	Once built, the structure is read-only: it can be queried concurrently.
+**/
+class CC_CORE_LIB_API TriangleBVH
+{
+public:
+
+	//! Default constructor
+	TriangleBVH();
+
+	//! Destructor
+	virtual ~TriangleBVH();
+
+	//! Builds the hierarchy
+	/** \param mesh the mesh (the triangles are copied, the mesh can be released afterwards)
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool build(GenericIndexedMesh* mesh, GenericProgressCallback* progressCb = 0);
+
+	//! Clears the structure
+	void clear();
+
+	//! Returns whether the hierarchy has been built
+	inline bool isValid() const { return !m_nodes.empty(); }
+
+	//! Returns the number of triangles
+	inline unsigned size() const { return static_cast<unsigned>(m_triangles.size()); }
+
+	//! Returns the number of nodes
+	inline unsigned nodeCount() const { return static_cast<unsigned>(m_nodes.size()); }
+
+	//! Searches for the nearest triangle
+	/** \param P the query point
+		\param maxSquareDist only the triangles strictly nearer than this (squared) distance are considered (or any negative value for no limit)
+		\param[out] triangleIndex index of the nearest triangle (in the input mesh)
+		\param[out] squareDist squared distance to the nearest triangle
+		\param[out] signedDist (optional) distance to the nearest triangle, signed relatively to its normal (see DistanceComputationTools::computePoint2TriangleDistance)
+		\return whether a triangle has been found
+	**/
+	bool findNearestTriangle(	const CCVector3& P,
+								double maxSquareDist,
+								unsigned& triangleIndex,
+								double& squareDist,
+								double* signedDist = 0) const;
+
+	//! Computes the squared distance between a point and a triangle
+	/** Same result as DistanceComputationTools::computePoint2TriangleDistance (double precision)
+		but without going through the (virtual) triangle interface.
+		\param P query point
+		\param A first vertex
+		\param B second vertex
+		\param C third vertex
+		\return the squared distance
+	**/
+	static double ComputeSquareDistance(const CCVector3d& P, const CCVector3& A, const CCVector3& B, const CCVector3& C);
+
+protected:
+
+	//! Tree node (32 bytes with single precision coordinates)
+	struct Node
+	{
+		//! Bounding box (min corner)
+		PointCoordinateType bbMin[3];
+		//! Index of the right child (inner node) or of the first triangle (leaf)
+		unsigned rightOrFirst;
+		//! Bounding box (max corner)
+		PointCoordinateType bbMax[3];
+		//! Number of triangles (0 for inner nodes - the left child is the next node)
+		unsigned count;
+
+		//! Returns whether the node is a leaf
+		inline bool isLeaf() const { return count != 0; }
+
+		//! Returns the squared distance between a point and the node bounding box
+		inline double squareDistTo(const CCVector3d& P) const
+		{
+			double d2 = 0;
+			for (unsigned char k=0; k<3; ++k)
+			{
+				double d = 0;
+				if (P.u[k] < bbMin[k])
+					d = bbMin[k] - P.u[k];
+				else if (P.u[k] > bbMax[k])
+					d = P.u[k] - bbMax[k];
+				d2 += d*d;
+			}
+			return d2;
+		}
+	};
+
+	//! Triangle vertices (stored in leaf order)
+	struct Triangle
+	{
+		CCVector3 A, B, C;
+	};
+
+	//! Builds the nodes once the triangles bounding boxes and centroids are known
+	bool buildNodes(const std::vector<CCVector3>& bbMins,
+					const std::vector<CCVector3>& bbMaxs,
+					const std::vector<CCVector3>& centroids,
+					std::vector<unsigned>& order);
+
+	//! Nodes (depth-first order)
+	std::vector<Node> m_nodes;
+	//! Triangles (leaf order)
+	std::vector<Triangle> m_triangles;
+	//! Original index of each triangle (leaf order)
+	std::vector<unsigned> m_triangleIndexes;
+};
+
+}
+
+#endif //TRIANGLE_BVH_HEADER
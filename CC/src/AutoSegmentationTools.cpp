@@ -36,7 +36,8 @@ int AutoSegmentationTools::labelConnectedComponents(GenericIndexedCloudPersist*
 													unsigned char level,
 													bool sixConnexity/*=false*/,
 													GenericProgressCallback* progressCb/*=0*/,
-													DgmOctree* inputOctree/*=0*/)
+													DgmOctree* inputOctree/*=0*/,
+													std::vector<DgmOctree::ConnectedComponentInfo>* componentsInfo/*=0*/)
 {
 	if (!theCloud)
 		return -1;
@@ -56,7 +57,7 @@ int AutoSegmentationTools::labelConnectedComponents(GenericIndexedCloudPersist*
 	//we use the default scalar field to store components labels
 	theCloud->enableScalarField();
 
-	int result = theOctree->extractCCs(level,sixConnexity,progressCb);
+	int result = theOctree->extractCCs(level,sixConnexity,progressCb,componentsInfo);
 
 	//remove octree if it was not provided as input
 	if (!inputOctree)
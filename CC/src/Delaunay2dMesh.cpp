@@ -31,6 +31,22 @@
 //system
 #include <assert.h>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#ifdef USE_QT
+#ifndef _DEBUG
+//enables multi-threading handling
+#define ENABLE_DELAUNAY_TILES_MT
+#endif
+#endif
+
+#ifdef ENABLE_DELAUNAY_TILES_MT
+#include <QThread>
+#include <QtConcurrentMap>
+#endif
 
 using namespace CCLib;
 
@@ -230,6 +246,555 @@ bool Delaunay2dMesh::buildMesh(	const std::vector<CCVector2>& points2D,
 #endif
 }
 
+#ifdef USE_TRIANGLE_LIB
+
+//! Regular grid of tiles (see Delaunay2dMesh::buildMeshByTiles)
+struct DelaunayTilesGrid
+{
+	//! Input 2D points
+	const std::vector<CCVector2>* points2D;
+	//! Associated cloud (optional, to measure the edges length in 3D)
+	GenericIndexedCloud* cloud;
+	//! Max edge length
+	double maxEdgeLength;
+	//! Max square edge length (same as in Delaunay2dMesh::removeTrianglesWithEdgesLongerThan)
+	PointCoordinateType squareMaxEdgeLength;
+	//! Domain (min corner)
+	CCVector2d minCorner;
+	//! Domain (max corner)
+	CCVector2d maxCorner;
+	//! Tiles dimensions
+	CCVector2d tileSize;
+	//! Number of tiles along X
+	int tileCountX;
+	//! Number of tiles along Y
+	int tileCountY;
+	//! Point indexes (sorted by tile)
+	std::vector<unsigned> pointIndexes;
+	//! Position of the first point of each tile in 'pointIndexes' (+ the total number of points)
+	std::vector<unsigned> tileFirstPoint;
+
+	//! Returns the column of the tile including a given abscissa
+	inline int tileX(double x) const
+	{
+		int i = static_cast<int>(floor((x - minCorner.x) / tileSize.x));
+		return std::max(0, std::min(tileCountX-1, i));
+	}
+
+	//! Returns the row of the tile including a given ordinate
+	inline int tileY(double y) const
+	{
+		int j = static_cast<int>(floor((y - minCorner.y) / tileSize.y));
+		return std::max(0, std::min(tileCountY-1, j));
+	}
+};
+
+//! Tile of a tiled Delaunay triangulation (see Delaunay2dMesh::buildMeshByTiles)
+struct DelaunayTile
+{
+	//! Grid
+	const DelaunayTilesGrid* grid;
+	//! Tile column
+	int i;
+	//! Tile row
+	int j;
+	//! Kept triangles (as 3 global vertex indexes per triangle)
+	std::vector<int> triangles;
+	//! Error message (if any)
+	std::string errorStr;
+	//! Whether the tile has been successfully triangulated
+	bool success;
+};
+
+//! Returns whether a point lies inside a given box
+static inline bool IsInside(const CCVector2& P, double minX, double minY, double maxX, double maxY)
+{
+	return (P.x >= minX && P.x <= maxX && P.y >= minY && P.y <= maxY);
+}
+
+static void TriangulateTile(DelaunayTile& tile)
+{
+	tile.success = false;
+	const DelaunayTilesGrid& grid = *tile.grid;
+	const std::vector<CCVector2>& points2D = *grid.points2D;
+	const PointCoordinateType& squareMaxEdgeLength = grid.squareMaxEdgeLength;
+
+	//tile extents (without margin)
+	const double coreMinX = grid.minCorner.x + tile.i * grid.tileSize.x;
+	const double coreMinY = grid.minCorner.y + tile.j * grid.tileSize.y;
+	const double coreMaxX = coreMinX + grid.tileSize.x;
+	const double coreMaxY = coreMinY + grid.tileSize.y;
+
+	//the margin should at least include the vertices of the (short) triangles owned by the tile
+	double margin = 2.0 * grid.maxEdgeLength;
+
+	triangulateio in;
+	memset(&in,0,sizeof(triangulateio));
+
+	try
+	{
+		std::vector<CCVector2> tilePoints;
+		std::vector<unsigned> tileIndexes;
+		//points outside of the tile margin that must be triangulated with the tile (sorted)
+		std::vector<unsigned> extraIndexes;
+		std::vector<unsigned> newExtraIndexes;
+		//grid tiles intersecting a circumcircle (with their squared distance to its center)
+		std::vector< std::pair<double,unsigned> > candidateTiles;
+
+		while (true)
+		{
+			//tile extents (with margin)
+			const double minX = coreMinX - margin;
+			const double minY = coreMinY - margin;
+			const double maxX = coreMaxX + margin;
+			const double maxY = coreMaxY + margin;
+			//an extent that reaches the domain border is virtually infinite (there's no point beyond it)
+			const bool openMinX = (tile.i == 0                 || minX <= grid.minCorner.x);
+			const bool openMinY = (tile.j == 0                 || minY <= grid.minCorner.y);
+			const bool openMaxX = (tile.i+1 == grid.tileCountX || maxX >= grid.maxCorner.x);
+			const bool openMaxY = (tile.j+1 == grid.tileCountY || maxY >= grid.maxCorner.y);
+
+			//gather the points inside the tile and its margin
+			tilePoints.resize(0);
+			tileIndexes.resize(0);
+			{
+				int i0 = grid.tileX(minX), i1 = grid.tileX(maxX);
+				int j0 = grid.tileY(minY), j1 = grid.tileY(maxY);
+				for (int j=j0; j<=j1; ++j)
+				{
+					for (int i=i0; i<=i1; ++i)
+					{
+						unsigned t = static_cast<unsigned>(i + j*grid.tileCountX);
+						for (unsigned k=grid.tileFirstPoint[t]; k<grid.tileFirstPoint[t+1]; ++k)
+						{
+							unsigned index = grid.pointIndexes[k];
+							const CCVector2& P = points2D[index];
+							if (IsInside(P, minX, minY, maxX, maxY))
+							{
+								tilePoints.push_back(P);
+								tileIndexes.push_back(index);
+							}
+						}
+					}
+				}
+				for (size_t k=0; k<extraIndexes.size(); ++k)
+				{
+					const CCVector2& P = points2D[extraIndexes[k]];
+					if (!IsInside(P, minX, minY, maxX, maxY)) //the margin may have grown in the meantime
+					{
+						tilePoints.push_back(P);
+						tileIndexes.push_back(extraIndexes[k]);
+					}
+				}
+			}
+
+			tile.triangles.resize(0);
+			if (tilePoints.size() < 3)
+			{
+				//nothing to do
+				break;
+			}
+
+			memset(&in,0,sizeof(triangulateio));
+			in.numberofpoints = static_cast<int>(tilePoints.size());
+			in.pointlist = (REAL*)(&tilePoints[0]);
+
+			triangulate ( "zQN", &in, &in, 0 );
+
+			//the margin required to contain the circumcircles of the kept triangles
+			double requiredMargin = 0;
+			//max number of points that can be checked directly (see below)
+			size_t pointsToCheck = 64 * tilePoints.size();
+			newExtraIndexes.resize(0);
+
+			const int* _tri = in.trianglelist;
+			for (int t=0; t<in.numberoftriangles; ++t, _tri+=3)
+			{
+				const unsigned iA = tileIndexes[_tri[0]];
+				const unsigned iB = tileIndexes[_tri[1]];
+				const unsigned iC = tileIndexes[_tri[2]];
+
+				//remove the triangles with too long edges (in 2D first, as it's cheaper)
+				const CCVector2& A = points2D[iA];
+				const CCVector2& B = points2D[iB];
+				const CCVector2& C = points2D[iC];
+				if (	(B-A).norm2() > squareMaxEdgeLength
+					||	(C-B).norm2() > squareMaxEdgeLength
+					||	(A-C).norm2() > squareMaxEdgeLength)
+				{
+					continue;
+				}
+
+				//compute the circumcircle
+				//(the vertices are sorted so that all the tiles get exactly the same result)
+				CCVector2d P0 = CCVector2d(A.x,A.y), P1 = CCVector2d(B.x,B.y), P2 = CCVector2d(C.x,C.y);
+				{
+					unsigned i0 = iA, i1 = iB, i2 = iC;
+					if (i1 < i0) { std::swap(i0,i1); std::swap(P0,P1); }
+					if (i2 < i1) { std::swap(i1,i2); std::swap(P1,P2); }
+					if (i1 < i0) { std::swap(i0,i1); std::swap(P0,P1); }
+				}
+				CCVector2d u = P1 - P0;
+				CCVector2d v = P2 - P0;
+				double d = 2.0 * (u.x * v.y - u.y * v.x);
+				CCVector2d center = (P0 + P1 + P2) / 3.0;
+				double radius = 0;
+				bool checkMargin = (d != 0);
+				if (checkMargin)
+				{
+					double u2 = u.norm2();
+					double v2 = v.norm2();
+					CCVector2d c((v.y * u2 - u.y * v2) / d, (u.x * v2 - v.x * u2) / d);
+					center = P0 + c;
+					radius = c.norm();
+				}
+				//else flat triangle (numerically): we use its barycenter and can't check it
+
+				//the triangle is owned by the tile including its circumcenter (clamped to its bounding box)
+				CCVector2d owner(	std::max(std::min(center.x, std::max(P0.x,std::max(P1.x,P2.x))), std::min(P0.x,std::min(P1.x,P2.x))),
+									std::max(std::min(center.y, std::max(P0.y,std::max(P1.y,P2.y))), std::min(P0.y,std::min(P1.y,P2.y))) );
+				if (grid.tileX(owner.x) != tile.i || grid.tileY(owner.y) != tile.j)
+					continue;
+
+				//remove the triangles with too long edges (in 3D)
+				if (grid.cloud)
+				{
+					const CCVector3* A3D = grid.cloud->getPoint(iA);
+					const CCVector3* B3D = grid.cloud->getPoint(iB);
+					const CCVector3* C3D = grid.cloud->getPoint(iC);
+					if (	(*B3D-*A3D).norm2() > squareMaxEdgeLength
+						||	(*C3D-*B3D).norm2() > squareMaxEdgeLength
+						||	(*A3D-*C3D).norm2() > squareMaxEdgeLength)
+					{
+						continue;
+					}
+				}
+
+				tile.triangles.push_back(static_cast<int>(iA));
+				tile.triangles.push_back(static_cast<int>(iB));
+				tile.triangles.push_back(static_cast<int>(iC));
+
+				//the circumcircle shouldn't contain any point that hasn't been triangulated with the tile
+				if (!checkMargin)
+					continue;
+
+				//we only consider the part of the circle that intersects the domain
+				//(hull triangles can have a huge circumcircle centered outside of the domain)
+				double dx = center.x - std::max(grid.minCorner.x, std::min(grid.maxCorner.x, center.x));
+				double dy = center.y - std::max(grid.minCorner.y, std::min(grid.maxCorner.y, center.y));
+				double halfWidth = sqrt(std::max(0.0, radius*radius - dy*dy));
+				double halfHeight = sqrt(std::max(0.0, radius*radius - dx*dx));
+
+				if (	(openMinX || center.x - halfWidth >= minX)
+					&&	(openMinY || center.y - halfHeight >= minY)
+					&&	(openMaxX || center.x + halfWidth <= maxX)
+					&&	(openMaxY || center.y + halfHeight <= maxY) )
+				{
+					//the circumcircle is inside the tile and its margin
+					continue;
+				}
+
+				//otherwise we look for an outside point inside the circumcircle directly (typically for
+				//the triangles bordering empty areas), starting with the grid tiles the closest to its center
+				const double squareRadius = radius * radius;
+				candidateTiles.resize(0);
+				{
+					int i0 = grid.tileX(center.x - halfWidth), i1 = grid.tileX(center.x + halfWidth);
+					int j0 = grid.tileY(center.y - halfHeight), j1 = grid.tileY(center.y + halfHeight);
+					for (int j=j0; j<=j1; ++j)
+					{
+						double tileMinY = grid.minCorner.y + j * grid.tileSize.y;
+						double ty = std::max(0.0, std::max(tileMinY - center.y, center.y - (tileMinY + grid.tileSize.y)));
+						for (int i=i0; i<=i1; ++i)
+						{
+							double tileMinX = grid.minCorner.x + i * grid.tileSize.x;
+							double tx = std::max(0.0, std::max(tileMinX - center.x, center.x - (tileMinX + grid.tileSize.x)));
+							double squareDist = tx*tx + ty*ty;
+							unsigned t = static_cast<unsigned>(i + j*grid.tileCountX);
+							if (squareDist < squareRadius && grid.tileFirstPoint[t+1] != grid.tileFirstPoint[t])
+								candidateTiles.push_back(std::pair<double,unsigned>(squareDist,t));
+						}
+					}
+					std::sort(candidateTiles.begin(), candidateTiles.end());
+				}
+
+				bool checked = true;
+				bool found = false;
+				for (size_t n=0; n<candidateTiles.size() && checked; ++n)
+				{
+					unsigned t = candidateTiles[n].second;
+					unsigned count = grid.tileFirstPoint[t+1] - grid.tileFirstPoint[t];
+					if (count > pointsToCheck)
+					{
+						//too expensive
+						pointsToCheck = 0;
+						checked = false;
+						break;
+					}
+					pointsToCheck -= count;
+
+					for (unsigned k=grid.tileFirstPoint[t]; k<grid.tileFirstPoint[t+1]; ++k)
+					{
+						unsigned index = grid.pointIndexes[k];
+						const CCVector2& P = points2D[index];
+						if (	(CCVector2d(P.x,P.y) - center).norm2() < squareRadius
+							&&	!IsInside(P, minX, minY, maxX, maxY)
+							&&	!std::binary_search(extraIndexes.begin(), extraIndexes.end(), index))
+						{
+							//the triangle is not valid: this point must be triangulated with the tile
+							//(one point is enough to discard the triangle)
+							newExtraIndexes.push_back(index);
+							found = true;
+							checked = false;
+							break;
+						}
+					}
+				}
+
+				if (!checked && !found)
+				{
+					//too expensive: we'll simply try again with a (reasonably) larger margin
+					requiredMargin = std::max(requiredMargin, 2.0 * margin);
+				}
+			}
+
+			trifree(in.trianglelist);
+			in.trianglelist = 0;
+
+			if (requiredMargin > margin)
+			{
+				//we try again with a larger margin
+				margin = requiredMargin;
+			}
+			else if (!newExtraIndexes.empty())
+			{
+				//we try again with the missing points
+				extraIndexes.insert(extraIndexes.end(), newExtraIndexes.begin(), newExtraIndexes.end());
+				std::sort(extraIndexes.begin(), extraIndexes.end());
+				extraIndexes.erase(std::unique(extraIndexes.begin(), extraIndexes.end()), extraIndexes.end());
+			}
+			else
+			{
+				//all the kept triangles are valid
+				break;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		tile.errorStr = "Not enough memory";
+		if (in.trianglelist)
+			trifree(in.trianglelist);
+		return;
+	}
+	catch (std::exception& e)
+	{
+		tile.errorStr = e.what();
+		if (in.trianglelist)
+			trifree(in.trianglelist);
+		return;
+	}
+	catch (...)
+	{
+		tile.errorStr = "Unknown error";
+		if (in.trianglelist)
+			trifree(in.trianglelist);
+		return;
+	}
+
+	tile.success = true;
+}
+
+//! Min number of points per tile (for the automatic tiling)
+static const size_t s_minPointsPerTile = 50000;
+//! Max number of points per tile (for the automatic tiling)
+static const size_t s_maxPointsPerTile = 1000000;
+
+#endif
+
+bool Delaunay2dMesh::buildMeshByTiles(	const std::vector<CCVector2>& points2D,
+										PointCoordinateType maxEdgeLength,
+										unsigned tileCount/*=0*/,
+										char* outputErrorStr/*=0*/)
+{
+#ifdef USE_TRIANGLE_LIB
+	if (maxEdgeLength <= 0)
+	{
+		if (outputErrorStr)
+			strcpy(outputErrorStr, "Invalid max edge length");
+		return false;
+	}
+	size_t pointCount = points2D.size();
+	if (pointCount < 3)
+	{
+		if (outputErrorStr)
+			strcpy(outputErrorStr, "Not enough points");
+		return false;
+	}
+	if (m_associatedCloud && static_cast<size_t>(m_associatedCloud->size()) != pointCount)
+	{
+		if (outputErrorStr)
+			strcpy(outputErrorStr, "Associated cloud size mismatch");
+		return false;
+	}
+
+	//reset
+	m_numberOfTriangles = 0;
+	if (m_triIndexes)
+	{
+		delete[] m_triIndexes;
+		m_triIndexes = 0;
+	}
+	m_globalIterator = m_globalIteratorEnd = 0;
+
+	DelaunayTilesGrid grid;
+	grid.points2D = &points2D;
+	grid.cloud = m_associatedCloud;
+	grid.maxEdgeLength = static_cast<double>(maxEdgeLength);
+	grid.squareMaxEdgeLength = maxEdgeLength*maxEdgeLength;
+
+	//domain extents
+	grid.minCorner = grid.maxCorner = CCVector2d(points2D[0].x, points2D[0].y);
+	for (size_t i=1; i<pointCount; ++i)
+	{
+		const CCVector2& P = points2D[i];
+		if (P.x < grid.minCorner.x)
+			grid.minCorner.x = P.x;
+		else if (P.x > grid.maxCorner.x)
+			grid.maxCorner.x = P.x;
+		if (P.y < grid.minCorner.y)
+			grid.minCorner.y = P.y;
+		else if (P.y > grid.maxCorner.y)
+			grid.maxCorner.y = P.y;
+	}
+	CCVector2d domainSize = grid.maxCorner - grid.minCorner;
+
+	//number of tiles
+	if (tileCount == 0)
+	{
+		size_t threadCount = 1;
+#ifdef ENABLE_DELAUNAY_TILES_MT
+		threadCount = static_cast<size_t>(std::max(1, QThread::idealThreadCount()));
+#endif
+		//enough tiles to keep all the threads busy, but not too small
+		size_t count = std::max(threadCount * 4, pointCount / s_maxPointsPerTile);
+		count = std::min(count, pointCount / s_minPointsPerTile);
+		tileCount = static_cast<unsigned>(std::max<size_t>(count, 1));
+	}
+	{
+		//the tiles should remain large compared to their margin (and as square as possible)
+		double minTileSize = 8.0 * grid.maxEdgeLength;
+		int maxCountX = static_cast<int>(std::min(domainSize.x / minTileSize, 65536.0));
+		int maxCountY = static_cast<int>(std::min(domainSize.y / minTileSize, 65536.0));
+		double ratio = (domainSize.y > 0 ? domainSize.x / domainSize.y : 1.0);
+		grid.tileCountX = std::max(1, std::min(maxCountX, static_cast<int>(ceil(sqrt(tileCount * ratio)))));
+		grid.tileCountY = std::max(1, std::min(maxCountY, static_cast<int>(ceil(static_cast<double>(tileCount) / grid.tileCountX))));
+		grid.tileSize.x = (domainSize.x > 0 ? domainSize.x / grid.tileCountX : 1.0);
+		grid.tileSize.y = (domainSize.y > 0 ? domainSize.y / grid.tileCountY : 1.0);
+	}
+	unsigned totalTileCount = static_cast<unsigned>(grid.tileCountX * grid.tileCountY);
+
+	std::vector<DelaunayTile> tiles;
+	try
+	{
+		//sort the points by tile
+		grid.tileFirstPoint.resize(totalTileCount+1,0);
+		grid.pointIndexes.resize(pointCount);
+		for (size_t i=0; i<pointCount; ++i)
+		{
+			const CCVector2& P = points2D[i];
+			++grid.tileFirstPoint[grid.tileX(P.x) + grid.tileY(P.y)*grid.tileCountX + 1];
+		}
+		for (unsigned t=0; t<totalTileCount; ++t)
+			grid.tileFirstPoint[t+1] += grid.tileFirstPoint[t];
+		{
+			std::vector<unsigned> fillIndexes(grid.tileFirstPoint.begin(), grid.tileFirstPoint.end()-1);
+			for (size_t i=0; i<pointCount; ++i)
+			{
+				const CCVector2& P = points2D[i];
+				grid.pointIndexes[fillIndexes[grid.tileX(P.x) + grid.tileY(P.y)*grid.tileCountX]++] = static_cast<unsigned>(i);
+			}
+		}
+
+		DelaunayTile tile;
+		tile.grid = &grid;
+		tile.success = false;
+		tiles.resize(totalTileCount, tile);
+		for (unsigned t=0; t<totalTileCount; ++t)
+		{
+			tiles[t].i = static_cast<int>(t % grid.tileCountX);
+			tiles[t].j = static_cast<int>(t / grid.tileCountX);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		if (outputErrorStr)
+			strcpy(outputErrorStr, "Not enough memory");
+		return false;
+	}
+
+	//triangulate each tile
+#ifdef ENABLE_DELAUNAY_TILES_MT
+	QtConcurrent::blockingMap(tiles, TriangulateTile);
+#else
+	for (unsigned t=0; t<totalTileCount; ++t)
+		TriangulateTile(tiles[t]);
+#endif
+
+	//stitch the tiles triangles together
+	size_t triangleCount = 0;
+	for (unsigned t=0; t<totalTileCount; ++t)
+	{
+		if (!tiles[t].success)
+		{
+			if (outputErrorStr)
+				strcpy(outputErrorStr, tiles[t].errorStr.c_str());
+			return false;
+		}
+		triangleCount += tiles[t].triangles.size() / 3;
+	}
+
+	if (triangleCount != 0)
+	{
+		//same allocation as Triangle lib. (see removeTrianglesWithEdgesLongerThan)
+		m_triIndexes = static_cast<int*>(malloc(sizeof(int)*3*triangleCount));
+		if (!m_triIndexes)
+		{
+			//not enough memory
+			if (outputErrorStr)
+				strcpy(outputErrorStr, "Not enough memory");
+			return false;
+		}
+
+		int* _triIndexes = m_triIndexes;
+		for (unsigned t=0; t<totalTileCount; ++t)
+		{
+			std::vector<int>& triangles = tiles[t].triangles;
+			if (!triangles.empty())
+			{
+				memcpy(_triIndexes, &(triangles[0]), sizeof(int)*triangles.size());
+				_triIndexes += triangles.size();
+			}
+			//release memory as soon as possible
+			std::vector<int>().swap(triangles);
+		}
+	}
+	m_numberOfTriangles = static_cast<unsigned>(triangleCount);
+
+	m_globalIterator = m_triIndexes;
+	m_globalIteratorEnd = m_triIndexes + 3*m_numberOfTriangles;
+
+	return true;
+#else
+
+	if (outputErrorStr)
+		strcpy(outputErrorStr, "Triangle library not supported");
+	return false;
+
+#endif
+}
+
 bool Delaunay2dMesh::removeOuterTriangles(	const std::vector<CCVector2>& vertices2D,
 											const std::vector<CCVector2>& polygon2D)
 {
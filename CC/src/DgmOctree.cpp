@@ -155,6 +155,11 @@ void getPointsInTreeCell(octreeTreeCell* cell, CCLib::DgmOctree::NeighboursSet&
 #endif
 #endif
 
+#ifdef ENABLE_MT_OCTREE
+#include <QThread>
+#include <QtConcurrentMap>
+#endif
+
 using namespace CCLib;
 
 bool DgmOctree::MultiThreadSupport()
@@ -166,10 +171,110 @@ bool DgmOctree::MultiThreadSupport()
 #endif
 }
 
+//! Compact description of the cells of a given level, with a direct or hashed lookup
+/** The lookup table contains the position of the cells in 'cells' (or EMPTY_SLOT). It is
+	directly indexed by the truncated cell code when the level is coarse enough, otherwise
+	it's an open addressing hash table (linear probing, load factor <= 0.5).
+**/
+struct DgmOctree::CellsIndexTable
+{
+	//! Cell descriptor
+	struct Cell
+	{
+		//! Truncated cell code
+		OctreeCellCodeType code;
+		//! Index of the first point of the cell (in m_thePointsAndTheirCellCodes)
+		unsigned first;
+		//! Number of points in the cell
+		unsigned count;
+	};
+
+	//! Empty lookup slot
+	static const unsigned EMPTY_SLOT = 0xFFFFFFFF;
+
+	//! Cells (sorted by code)
+	std::vector<Cell> cells;
+	//! Lookup table
+	std::vector<unsigned> slots;
+	//! Whether the lookup table is directly indexed by the cell codes
+	bool direct;
+	//! Number of bits of the hash values
+	unsigned char hashBits;
+
+	//! Computes the lookup table size for a given level and number of cells
+	static size_t LookupSize(unsigned char level, unsigned cellCount, bool& direct, unsigned char& hashBits)
+	{
+		//hash table size: the smallest power of 2 >= 2 * cellCount
+		hashBits = 1;
+		while ((static_cast<size_t>(1) << hashBits) < 2 * static_cast<size_t>(cellCount))
+			++hashBits;
+		size_t hashSize = (static_cast<size_t>(1) << hashBits);
+
+		//direct lookup if it doesn't need more memory
+		direct = (3 * static_cast<unsigned>(level) <= hashBits);
+		return direct ? (static_cast<size_t>(1) << (3 * level)) : hashSize;
+	}
+
+	//! Returns the expected memory usage for a given level and number of cells
+	static size_t ExpectedMemoryUsage(unsigned char level, unsigned cellCount)
+	{
+		bool direct;
+		unsigned char hashBits;
+		return cellCount * sizeof(Cell) + LookupSize(level, cellCount, direct, hashBits) * sizeof(unsigned);
+	}
+
+	//! Returns the memory used by the table
+	size_t memoryUsage() const
+	{
+		return cells.capacity() * sizeof(Cell) + slots.capacity() * sizeof(unsigned);
+	}
+
+	//! Returns the hash value of a code
+	inline size_t hash(OctreeCellCodeType code) const
+	{
+		//Fibonacci hashing
+		return static_cast<size_t>((static_cast<unsigned long long>(code) * 11400714819323198485ULL) >> (64 - hashBits));
+	}
+
+	//! Returns the index of the first point of a cell (or 'notFound')
+	inline unsigned cellIndex(OctreeCellCodeType code, unsigned notFound) const
+	{
+		if (direct)
+		{
+			if (code >= slots.size())
+				return notFound;
+			unsigned slot = slots[static_cast<size_t>(code)];
+			return slot != EMPTY_SLOT ? cells[slot].first : notFound;
+		}
+
+		const size_t mask = slots.size() - 1;
+		for (size_t h = hash(code); ; h = ((h + 1) & mask))
+		{
+			unsigned slot = slots[h];
+			if (slot == EMPTY_SLOT)
+				return notFound;
+			if (cells[slot].code == code)
+				return cells[slot].first;
+		}
+	}
+};
+
+const unsigned DgmOctree::CellsIndexTable::EMPTY_SLOT;
+
+inline const CCVector3* DgmOctree::getCodeOrderedPoint(cellsContainer::const_iterator p) const
+{
+	return m_codeOrderedPoints.empty()	? m_theAssociatedCloud->getPointPersistentPtr(p->theIndex)
+										: &m_codeOrderedPoints[p - m_thePointsAndTheirCellCodes.begin()];
+}
+
 DgmOctree::DgmOctree(GenericIndexedCloudPersist* cloud)
 	: m_theAssociatedCloud(cloud)
 	, m_numberOfProjectedPoints(0)
+	, m_cellsIndexTablesMaxMemory(DEFAULT_CELLS_INDEX_TABLES_MAX_MEMORY)
+	, m_codeOrderedPointsCopyEnabled(false)
 {
+	memset(m_cellsIndexTables, 0, sizeof(CellsIndexTable*)*(MAX_OCTREE_LEVEL+1));
+
 	clear();
 
 	assert(m_theAssociatedCloud);
@@ -177,6 +282,8 @@ DgmOctree::DgmOctree(GenericIndexedCloudPersist* cloud)
 
 DgmOctree::~DgmOctree()
 {
+	releaseCellsIndexTables();
+
 #ifdef OCTREE_TREE_TEST
 	if (s_root)
 		delete s_root;
@@ -191,6 +298,9 @@ void DgmOctree::clear()
 
 	m_numberOfProjectedPoints = 0;
 	m_thePointsAndTheirCellCodes.clear();
+	releaseCellsIndexTables();
+	//the copy in cell code order stays enabled (see genericBuild)
+	m_codeOrderedPoints.clear();
 
 	memset(m_fillIndexes,0,sizeof(int)*(MAX_OCTREE_LEVEL+1)*6);
 	memset(m_cellSize,0,sizeof(PointCoordinateType)*(MAX_OCTREE_LEVEL+2));
@@ -360,6 +470,13 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 	//update the pre-computed 'number of cells per level of subdivision' array
 	updateCellCountTable();
 
+	//update the copy of the points in cell code order (if enabled)
+	if (m_codeOrderedPointsCopyEnabled && !updateCodeOrderedPointsCopy())
+	{
+		//not enough memory: we continue without it
+		m_codeOrderedPointsCopyEnabled = false;
+	}
+
 	//end of process notification
 	if (progressCb)
 	{
@@ -715,6 +832,11 @@ bool DgmOctree::getPointsInCell(OctreeCellCodeType cellCode,
 
 unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec) const
 {
+	//direct or hashed lookup if the cells index table is available
+	const CellsIndexTable* table = m_cellsIndexTables[MAX_OCTREE_LEVEL - bitDec/3];
+	if (table)
+		return table->cellIndex(truncatedCellCode, m_numberOfProjectedPoints);
+
 	//inspired from the algorithm proposed by MATT PULVER (see http://eigenjoy.com/2011/01/21/worlds-fastest-binary-search/)
 	//DGM:	it's not faster, but the code is simpler ;)
 	unsigned i = 0;
@@ -759,6 +881,11 @@ unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned
 	assert(end >= begin);
 	assert(end < m_numberOfProjectedPoints);
 
+	//the search interval doesn't matter if the cells index table is available
+	const CellsIndexTable* table = m_cellsIndexTables[MAX_OCTREE_LEVEL - bitDec/3];
+	if (table)
+		return table->cellIndex(truncatedCellCode, m_numberOfProjectedPoints);
+
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 	s_binarySearchCount += 1;
 #endif
@@ -825,6 +952,11 @@ unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned
 	assert(truncatedCellCode != INVALID_CELL_CODE);
 	assert(end >= begin && end < m_numberOfProjectedPoints);
 
+	//the search interval doesn't matter if the cells index table is available
+	const CellsIndexTable* table = m_cellsIndexTables[MAX_OCTREE_LEVEL - bitDec/3];
+	if (table)
+		return table->cellIndex(truncatedCellCode, m_numberOfProjectedPoints);
+
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 	s_binarySearchCount += 1;
 #endif
@@ -1096,7 +1228,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 						{
 							if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 							{
-								PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+								PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 								nNSS.pointsInNeighbourhood.push_back(newPoint);
 							}
 						}
@@ -1127,7 +1259,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 						{
 							if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 							{
-								PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+								PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 								nNSS.pointsInNeighbourhood.push_back(newPoint);
 							}
 						}
@@ -1155,7 +1287,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 						{
 							if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 							{
-								PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+								PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 								nNSS.pointsInNeighbourhood.push_back(newPoint);
 							}
 						}
@@ -1191,7 +1323,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 			for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == truncatedCellCode); ++p)
 			{
-				PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+				PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 				nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
 			}
 		}
@@ -1246,7 +1378,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1286,7 +1418,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1326,7 +1458,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1366,7 +1498,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1405,7 +1537,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c1); ++p)
 						{
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 							nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
 						}
 
@@ -1444,7 +1576,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c1); ++p)
 						{
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 							nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
 						}
 
@@ -1581,7 +1713,7 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 			while (m < m_numberOfProjectedPoints && (p->theCode >> bitDec) == code)
 			{
 				//square distance to query point
-				double dist2 = (*m_theAssociatedCloud->getPointPersistentPtr(p->theIndex) - nNSS.queryPoint).norm2d();
+				double dist2 = (*getCodeOrderedPoint(p) - nNSS.queryPoint).norm2d();
 				//we keep track of the closest one
 				if (dist2 < minSquareDist || minSquareDist < 0)
 				{
@@ -1663,7 +1795,7 @@ unsigned DgmOctree::findNearestNeighborsStartingFromCell(	NearestNeighboursSearc
 			{
 				if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 				{
-					PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+					PointDescriptor newPoint(getCodeOrderedPoint(p),p->theIndex);
 					nNSS.pointsInNeighbourhood.push_back(newPoint);
 					++p;
 				}
@@ -1865,7 +1997,7 @@ int DgmOctree::getPointsInSphericalNeighbourhood(	const CCVector3& sphereCenter,
 						//while the (partial) cell code matches this cell
 						for ( ; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == searchCode); ++p)
 						{
-							const CCVector3* P = m_theAssociatedCloud->getPoint(p->theIndex);
+							const CCVector3* P = getCodeOrderedPoint(p);
 							double d2 = (*P - sphereCenter).norm2d();
 							//we keep the points falling inside the sphere
 							if (d2 <= squareRadius)
@@ -1987,7 +2119,7 @@ size_t DgmOctree::getPointsInCylindricalNeighbourhood(CylindricalNeighbourhood&
 						//while the (partial) cell code matches this cell
 						for ( ; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == searchCode); ++p)
 						{
-							const CCVector3* P = m_theAssociatedCloud->getPoint(p->theIndex);
+							const CCVector3* P = getCodeOrderedPoint(p);
 
 							//we keep the points falling inside the sphere
 							CCVector3 OP = (*P - params.center);
@@ -2145,7 +2277,7 @@ size_t DgmOctree::getPointsInCylindricalNeighbourhoodProgressive(ProgressiveCyli
 							//while the (partial) cell code matches this cell
 							for ( ; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == searchCode); ++p)
 							{
-								const CCVector3* P = m_theAssociatedCloud->getPoint(p->theIndex);
+								const CCVector3* P = getCodeOrderedPoint(p);
 
 								//we keep the points falling inside the sphere
 								CCVector3 OP = (*P - params.center);
@@ -2508,7 +2640,7 @@ int DgmOctree::getPointsInSphericalNeighbourhood(const CCVector3& sphereCenter,
 					if (uniquePointCell)
 					{
 						//we test the point directly!
-						const CCVector3* P = m_theAssociatedCloud->getPointPersistentPtr(p->theIndex);
+						const CCVector3* P = getCodeOrderedPoint(p);
 						PointCoordinateType d2 = (*P - sphereCenter).norm2();
 
 						if (d2 <= squareRadius)
@@ -2585,7 +2717,7 @@ int DgmOctree::getPointsInSphericalNeighbourhood(const CCVector3& sphereCenter,
 				else
 				{
 					//otherwise we have to test the point
-					const CCVector3* P = m_theAssociatedCloud->getPointPersistentPtr(p->theIndex);
+					const CCVector3* P = getCodeOrderedPoint(p);
 					PointCoordinateType d2 = (*P - sphereCenter).norm2();
 
 					if (d2<=squareRadius)
@@ -2894,6 +3026,166 @@ double DgmOctree::computeMeanOctreeDensity(unsigned char level) const
 	return static_cast<double>(m_numberOfProjectedPoints)/static_cast<double>(getCellNumber(level));
 }
 
+bool DgmOctree::prepareCellsIndexTable(unsigned char level)
+{
+	assert(level <= MAX_OCTREE_LEVEL);
+
+	if (m_cellsIndexTables[level])
+		return true;
+
+	if (m_thePointsAndTheirCellCodes.empty())
+		return false;
+
+	//memory budget
+	const unsigned cellCount = getCellNumber(level);
+	size_t required = CellsIndexTable::ExpectedMemoryUsage(level, cellCount);
+	if (required > m_cellsIndexTablesMaxMemory)
+		return false;
+
+	//we release the other levels tables if necessary
+	trimCellsIndexTables(required);
+
+	CellsIndexTable* table = new CellsIndexTable;
+	try
+	{
+		size_t lookupSize = CellsIndexTable::LookupSize(level, cellCount, table->direct, table->hashBits);
+		table->cells.reserve(cellCount);
+		table->slots.resize(lookupSize, CellsIndexTable::EMPTY_SLOT);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		delete table;
+		return false;
+	}
+
+	//the cells (the points are sorted by code)
+	unsigned char bitDec = GET_BIT_SHIFT(level);
+	for (unsigned i = 0; i < m_numberOfProjectedPoints; ++i)
+	{
+		OctreeCellCodeType truncatedCode = (m_thePointsAndTheirCellCodes[i].theCode >> bitDec);
+		if (table->cells.empty() || table->cells.back().code != truncatedCode)
+		{
+			CellsIndexTable::Cell cell;
+			cell.code = truncatedCode;
+			cell.first = i;
+			cell.count = 1;
+			table->cells.push_back(cell); //can't fail (see above)
+		}
+		else
+		{
+			++table->cells.back().count;
+		}
+	}
+	assert(table->cells.size() == cellCount);
+
+	//the lookup table
+	const size_t mask = table->slots.size() - 1;
+	for (unsigned i = 0; i < static_cast<unsigned>(table->cells.size()); ++i)
+	{
+		OctreeCellCodeType code = table->cells[i].code;
+		if (table->direct)
+		{
+			table->slots[static_cast<size_t>(code)] = i;
+		}
+		else
+		{
+			size_t h = table->hash(code);
+			while (table->slots[h] != CellsIndexTable::EMPTY_SLOT)
+				h = ((h + 1) & mask);
+			table->slots[h] = i;
+		}
+	}
+
+	m_cellsIndexTables[level] = table;
+	return true;
+}
+
+void DgmOctree::releaseCellsIndexTables()
+{
+	for (int i = 0; i <= MAX_OCTREE_LEVEL; ++i)
+	{
+		delete m_cellsIndexTables[i];
+		m_cellsIndexTables[i] = 0;
+	}
+}
+
+size_t DgmOctree::getCellsIndexTablesMemoryUsage() const
+{
+	size_t usage = 0;
+	for (int i = 0; i <= MAX_OCTREE_LEVEL; ++i)
+		if (m_cellsIndexTables[i])
+			usage += m_cellsIndexTables[i]->memoryUsage();
+	return usage;
+}
+
+void DgmOctree::setCellsIndexTablesMaxMemory(size_t maxMemory)
+{
+	m_cellsIndexTablesMaxMemory = maxMemory;
+	trimCellsIndexTables(0);
+}
+
+bool DgmOctree::setCodeOrderedPointsCopy(bool state)
+{
+	m_codeOrderedPointsCopyEnabled = state;
+
+	if (!updateCodeOrderedPointsCopy())
+	{
+		m_codeOrderedPointsCopyEnabled = false;
+		return false;
+	}
+
+	return true;
+}
+
+bool DgmOctree::updateCodeOrderedPointsCopy()
+{
+	//we release the previous copy first
+	std::vector<CCVector3>().swap(m_codeOrderedPoints);
+
+	if (!m_codeOrderedPointsCopyEnabled || m_thePointsAndTheirCellCodes.empty())
+		return true;
+
+	try
+	{
+		m_codeOrderedPoints.resize(m_numberOfProjectedPoints);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		std::vector<CCVector3>().swap(m_codeOrderedPoints);
+		return false;
+	}
+
+	for (unsigned i = 0; i < m_numberOfProjectedPoints; ++i)
+	{
+		m_codeOrderedPoints[i] = *m_theAssociatedCloud->getPointPersistentPtr(m_thePointsAndTheirCellCodes[i].theIndex);
+	}
+
+	return true;
+}
+
+size_t DgmOctree::getCodeOrderedPointsCopyMemoryUsage() const
+{
+	return m_codeOrderedPoints.capacity() * sizeof(CCVector3);
+}
+
+void DgmOctree::trimCellsIndexTables(size_t required)
+{
+	//we release the biggest tables first
+	while (getCellsIndexTablesMemoryUsage() + required > m_cellsIndexTablesMaxMemory)
+	{
+		int biggestLevel = -1;
+		for (int i = 0; i <= MAX_OCTREE_LEVEL; ++i)
+		{
+			if (m_cellsIndexTables[i] && (biggestLevel < 0 || m_cellsIndexTables[i]->cells.size() > m_cellsIndexTables[biggestLevel]->cells.size()))
+				biggestLevel = i;
+		}
+		if (biggestLevel < 0)
+			break;
+		delete m_cellsIndexTables[biggestLevel];
+		m_cellsIndexTables[biggestLevel] = 0;
+	}
+}
+
 bool DgmOctree::getCellCodesAndIndexes(unsigned char level, cellsContainer& vec, bool truncatedCodes/*=false*/) const
 {
 	try
@@ -3146,14 +3438,245 @@ void DgmOctree::diff(unsigned char octreeLevel, const cellsContainer &codesA, co
 	}
 }
 
-int DgmOctree::extractCCs(unsigned char level, bool sixConnexity, GenericProgressCallback* progressCb) const
+//! Returns the root of a connected component (union-find with path halving)
+/** The root of a component is always its smallest cell index.
+**/
+static inline unsigned FindCCRoot(std::vector<unsigned>& parent, unsigned i)
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+//! Merges the connected components of two cells (the smallest root is kept)
+static inline void MergeCCs(std::vector<unsigned>& parent, unsigned a, unsigned b)
+{
+	unsigned rootA = FindCCRoot(parent,a);
+	unsigned rootB = FindCCRoot(parent,b);
+	if (rootA < rootB)
+		parent[rootB] = rootA;
+	else if (rootB < rootA)
+		parent[rootA] = rootB;
+}
+
+//! Parameters shared by the connected components labelling jobs (see DgmOctree::extractCCs)
+struct CCLabellingContext
+{
+	//! Input cells (sorted by slice, then row, then column)
+	const std::vector<DgmOctree::IndexAndCode>* cells;
+	//! Union-find parent of each cell
+	std::vector<unsigned>* parent;
+	//! Octree level
+	unsigned char level;
+	//! Min cell position
+	Tuple3i indexMin;
+	//! Width of a virtual slice (with margin)
+	int rowSize;
+	//! Size of a virtual slice (with margin)
+	int sliceSize;
+	//! Number of (already processed) neighbors in the current slice
+	unsigned char neighborsInCurrentSlice;
+	//! Number of neighbors in the preceding slice
+	unsigned char neighborsInPrecedingSlice;
+	//! Relative positions of the neighbors in the current slice
+	int currentSliceNeighborsShifts[4];
+	//! Relative positions of the neighbors in the preceding slice
+	int precedingSliceNeighborsShifts[9];
+
+	//! Returns the slice of a cell
+	inline int sliceOf(size_t i) const { return static_cast<int>((*cells)[i].theIndex >> (level<<1)); }
+
+	//! Returns the position of a cell inside its (virtual) slice
+	inline int posInSlice(size_t i) const
+	{
+		const unsigned gridCoordMask = (1 << level)-1;
+		int iind = static_cast<int>((*cells)[i].theIndex & gridCoordMask);
+		int jind = static_cast<int>(((*cells)[i].theIndex >> level) & gridCoordMask);
+		return (iind-indexMin.x+1) + (jind-indexMin.y+1)*rowSize;
+	}
+};
+
+//! Connected components labelling job (a slab of consecutive slices)
+struct CCLabellingSlab
+{
+	const CCLabellingContext* context;
+	size_t firstCell;
+	size_t lastCell;
+	NormalizedProgress* nprogress;
+	bool success;
+};
+
+static void LabelCCsInSlab(CCLabellingSlab& slab)
+{
+	const CCLabellingContext& ctx = *slab.context;
+	std::vector<unsigned>& parent = *ctx.parent;
+
+	//virtual slices (cell index + 1, or 0 if empty)
+	std::vector<unsigned> slice, oldSlice;
+	try
+	{
+		slice.resize(ctx.sliceSize,0);
+		oldSlice.resize(ctx.sliceSize,0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		slab.success = false;
+		return;
+	}
+
+	size_t prevFirst = slab.firstCell, prevLast = slab.firstCell;
+	int prevSlice = 0;
+	size_t i = slab.firstCell;
+	while (i < slab.lastCell)
+	{
+		int k = ctx.sliceOf(i);
+		bool hasPrecedingSlice = (prevLast != prevFirst && prevSlice+1 == k);
+		size_t sliceFirst = i;
+
+		//for each cell of the slice
+		for ( ; i < slab.lastCell && ctx.sliceOf(i) == k; ++i)
+		{
+			int cellIndex = ctx.posInSlice(i);
+
+			//we look if the cell has neighbors inside the slice
+			unsigned* _slice = &(slice[cellIndex]);
+			for (unsigned char n=0; n<ctx.neighborsInCurrentSlice; n++)
+			{
+				assert(cellIndex+ctx.currentSliceNeighborsShifts[n] < ctx.sliceSize);
+				unsigned neighbor = _slice[ctx.currentSliceNeighborsShifts[n]];
+				if (neighbor != 0)
+					MergeCCs(parent, static_cast<unsigned>(i), neighbor-1);
+			}
+
+			//and in the previous slice
+			if (hasPrecedingSlice)
+			{
+				const unsigned* _oldSlice = &(oldSlice[cellIndex]);
+				for (unsigned char n=0; n<ctx.neighborsInPrecedingSlice; n++)
+				{
+					assert(cellIndex+ctx.precedingSliceNeighborsShifts[n] < ctx.sliceSize);
+					unsigned neighbor = _oldSlice[ctx.precedingSliceNeighborsShifts[n]];
+					if (neighbor != 0)
+						MergeCCs(parent, static_cast<unsigned>(i), neighbor-1);
+				}
+			}
+
+			*_slice = static_cast<unsigned>(i)+1;
+		}
+
+		//the current slice becomes the preceding one (and the oldest one is cleared)
+		for (size_t j=prevFirst; j<prevLast; ++j)
+			oldSlice[ctx.posInSlice(j)] = 0;
+		std::swap(slice,oldSlice);
+		prevFirst = sliceFirst;
+		prevLast = i;
+		prevSlice = k;
+
+		if (slab.nprogress)
+			slab.nprogress->oneStep();
+	}
+
+	slab.success = true;
+}
+
+int DgmOctree::extractCCs(	unsigned char level,
+							bool sixConnexity,
+							GenericProgressCallback* progressCb,
+							std::vector<ConnectedComponentInfo>* componentsInfo) const
 {
 	std::vector<OctreeCellCodeType> cellCodes;
 	getCellCodes(level,cellCodes);
-	return extractCCs(cellCodes, level, sixConnexity, progressCb);
+	return extractCCs(cellCodes, level, sixConnexity, progressCb, componentsInfo);
 }
 
-int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char level, bool sixConnexity, GenericProgressCallback* progressCb) const
+//! Connected component description (partial, see DgmOctree::extractCCs)
+struct PartialCCInfo
+{
+	unsigned label;
+	DgmOctree::ConnectedComponentInfo info;
+};
+
+//! Job for flagging the points with their connected component label (a range of cells)
+struct CCFlaggingJob
+{
+	const DgmOctree* octree;
+	const std::vector<DgmOctree::IndexAndCode>* cells;
+	const std::vector<unsigned>* labels;
+	unsigned char level;
+	size_t firstCell;
+	size_t lastCell;
+	//! Per-component statistics (optional, consecutive cells with the same label are merged)
+	std::vector<PartialCCInfo>* infos;
+	NormalizedProgress* nprogress;
+	bool success;
+};
+
+static void FlagCCPoints(CCFlaggingJob& job)
+{
+	job.success = true;
+	try
+	{
+		ReferenceCloud Y(job.octree->associatedCloud());
+		for (size_t i=job.firstCell; i<job.lastCell; i++)
+		{
+			unsigned label = (*job.labels)[i];
+			assert(label > 0);
+			job.octree->getPointsInCell((*job.cells)[i].theCode,job.level,&Y,true);
+			Y.placeIteratorAtBegining();
+			ScalarType d = static_cast<ScalarType>(label);
+			for (unsigned j=0; j<Y.size(); ++j)
+			{
+				Y.setCurrentPointScalarValue(d);
+				Y.forwardIterator();
+			}
+
+			if (job.infos && Y.size() != 0)
+			{
+				if (job.infos->empty() || job.infos->back().label != label)
+				{
+					PartialCCInfo cc;
+					cc.label = label;
+					cc.info.pointCount = 0;
+					cc.info.cellCount = 0;
+					cc.info.bbMin = cc.info.bbMax = *Y.getPoint(0);
+					job.infos->push_back(cc);
+				}
+				DgmOctree::ConnectedComponentInfo& info = job.infos->back().info;
+				info.pointCount += Y.size();
+				++info.cellCount;
+				for (unsigned j=0; j<Y.size(); ++j)
+				{
+					const CCVector3* P = Y.getPoint(j);
+					for (unsigned char k=0; k<3; ++k)
+					{
+						if (P->u[k] < info.bbMin.u[k])
+							info.bbMin.u[k] = P->u[k];
+						else if (P->u[k] > info.bbMax.u[k])
+							info.bbMax.u[k] = P->u[k];
+					}
+				}
+			}
+
+			if (job.nprogress)
+				job.nprogress->oneStep();
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		job.success = false;
+	}
+}
+
+int DgmOctree::extractCCs(	const cellCodesContainer& cellCodes,
+							unsigned char level,
+							bool sixConnexity,
+							GenericProgressCallback* progressCb,
+							std::vector<ConnectedComponentInfo>* componentsInfo) const
 {
 	size_t numberOfCells = cellCodes.size();
 	if (numberOfCells == 0) //no cells!
@@ -3171,8 +3694,8 @@ int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char lev
 		return -2;
 	}
 
-    //we compute the position of each cell (grid coordinates)
-    Tuple3i indexMin, indexMax;
+	//we compute the position of each cell (grid coordinates)
+	Tuple3i indexMin, indexMax;
 	{
 		//binary shift for cell code truncation
 		unsigned char bitDec = GET_BIT_SHIFT(level);
@@ -3210,328 +3733,310 @@ int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char lev
 		}
 	}
 
-    //we deduce the size of the grid that totally includes input cells
-    Tuple3i gridSize = indexMax - indexMin + Tuple3i(1,1,1);
+	//we deduce the size of the grid that totally includes input cells
+	Tuple3i gridSize = indexMax - indexMin + Tuple3i(1,1,1);
 
-    //we sort the cells
-    std::sort(ccCells.begin(),ccCells.end(),IndexAndCode::indexComp); //ascending index code order
+	//we sort the cells
+	std::sort(ccCells.begin(),ccCells.end(),IndexAndCode::indexComp); //ascending index code order
 
-    const int& di = gridSize.x;
-    const int& dj = gridSize.y;
-    const int& step = gridSize.z;
+	const int& di = gridSize.x;
+	const int& dj = gridSize.y;
+	const int& step = gridSize.z;
 
-    //relative neighbos positions (either 6 or 26 total - but we only use half of it)
-    unsigned char neighborsInCurrentSlice = 0, neighborsInPrecedingSlice = 0;
-    int currentSliceNeighborsShifts[4], precedingSliceNeighborsShifts[9]; //maximum size to simplify code...
+	CCLabellingContext context;
+	context.cells = &ccCells;
+	context.level = level;
+	context.indexMin = indexMin;
+	context.rowSize = di+2;
+	context.sliceSize = (di+2)*(dj+2); //add a margin to avoid "boundary effects"
 
+	//relative neighbos positions (either 6 or 26 total - but we only use half of it)
 	if (sixConnexity) //6-connexity
-    {
-        neighborsInCurrentSlice = 2;
-        currentSliceNeighborsShifts[0] = -(di+2);
-        currentSliceNeighborsShifts[1] = -1;
-
-        neighborsInPrecedingSlice = 1;
-        precedingSliceNeighborsShifts[0] = 0;
-    }
-    else //26-connexity
-    {
-        neighborsInCurrentSlice = 4;
-        currentSliceNeighborsShifts[0] = -1-(di+2);
-        currentSliceNeighborsShifts[1] = -(di+2);
-        currentSliceNeighborsShifts[2] = 1-(di+2);
-        currentSliceNeighborsShifts[3] = -1;
-
-        neighborsInPrecedingSlice = 9;
-        precedingSliceNeighborsShifts[0] = -1-(di+2);
-        precedingSliceNeighborsShifts[1] = -(di+2);
-        precedingSliceNeighborsShifts[2] = 1-(di+2);
-        precedingSliceNeighborsShifts[3] = -1;
-        precedingSliceNeighborsShifts[4] = 0;
-        precedingSliceNeighborsShifts[5] = 1;
-        precedingSliceNeighborsShifts[6] = -1+(di+2);
-        precedingSliceNeighborsShifts[7] = (di+2);
-        precedingSliceNeighborsShifts[8] = 1+(di+2);
-    }
-
-	//shared structures (to avoid repeated allocations)
-    std::vector<int> neighboursVal, neighboursMin;
-	try
 	{
-		neighboursVal.reserve(neighborsInCurrentSlice+neighborsInPrecedingSlice);
-		neighboursMin.reserve(neighborsInCurrentSlice+neighborsInPrecedingSlice);
+		context.neighborsInCurrentSlice = 2;
+		context.currentSliceNeighborsShifts[0] = -(di+2);
+		context.currentSliceNeighborsShifts[1] = -1;
+
+		context.neighborsInPrecedingSlice = 1;
+		context.precedingSliceNeighborsShifts[0] = 0;
 	}
-	catch (const std::bad_alloc&)
+	else //26-connexity
 	{
-		//not enough memory
-		return -2;
+		context.neighborsInCurrentSlice = 4;
+		context.currentSliceNeighborsShifts[0] = -1-(di+2);
+		context.currentSliceNeighborsShifts[1] = -(di+2);
+		context.currentSliceNeighborsShifts[2] = 1-(di+2);
+		context.currentSliceNeighborsShifts[3] = -1;
+
+		context.neighborsInPrecedingSlice = 9;
+		context.precedingSliceNeighborsShifts[0] = -1-(di+2);
+		context.precedingSliceNeighborsShifts[1] = -(di+2);
+		context.precedingSliceNeighborsShifts[2] = 1-(di+2);
+		context.precedingSliceNeighborsShifts[3] = -1;
+		context.precedingSliceNeighborsShifts[4] = 0;
+		context.precedingSliceNeighborsShifts[5] = 1;
+		context.precedingSliceNeighborsShifts[6] = -1+(di+2);
+		context.precedingSliceNeighborsShifts[7] = (di+2);
+		context.precedingSliceNeighborsShifts[8] = 1+(di+2);
 	}
 
-    //temporary virtual 'slices'
-    int sliceSize = (di+2)*(dj+2); //add a margin to avoid "boundary effects"
-	std::vector<int> slice;
-	std::vector<int> oldSlice;
-    //equivalence table between 'on the fly' labels
-	std::vector<int> equivalentLabels;
-    std::vector<int> cellIndexToLabel;
-
+	//union-find structure (the root of each component is its first cell)
+	std::vector<unsigned> parent;
 	try
 	{
-		slice.resize(sliceSize);
-		oldSlice.resize(sliceSize,0); //previous slice is empty by default
-		equivalentLabels.resize(numberOfCells+2,0);
-		cellIndexToLabel.resize(numberOfCells,0);
+		parent.resize(numberOfCells);
 	}
 	catch (const std::bad_alloc&)
 	{
 		//not enough memory
 		return -2;
 	}
+	for (size_t i=0; i<numberOfCells; i++)
+		parent[i] = static_cast<unsigned>(i);
+	context.parent = &parent;
 
-    //progress notification
-    if (progressCb)
-    {
-        progressCb->reset();
-        progressCb->setMethodTitle("Components Labeling");
-        char buffer[256];
+	//progress notification
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Components Labeling");
+		char buffer[256];
 		sprintf(buffer,"Box: [%i*%i*%i]",gridSize.x,gridSize.y,gridSize.z);
-        progressCb->setInfo(buffer);
-        progressCb->start();
-    }
-
-    //current label
-    size_t currentLabel = 1;
+		progressCb->setInfo(buffer);
+		progressCb->start();
+	}
 
-    //process each slice
+	//the slices are split in slabs (with approximately the same number of cells) labelled independently
+	std::vector<CCLabellingSlab> slabs;
 	{
-		unsigned counter = 0;
-		const unsigned gridCoordMask = (1 << level)-1;
-		std::vector<IndexAndCode>::const_iterator _ccCells = ccCells.begin();
 		NormalizedProgress nprogress(progressCb,step);
 
-		for (int k = indexMin.z; k < indexMin.z+step; k++)
+		size_t slabCount = 1;
+#ifdef ENABLE_MT_OCTREE
+		slabCount = static_cast<size_t>(std::max(1,QThread::idealThreadCount()));
+#endif
+		try
 		{
-			//initialize the 'current' slice
-			std::fill(slice.begin(),slice.end(),0);
-
-			//for each cell of the slice
-			while (counter<numberOfCells && static_cast<int>(_ccCells->theIndex >> (level<<1)) == k)
+			CCLabellingSlab slab;
+			slab.context = &context;
+			slab.nprogress = progressCb ? &nprogress : 0;
+			slab.success = false;
+			slab.lastCell = 0;
+			for (size_t s=1; s<=slabCount && slab.lastCell<numberOfCells; ++s)
 			{
-				int iind = static_cast<int>(_ccCells->theIndex & gridCoordMask);
-				int jind = static_cast<int>((_ccCells->theIndex >> level) & gridCoordMask);
-				int cellIndex = (iind-indexMin.x+1) + (jind-indexMin.y+1)*(di+2);
-				++_ccCells;
-
-				//we look if the cell has neighbors inside the slice
-				int* _slice = &(slice[cellIndex]);
-				{
-					for (unsigned char n=0; n<neighborsInCurrentSlice; n++)
-					{
-						assert(cellIndex+currentSliceNeighborsShifts[n] < sliceSize);
-						const int& neighborLabel = _slice[currentSliceNeighborsShifts[n]];
-						if (neighborLabel > 1)
-							neighboursVal.push_back(neighborLabel);
-					}
-				}
-
-				//and in the previous slice
-				const int* _oldSlice = &(oldSlice[cellIndex]);
-				{
-					for (unsigned char n=0; n<neighborsInPrecedingSlice; n++)
-					{
-						assert(cellIndex+precedingSliceNeighborsShifts[n] < sliceSize);
-						const int& neighborLabel = _oldSlice[precedingSliceNeighborsShifts[n]];
-						if (neighborLabel > 1)
-							neighboursVal.push_back(neighborLabel);
-					}
-				}
-
-				//number of neighbors for current cell
-				size_t p = neighboursVal.size();
-
-				if (p == 0) //no neighbor
-				{
-					*_slice = static_cast<int>(++currentLabel); //we create a new label
-				}
-				else if (p == 1) //1 neighbor
-				{
-					*_slice = neighboursVal.back(); //we'll use its label
-					neighboursVal.pop_back();
-				}
-				else //more than 1 neighbor?
-				{
-					//we get the smallest label
-					std::sort(neighboursVal.begin(),neighboursVal.end());
-					int smallestLabel = neighboursVal[0];
-
-					//if they are not the same
-					if (smallestLabel != neighboursVal.back())
-					{
-						int lastLabel = 0;
-						neighboursMin.clear();
-						//we get the smallest equivalent label for each neighbor's branch
-						{
-							for (size_t n=0; n<p; n++)
-							{
-								// ... we start from its C.C. index
-								int label = neighboursVal[n];
-								//if it's not the same as the previous neighbor's
-								if (label != lastLabel)
-								{
-									//we update the 'before' value
-									assert(label < static_cast<int>(numberOfCells)+2);
-									lastLabel = label;
-
-									//we look for its real equivalent value
-									while (equivalentLabels[label] > 1)
-									{
-										label = equivalentLabels[label];
-										assert(label < static_cast<int>(numberOfCells)+2);
-									}
-
-									neighboursMin.push_back(label);
-								}
-							}
-						}
-
-						//get the smallest one
-						std::sort(neighboursMin.begin(),neighboursMin.end());
-						smallestLabel = neighboursMin.front();
-
-						//update the equivalence table by the way
-						//for all other branches
-						lastLabel = smallestLabel;
-						{
-							for (size_t n=1; n<neighboursMin.size(); n++)
-							{
-								int label = neighboursMin[n];
-								assert(label < static_cast<int>(numberOfCells)+2);
-								//we don't process it if it's the same label as the previous neighbor
-								if (label != lastLabel)
-								{
-									equivalentLabels[label] = smallestLabel;
-									lastLabel = label;
-								}
-							}
-						}
-					}
-
-					//update current cell label
-					*_slice = smallestLabel;
-					neighboursVal.clear();
-				}
-
-				cellIndexToLabel[counter++] = *_slice;
+				slab.firstCell = slab.lastCell;
+				//a slab always ends with a complete slice
+				slab.lastCell = std::max(slab.firstCell+1, (numberOfCells * s) / slabCount);
+				while (slab.lastCell < numberOfCells && context.sliceOf(slab.lastCell) == context.sliceOf(slab.lastCell-1))
+					++slab.lastCell;
+				slabs.push_back(slab);
 			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return -2;
+		}
 
-			if (counter == numberOfCells)
-				break;
-
-			std::swap(slice,oldSlice);
+#ifdef ENABLE_MT_OCTREE
+		QtConcurrent::blockingMap(slabs, LabelCCsInSlab);
+#else
+		for (size_t s=0; s<slabs.size(); ++s)
+			LabelCCsInSlab(slabs[s]);
+#endif
 
-			nprogress.oneStep();
+		for (size_t s=0; s<slabs.size(); ++s)
+		{
+			if (!slabs[s].success)
+			{
+				//not enough memory
+				if (progressCb)
+					progressCb->stop();
+				return -2;
+			}
 		}
 	}
 
-    //release some memory
-    slice.clear();
-    oldSlice.clear();
-
-    if (progressCb)
+	//merge the components across the slabs borders
+	if (slabs.size() > 1)
 	{
-		progressCb->stop();
-	}
-
-    if (currentLabel < 2)
-    {
-		//No component found
-        return -3;
-    }
+		std::vector<unsigned> oldSlice;
+		try
+		{
+			oldSlice.resize(context.sliceSize,0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			if (progressCb)
+				progressCb->stop();
+			return -2;
+		}
 
-    //path compression (http://en.wikipedia.org/wiki/Union_find)
-    assert(currentLabel < numberOfCells+2);
-	{
-		for (size_t i=2; i<=currentLabel; i++)
+		for (size_t s=1; s<slabs.size(); ++s)
 		{
-			int label = equivalentLabels[i];
-			assert(label < static_cast<int>(numberOfCells)+2);
-			while (equivalentLabels[label] > 1) //equivalentLabels[0] == 0 !!!
+			size_t first = slabs[s].firstCell;
+			int k = context.sliceOf(first);
+			if (context.sliceOf(first-1) != k-1)
+				continue;
+
+			//last slice of the preceding slab
+			size_t prevFirst = first;
+			while (prevFirst > 0 && context.sliceOf(prevFirst-1) == k-1)
+				--prevFirst;
+			for (size_t i=prevFirst; i<first; ++i)
+				oldSlice[context.posInSlice(i)] = static_cast<unsigned>(i)+1;
+
+			//first slice of the current slab
+			for (size_t i=first; i<slabs[s].lastCell && context.sliceOf(i) == k; ++i)
 			{
-				label = equivalentLabels[label];
-				assert(label < static_cast<int>(numberOfCells)+2);
+				const unsigned* _oldSlice = &(oldSlice[context.posInSlice(i)]);
+				for (unsigned char n=0; n<context.neighborsInPrecedingSlice; n++)
+				{
+					unsigned neighbor = _oldSlice[context.precedingSliceNeighborsShifts[n]];
+					if (neighbor != 0)
+						MergeCCs(parent, static_cast<unsigned>(i), neighbor-1);
+				}
 			}
-			equivalentLabels[i] = label;
+
+			for (size_t i=prevFirst; i<first; ++i)
+				oldSlice[context.posInSlice(i)] = 0;
 		}
 	}
 
-    //update leafs
+	if (progressCb)
 	{
-		for (size_t i=0; i<numberOfCells; i++)
-		{
-			int label = cellIndexToLabel[i];
-			assert(label < static_cast<int>(numberOfCells)+2);
-			if (equivalentLabels[label] > 1)
-				cellIndexToLabel[i] = equivalentLabels[label];
-		}
+		progressCb->stop();
 	}
 
-    //hack: we use "equivalentLabels" to count how many components will have to be created
-	int numberOfComponents = 0;
+	//we number the components in the order of their first cell
+	//(and we replace the parent of each cell by its component label by the way)
+	unsigned numberOfComponents = 0;
 	{
-		std::fill(equivalentLabels.begin(),equivalentLabels.end(),0);
+		//as a parent always precedes its children, we can link each cell to its root in one pass
+		for (size_t i=0; i<numberOfCells; i++)
+			parent[i] = parent[parent[i]];
 
 		for (size_t i=0; i<numberOfCells; i++)
 		{
-			assert(cellIndexToLabel[i] > 1 && cellIndexToLabel[i] < static_cast<int>(numberOfCells)+2);
-			equivalentLabels[cellIndexToLabel[i]] = 1;
+			unsigned root = parent[i];
+			if (root == i)
+				parent[i] = ++numberOfComponents; //labels start at '1'
+			else
+				parent[i] = parent[root]; //the root label has already been set
 		}
+	}
 
-		//we create (following) indexes for each components
-		for (size_t i=2; i<numberOfCells+2; i++)
-			if (equivalentLabels[i] == 1)
-				equivalentLabels[i] = ++numberOfComponents; //labels start at '1'
+	if (numberOfComponents == 0)
+	{
+		//No component found
+		return -3;
 	}
-    assert(equivalentLabels[0] == 0);
-    assert(equivalentLabels[1] == 0);
 
-    //we flag each component's points with its label
+	//we flag each component's points with its label
 	{
 		if (progressCb)
 		{
 			progressCb->reset();
 			char buffer[256];
-			sprintf(buffer,"Components: %i",numberOfComponents);
+			sprintf(buffer,"Components: %u",numberOfComponents);
 			progressCb->setMethodTitle("Connected Components Extraction");
 			progressCb->setInfo(buffer);
 			progressCb->start();
 		}
 		NormalizedProgress nprogress(progressCb,static_cast<unsigned>(numberOfCells));
 
-		ReferenceCloud Y(m_theAssociatedCloud);
-		for (size_t i=0; i<numberOfCells; i++)
+		std::vector< std::vector<PartialCCInfo> > partialInfos;
+		std::vector<CCFlaggingJob> jobs;
+		try
 		{
-			assert(cellIndexToLabel[i] < static_cast<int>(numberOfCells)+2);
-
-			const int& label = equivalentLabels[cellIndexToLabel[i]];
-			assert(label > 0);
-			getPointsInCell(ccCells[i].theCode,level,&Y,true);
-			Y.placeIteratorAtBegining();
-			ScalarType d = static_cast<ScalarType>(label);
-			for (unsigned j=0; j<Y.size(); ++j)
+			size_t jobCount = 1;
+#ifdef ENABLE_MT_OCTREE
+			jobCount = std::min<size_t>(static_cast<size_t>(std::max(1,QThread::idealThreadCount())) * 4, numberOfCells);
+#endif
+			if (componentsInfo)
+				partialInfos.resize(jobCount);
+
+			CCFlaggingJob job;
+			job.octree = this;
+			job.cells = &ccCells;
+			job.labels = &parent;
+			job.level = level;
+			job.nprogress = progressCb ? &nprogress : 0;
+			job.success = false;
+			job.lastCell = 0;
+			for (size_t j=0; j<jobCount; ++j)
 			{
-				Y.setCurrentPointScalarValue(d);
-				Y.forwardIterator();
+				job.firstCell = job.lastCell;
+				job.lastCell = (numberOfCells * (j+1)) / jobCount;
+				job.infos = componentsInfo ? &(partialInfos[j]) : 0;
+				jobs.push_back(job);
 			}
 
-			nprogress.oneStep();
+			if (componentsInfo)
+			{
+				componentsInfo->clear();
+				componentsInfo->resize(numberOfComponents);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			if (progressCb)
+				progressCb->stop();
+			return -2;
 		}
 
+#ifdef ENABLE_MT_OCTREE
+		QtConcurrent::blockingMap(jobs, FlagCCPoints);
+#else
+		for (size_t j=0; j<jobs.size(); ++j)
+			FlagCCPoints(jobs[j]);
+#endif
+
 		if (progressCb)
 		{
 			progressCb->stop();
 		}
+
+		for (size_t j=0; j<jobs.size(); ++j)
+		{
+			if (!jobs[j].success)
+			{
+				//not enough memory
+				return -2;
+			}
+		}
+
+		//merge the components statistics
+		if (componentsInfo)
+		{
+			std::vector<bool> initialized(numberOfComponents,false);
+			for (size_t j=0; j<partialInfos.size(); ++j)
+			{
+				for (size_t n=0; n<partialInfos[j].size(); ++n)
+				{
+					const PartialCCInfo& partial = partialInfos[j][n];
+					ConnectedComponentInfo& info = (*componentsInfo)[partial.label-1];
+					if (!initialized[partial.label-1])
+					{
+						info = partial.info;
+						initialized[partial.label-1] = true;
+						continue;
+					}
+					info.pointCount += partial.info.pointCount;
+					info.cellCount += partial.info.cellCount;
+					for (unsigned char k=0; k<3; ++k)
+					{
+						info.bbMin.u[k] = std::min(info.bbMin.u[k], partial.info.bbMin.u[k]);
+						info.bbMax.u[k] = std::max(info.bbMax.u[k], partial.info.bbMax.u[k]);
+					}
+				}
+			}
+		}
 	}
 
-    return 0;
+	return 0;
 }
 
 /*** Octree-based cloud traversal mechanism ***/
@@ -3643,6 +4148,9 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
 	if (m_thePointsAndTheirCellCodes.empty())
 		return 0;
 
+	//the cell functions generally look for neighbours at the same level
+	prepareCellsIndexTable(level);
+
 #ifdef ENABLE_MT_OCTREE
 
 	//cells that will be processed by QtConcurrent::map
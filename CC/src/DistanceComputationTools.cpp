@@ -34,12 +34,14 @@
 #include "LocalModel.h"
 #include "SimpleTriangle.h"
 #include "ScalarField.h"
+#include "TriangleBVH.h"
 
 //system
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <limits>
+#include <algorithm>
 
 #ifdef USE_QT
 #ifndef _DEBUG
@@ -213,6 +215,11 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 		params.octreeLevel = comparedOctree->findBestLevelForComparisonWithOctree(referenceOctree);
 	}
 
+	//the neighbours are looked for in the reference octree (at the same level)
+	referenceOctree->prepareCellsIndexTable(params.octreeLevel);
+	//and read from a copy of its points sorted in cell code order (if there's enough memory)
+	bool pointsCopy = (!referenceOctree->codeOrderedPointsCopyEnabled() && referenceOctree->setCodeOrderedPointsCopy(true));
+
 	//additional parameters
 	void* additionalParameters[4] = {	reinterpret_cast<void*>(referenceCloud),
 										reinterpret_cast<void*>(referenceOctree),
@@ -233,6 +240,9 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 		result = -2;
 	}
 
+	if (pointsCopy)
+		referenceOctree->setCodeOrderedPointsCopy(false);
+
 	if (comparedOctree && !compOctree)
 	{
 		delete comparedOctree;
@@ -389,6 +399,191 @@ DistanceComputationTools::SOReturnCode
 	return SYNCHRONIZED;
 }
 
+DistanceComputationTools::SOReturnCode
+	DistanceComputationTools::synchronizeOctrees(	GenericCloud* comparedCloud,
+													GenericCloud* referenceCloud,
+													OutOfCoreOctree& comparedOctree,
+													OutOfCoreOctree& referenceOctree,
+													PointCoordinateType maxDist/*=-PC_ONE*/,
+													GenericProgressCallback* progressCb/*=0*/)
+{
+	assert(comparedCloud && referenceCloud);
+
+	if (comparedCloud->size() == 0 || referenceCloud->size() == 0)
+		return EMPTY_CLOUD;
+
+	//we compute the union of both bounding-boxes
+	CCVector3 minsA,minsB,maxsA,maxsB;
+	comparedCloud->getBoundingBox(minsA,maxsA);
+	referenceCloud->getBoundingBox(minsB,maxsB);
+
+	CCVector3 maxD,minD;
+	for (unsigned char k=0; k<3; k++)
+	{
+		minD.u[k] = std::min(minsA.u[k],minsB.u[k]);
+		maxD.u[k] = std::max(maxsA.u[k],maxsB.u[k]);
+
+		//the clouds are too far from each other?
+		if (maxDist >= 0 && std::max(minsA.u[k],minsB.u[k]) - std::min(maxsA.u[k],maxsB.u[k]) > maxDist)
+			return DISJOINT;
+	}
+
+	//we make this bounding-box cubical (+1% growth to avoid round-off issues)
+	CCMiscTools::MakeMinAndMaxCubical(minD,maxD,0.01);
+
+	//contrary to the in-core version, all the compared points are projected
+	//(so that they all get a value - at least 'maxDist')
+	if (	comparedOctree.build(comparedCloud,minD,maxD,progressCb) < 1
+		||	referenceOctree.build(referenceCloud,minD,maxD,progressCb) < 1 )
+	{
+		return OUT_OF_MEMORY;
+	}
+
+	return SYNCHRONIZED;
+}
+
+int DistanceComputationTools::computeCloud2CloudDistance(	OutOfCoreOctree* comparedOctree,
+															OutOfCoreOctree* referenceOctree,
+															unsigned char octreeLevel/*=0*/,
+															ScalarType maxSearchDist/*=-1.0*/,
+															GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!comparedOctree || !referenceOctree)
+		return -1;
+
+	if (comparedOctree->getNumberOfProjectedPoints() == 0 || referenceOctree->getNumberOfProjectedPoints() == 0)
+		return -2;
+
+	//both octrees must have the same cells
+	if (!comparedOctree->hasSameGridAs(*referenceOctree))
+		return -3;
+
+	if (octreeLevel == 0 || octreeLevel > DgmOctree::MAX_OCTREE_LEVEL)
+	{
+		//a few reference points per cell
+		octreeLevel = std::max<unsigned char>(referenceOctree->findBestLevelForAGivenPopulationPerCell(16), 1);
+	}
+
+	void* additionalParameters[2] = {	reinterpret_cast<void*>(referenceOctree),
+										reinterpret_cast<void*>(&maxSearchDist) };
+
+	if (comparedOctree->executeFunctionForAllCellsAtLevel(	octreeLevel,
+															&computeCellHausdorffDistanceOutOfCore,
+															additionalParameters,
+															progressCb,
+															"Cloud-Cloud Distance (out-of-core)") == 0)
+	{
+		//something went wrong
+		return -4;
+	}
+
+	return 0;
+}
+
+//Description of expected 'additionalParameters'
+// [0] -> (OutOfCoreOctree*): reference cloud octree
+// [1] -> (ScalarType*): max search distance (or -1)
+bool DistanceComputationTools::computeCellHausdorffDistanceOutOfCore(	const OutOfCoreOctree::octreeCell& cell,
+																		void** additionalParameters,
+																		NormalizedProgress* nProgress/*=0*/)
+{
+	//additional parameters
+	const OutOfCoreOctree* referenceOctree = reinterpret_cast<OutOfCoreOctree*>(additionalParameters[0]);
+	ScalarType maxSearchDist = *reinterpret_cast<ScalarType*>(additionalParameters[1]);
+
+	const OutOfCoreOctree::PointRecords& points = *cell.points;
+	std::vector<ScalarType>& values = *cell.values;
+	size_t pointCount = points.size();
+
+	//max neighbourhood size (in cells)
+	const PointCoordinateType& cs = cell.parentOctree->getCellSize(cell.level);
+	int maxNeighbourhoodLength = 0;
+	{
+		Tuple3i fillMin, fillMax;
+		referenceOctree->getFillIndexes(cell.level, fillMin, fillMax);
+		for (unsigned char k=0; k<3; ++k)
+		{
+			maxNeighbourhoodLength = std::max(maxNeighbourhoodLength, cell.cellPos.u[k] - fillMin.u[k]);
+			maxNeighbourhoodLength = std::max(maxNeighbourhoodLength, fillMax.u[k] - cell.cellPos.u[k]);
+		}
+		if (maxSearchDist >= 0)
+			maxNeighbourhoodLength = std::min(maxNeighbourhoodLength, static_cast<int>(ceil(maxSearchDist / cs)));
+	}
+
+	//cell limits
+	CCVector3 cellCenter;
+	cell.parentOctree->computeCellCenter(cell.cellPos, cell.level, cellCenter);
+	CCVector3 cellMin = cellCenter - CCVector3(cs/2, cs/2, cs/2);
+	CCVector3 cellMax = cellCenter + CCVector3(cs/2, cs/2, cs/2);
+
+	std::vector<double> minSquareDists;
+	std::vector<bool> resolved;
+	try
+	{
+		minSquareDists.resize(pointCount, -1.0);
+		resolved.resize(pointCount, false);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		return false;
+	}
+
+	//we look for the reference points in growing neighbourhoods (only the new cells are read each time)
+	OutOfCoreOctree::PointRecords neighbours;
+	size_t remainingPoints = pointCount;
+	for (int n = 0; n <= maxNeighbourhoodLength && remainingPoints != 0; ++n)
+	{
+		neighbours.clear();
+		if (!referenceOctree->getPointsInNeighbourCells(cell.cellPos, cell.level, n, neighbours, true))
+			return false;
+
+		for (size_t i = 0; i < pointCount; ++i)
+		{
+			if (resolved[i])
+				continue;
+
+			const CCVector3& P = points[i].P;
+			for (size_t j = 0; j < neighbours.size(); ++j)
+			{
+				double d2 = (neighbours[j].P - P).norm2d();
+				if (minSquareDists[i] < 0 || d2 < minSquareDists[i])
+					minSquareDists[i] = d2;
+			}
+
+			//the nearest neighbour is certain if it is closer than the not yet visited cells
+			if (minSquareDists[i] >= 0)
+			{
+				double borderDist = static_cast<double>(n) * cs;
+				borderDist += std::min(	std::min(std::min(P.x - cellMin.x, cellMax.x - P.x), std::min(P.y - cellMin.y, cellMax.y - P.y)),
+										std::min(P.z - cellMin.z, cellMax.z - P.z) );
+				if (minSquareDists[i] <= borderDist * borderDist)
+				{
+					resolved[i] = true;
+					--remainingPoints;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < pointCount; ++i)
+	{
+		if (minSquareDists[i] >= 0)
+		{
+			ScalarType d = static_cast<ScalarType>(sqrt(minSquareDists[i]));
+			values[i] = (maxSearchDist >= 0 && d > maxSearchDist ? maxSearchDist : d);
+		}
+		else
+		{
+			values[i] = (maxSearchDist >= 0 ? maxSearchDist : NAN_VALUE);
+		}
+	}
+
+	if (nProgress && !nProgress->steps(static_cast<unsigned>(pointCount)))
+		return false;
+
+	return true;
+}
+
 //Description of expected 'additionalParameters'
 // [0] -> (GenericIndexedCloudPersist*) reference cloud
 // [1] -> (Octree*): reference cloud octree
@@ -497,11 +692,27 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 		//memcpy(nNSS_Model_kNN.cellPos,nNSS.cellPos,3*sizeof(int));
 	}
 
-	//already computed models
-	std::vector<const LocalModel*> models;
-
 	//for each point of the current cell (compared octree) we look its nearest neighbour in the reference cloud
 	unsigned pointCount = cell.points->size();
+
+	//already computed models (allocated in a pool and released all at once at the end of the cell)
+	LocalModelPool modelsPool(std::min<unsigned>(pointCount, 256));
+	//models of the cell (or 0 if the computation failed) and index of the (reference) point around which each of them was built
+	std::vector<const LocalModel*> models;
+	std::vector<unsigned> modelsNearestPointIndexes;
+	try
+	{
+		models.reserve(pointCount);
+		modelsNearestPointIndexes.reserve(pointCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory!
+		return false;
+	}
+	//last used model
+	const LocalModel* lastModel = 0;
+
 	for (unsigned i=0; i<pointCount; ++i)
 	{
 		//distance of the current point
@@ -523,23 +734,44 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 
 				//local model for the 'nearest point'
 				const LocalModel* lm = 0;
+				bool modelFound = false;
+
+				//neighbouring query points often share the same nearest point: as the model only
+				//depends on the nearest point (and its neighbours), we can reuse it as is
+				for (size_t j=models.size(); j!=0; --j)
+				{
+					if (modelsNearestPointIndexes[j-1] == nNSS.theNearestPointIndex)
+					{
+						lm = models[j-1];
+						modelFound = true;
+						break;
+					}
+				}
 
-				if (params->reuseExistingLocalModels)
+				if (!modelFound && params->reuseExistingLocalModels)
 				{
-					//we look if the nearest point is close to existing models
-					for (std::vector<const LocalModel*>::const_iterator it = models.begin(); it!=models.end(); ++it)
+					//we look if the nearest point is close to existing models (starting with the last used one)
+					if (lastModel && (lastModel->getCenter() - nearestPoint).norm2() <= lastModel->getSquareSize())
+					{
+						lm = lastModel;
+					}
+					else
 					{
-						//we take the first model that 'includes' the nearest point
-						if ( ((*it)->getCenter() - nearestPoint).norm2() <= (*it)->getSquareSize())
+						for (std::vector<const LocalModel*>::const_iterator it = models.begin(); it!=models.end(); ++it)
 						{
-							lm = *it;
-							break;
+							//we take the first model that 'includes' the nearest point
+							if (*it && ((*it)->getCenter() - nearestPoint).norm2() <= (*it)->getSquareSize())
+							{
+								lm = *it;
+								break;
+							}
 						}
 					}
+					modelFound = (lm != 0);
 				}
 
 				//create new local model
-				if (!lm)
+				if (!modelFound)
 				{
 					nNSS_Model.queryPoint = nearestPoint;
 
@@ -589,28 +821,15 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 						const double& maxSquareDist = nNSS_Model.pointsInNeighbourhood[kNN-1].squareDistd;
 						if (maxSquareDist > 0) //DGM: it happens with duplicate points :(
 						{
-							lm = LocalModel::New(params->localModel,Z,nearestPoint,static_cast<PointCoordinateType>(maxSquareDist));
-							if (lm && params->reuseExistingLocalModels)
-							{
-								//we add the model to the 'existing models' list
-								try
-								{
-									models.push_back(lm);
-								}
-								catch (const std::bad_alloc&)
-								{
-									//not enough memory!
-									while (!models.empty())
-									{
-										delete models.back();
-										models.pop_back();
-									}
-									return false;
-								}
-							}
+							lm = modelsPool.create(params->localModel,Z,nearestPoint,static_cast<PointCoordinateType>(maxSquareDist));
 						}
 						//neighbours->clear();
 					}
+
+					//we add the model (even if null) to the 'existing models' list
+					//(can't throw as enough memory has been reserved)
+					models.push_back(lm);
+					modelsNearestPointIndexes.push_back(nNSS.theNearestPointIndex);
 				}
 
 				//if we have a local model
@@ -623,12 +842,7 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 					//instead of 'adding' noise if the model is badly shaped
 					distPt = std::min(distToNearestPoint,distToModel);
 
-					if (!params->reuseExistingLocalModels)
-					{
-						//we don't need the local model anymore!
-						delete lm;
-						lm = 0;
-					}
+					lastModel = lm;
 				}
 				else
 				{
@@ -650,13 +864,7 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 			return false;
 	}
 
-	//clear all models for this cell
-	while (!models.empty())
-	{
-		delete models.back();
-		models.pop_back();
-	}
-
+	//all the models of this cell are released with the pool
 	return true;
 }
 
@@ -1872,6 +2080,507 @@ int DistanceComputationTools::computeCloud2MeshDistance(	GenericIndexedCloudPers
 	return 0;
 }
 
+//! Number of points processed by each job of computeCloud2MeshDistanceWithBVH
+static const unsigned POINTS_PER_BVH_JOB = 4096;
+
+//! Job of DistanceComputationTools::computeCloud2MeshDistanceWithBVH (a range of points)
+struct Cloud2MeshBVHJob
+{
+	GenericIndexedCloudPersist* cloud;
+	const TriangleBVH* bvh;
+	ScalarType maxSearchDist;
+	double maxSquareDist;
+	bool signedDistances;
+	double normalSign;
+	unsigned firstIndex;
+	unsigned lastIndex;
+};
+
+static void cloud2MeshBVHJobFunc(Cloud2MeshBVHJob& job)
+{
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		const CCVector3* P = job.cloud->getPoint(i);
+
+		unsigned triIndex = 0;
+		double squareDist = 0;
+		double signedDist = 0;
+		ScalarType dist = NAN_VALUE;
+		if (job.bvh->findNearestTriangle(*P, job.maxSquareDist, triIndex, squareDist, job.signedDistances ? &signedDist : 0))
+		{
+			dist = static_cast<ScalarType>(job.signedDistances ? job.normalSign * signedDist : sqrt(squareDist));
+		}
+		else if (job.maxSearchDist >= 0)
+		{
+			//no triangle nearer than 'maxSearchDist'
+			dist = job.maxSearchDist;
+		}
+
+		job.cloud->setPointScalarValue(i, dist);
+	}
+}
+
+int DistanceComputationTools::computeCloud2MeshDistanceWithBVH(	GenericIndexedCloudPersist* pointCloud,
+																GenericIndexedMesh* mesh,
+																ScalarType maxSearchDist/*=-1.0*/,
+																bool signedDistances/*=false*/,
+																bool flipNormals/*=false*/,
+																bool multiThread/*=true*/,
+																GenericProgressCallback* progressCb/*=0*/,
+																const TriangleBVH* bvh/*=0*/)
+{
+	//check the input
+	if (!pointCloud || pointCloud->size() == 0 || !mesh || mesh->size() == 0)
+	{
+		assert(false);
+		return -2;
+	}
+
+	//build the BVH if necessary
+	TriangleBVH tempBVH;
+	if (!bvh || !bvh->isValid())
+	{
+		if (!tempBVH.build(mesh, progressCb))
+		{
+			//not enough memory (or process cancelled by user)
+			return -3;
+		}
+		bvh = &tempBVH;
+	}
+
+	if (!pointCloud->enableScalarField())
+	{
+		//not enough memory
+		return -4;
+	}
+
+	unsigned pointCount = pointCloud->size();
+
+	//Progress callback
+	NormalizedProgress nProgress(progressCb, pointCount);
+	if (progressCb)
+	{
+		char buffer[256];
+		sprintf(buffer, "Points: %u / Triangles: %u", pointCount, bvh->size());
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle(signedDistances ? "Compute signed distances (BVH)" : "Compute distances (BVH)");
+		progressCb->start();
+	}
+
+	Cloud2MeshBVHJob prototype;
+	prototype.cloud = pointCloud;
+	prototype.bvh = bvh;
+	prototype.maxSearchDist = (maxSearchDist >= 0 ? maxSearchDist : -1);
+	prototype.maxSquareDist = (maxSearchDist >= 0 ? static_cast<double>(maxSearchDist) * maxSearchDist : -1.0);
+	prototype.signedDistances = signedDistances;
+	prototype.normalSign = (flipNormals ? -1.0 : 1.0);
+	prototype.firstIndex = prototype.lastIndex = 0;
+
+	unsigned threadCount = 1;
+#ifdef ENABLE_CLOUD2MESH_DIST_MT
+	if (multiThread)
+		threadCount = static_cast<unsigned>(std::max(1, QThread::idealThreadCount()));
+#endif
+
+	//the points are processed by batches (so that the progress can be updated and the user can cancel the process)
+	unsigned jobsPerBatch = threadCount * 4;
+	std::vector<Cloud2MeshBVHJob> jobs;
+	try
+	{
+		jobs.reserve(jobsPerBatch);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return -4;
+	}
+
+	for (unsigned first=0; first<pointCount; )
+	{
+		jobs.clear();
+		for (unsigned j=0; j<jobsPerBatch && first<pointCount; ++j)
+		{
+			Cloud2MeshBVHJob job = prototype;
+			job.firstIndex = first;
+			job.lastIndex = (pointCount - first > POINTS_PER_BVH_JOB ? first + POINTS_PER_BVH_JOB : pointCount);
+			jobs.push_back(job);
+			first = job.lastIndex;
+		}
+
+#ifdef ENABLE_CLOUD2MESH_DIST_MT
+		if (threadCount > 1)
+		{
+			QtConcurrent::blockingMap(jobs, cloud2MeshBVHJobFunc);
+		}
+		else
+#endif
+		{
+			for (size_t j=0; j<jobs.size(); ++j)
+				cloud2MeshBVHJobFunc(jobs[j]);
+		}
+
+		if (!nProgress.steps(jobs.back().lastIndex - jobs.front().firstIndex))
+		{
+			//process cancelled by user
+			return -5;
+		}
+	}
+
+	return 0;
+}
+
+//! Number of core points processed by each job of computeM3C2Distances
+static const unsigned CORE_POINTS_PER_M3C2_JOB = 256;
+
+//! Job of DistanceComputationTools::computeM3C2Distances (a range of core points)
+struct M3C2Job
+{
+	GenericIndexedCloudPersist* corePoints;
+	const DgmOctree* octree1;
+	const DgmOctree* octree2;
+	const DistanceComputationTools::M3C2Params* params;
+	//! Normal scales (radii) and the corresponding levels of subdivision of the first octree
+	const std::vector<PointCoordinateType>* normalRadii;
+	const std::vector<unsigned char>* normalLevels;
+	//! Levels of subdivision for cylinders extraction
+	unsigned char cylinderLevel1;
+	unsigned char cylinderLevel2;
+	unsigned firstIndex;
+	unsigned lastIndex;
+};
+
+//! Computes the position (mean or median) and the spread of the points of a cylinder along its axis
+/** The spread is the standard deviation, or the inter-quartile range scaled so as to be
+	comparable with a standard deviation (for a normal distribution) if 'useMedian' is true.
+	\warning the set may be sorted
+**/
+static void ComputeCylinderStats(DgmOctree::NeighboursSet& neighbours, bool useMedian, double& position, double& spread)
+{
+	//the signed distances along the cylinder axis are stored in 'squareDistd'
+	size_t count = neighbours.size();
+	assert(count != 0);
+
+	if (useMedian)
+	{
+		std::sort(neighbours.begin(), neighbours.end(), DgmOctree::PointDescriptor::distComp);
+		size_t half = count/2;
+		position = (count & 1) ? neighbours[half].squareDistd : (neighbours[half-1].squareDistd + neighbours[half].squareDistd) / 2;
+		double q1 = neighbours[count/4].squareDistd;
+		double q3 = neighbours[std::min(count-1, (3*count)/4)].squareDistd;
+		spread = (q3 - q1) / 1.349;
+	}
+	else
+	{
+		double sum = 0;
+		double sum2 = 0;
+		for (size_t k=0; k<count; ++k)
+		{
+			double d = neighbours[k].squareDistd;
+			sum += d;
+			sum2 += d*d;
+		}
+		position = sum / count;
+		//unbiased estimator
+		double var = (count > 1 ? (sum2 - sum*position) / (count-1) : 0);
+		spread = (var > 0 ? sqrt(var) : 0);
+	}
+}
+
+static void m3c2JobFunc(M3C2Job& job)
+{
+	const DistanceComputationTools::M3C2Params& params = *job.params;
+	size_t scaleCount = job.normalRadii->size();
+
+	//the neighbours containers are reused from one core point to the next
+	DgmOctree::NeighboursSet sphere;
+	DgmOctree::CylindricalNeighbourhood cylinder;
+	cylinder.radius = params.projectionScale / 2;
+	cylinder.maxHalfLength = params.maxDepth;
+
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		const CCVector3* P = job.corePoints->getPoint(i);
+
+		//compute the normal (keep the most planar neighbourhood among all the scales)
+		CCVector3 N(0,0,0);
+		double bestVariation = -1.0;
+		ScalarType bestScale = NAN_VALUE;
+		for (size_t s=0; s<scaleCount; ++s)
+		{
+			sphere.clear();
+			job.octree1->getPointsInSphericalNeighbourhood(*P, job.normalRadii->at(s), sphere, job.normalLevels->at(s));
+			if (sphere.size() < 3)
+				continue;
+
+			DgmOctreeReferenceCloud neighboursCloud(&sphere, static_cast<unsigned>(sphere.size()));
+			Neighbourhood Z(&neighboursCloud);
+			SquareMatrixd eig = Z.computeCovarianceMatrix().computeJacobianEigenValuesAndVectors();
+			if (!eig.isValid())
+				continue;
+
+			CCVector3d normal;
+			double minEigenValue = eig.getMinEigenValueAndVector(normal.u);
+			const double* eigenValues = eig.getEigenValues();
+			double sum = eigenValues[0] + eigenValues[1] + eigenValues[2];
+			if (sum < ZERO_TOLERANCE)
+				continue; //all points are the same
+
+			//surface variation
+			double variation = minEigenValue / sum;
+			if (bestVariation < 0 || variation < bestVariation)
+			{
+				bestVariation = variation;
+				bestScale = static_cast<ScalarType>(2 * job.normalRadii->at(s));
+				N = CCVector3::fromArray(normal.u);
+			}
+		}
+
+		ScalarType dist = NAN_VALUE;
+		ScalarType uncertainty = NAN_VALUE;
+		ScalarType significant = NAN_VALUE;
+		ScalarType std1 = NAN_VALUE;
+		ScalarType std2 = NAN_VALUE;
+		size_t n1 = 0;
+		size_t n2 = 0;
+
+		if (bestVariation >= 0)
+		{
+			N.normalize();
+			if (N.dot(params.preferredOrientation) < 0)
+				N = -N;
+
+			cylinder.center = *P;
+			cylinder.dir = N;
+
+			double i1 = 0;
+			double s1 = 0;
+			cylinder.level = job.cylinderLevel1;
+			cylinder.neighbours.clear();
+			n1 = job.octree1->getPointsInCylindricalNeighbourhood(cylinder);
+			if (n1 != 0)
+			{
+				ComputeCylinderStats(cylinder.neighbours, params.useMedian, i1, s1);
+				std1 = static_cast<ScalarType>(s1);
+			}
+
+			double i2 = 0;
+			double s2 = 0;
+			cylinder.level = job.cylinderLevel2;
+			cylinder.neighbours.clear();
+			n2 = job.octree2->getPointsInCylindricalNeighbourhood(cylinder);
+			if (n2 != 0)
+			{
+				ComputeCylinderStats(cylinder.neighbours, params.useMedian, i2, s2);
+				std2 = static_cast<ScalarType>(s2);
+			}
+
+			if (n1 != 0 && n2 != 0 && n1 >= params.minPointsPerCylinder && n2 >= params.minPointsPerCylinder)
+			{
+				dist = static_cast<ScalarType>(i2 - i1);
+
+				//95% level of detection
+				double LoD = 1.96 * sqrt(s1*s1/n1 + s2*s2/n2) + params.registrationError;
+				uncertainty = static_cast<ScalarType>(LoD);
+				significant = (fabs(i2 - i1) > LoD ? static_cast<ScalarType>(1) : static_cast<ScalarType>(0));
+			}
+		}
+
+		job.corePoints->setPointScalarValue(i, dist);
+
+		if (params.uncertaintySF)
+			params.uncertaintySF->setValue(i, uncertainty);
+		if (params.significantChangeSF)
+			params.significantChangeSF->setValue(i, significant);
+		if (params.stdDev1SF)
+			params.stdDev1SF->setValue(i, std1);
+		if (params.stdDev2SF)
+			params.stdDev2SF->setValue(i, std2);
+		if (params.pointCount1SF)
+			params.pointCount1SF->setValue(i, static_cast<ScalarType>(n1));
+		if (params.pointCount2SF)
+			params.pointCount2SF->setValue(i, static_cast<ScalarType>(n2));
+		if (params.normalScaleSF)
+			params.normalScaleSF->setValue(i, bestScale);
+		if (params.normals)
+			params.normals->at(i) = N;
+	}
+}
+
+int DistanceComputationTools::computeM3C2Distances(	GenericIndexedCloudPersist* corePoints,
+													GenericIndexedCloudPersist* cloud1,
+													GenericIndexedCloudPersist* cloud2,
+													const M3C2Params& params,
+													GenericProgressCallback* progressCb/*=0*/,
+													DgmOctree* octree1/*=0*/,
+													DgmOctree* octree2/*=0*/)
+{
+	//check the input
+	if (	!corePoints || corePoints->size() == 0
+		||	!cloud1 || cloud1->size() == 0
+		||	!cloud2 || cloud2->size() == 0
+		||	params.normalScales.empty()
+		||	params.projectionScale <= 0
+		||	params.maxDepth <= 0 )
+	{
+		return -2;
+	}
+
+	unsigned pointCount = corePoints->size();
+
+	//check the (optional) outputs
+	{
+		ScalarField* outputSFs[7] = {	params.uncertaintySF,
+										params.significantChangeSF,
+										params.stdDev1SF,
+										params.stdDev2SF,
+										params.pointCount1SF,
+										params.pointCount2SF,
+										params.normalScaleSF };
+		for (unsigned k=0; k<7; ++k)
+		{
+			if (outputSFs[k] && outputSFs[k]->currentSize() < pointCount)
+			{
+				assert(false);
+				return -2;
+			}
+		}
+		if (params.normals && params.normals->size() < pointCount)
+		{
+			assert(false);
+			return -2;
+		}
+	}
+
+	std::vector<PointCoordinateType> normalRadii;
+	for (size_t s=0; s<params.normalScales.size(); ++s)
+	{
+		if (params.normalScales[s] <= 0)
+			return -2;
+		normalRadii.push_back(params.normalScales[s] / 2);
+	}
+
+	if (!corePoints->enableScalarField())
+	{
+		//not enough memory
+		return -4;
+	}
+
+	//compute the octrees if necessary
+	DgmOctree* theOctree1 = octree1;
+	if (!theOctree1)
+	{
+		theOctree1 = new DgmOctree(cloud1);
+		if (theOctree1->build(progressCb) < 1)
+		{
+			delete theOctree1;
+			return -3;
+		}
+	}
+	DgmOctree* theOctree2 = octree2;
+	if (!theOctree2)
+	{
+		theOctree2 = new DgmOctree(cloud2);
+		if (theOctree2->build(progressCb) < 1)
+		{
+			delete theOctree2;
+			if (!octree1)
+				delete theOctree1;
+			return -3;
+		}
+	}
+
+	std::vector<unsigned char> normalLevels;
+	for (size_t s=0; s<normalRadii.size(); ++s)
+		normalLevels.push_back(theOctree1->findBestLevelForAGivenNeighbourhoodSizeExtraction(normalRadii[s]));
+
+	M3C2Job prototype;
+	prototype.corePoints = corePoints;
+	prototype.octree1 = theOctree1;
+	prototype.octree2 = theOctree2;
+	prototype.params = &params;
+	prototype.normalRadii = &normalRadii;
+	prototype.normalLevels = &normalLevels;
+	//the cylinders are generally much longer than wide: we use cells roughly as large as their diameter
+	//(instead of the radius/2.5 of spherical extractions), otherwise most of the (empty) cells of their
+	//bounding-box would be tested for nothing
+	PointCoordinateType cylinderExtractionRadius = static_cast<PointCoordinateType>(2.5) * params.projectionScale;
+	prototype.cylinderLevel1 = theOctree1->findBestLevelForAGivenNeighbourhoodSizeExtraction(cylinderExtractionRadius);
+	prototype.cylinderLevel2 = theOctree2->findBestLevelForAGivenNeighbourhoodSizeExtraction(cylinderExtractionRadius);
+	prototype.firstIndex = prototype.lastIndex = 0;
+
+	//Progress callback
+	NormalizedProgress nProgress(progressCb, pointCount);
+	if (progressCb)
+	{
+		char buffer[256];
+		sprintf(buffer, "Core points: %u\nCloud #1: %u points\nCloud #2: %u points", pointCount, cloud1->size(), cloud2->size());
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle("M3C2 distances");
+		progressCb->start();
+	}
+
+	unsigned threadCount = 1;
+#ifdef ENABLE_CLOUD2MESH_DIST_MT
+	if (params.multiThread)
+		threadCount = static_cast<unsigned>(std::max(1, QThread::idealThreadCount()));
+#endif
+
+	int result = 0;
+
+	//the core points are processed by batches (so that the progress can be updated and the user can cancel the process)
+	unsigned jobsPerBatch = threadCount * 4;
+	std::vector<M3C2Job> jobs;
+	try
+	{
+		jobs.reserve(jobsPerBatch);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		result = -4;
+	}
+
+	for (unsigned first=0; first<pointCount && result == 0; )
+	{
+		jobs.clear();
+		for (unsigned j=0; j<jobsPerBatch && first<pointCount; ++j)
+		{
+			M3C2Job job = prototype;
+			job.firstIndex = first;
+			job.lastIndex = (pointCount - first > CORE_POINTS_PER_M3C2_JOB ? first + CORE_POINTS_PER_M3C2_JOB : pointCount);
+			jobs.push_back(job);
+			first = job.lastIndex;
+		}
+
+#ifdef ENABLE_CLOUD2MESH_DIST_MT
+		if (threadCount > 1)
+		{
+			QtConcurrent::blockingMap(jobs, m3c2JobFunc);
+		}
+		else
+#endif
+		{
+			for (size_t j=0; j<jobs.size(); ++j)
+				m3c2JobFunc(jobs[j]);
+		}
+
+		if (!nProgress.steps(jobs.back().lastIndex - jobs.front().firstIndex))
+		{
+			//process cancelled by user
+			result = -5;
+		}
+	}
+
+	if (!octree1)
+		delete theOctree1;
+	if (!octree2)
+		delete theOctree2;
+
+	return result;
+}
+
 /******* Calcul de distance entre un point et un triangle *****/
 // Inspired from documents and code by:
 // David Eberly
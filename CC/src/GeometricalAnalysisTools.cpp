@@ -302,6 +302,9 @@ int GeometricalAnalysisTools::computeLocalDensityApprox(GenericIndexedCloudPersi
 	//parameters
 	void* additionalParameters[] = { static_cast<void*>(&densityType) };
 
+	//the neighbours are read from a copy of the points sorted in cell code order (if there's enough memory)
+	bool pointsCopy = (!theOctree->codeOrderedPointsCopyEnabled() && theOctree->setCodeOrderedPointsCopy(true));
+
 	int result = 0;
 
 	if (theOctree->executeFunctionForAllCellsAtLevel(	level,
@@ -315,6 +318,9 @@ int GeometricalAnalysisTools::computeLocalDensityApprox(GenericIndexedCloudPersi
 		result = -4;
 	}
 
+	if (pointsCopy)
+		theOctree->setCodeOrderedPointsCopy(false);
+
 	if (!inputOctree)
 		delete theOctree;
 
@@ -324,6 +330,24 @@ int GeometricalAnalysisTools::computeLocalDensityApprox(GenericIndexedCloudPersi
 //volume of a unit sphere
 static double s_UnitSphereVolume = 4.0 * M_PI / 3.0;
 
+//returns the dimensional coef. corresponding to a given type of density (or -1 if the type is invalid)
+static double DensityDimensionalCoef(GeometricalAnalysisTools::Density densityType, PointCoordinateType kernelRadius)
+{
+	switch (densityType)
+	{
+	case GeometricalAnalysisTools::DENSITY_KNN:
+		return 1.0;
+	case GeometricalAnalysisTools::DENSITY_2D:
+		return M_PI * (static_cast<double>(kernelRadius) * kernelRadius);
+	case GeometricalAnalysisTools::DENSITY_3D:
+		return s_UnitSphereVolume * ((static_cast<double>(kernelRadius) * kernelRadius) * kernelRadius);
+	default:
+		assert(false);
+		break;
+	}
+	return -1.0;
+}
+
 //"PER-CELL" METHOD: APPROXIMATE LOCAL DENSITY
 //ADDITIONAL PARAMETERS (0): NONE
 bool GeometricalAnalysisTools::computeApproxPointsDensityInACellAtLevel(const DgmOctree::octreeCell& cell,
@@ -409,22 +433,9 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 		return -2;
 
 	//compute the right dimensional coef based on the expected output
-	double dimensionalCoef = 1.0;
-	switch (densityType)
-	{
-	case DENSITY_KNN:
-		dimensionalCoef = 1.0;
-		break;
-	case DENSITY_2D:
-		dimensionalCoef = M_PI * (static_cast<double>(kernelRadius) * kernelRadius);
-		break;
-	case DENSITY_3D:
-		dimensionalCoef = s_UnitSphereVolume * ((static_cast<double>(kernelRadius) * kernelRadius) * kernelRadius);
-		break;
-	default:
-		assert(false);
+	double dimensionalCoef = DensityDimensionalCoef(densityType, kernelRadius);
+	if (dimensionalCoef <= 0)
 		return -5;
-	}
 
 	DgmOctree* theOctree = inputOctree;
 	if (!theOctree)
@@ -446,6 +457,9 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 	void* additionalParameters[] = {	static_cast<void*>(&kernelRadius),
 										static_cast<void*>(&dimensionalCoef) };
 
+	//the neighbours are read from a copy of the points sorted in cell code order (if there's enough memory)
+	bool pointsCopy = (!theOctree->codeOrderedPointsCopyEnabled() && theOctree->setCodeOrderedPointsCopy(true));
+
 	int result = 0;
 
 	if (theOctree->executeFunctionForAllCellsAtLevel(	level,
@@ -459,6 +473,9 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 		result = -4;
 	}
 
+	if (pointsCopy)
+		theOctree->setCodeOrderedPointsCopy(false);
+
 	if (!inputOctree)
         delete theOctree;
 
@@ -534,6 +551,9 @@ int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCl
 	//parameters
 	void* additionalParameters[1] = { static_cast<void*>(&kernelRadius) };
 
+	//the neighbours are read from a copy of the points sorted in cell code order (if there's enough memory)
+	bool pointsCopy = (!theOctree->codeOrderedPointsCopyEnabled() && theOctree->setCodeOrderedPointsCopy(true));
+
 	int result = 0;
 
 	if (theOctree->executeFunctionForAllCellsAtLevel(	level,
@@ -547,6 +567,9 @@ int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCl
 		result = -4;
 	}
 
+	if (pointsCopy)
+		theOctree->setCodeOrderedPointsCopy(false);
+
 	if (!inputOctree)
 		delete theOctree;
 
@@ -618,6 +641,165 @@ bool GeometricalAnalysisTools::computePointsRoughnessInACellAtLevel(const DgmOct
 	return true;
 }
 
+int GeometricalAnalysisTools::computeLocalDensity(	OutOfCoreOctree* octree,
+													Density densityType,
+													PointCoordinateType kernelRadius,
+													GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!octree)
+		return -1;
+
+	if (octree->getNumberOfProjectedPoints() < 3)
+		return -2;
+
+	double dimensionalCoef = DensityDimensionalCoef(densityType, kernelRadius);
+	if (dimensionalCoef <= 0)
+		return -5;
+
+	//at this level, all the neighbours lie in the 27 cells around each point
+	unsigned char level = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(kernelRadius);
+
+	//parameters
+	void* additionalParameters[] = {	static_cast<void*>(&kernelRadius),
+										static_cast<void*>(&dimensionalCoef) };
+
+	if (octree->executeFunctionForAllCellsAtLevel(	level,
+													&computePointsDensityInAnOutOfCoreCell,
+													additionalParameters,
+													progressCb,
+													"Local Density Computation") == 0)
+	{
+		//something went wrong
+		return -4;
+	}
+
+	return 0;
+}
+
+//"PER-CELL" METHOD: LOCAL DENSITY (OUT-OF-CORE)
+//ADDITIONNAL PARAMETERS (2):
+// [0] -> (PointCoordinateType*) kernelRadius : spherical neighborhood radius
+// [1] -> (ScalarType*) sphereVolume : spherical neighborhood volume
+bool GeometricalAnalysisTools::computePointsDensityInAnOutOfCoreCell(	const OutOfCoreOctree::octreeCell& cell,
+																		void** additionalParameters,
+																		NormalizedProgress* nProgress/*=0*/)
+{
+	//parameter(s)
+	PointCoordinateType radius = *static_cast<PointCoordinateType*>(additionalParameters[0]);
+	double dimensionalCoef = *static_cast<double*>(additionalParameters[1]);
+
+	assert(dimensionalCoef > 0);
+
+	//points in the 27 cells around the current one
+	OutOfCoreOctree::PointRecords neighbours;
+	if (!cell.parentOctree->getPointsInNeighbourCells(cell.cellPos, cell.level, 1, neighbours))
+		return false;
+
+	const OutOfCoreOctree::PointRecords& points = *cell.points;
+	std::vector<ScalarType>& values = *cell.values;
+	PointCoordinateType squareRadius = radius * radius;
+	size_t neighbourCount = neighbours.size();
+
+	//for each point in the cell
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		//count the neighbors inside the sphere (the query point included, as in the in-core version)
+		unsigned count = 0;
+		for (size_t j = 0; j < neighbourCount; ++j)
+			if ((neighbours[j].P - points[i].P).norm2() <= squareRadius)
+				++count;
+
+		values[i] = static_cast<ScalarType>(count/dimensionalCoef);
+
+		if (nProgress && !nProgress->oneStep())
+			return false;
+	}
+
+	return true;
+}
+
+int GeometricalAnalysisTools::computeRoughness(OutOfCoreOctree* octree, PointCoordinateType kernelRadius, GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!octree)
+		return -1;
+
+	if (octree->getNumberOfProjectedPoints() < 3)
+		return -2;
+
+	//at this level, all the neighbours lie in the 27 cells around each point
+	unsigned char level = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(kernelRadius);
+
+	//parameters
+	void* additionalParameters[1] = { static_cast<void*>(&kernelRadius) };
+
+	if (octree->executeFunctionForAllCellsAtLevel(	level,
+													&computePointsRoughnessInAnOutOfCoreCell,
+													additionalParameters,
+													progressCb,
+													"Roughness Computation") == 0)
+	{
+		//something went wrong
+		return -4;
+	}
+
+	return 0;
+}
+
+//"PER-CELL" METHOD: ROUGHNESS ESTIMATION (OUT-OF-CORE)
+//ADDITIONNAL PARAMETERS (1):
+// [0] -> (PointCoordinateType*) kernelRadius : neighbourhood radius
+bool GeometricalAnalysisTools::computePointsRoughnessInAnOutOfCoreCell(	const OutOfCoreOctree::octreeCell& cell,
+																		void** additionalParameters,
+																		NormalizedProgress* nProgress/*=0*/)
+{
+	//parameter(s)
+	PointCoordinateType radius = *static_cast<PointCoordinateType*>(additionalParameters[0]);
+
+	//points in the 27 cells around the current one
+	OutOfCoreOctree::PointRecords neighbours;
+	if (!cell.parentOctree->getPointsInNeighbourCells(cell.cellPos, cell.level, 1, neighbours))
+		return false;
+
+	const OutOfCoreOctree::PointRecords& points = *cell.points;
+	std::vector<ScalarType>& values = *cell.values;
+	PointCoordinateType squareRadius = radius * radius;
+	size_t neighbourCount = neighbours.size();
+
+	DgmOctree::NeighboursSet neighboursSet;
+
+	//for each point in the cell
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		//neighbors inside the sphere (we don't take the query point into account!)
+		neighboursSet.clear();
+		for (size_t j = 0; j < neighbourCount; ++j)
+		{
+			if (neighbours[j].index == points[i].index)
+				continue;
+			double d2 = (neighbours[j].P - points[i].P).norm2d();
+			if (d2 <= squareRadius)
+				neighboursSet.push_back(DgmOctree::PointDescriptor(&neighbours[j].P, neighbours[j].index, d2));
+		}
+
+		ScalarType d = NAN_VALUE;
+		if (neighboursSet.size() >= 3)
+		{
+			DgmOctreeReferenceCloud neighboursCloud(&neighboursSet);
+			Neighbourhood Z(&neighboursCloud);
+
+			const PointCoordinateType* lsPlane = Z.getLSPlane();
+			if (lsPlane)
+				d = fabs(DistanceComputationTools::computePoint2PlaneDistance(&points[i].P,lsPlane));
+		}
+		values[i] = d;
+
+		if (nProgress && !nProgress->oneStep())
+			return false;
+	}
+
+	return true;
+}
+
 CCVector3 GeometricalAnalysisTools::computeGravityCenter(GenericCloud* theCloud)
 {
 	assert(theCloud);
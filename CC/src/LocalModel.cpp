@@ -27,6 +27,8 @@
 //system
 #include <string.h>
 #include <math.h>
+#include <new>
+#include <algorithm>
 
 using namespace CCLib;
 
@@ -167,6 +169,15 @@ LocalModel* LocalModel::New(CC_LOCAL_MODEL_TYPES type,
 							Neighbourhood& subset,
 							const CCVector3 &center,
 							PointCoordinateType squaredRadius)
+{
+	return Create(type, subset, center, squaredRadius, 0);
+}
+
+LocalModel* LocalModel::Create(	CC_LOCAL_MODEL_TYPES type,
+								Neighbourhood& subset,
+								const CCVector3 &center,
+								PointCoordinateType squaredRadius,
+								void* storage)
 {
 	switch(type)
 	{
@@ -179,6 +190,8 @@ LocalModel* LocalModel::New(CC_LOCAL_MODEL_TYPES type,
 			const PointCoordinateType* lsPlane = subset.getLSPlane();
 			if (lsPlane)
 			{
+				if (storage)
+					return new (storage) LSLocalModel(lsPlane,center,squaredRadius);
 				return new LSLocalModel(lsPlane,center,squaredRadius);
 			}
 		}
@@ -189,6 +202,8 @@ LocalModel* LocalModel::New(CC_LOCAL_MODEL_TYPES type,
 			GenericMesh* tri = subset.triangulateOnPlane(true); //'subset' is potentially associated to a volatile ReferenceCloud, so we must duplicate vertices!
 			if (tri)
 			{
+				if (storage)
+					return new (storage) DelaunayLocalModel(tri,center,squaredRadius);
 				return new DelaunayLocalModel(tri,center,squaredRadius);
 			}
 		}
@@ -200,6 +215,16 @@ LocalModel* LocalModel::New(CC_LOCAL_MODEL_TYPES type,
 			const PointCoordinateType* eq = subset.getQuadric(&dims);
 			if (eq)
 			{
+				if (storage)
+				{
+					return new (storage) QuadricLocalModel(	eq,
+															dims.x,
+															dims.y,
+															dims.z,
+															*subset.getGravityCenter(), //should be ok as the quadric computation succeeded!
+															center,
+															squaredRadius );
+				}
 				return new QuadricLocalModel(	eq,
 												dims.x,
 												dims.y,
@@ -215,3 +240,64 @@ LocalModel* LocalModel::New(CC_LOCAL_MODEL_TYPES type,
 	//invalid input type or computation failed!
 	return 0;
 }
+
+//! Size of a model 'slot' in the pool blocks (big enough for any model, multiple of 16 bytes to preserve the alignment)
+static const size_t MODEL_SLOT_SIZE = ((std::max(sizeof(LSLocalModel), std::max(sizeof(DelaunayLocalModel), sizeof(QuadricLocalModel))) + 15) / 16) * 16;
+
+LocalModelPool::LocalModelPool(unsigned modelsPerBlock/*=256*/)
+	: m_modelsPerBlock(std::max<unsigned>(modelsPerBlock, 1))
+{
+}
+
+LocalModelPool::~LocalModelPool()
+{
+	clear();
+
+	for (size_t i=0; i<m_blocks.size(); ++i)
+		delete[] m_blocks[i];
+	m_blocks.clear();
+}
+
+void LocalModelPool::clear()
+{
+	//the models are only destroyed (their memory is recycled)
+	while (!m_models.empty())
+	{
+		m_models.back()->~LocalModel();
+		m_models.pop_back();
+	}
+}
+
+const LocalModel* LocalModelPool::create(	CC_LOCAL_MODEL_TYPES type,
+											Neighbourhood& subset,
+											const CCVector3 &center,
+											PointCoordinateType squaredRadius)
+{
+	size_t index = m_models.size();
+	size_t blockIndex = index / m_modelsPerBlock;
+	if (blockIndex == m_blocks.size())
+	{
+		//we need a new block
+		try
+		{
+			m_models.reserve((blockIndex + 1) * m_modelsPerBlock);
+			m_blocks.reserve(blockIndex + 1);
+			m_blocks.push_back(new char[m_modelsPerBlock * MODEL_SLOT_SIZE]);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return 0;
+		}
+	}
+
+	void* slot = m_blocks[blockIndex] + (index % m_modelsPerBlock) * MODEL_SLOT_SIZE;
+	LocalModel* model = LocalModel::Create(type, subset, center, squaredRadius, slot);
+	if (model)
+	{
+		//can't throw (see the 'reserve' call above)
+		m_models.push_back(model);
+	}
+
+	return model;
+}
@@ -0,0 +1,1243 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "OutOfCoreOctree.h"
+
+//local
+#include "CCMiscTools.h"
+#include "GenericCloud.h"
+#include "GenericProgressCallback.h"
+#include "ScalarField.h"
+
+//system
+#include <algorithm>
+#include <assert.h>
+#include <queue>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef USE_QT
+//we use Qt for the atomic counter
+#include <QAtomicInt>
+#endif
+
+using namespace CCLib;
+
+//! Number of points per page (read from the points file at once)
+static const unsigned c_pageSize = (1 << 16);
+
+//! Number of elements read or written at once when streaming the files
+static const unsigned c_blockSize = (1 << 16);
+
+//! Minimum memory limit (below, the number of sorted blocks would explode)
+static const size_t c_minMemoryLimit = (size_t(16) << 20);
+
+//! Counter used to generate unique temporary file names (octrees may be created by concurrent threads)
+#ifdef USE_QT
+static QAtomicInt s_octreeCounter(0);
+#else
+static unsigned s_octreeCounter = 0; //not thread safe (but CCLib doesn't use threads without Qt)
+#endif
+
+//! Returns a new (unique) octree number
+static unsigned NextOctreeNumber()
+{
+#ifdef USE_QT
+	return static_cast<unsigned>(s_octreeCounter.fetchAndAddOrdered(1));
+#else
+	return s_octreeCounter++;
+#endif
+}
+
+//! Point and its code (for the external sort)
+struct SortEntry
+{
+	OutOfCoreOctree::OctreeCellCodeType code;
+	OutOfCoreOctree::PointRecord record;
+};
+
+static bool SortEntryComp(const SortEntry& a, const SortEntry& b)
+{
+	return a.code < b.code;
+}
+
+//! Point index and its value (for the external sort of the exported values)
+struct IndexedValue
+{
+	unsigned index;
+	ScalarType value;
+};
+
+static bool IndexedValueComp(const IndexedValue& a, const IndexedValue& b)
+{
+	return a.index < b.index;
+}
+
+//! Sets the position of a file (64 bits offsets)
+static bool Seek(FILE* fp, unsigned long long pos)
+{
+#ifdef _MSC_VER
+	return _fseeki64(fp, static_cast<__int64>(pos), SEEK_SET) == 0;
+#else
+	return fseeko(fp, static_cast<off_t>(pos), SEEK_SET) == 0;
+#endif
+}
+
+//! Writes the sorted points and codes (by blocks) and counts the cells at each level
+class SortedPointsWriter
+{
+public:
+
+	SortedPointsWriter(FILE* pointsFile, FILE* codesFile, unsigned* cellCount)
+		: m_pointsFile(pointsFile)
+		, m_codesFile(codesFile)
+		, m_cellCount(cellCount)
+		, m_lastCode(0)
+		, m_written(0)
+		, m_error(false)
+	{
+		m_records.reserve(c_blockSize);
+		m_codes.reserve(c_blockSize);
+		memset(m_cellCount, 0, sizeof(unsigned)*(DgmOctree::MAX_OCTREE_LEVEL+1));
+	}
+
+	bool add(const SortEntry& entry)
+	{
+		//update the cells count (if two codes are equal at a given level, they are equal at all the upper ones)
+		if (m_written == 0)
+		{
+			for (int level = 0; level <= DgmOctree::MAX_OCTREE_LEVEL; ++level)
+				m_cellCount[level] = 1;
+		}
+		else
+		{
+			for (int level = DgmOctree::MAX_OCTREE_LEVEL; level > 0; --level)
+			{
+				unsigned char bitDec = GET_BIT_SHIFT(level);
+				if ((entry.code >> bitDec) == (m_lastCode >> bitDec))
+					break;
+				++m_cellCount[level];
+			}
+		}
+		m_lastCode = entry.code;
+		++m_written;
+
+		m_records.push_back(entry.record);
+		m_codes.push_back(entry.code);
+		if (m_records.size() == c_blockSize)
+			return flush();
+
+		return !m_error;
+	}
+
+	bool flush()
+	{
+		if (!m_records.empty())
+		{
+			if (	fwrite(&m_records[0], sizeof(OutOfCoreOctree::PointRecord), m_records.size(), m_pointsFile) != m_records.size()
+				||	fwrite(&m_codes[0], sizeof(OutOfCoreOctree::OctreeCellCodeType), m_codes.size(), m_codesFile) != m_codes.size() )
+			{
+				m_error = true;
+			}
+			m_records.clear();
+			m_codes.clear();
+		}
+		return !m_error;
+	}
+
+protected:
+
+	FILE* m_pointsFile;
+	FILE* m_codesFile;
+	unsigned* m_cellCount;
+	OutOfCoreOctree::OctreeCellCodeType m_lastCode;
+	unsigned m_written;
+	bool m_error;
+	OutOfCoreOctree::PointRecords m_records;
+	std::vector<OutOfCoreOctree::OctreeCellCodeType> m_codes;
+};
+
+//! Reads a sorted run (by blocks) during the merge
+template <class Entry> struct RunReader
+{
+	RunReader() : fp(0), pos(0) {}
+
+	bool open(const std::string& filename, size_t capacity)
+	{
+		fp = fopen(filename.c_str(), "rb");
+		if (!fp)
+			return false;
+		try
+		{
+			buffer.reserve(capacity);
+		}
+		catch (.../*const std::bad_alloc&*/)
+		{
+			return false;
+		}
+		return true;
+	}
+
+	//! Returns the current entry (or 0 if the run is exhausted)
+	const Entry* current()
+	{
+		if (pos == buffer.size())
+		{
+			buffer.resize(buffer.capacity());
+			size_t read = fp ? fread(&buffer[0], sizeof(Entry), buffer.size(), fp) : 0;
+			buffer.resize(read);
+			pos = 0;
+			if (read == 0)
+				return 0;
+		}
+		return &buffer[pos];
+	}
+
+	void close()
+	{
+		if (fp)
+			fclose(fp);
+		fp = 0;
+		std::vector<Entry>().swap(buffer);
+	}
+
+	FILE* fp;
+	std::vector<Entry> buffer;
+	size_t pos;
+};
+
+OutOfCoreOctree::OutOfCoreOctree(const char* tempDir/*=0*/, size_t memoryLimit/*=DEFAULT_MEMORY_LIMIT*/)
+	: m_tempDir(tempDir && tempDir[0] != 0 ? tempDir : ".")
+	, m_memoryLimit(std::max(memoryLimit, c_minMemoryLimit))
+	, m_pointsFile(0)
+	, m_codesFile(0)
+	, m_numberOfProjectedPoints(0)
+	, m_numberOfInputPoints(0)
+	, m_cacheClock(0)
+	, m_hasValues(false)
+{
+	//unique prefix for the temporary files
+	char prefix[128];
+	sprintf(prefix, "ccOutOfCoreOctree_%lx_%u_%u", static_cast<unsigned long>(time(0)), static_cast<unsigned>(clock()), NextOctreeNumber());
+	m_filePrefix = prefix;
+
+	memset(m_cellsTables, 0, sizeof(CellsTable*)*(DgmOctree::MAX_OCTREE_LEVEL+1));
+	clear();
+}
+
+OutOfCoreOctree::~OutOfCoreOctree()
+{
+	clear();
+}
+
+std::string OutOfCoreOctree::tempFilename(const char* suffix) const
+{
+	return m_tempDir + "/" + m_filePrefix + "_" + suffix + ".tmp";
+}
+
+void OutOfCoreOctree::clear()
+{
+	if (m_pointsFile)
+	{
+		fclose(m_pointsFile);
+		m_pointsFile = 0;
+		remove(tempFilename("points").c_str());
+	}
+	if (m_codesFile)
+	{
+		fclose(m_codesFile);
+		m_codesFile = 0;
+		remove(tempFilename("codes").c_str());
+	}
+	if (m_hasValues)
+	{
+		remove(tempFilename("values").c_str());
+		m_hasValues = false;
+	}
+
+	for (int level = 0; level <= DgmOctree::MAX_OCTREE_LEVEL; ++level)
+	{
+		delete m_cellsTables[level];
+		m_cellsTables[level] = 0;
+	}
+
+	for (size_t i = 0; i < m_pages.size(); ++i)
+		delete m_pages[i];
+	m_pages.clear();
+	m_pageSlots.clear();
+	m_cacheClock = 0;
+
+	m_numberOfProjectedPoints = 0;
+	m_numberOfInputPoints = 0;
+	m_dimMin = m_dimMax = CCVector3(0,0,0);
+	m_fillMin = m_fillMax = Tuple3i(0,0,0);
+	memset(m_cellSize, 0, sizeof(PointCoordinateType)*(DgmOctree::MAX_OCTREE_LEVEL+2));
+	memset(m_cellCount, 0, sizeof(unsigned)*(DgmOctree::MAX_OCTREE_LEVEL+1));
+}
+
+void OutOfCoreOctree::setMemoryLimit(size_t memoryLimit)
+{
+	m_memoryLimit = std::max(memoryLimit, c_minMemoryLimit);
+	releaseMemory(0, 0xFF);
+}
+
+size_t OutOfCoreOctree::memoryUsage() const
+{
+	size_t usage = m_pages.size() * (c_pageSize * sizeof(PointRecord));
+	for (int level = 0; level <= DgmOctree::MAX_OCTREE_LEVEL; ++level)
+		if (m_cellsTables[level])
+			usage += m_cellsTables[level]->capacity() * sizeof(CellEntry);
+	return usage;
+}
+
+void OutOfCoreOctree::releaseMemory(size_t required, unsigned char keptLevel, bool pagesOnly/*=false*/) const
+{
+	//first the cells tables of the other levels (the biggest first)
+	while (!pagesOnly && memoryUsage() + required > m_memoryLimit)
+	{
+		int biggestLevel = -1;
+		for (int level = 0; level <= DgmOctree::MAX_OCTREE_LEVEL; ++level)
+		{
+			if (level != keptLevel && m_cellsTables[level] && (biggestLevel < 0 || m_cellsTables[level]->size() > m_cellsTables[biggestLevel]->size()))
+				biggestLevel = level;
+		}
+		if (biggestLevel < 0)
+			break;
+		delete m_cellsTables[biggestLevel];
+		m_cellsTables[biggestLevel] = 0;
+	}
+
+	//then the cached pages
+	while (!m_pages.empty() && memoryUsage() + required > m_memoryLimit)
+	{
+		size_t lruSlot = 0;
+		for (size_t i = 1; i < m_pages.size(); ++i)
+			if (m_pages[i]->lastUse < m_pages[lruSlot]->lastUse)
+				lruSlot = i;
+
+		m_pageSlots.erase(m_pages[lruSlot]->index);
+		delete m_pages[lruSlot];
+		if (lruSlot + 1 != m_pages.size())
+		{
+			m_pages[lruSlot] = m_pages.back();
+			m_pageSlots[m_pages[lruSlot]->index] = lruSlot;
+		}
+		m_pages.pop_back();
+	}
+}
+
+int OutOfCoreOctree::build(GenericCloud* cloud, GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!cloud)
+		return -1;
+
+	clear();
+
+	cloud->getBoundingBox(m_dimMin, m_dimMax);
+	CCMiscTools::MakeMinAndMaxCubical(m_dimMin, m_dimMax);
+
+	return genericBuild(cloud, progressCb);
+}
+
+int OutOfCoreOctree::build(	GenericCloud* cloud,
+							const CCVector3& octreeMin,
+							const CCVector3& octreeMax,
+							GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!cloud)
+		return -1;
+
+	clear();
+
+	m_dimMin = octreeMin;
+	m_dimMax = octreeMax;
+
+	return genericBuild(cloud, progressCb);
+}
+
+//! Sorts a block of entries and writes it in a temporary file (external sort)
+template <class Entry> static bool WriteRun(std::vector<Entry>& buffer, bool (*comp)(const Entry&, const Entry&), const std::string& filename)
+{
+	std::sort(buffer.begin(), buffer.end(), comp);
+
+	FILE* fp = fopen(filename.c_str(), "wb");
+	if (!fp)
+		return false;
+	bool success = (fwrite(&buffer[0], sizeof(Entry), buffer.size(), fp) == buffer.size());
+	fclose(fp);
+
+	buffer.clear();
+	return success;
+}
+
+int OutOfCoreOctree::genericBuild(GenericCloud* cloud, GenericProgressCallback* progressCb)
+{
+	unsigned pointCount = cloud->size();
+	if (pointCount == 0)
+	{
+		//no point?!
+		return -1;
+	}
+
+	//cell dimension for each subdivision level
+	m_cellSize[0] = m_dimMax.x - m_dimMin.x;
+	for (int k = 1; k <= DgmOctree::MAX_OCTREE_LEVEL; k++)
+		m_cellSize[k] = m_cellSize[k-1] / 2;
+
+	//sort buffer (the whole memory limit is used at this stage)
+	size_t bufferCapacity = std::min<size_t>(m_memoryLimit / sizeof(SortEntry), pointCount);
+	std::vector<SortEntry> buffer;
+	try
+	{
+		buffer.reserve(bufferCapacity);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		return -1;
+	}
+
+	//progress notification (optional)
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Build out-of-core octree");
+		char infosBuffer[256];
+		sprintf(infosBuffer, "Projecting %u points\nMemory limit: %u Mb", pointCount, static_cast<unsigned>(m_memoryLimit >> 20));
+		progressCb->setInfo(infosBuffer);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, pointCount, 60); //first phase: 60% (we keep 40% for the merge)
+
+	const PointCoordinateType& cs = m_cellSize[DgmOctree::MAX_OCTREE_LEVEL];
+	std::vector<std::string> runFiles;
+	bool error = false;
+
+	//first phase: we project the points and write sorted blocks ('runs')
+	cloud->placeIteratorAtBegining();
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		const CCVector3* P = cloud->getNextPoint();
+		if (!P)
+			break;
+		++m_numberOfInputPoints;
+
+		if (	(P->x >= m_dimMin.x) && (P->x <= m_dimMax.x)
+			&&	(P->y >= m_dimMin.y) && (P->y <= m_dimMax.y)
+			&&	(P->z >= m_dimMin.z) && (P->z <= m_dimMax.z) )
+		{
+			//same as DgmOctree::getTheCellPosWhichIncludesThePoint (+ clipping)
+			Tuple3i cellPos(	static_cast<int>((P->x - m_dimMin.x)/cs),
+								static_cast<int>((P->y - m_dimMin.y)/cs),
+								static_cast<int>((P->z - m_dimMin.z)/cs) );
+			for (unsigned char d = 0; d < 3; ++d)
+			{
+				if (cellPos.u[d] < 0)
+					cellPos.u[d] = 0;
+				else if (cellPos.u[d] > DgmOctree::MAX_OCTREE_LENGTH)
+					cellPos.u[d] = DgmOctree::MAX_OCTREE_LENGTH;
+
+				if (m_numberOfProjectedPoints == 0)
+				{
+					m_fillMin.u[d] = m_fillMax.u[d] = cellPos.u[d];
+				}
+				else if (m_fillMin.u[d] > cellPos.u[d])
+				{
+					m_fillMin.u[d] = cellPos.u[d];
+				}
+				else if (m_fillMax.u[d] < cellPos.u[d])
+				{
+					m_fillMax.u[d] = cellPos.u[d];
+				}
+			}
+
+			SortEntry entry;
+			entry.code = GenerateTruncatedCellCode(cellPos, DgmOctree::MAX_OCTREE_LEVEL);
+			entry.record.P = *P;
+			entry.record.index = i;
+			buffer.push_back(entry);
+			++m_numberOfProjectedPoints;
+
+			//the buffer is full: we sort it and write it in a temporary file
+			if (buffer.size() == bufferCapacity && i + 1 < pointCount)
+			{
+				char suffix[32];
+				sprintf(suffix, "run%u", static_cast<unsigned>(runFiles.size()));
+				runFiles.push_back(tempFilename(suffix));
+				error = !WriteRun(buffer, SortEntryComp, runFiles.back());
+			}
+		}
+
+		if (error || !nprogress.oneStep())
+		{
+			error = true;
+			break;
+		}
+	}
+
+	if (!error && m_numberOfProjectedPoints != 0)
+	{
+		m_pointsFile = fopen(tempFilename("points").c_str(), "w+b");
+		m_codesFile = fopen(tempFilename("codes").c_str(), "w+b");
+		error = (!m_pointsFile || !m_codesFile);
+	}
+
+	if (!error && m_numberOfProjectedPoints != 0)
+	{
+		SortedPointsWriter writer(m_pointsFile, m_codesFile, m_cellCount);
+
+		if (runFiles.empty())
+		{
+			//everything fits in memory
+			std::sort(buffer.begin(), buffer.end(), SortEntryComp);
+			for (size_t i = 0; i < buffer.size() && !error; ++i)
+				error = !writer.add(buffer[i]);
+			if (progressCb)
+				progressCb->update(100.0f);
+		}
+		else
+		{
+			//the last block is written as well, so as to release its memory before the merge
+			if (!buffer.empty())
+			{
+				char suffix[32];
+				sprintf(suffix, "run%u", static_cast<unsigned>(runFiles.size()));
+				runFiles.push_back(tempFilename(suffix));
+				error = !WriteRun(buffer, SortEntryComp, runFiles.back());
+			}
+			std::vector<SortEntry>().swap(buffer);
+
+			//second phase: k-way merge of the runs
+			NormalizedProgress mergeProgress(progressCb, m_numberOfProjectedPoints, 40);
+			size_t runCount = runFiles.size();
+			size_t readersCapacity = std::max<size_t>(m_memoryLimit / (runCount * sizeof(SortEntry)), 1024);
+
+			std::vector< RunReader<SortEntry> > readers(runCount);
+			for (size_t r = 0; r < runCount && !error; ++r)
+				error = !readers[r].open(runFiles[r], readersCapacity);
+
+			//priority queue: (code, run index)
+			typedef std::pair<OctreeCellCodeType, size_t> QueueItem;
+			std::priority_queue< QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > queue;
+			for (size_t r = 0; r < runCount && !error; ++r)
+			{
+				const SortEntry* entry = readers[r].current();
+				if (entry)
+					queue.push(QueueItem(entry->code, r));
+			}
+
+			while (!queue.empty() && !error)
+			{
+				size_t r = queue.top().second;
+				queue.pop();
+
+				error = !writer.add(*readers[r].current());
+				++readers[r].pos;
+				const SortEntry* entry = readers[r].current();
+				if (entry)
+					queue.push(QueueItem(entry->code, r));
+
+				if (!mergeProgress.oneStep())
+					error = true;
+			}
+
+			for (size_t r = 0; r < runCount; ++r)
+				readers[r].close();
+		}
+
+		if (!error)
+			error = !writer.flush();
+	}
+
+	//we don't need the runs anymore
+	for (size_t r = 0; r < runFiles.size(); ++r)
+		remove(runFiles[r].c_str());
+
+	if (progressCb)
+		progressCb->stop();
+
+	if (error || m_numberOfProjectedPoints == 0)
+	{
+		clear();
+		return -1;
+	}
+
+	fflush(m_pointsFile);
+	fflush(m_codesFile);
+
+	return static_cast<int>(m_numberOfProjectedPoints);
+}
+
+bool OutOfCoreOctree::hasSameGridAs(const OutOfCoreOctree& other) const
+{
+	return	m_dimMin.x == other.m_dimMin.x && m_dimMin.y == other.m_dimMin.y && m_dimMin.z == other.m_dimMin.z
+		&&	m_dimMax.x == other.m_dimMax.x && m_dimMax.y == other.m_dimMax.y && m_dimMax.z == other.m_dimMax.z;
+}
+
+void OutOfCoreOctree::getTheCellPosWhichIncludesThePoint(const CCVector3& P, Tuple3i& cellPos, unsigned char level) const
+{
+	assert(level <= DgmOctree::MAX_OCTREE_LEVEL);
+
+	const PointCoordinateType& cs = getCellSize(DgmOctree::MAX_OCTREE_LEVEL);
+	const unsigned char dec = DgmOctree::MAX_OCTREE_LEVEL-level;
+	cellPos.x = static_cast<int>((P.x - m_dimMin.x)/cs) >> dec;
+	cellPos.y = static_cast<int>((P.y - m_dimMin.y)/cs) >> dec;
+	cellPos.z = static_cast<int>((P.z - m_dimMin.z)/cs) >> dec;
+}
+
+void OutOfCoreOctree::GetCellPos(OctreeCellCodeType truncatedCode, unsigned char level, Tuple3i& cellPos)
+{
+	cellPos = Tuple3i(0,0,0);
+
+	int bitMask = 1;
+	for (unsigned char k = 0; k < level; ++k)
+	{
+		if (truncatedCode & 4)
+			cellPos.z |= bitMask;
+		if (truncatedCode & 2)
+			cellPos.y |= bitMask;
+		if (truncatedCode & 1)
+			cellPos.x |= bitMask;
+
+		truncatedCode >>= 3;
+		bitMask <<= 1;
+	}
+}
+
+OutOfCoreOctree::OctreeCellCodeType OutOfCoreOctree::GenerateTruncatedCellCode(const Tuple3i& cellPos, unsigned char level)
+{
+	assert(cellPos.x >= 0 && cellPos.y >= 0 && cellPos.z >= 0);
+
+	OctreeCellCodeType code = 0;
+	for (unsigned char k = 0; k < level; ++k)
+	{
+		code |=	(	 (static_cast<OctreeCellCodeType>((cellPos.x >> k) & 1))
+				|	((static_cast<OctreeCellCodeType>((cellPos.y >> k) & 1)) << 1)
+				|	((static_cast<OctreeCellCodeType>((cellPos.z >> k) & 1)) << 2) ) << (3*k);
+	}
+	return code;
+}
+
+void OutOfCoreOctree::computeCellCenter(const Tuple3i& cellPos, unsigned char level, CCVector3& center) const
+{
+	const PointCoordinateType& cs = getCellSize(level);
+	center.x = m_dimMin.x + cs * (static_cast<PointCoordinateType>(cellPos.x) + static_cast<PointCoordinateType>(0.5));
+	center.y = m_dimMin.y + cs * (static_cast<PointCoordinateType>(cellPos.y) + static_cast<PointCoordinateType>(0.5));
+	center.z = m_dimMin.z + cs * (static_cast<PointCoordinateType>(cellPos.z) + static_cast<PointCoordinateType>(0.5));
+}
+
+void OutOfCoreOctree::getFillIndexes(unsigned char level, Tuple3i& minPos, Tuple3i& maxPos) const
+{
+	assert(level <= DgmOctree::MAX_OCTREE_LEVEL);
+
+	const unsigned char dec = DgmOctree::MAX_OCTREE_LEVEL-level;
+	minPos = Tuple3i(m_fillMin.x >> dec, m_fillMin.y >> dec, m_fillMin.z >> dec);
+	maxPos = Tuple3i(m_fillMax.x >> dec, m_fillMax.y >> dec, m_fillMax.z >> dec);
+}
+
+unsigned char OutOfCoreOctree::findBestLevelForAGivenNeighbourhoodSizeExtraction(PointCoordinateType radius) const
+{
+	unsigned char level = 1;
+	while (level < DgmOctree::MAX_OCTREE_LEVEL && getCellSize(level+1) >= radius)
+		++level;
+
+	return level;
+}
+
+unsigned char OutOfCoreOctree::findBestLevelForAGivenPopulationPerCell(unsigned indicativeNumberOfPointsPerCell) const
+{
+	//same as DgmOctree::findBestLevelForAGivenPopulationPerCell
+	double density = 0, prevDensity = 0;
+
+	unsigned char level = DgmOctree::MAX_OCTREE_LEVEL;
+	for (level = DgmOctree::MAX_OCTREE_LEVEL; level > 0; --level)
+	{
+		prevDensity = density;
+		density = static_cast<double>(m_numberOfProjectedPoints)/std::max<unsigned>(getCellNumber(level), 1);
+		if (density >= indicativeNumberOfPointsPerCell)
+			break;
+	}
+
+	if (level < DgmOctree::MAX_OCTREE_LEVEL)
+	{
+		if (level == 0)
+		{
+			prevDensity = density;
+			density = static_cast<double>(m_numberOfProjectedPoints);
+		}
+
+		//we take the closest match
+		if (density-indicativeNumberOfPointsPerCell > indicativeNumberOfPointsPerCell-prevDensity)
+			++level;
+	}
+
+	return level;
+}
+
+const OutOfCoreOctree::CellsTable* OutOfCoreOctree::getCellsTable(unsigned char level) const
+{
+	assert(level <= DgmOctree::MAX_OCTREE_LEVEL);
+
+	if (m_cellsTables[level])
+		return m_cellsTables[level];
+
+	if (!m_codesFile || m_numberOfProjectedPoints == 0)
+		return 0;
+
+	releaseMemory(static_cast<size_t>(getCellNumber(level)) * sizeof(CellEntry), level);
+
+	CellsTable* table = new CellsTable;
+	std::vector<OctreeCellCodeType> codes;
+	try
+	{
+		table->reserve(getCellNumber(level));
+		codes.resize(c_blockSize);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		delete table;
+		return 0;
+	}
+
+	//we scan the (sorted) codes file
+	if (!Seek(m_codesFile, 0))
+	{
+		delete table;
+		return 0;
+	}
+
+	unsigned char bitDec = GET_BIT_SHIFT(level);
+	for (unsigned first = 0; first < m_numberOfProjectedPoints; )
+	{
+		size_t count = std::min<size_t>(c_blockSize, m_numberOfProjectedPoints - first);
+		if (fread(&codes[0], sizeof(OctreeCellCodeType), count, m_codesFile) != count)
+		{
+			delete table;
+			return 0;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			OctreeCellCodeType truncatedCode = (codes[i] >> bitDec);
+			if (table->empty() || table->back().code != truncatedCode)
+			{
+				CellEntry entry;
+				entry.code = truncatedCode;
+				entry.first = first + static_cast<unsigned>(i);
+				entry.count = 1;
+				table->push_back(entry);
+			}
+			else
+			{
+				++table->back().count;
+			}
+		}
+
+		first += static_cast<unsigned>(count);
+	}
+
+	m_cellsTables[level] = table;
+	return table;
+}
+
+int OutOfCoreOctree::FindCell(const CellsTable& table, OctreeCellCodeType truncatedCode)
+{
+	//binary search
+	size_t begin = 0, end = table.size();
+	while (begin < end)
+	{
+		size_t middle = (begin + end) / 2;
+		if (table[middle].code < truncatedCode)
+			begin = middle + 1;
+		else
+			end = middle;
+	}
+
+	return (begin < table.size() && table[begin].code == truncatedCode ? static_cast<int>(begin) : -1);
+}
+
+const OutOfCoreOctree::Page* OutOfCoreOctree::getPage(unsigned pageIndex) const
+{
+	std::map<unsigned,size_t>::const_iterator it = m_pageSlots.find(pageIndex);
+	if (it != m_pageSlots.end())
+	{
+		Page* page = m_pages[it->second];
+		page->lastUse = ++m_cacheClock;
+		return page;
+	}
+
+	//we make some room if necessary (but we always keep at least one page)
+	//the cells tables are left untouched as the caller may be iterating over one of them
+	const size_t pageBytes = c_pageSize * sizeof(PointRecord);
+	if (m_pages.size() > 1 && memoryUsage() + pageBytes > m_memoryLimit)
+		releaseMemory(pageBytes, 0xFF, true);
+
+	unsigned first = pageIndex * c_pageSize;
+	if (first >= m_numberOfProjectedPoints || !m_pointsFile)
+		return 0;
+	size_t count = std::min<size_t>(c_pageSize, m_numberOfProjectedPoints - first);
+
+	Page* page = new Page;
+	try
+	{
+		page->records.reserve(c_pageSize); //for memory accounting
+		page->records.resize(count);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		delete page;
+		return 0;
+	}
+
+	if (	!Seek(m_pointsFile, static_cast<unsigned long long>(first) * sizeof(PointRecord))
+		||	fread(&page->records[0], sizeof(PointRecord), count, m_pointsFile) != count)
+	{
+		delete page;
+		return 0;
+	}
+
+	page->index = pageIndex;
+	page->lastUse = ++m_cacheClock;
+	m_pageSlots[pageIndex] = m_pages.size();
+	m_pages.push_back(page);
+
+	return page;
+}
+
+bool OutOfCoreOctree::readPoints(unsigned first, unsigned count, PointRecords& points) const
+{
+	size_t pos = points.size();
+	try
+	{
+		points.resize(pos + count);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		return false;
+	}
+
+	while (count != 0)
+	{
+		unsigned pageIndex = first / c_pageSize;
+		const Page* page = getPage(pageIndex);
+		if (!page)
+			return false;
+
+		unsigned offset = first - pageIndex * c_pageSize;
+		unsigned n = std::min<unsigned>(count, static_cast<unsigned>(page->records.size()) - offset);
+		std::copy(page->records.begin() + offset, page->records.begin() + (offset + n), points.begin() + pos);
+
+		pos += n;
+		first += n;
+		count -= n;
+	}
+
+	return true;
+}
+
+bool OutOfCoreOctree::getPointsInCell(const Tuple3i& cellPos, unsigned char level, PointRecords& points) const
+{
+	return getPointsInNeighbourCells(cellPos, level, 0, points);
+}
+
+bool OutOfCoreOctree::getPointsInNeighbourCells(const Tuple3i& cellPos,
+												unsigned char level,
+												int neighbourhoodLength,
+												PointRecords& points,
+												bool onlyBorder/*=false*/) const
+{
+	const CellsTable* table = getCellsTable(level);
+	if (!table)
+		return false;
+
+	//we only look at the filled part of the octree
+	Tuple3i fillMin, fillMax;
+	getFillIndexes(level, fillMin, fillMax);
+	Tuple3i minPos, maxPos;
+	for (unsigned char d = 0; d < 3; ++d)
+	{
+		minPos.u[d] = std::max(cellPos.u[d] - neighbourhoodLength, fillMin.u[d]);
+		maxPos.u[d] = std::min(cellPos.u[d] + neighbourhoodLength, fillMax.u[d]);
+	}
+
+	Tuple3i pos;
+	for (pos.x = minPos.x; pos.x <= maxPos.x; ++pos.x)
+	{
+		bool xBorder = (abs(pos.x - cellPos.x) == neighbourhoodLength);
+		for (pos.y = minPos.y; pos.y <= maxPos.y; ++pos.y)
+		{
+			bool xyBorder = xBorder || (abs(pos.y - cellPos.y) == neighbourhoodLength);
+			//if we are not on a X or Y border, only the 2 cells at the Z borders are needed
+			int zStep = (onlyBorder && !xyBorder ? std::max(2*neighbourhoodLength, 1) : 1);
+			for (pos.z = (onlyBorder && !xyBorder ? cellPos.z - neighbourhoodLength : minPos.z); pos.z <= maxPos.z; pos.z += zStep)
+			{
+				if (pos.z < minPos.z)
+					continue;
+
+				int cellIndex = FindCell(*table, GenerateTruncatedCellCode(pos, level));
+				if (cellIndex >= 0)
+				{
+					const CellEntry& cell = (*table)[cellIndex];
+					if (!readPoints(cell.first, cell.count, points))
+						return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+unsigned OutOfCoreOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
+															octreeCellFunc func,
+															void** additionalParameters,
+															GenericProgressCallback* progressCb/*=0*/,
+															const char* functionTitle/*=0*/)
+{
+	if (!func || m_numberOfProjectedPoints == 0 || level > DgmOctree::MAX_OCTREE_LEVEL)
+		return 0;
+
+	const CellsTable* table = getCellsTable(level);
+	if (!table)
+		return 0;
+	size_t cellCount = table->size();
+
+	//the per-point values are written in the same order as the points
+	m_hasValues = false;
+	std::string valuesFilename = tempFilename("values");
+	FILE* valuesFile = fopen(valuesFilename.c_str(), "wb");
+	if (!valuesFile)
+		return 0;
+
+	//progress notification (optional)
+	if (progressCb)
+	{
+		progressCb->reset();
+		if (functionTitle)
+			progressCb->setMethodTitle(functionTitle);
+		char buffer[512];
+		sprintf(buffer, "Octree level %i\nCells: %u\nPoints: %u\n(out-of-core)", level, static_cast<unsigned>(cellCount), m_numberOfProjectedPoints);
+		progressCb->setInfo(buffer);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, m_numberOfProjectedPoints);
+
+	PointRecords points;
+	std::vector<ScalarType> values;
+
+	octreeCell cell;
+	cell.parentOctree = this;
+	cell.level = level;
+	cell.points = &points;
+	cell.values = &values;
+
+	bool success = true;
+	unsigned processedCells = 0;
+	for (size_t i = 0; i < cellCount; ++i)
+	{
+		//the table may have been released by the function (if it requested other levels)
+		table = getCellsTable(level);
+		if (!table)
+		{
+			success = false;
+			break;
+		}
+		CellEntry entry = (*table)[i];
+
+		points.clear();
+		if (!readPoints(entry.first, entry.count, points))
+		{
+			success = false;
+			break;
+		}
+
+		try
+		{
+			values.assign(entry.count, NAN_VALUE);
+		}
+		catch (.../*const std::bad_alloc&*/) //out of memory
+		{
+			success = false;
+			break;
+		}
+
+		cell.truncatedCode = entry.code;
+		GetCellPos(entry.code, level, cell.cellPos);
+
+		if (!(*func)(cell, additionalParameters, &nprogress))
+		{
+			//something went wrong (or the process has been cancelled)
+			success = false;
+			break;
+		}
+
+		if (fwrite(&values[0], sizeof(ScalarType), values.size(), valuesFile) != values.size())
+		{
+			success = false;
+			break;
+		}
+
+		++processedCells;
+	}
+
+	fclose(valuesFile);
+
+	if (progressCb)
+		progressCb->stop();
+
+	if (!success)
+	{
+		remove(valuesFilename.c_str());
+		return 0;
+	}
+
+	m_hasValues = true;
+	return processedCells;
+}
+
+bool OutOfCoreOctree::exportValues(ScalarField* sf, GenericProgressCallback* progressCb/*=0*/) const
+{
+	if (!sf || !m_hasValues || !m_pointsFile)
+		return false;
+
+	FILE* valuesFile = fopen(tempFilename("values").c_str(), "rb");
+	if (!valuesFile)
+		return false;
+
+	PointRecords records;
+	std::vector<ScalarType> values;
+	try
+	{
+		records.resize(c_blockSize);
+		values.resize(c_blockSize);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		fclose(valuesFile);
+		return false;
+	}
+
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Export values");
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, m_numberOfProjectedPoints);
+
+	bool success = Seek(m_pointsFile, 0);
+	unsigned sfSize = sf->currentSize();
+	for (unsigned first = 0; first < m_numberOfProjectedPoints && success; )
+	{
+		size_t count = std::min<size_t>(c_blockSize, m_numberOfProjectedPoints - first);
+		if (	fread(&records[0], sizeof(PointRecord), count, m_pointsFile) != count
+			||	fread(&values[0], sizeof(ScalarType), count, valuesFile) != count )
+		{
+			success = false;
+			break;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (records[i].index >= sfSize)
+			{
+				//scalar field is too small
+				success = false;
+				break;
+			}
+			sf->setValue(records[i].index, values[i]);
+		}
+
+		first += static_cast<unsigned>(count);
+		if (!nprogress.steps(static_cast<unsigned>(count)))
+			success = false;
+	}
+
+	fclose(valuesFile);
+
+	if (progressCb)
+		progressCb->stop();
+
+	return success;
+}
+
+bool OutOfCoreOctree::exportValues(ValuesOutput& output, GenericProgressCallback* progressCb/*=0*/) const
+{
+	if (!m_hasValues || !m_pointsFile)
+		return false;
+
+	FILE* valuesFile = fopen(tempFilename("values").c_str(), "rb");
+	if (!valuesFile)
+		return false;
+
+	//the values are sorted back in the order of the input points (external sort)
+	releaseMemory(m_memoryLimit, 0xFF); //we don't need the cells tables and the cached pages anymore
+	size_t bufferCapacity = std::min<size_t>(m_memoryLimit / sizeof(IndexedValue), m_numberOfProjectedPoints);
+	PointRecords records;
+	std::vector<ScalarType> values;
+	std::vector<IndexedValue> buffer;
+	try
+	{
+		records.resize(c_blockSize);
+		values.resize(c_blockSize);
+		buffer.reserve(bufferCapacity);
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		fclose(valuesFile);
+		return false;
+	}
+
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Export values");
+		char infosBuffer[256];
+		sprintf(infosBuffer, "Points: %u\nMemory limit: %u Mb", m_numberOfInputPoints, static_cast<unsigned>(m_memoryLimit >> 20));
+		progressCb->setInfo(infosBuffer);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, m_numberOfProjectedPoints, 50); //first phase: 50% (we keep 50% for the merge)
+
+	std::vector<std::string> runFiles;
+	bool success = Seek(m_pointsFile, 0);
+
+	//first phase: we read the values (in the octree order) and write blocks sorted by point index ('runs')
+	for (unsigned first = 0; first < m_numberOfProjectedPoints && success; )
+	{
+		size_t count = std::min<size_t>(c_blockSize, m_numberOfProjectedPoints - first);
+		if (	fread(&records[0], sizeof(PointRecord), count, m_pointsFile) != count
+			||	fread(&values[0], sizeof(ScalarType), count, valuesFile) != count )
+		{
+			success = false;
+			break;
+		}
+
+		for (size_t i = 0; i < count && success; ++i)
+		{
+			IndexedValue entry;
+			entry.index = records[i].index;
+			entry.value = values[i];
+			buffer.push_back(entry);
+
+			//the buffer is full: we sort it and write it in a temporary file
+			if (buffer.size() == bufferCapacity && first + i + 1 < m_numberOfProjectedPoints)
+			{
+				char suffix[32];
+				sprintf(suffix, "export%u", static_cast<unsigned>(runFiles.size()));
+				runFiles.push_back(tempFilename(suffix));
+				success = WriteRun(buffer, IndexedValueComp, runFiles.back());
+			}
+		}
+
+		first += static_cast<unsigned>(count);
+		if (!nprogress.steps(static_cast<unsigned>(count)))
+			success = false;
+	}
+
+	fclose(valuesFile);
+	std::vector<ScalarType>().swap(values);
+	PointRecords().swap(records);
+
+	//second phase: the values are sent in the order of the input points (NAN_VALUE for the points outside of the octree)
+	NormalizedProgress outputProgress(progressCb, m_numberOfInputPoints, 50);
+	unsigned nextIndex = 0;
+	if (success)
+	{
+		if (runFiles.empty())
+		{
+			//everything fits in memory
+			std::sort(buffer.begin(), buffer.end(), IndexedValueComp);
+			for (size_t i = 0; i < buffer.size() && success; ++i)
+			{
+				for (; nextIndex < buffer[i].index && success; ++nextIndex)
+					success = output.addValue(NAN_VALUE) && outputProgress.oneStep();
+				if (success)
+				{
+					success = output.addValue(buffer[i].value) && outputProgress.oneStep();
+					++nextIndex;
+				}
+			}
+		}
+		else
+		{
+			//the last block is written as well, so as to release its memory before the merge
+			if (!buffer.empty())
+			{
+				char suffix[32];
+				sprintf(suffix, "export%u", static_cast<unsigned>(runFiles.size()));
+				runFiles.push_back(tempFilename(suffix));
+				success = WriteRun(buffer, IndexedValueComp, runFiles.back());
+			}
+			std::vector<IndexedValue>().swap(buffer);
+
+			//k-way merge of the runs
+			size_t runCount = runFiles.size();
+			size_t readersCapacity = std::max<size_t>(m_memoryLimit / (runCount * sizeof(IndexedValue)), 1024);
+
+			std::vector< RunReader<IndexedValue> > readers(runCount);
+			for (size_t r = 0; r < runCount && success; ++r)
+				success = readers[r].open(runFiles[r], readersCapacity);
+
+			//priority queue: (point index, run index)
+			typedef std::pair<unsigned, size_t> QueueItem;
+			std::priority_queue< QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > queue;
+			for (size_t r = 0; r < runCount && success; ++r)
+			{
+				const IndexedValue* entry = readers[r].current();
+				if (entry)
+					queue.push(QueueItem(entry->index, r));
+			}
+
+			while (!queue.empty() && success)
+			{
+				size_t r = queue.top().second;
+				queue.pop();
+
+				const IndexedValue* entry = readers[r].current();
+				for (; nextIndex < entry->index && success; ++nextIndex)
+					success = output.addValue(NAN_VALUE) && outputProgress.oneStep();
+				if (success)
+				{
+					success = output.addValue(entry->value) && outputProgress.oneStep();
+					++nextIndex;
+				}
+
+				++readers[r].pos;
+				entry = readers[r].current();
+				if (entry)
+					queue.push(QueueItem(entry->index, r));
+			}
+
+			for (size_t r = 0; r < runCount; ++r)
+				readers[r].close();
+		}
+	}
+
+	//points left after the last projected one
+	for (; nextIndex < m_numberOfInputPoints && success; ++nextIndex)
+		success = output.addValue(NAN_VALUE) && outputProgress.oneStep();
+
+	//we don't need the runs anymore
+	for (size_t r = 0; r < runFiles.size(); ++r)
+		remove(runFiles[r].c_str());
+
+	if (progressCb)
+		progressCb->stop();
+
+	return success;
+}
@@ -288,27 +288,37 @@ GenericIndexedMesh* PointProjectionTools::computeTriangulation(	GenericIndexedCl
 
 			Delaunay2dMesh* dm = new Delaunay2dMesh();
 			char triLibErrorStr[1024];
-			if (!dm->buildMesh(the2DPoints,0,triLibErrorStr))
+			if (maxEdgeLength > 0)
 			{
-				if (errorStr)
-					strcpy(errorStr, triLibErrorStr);
-				delete dm;
-				return 0;
+				//the mesh is computed by tiles, and the triangles with too long edges are removed on the fly
+				dm->linkMeshWith(cloud,false);
+				if (!dm->buildMeshByTiles(the2DPoints,maxEdgeLength,0,triLibErrorStr))
+				{
+					if (errorStr)
+						strcpy(errorStr, triLibErrorStr);
+					delete dm;
+					return 0;
+				}
 			}
-			dm->linkMeshWith(cloud,false);
-
-			//remove triangles with too long edges
-			if (maxEdgeLength > 0)
+			else
 			{
-				dm->removeTrianglesWithEdgesLongerThan(maxEdgeLength);
-				if (dm->size() == 0)
+				if (!dm->buildMesh(the2DPoints,0,triLibErrorStr))
 				{
-					//no more triangles?
 					if (errorStr)
-						strcpy(errorStr, "No triangle left after pruning");
+						strcpy(errorStr, triLibErrorStr);
 					delete dm;
 					return 0;
 				}
+				dm->linkMeshWith(cloud,false);
+			}
+
+			if (maxEdgeLength > 0 && dm->size() == 0)
+			{
+				//no more triangles?
+				if (errorStr)
+					strcpy(errorStr, "No triangle left after pruning");
+				delete dm;
+				return 0;
 			}
 
 			return static_cast<GenericIndexedMesh*>(dm);
@@ -163,7 +163,8 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::RegisterClouds(	GenericI
 																		double finalOverlapRatio/*=1.0*/,
 																		ScalarField* inputModelWeights/*=0*/,
 																		ScalarField* inputDataWeights/*=0*/,
-																		int filters/*=SKIP_NONE*/)
+																		int filters/*=SKIP_NONE*/,
+																		bool multiThread/*=true*/)
 {
 	assert(inputModelCloud && inputDataCloud);
 
@@ -318,6 +319,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::RegisterClouds(	GenericI
 		//data.cloud->forEach(ScalarFieldTools::SetScalarValueToNaN); //DGM: done automatically in computeCloud2CloudDistance now
 		DistanceComputationTools::Cloud2CloudDistanceComputationParams c2cDistParams;
 		c2cDistParams.CPSet = data.CPSet;
+		c2cDistParams.multiThread = multiThread;
 		if (DistanceComputationTools::computeCloud2CloudDistance(data.cloud,model.cloud,c2cDistParams,progressCb) < 0)
 		{
 			//an error occurred during distances computation...
@@ -681,6 +683,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::RegisterClouds(	GenericI
 		{
 			DistanceComputationTools::Cloud2CloudDistanceComputationParams c2cDistParams;
 			c2cDistParams.CPSet = data.CPSet;
+			c2cDistParams.multiThread = multiThread;
 			if (DistanceComputationTools::computeCloud2CloudDistance(data.cloud,model.cloud,c2cDistParams) < 0)
 			{
 				//an error occurred during distances computation...
@@ -12,8 +12,184 @@
 #include <stdint.h>
 #include <stdio.h> //for sprintf
 
+#ifdef USE_QT
+#ifndef _DEBUG
+//enables multi-threading handling
+#define ENABLE_MT_SAITO
+#include <QThread>
+#include <QtConcurrentMap>
+#endif
+#endif
+
 using namespace CCLib;
 
+//! Minimum number of triangles per job (the slices and rows are processed one by one)
+static const size_t MIN_TRIANGLES_PER_JOB = 4096;
+
+bool SaitoSquaredDistanceTransform::ProcessJobs(const Job& prototype, size_t count, void (*func)(Job&), NormalizedProgress& nProgress)
+{
+	if (count == 0)
+		return true;
+
+	size_t threadCount = 1;
+#ifdef ENABLE_MT_SAITO
+	threadCount = static_cast<size_t>(std::max(1,QThread::idealThreadCount()));
+#endif
+
+	//a few jobs per thread (so that they are balanced)
+	size_t minCountPerJob = (func == IntersectTriangles_Job ? MIN_TRIANGLES_PER_JOB : 1);
+	size_t jobCount = std::max<size_t>(1, std::min<size_t>(count / minCountPerJob, threadCount * 4));
+
+	std::vector<Job> jobs;
+	try
+	{
+		jobs.resize(jobCount, prototype);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+	for (size_t j=0; j<jobCount; ++j)
+	{
+		jobs[j].first = (count * j) / jobCount;
+		jobs[j].last = (count * (j+1)) / jobCount;
+		jobs[j].success = true;
+	}
+
+	//jobs are processed by batches (so that the progress can be updated and the user can cancel the process)
+	for (size_t start=0; start<jobCount; start+=threadCount)
+	{
+		size_t stop = std::min(jobCount, start+threadCount);
+		std::vector<Job> batch(jobs.begin()+start, jobs.begin()+stop);
+
+#ifdef ENABLE_MT_SAITO
+		QtConcurrent::blockingMap(batch, func);
+#else
+		for (size_t j=0; j<batch.size(); ++j)
+			func(batch[j]);
+#endif
+
+		for (size_t j=0; j<batch.size(); ++j)
+		{
+			if (!batch[j].success)
+				return false;
+			if (!nProgress.steps(static_cast<unsigned>(batch[j].last - batch[j].first)))
+			{
+				//process cancelled by user
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void SaitoSquaredDistanceTransform::SDT_2D_Job(Job& job)
+{
+	const Tuple3ui& gridSize = job.grid->size();
+	size_t sliceSize = static_cast<size_t>(gridSize.x) * gridSize.y;
+
+	for (size_t k = job.first; k < job.last; ++k)
+	{
+		GridElement* data = job.grid->data() + k * sliceSize;
+		for (size_t i = 0; i < sliceSize; ++i)
+		{
+			//DGM: warning we must invert the input image here!
+			if (data[i] == 0)
+				data[i] = job.maxDistance;
+			else
+				data[i] = 0;
+		}
+
+		if (!SDT_2D(*job.grid, k, *job.sq))
+		{
+			job.success = false;
+			return;
+		}
+	}
+}
+
+void SaitoSquaredDistanceTransform::SDT_1D_Z_Job(Job& job)
+{
+	for (size_t j = job.first; j < job.last; ++j)
+	{
+		if (!SDT_1D_Z(*job.grid, j, *job.sq))
+		{
+			job.success = false;
+			return;
+		}
+	}
+}
+
+void SaitoSquaredDistanceTransform::IntersectTriangles_Job(Job& job)
+{
+	std::vector<CellToTest> cellsToTest;
+	try
+	{
+		cellsToTest.resize(1); //initial size must be > 0
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		job.success = false;
+		return;
+	}
+
+	for (size_t n = job.first; n < job.last; ++n)
+	{
+		CCVector3 A, B, C;
+		job.mesh->getTriangleVertices(static_cast<unsigned>(n), A, B, C);
+		const CCVector3* triPoints[3] = { &A, &B, &C };
+
+		if (!job.grid->intersectWithTriangle(triPoints, job.cellLength, job.gridMinCorner, 1, cellsToTest))
+		{
+			//not enough memory
+			job.success = false;
+			return;
+		}
+	}
+}
+
+bool SaitoSquaredDistanceTransform::initDT(	GenericIndexedMesh* mesh,
+											PointCoordinateType cellLength,
+											const CCVector3& gridMinCorner,
+											GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!mesh || !isInitialized())
+	{
+		assert(false);
+		return false;
+	}
+
+	//number of triangles
+	unsigned numberOfTriangles = mesh->size();
+
+	//progress notification
+	NormalizedProgress nProgress(progressCb, numberOfTriangles);
+	if (progressCb)
+	{
+		char buffer[64];
+		sprintf(buffer, "Triangles: %u", numberOfTriangles);
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle("Intersect Grid/Mesh");
+		progressCb->start();
+	}
+
+	Job prototype;
+	prototype.grid = this;
+	prototype.sq = 0;
+	prototype.maxDistance = 0;
+	prototype.mesh = mesh;
+	prototype.cellLength = cellLength;
+	prototype.gridMinCorner = gridMinCorner;
+	prototype.first = prototype.last = 0;
+	prototype.success = true;
+
+	return ProcessJobs(prototype, numberOfTriangles, IntersectTriangles_Job, nProgress);
+}
+
 bool SaitoSquaredDistanceTransform::EDT_1D(GridElement* slice, size_t r, size_t c)
 {
 	GridElement *row = slice;
@@ -183,13 +359,110 @@ bool SaitoSquaredDistanceTransform::SDT_2D(Grid3D<GridElement>& grid, size_t sli
 	return true;
 }
 
+bool SaitoSquaredDistanceTransform::SDT_1D_Z(Grid3D<GridElement>& grid, size_t rowIndex, const std::vector<GridElement>& sq)
+{
+	const Tuple3ui& gridSize = grid.size();
+	size_t r = gridSize.y;
+	size_t c = gridSize.x;
+	size_t p = gridSize.z;
+	size_t rc = r*c;
+
+	std::vector<GridElement> colData;
+	try
+	{
+		colData.resize(p);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	GridElement* data = grid.data() + rowIndex * c;
+
+	for (size_t i = 0; i < c; ++i)
+	{
+		GridElement* pt = data + i;
+
+		for (size_t k = 0; k < p; ++k, pt += rc)
+			colData[k] = *pt;
+
+		pt = data + i + rc;
+		GridElement a = 0;
+		GridElement buffer = colData[0];
+
+		for (size_t k = 1; k < p; ++k, pt += rc)
+		{
+			if (a != 0)
+				--a;
+			if (colData[k] > buffer + 1)
+			{
+				GridElement b = (colData[k] - buffer - 1) / 2;
+				if (k + b + 1 > p)
+					b = static_cast<GridElement>(p - 1 - k);
+
+				GridElement* npt = pt + a*rc;
+				for (GridElement l = a; l <= b; ++l)
+				{
+					GridElement m = buffer + sq[l + 1];
+					if (colData[k + l] <= m)
+						break;   // go to next plane k
+					if (m < *npt)
+						*npt = m;
+					npt += rc;
+				}
+				a = b;
+			}
+			else
+			{
+				a = 0;
+			}
+			buffer = colData[k];
+		}
+
+		a = 0;
+		pt -= 2 * rc;
+		buffer = colData[p - 1];
+
+		for (size_t k = p - 2; k != static_cast<size_t>(-1); --k, pt -= rc)
+		{
+			if (a != 0)
+				--a;
+			if (colData[k] > buffer + 1)
+			{
+				GridElement b = (colData[k] - buffer - 1) / 2;
+				if (k < b)
+					b = static_cast<GridElement>(k);
+
+				GridElement* npt = pt - a*rc;
+				for (GridElement l = a; l <= b; ++l)
+				{
+					GridElement m = buffer + sq[l + 1];
+					if (colData[k - l] <= m)
+						break;   // go to next column k
+					if (m < *npt)
+						*npt = m;
+					npt -= rc;
+				}
+				a = b;
+			}
+			else
+			{
+				a = 0;
+			}
+			buffer = colData[k];
+		}
+	}
+
+	return true;
+}
+
 bool SaitoSquaredDistanceTransform::SDT_3D(Grid3D<GridElement>& grid, GenericProgressCallback* progressCb/*=0*/)
 {
 	const Tuple3ui& gridSize = grid.size();
 	size_t r = gridSize.y;
 	size_t c = gridSize.x;
 	size_t p = gridSize.z;
-	size_t voxelCount = r*c*p;
 
 	size_t diag = static_cast<size_t>(ceil(sqrt(static_cast<double>(r*r + c*c + p*p))) - 1);
 	size_t nsqr = 2 * (diag + 1);
@@ -223,127 +496,27 @@ bool SaitoSquaredDistanceTransform::SDT_3D(Grid3D<GridElement>& grid, GenericPro
 		progressCb->start();
 	}
 
-	GridElement* data = grid.data();
-	{
-		for (size_t i = 0; i < voxelCount; ++i)
-		{
-			//DGM: warning we must invert the input image here!
-			if (data[i] == 0)
-				data[i] = maxDistance;
-			else
-				data[i] = 0;
-		}
-	}
-
-	// 2D EDT for each slice
-	for (size_t k = 0; k < p; ++k)
+	Job prototype;
+	prototype.grid = &grid;
+	prototype.sq = &sq;
+	prototype.maxDistance = maxDistance;
+	prototype.mesh = 0;
+	prototype.cellLength = 0;
+	prototype.first = prototype.last = 0;
+	prototype.success = true;
+
+	// 2D EDT for each slice (slices are independent)
+	if (!ProcessJobs(prototype, p, SDT_2D_Job, normProgress))
 	{
-		if (!SDT_2D(grid, k, sq))
-		{
-			return false;
-		}
-
-		if (progressCb && !normProgress.oneStep())
-		{
-			//process cancelled by user
-			return false;
-		}
-	}
-
-	// Now, for each pixel, compute final distance by searching along Z direction
-	size_t rc = r*c;
-	std::vector<GridElement> colData;
-	try
-	{
-		colData.resize(p);
-	}
-	catch (const std::bad_alloc&)
-	{
-		//not enough memory
+		//not enough memory or process cancelled by user
 		return false;
 	}
 
-	for (size_t j = 0; j < r; ++j, data += c)
+	// Now, for each pixel, compute final distance by searching along Z direction (rows are independent)
+	if (!ProcessJobs(prototype, r, SDT_1D_Z_Job, normProgress))
 	{
-		for (size_t i = 0; i < c; ++i)
-		{
-			GridElement* pt = data + i;
-
-			for (size_t k = 0; k < p; ++k, pt += rc)
-				colData[k] = *pt;
-
-			pt = data + i + rc;
-			GridElement a = 0;
-			GridElement buffer = colData[0];
-
-			for (size_t k = 1; k < p; ++k, pt += rc)
-			{
-				if (a != 0)
-					--a;
-				if (colData[k] > buffer + 1)
-				{
-					GridElement b = (colData[k] - buffer - 1) / 2;
-					if (k + b + 1 > p)
-						b = static_cast<GridElement>(p - 1 - k);
-
-					GridElement* npt = pt + a*rc;
-					for (GridElement l = a; l <= b; ++l)
-					{
-						GridElement m = buffer + sq[l + 1];
-						if (colData[k + l] <= m)
-							break;   // go to next plane k
-						if (m < *npt)
-							*npt = m;
-						npt += rc;
-					}
-					a = b;
-				}
-				else
-				{
-					a = 0;
-				}
-				buffer = colData[k];
-			}
-
-			a = 0;
-			pt -= 2 * rc;
-			buffer = colData[p - 1];
-
-			for (size_t k = p - 2; k != static_cast<size_t>(-1); --k, pt -= rc)
-			{
-				if (a != 0)
-					--a;
-				if (colData[k] > buffer + 1)
-				{
-					GridElement b = (colData[k] - buffer - 1) / 2;
-					if (k < b)
-						b = static_cast<GridElement>(k);
-
-					GridElement* npt = pt - a*rc;
-					for (GridElement l = a; l <= b; ++l)
-					{
-						GridElement m = buffer + sq[l + 1];
-						if (colData[k - l] <= m)
-							break;   // go to next column k
-						if (m < *npt)
-							*npt = m;
-						npt -= rc;
-					}
-					a = b;
-				}
-				else
-				{
-					a = 0;
-				}
-				buffer = colData[k];
-			}
-		}
-
-		if (progressCb && !normProgress.oneStep())
-		{
-			//process cancelled by user
-			return false;
-		}
+		//not enough memory or process cancelled by user
+		return false;
 	}
 
 	return true;
@@ -20,9 +20,177 @@
 //system
 #include <assert.h>
 #include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#ifdef USE_QT
+#ifndef _DEBUG
+//enables multi-threading handling
+#define ENABLE_MT_SF_STATS
+#include <QThread>
+#include <QtConcurrentMap>
+#endif
+#endif
 
 using namespace CCLib;
 
+//! Set of contiguous chunks of a scalar field processed by a single job
+struct SFChunksJob
+{
+	const ScalarField* sf;
+	unsigned firstChunk;
+	unsigned lastChunk; //excluded
+
+	//statistics
+	ScalarField::Statistics stats;
+	double m2; //sum of squared differences from the mean
+
+	//histogram
+	ScalarType histoMin;
+	ScalarType histoMax;
+	double histoInvStep;
+	std::vector<unsigned> histo;
+};
+
+//! Splits the chunks of a scalar field in (balanced) jobs
+static bool PrepareChunksJobs(const ScalarField* sf, std::vector<SFChunksJob>& jobs)
+{
+	unsigned chunkCount = sf->chunksCount();
+	unsigned jobCount = 1;
+#ifdef ENABLE_MT_SF_STATS
+	//a few jobs per thread (so that they are balanced)
+	jobCount = std::max<unsigned>(1, std::min<unsigned>(chunkCount, static_cast<unsigned>(std::max(1,QThread::idealThreadCount())) * 4));
+#endif
+
+	try
+	{
+		jobs.resize(jobCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (unsigned j=0; j<jobCount; ++j)
+	{
+		SFChunksJob& job = jobs[j];
+		job.sf = sf;
+		job.firstChunk = static_cast<unsigned>((static_cast<size_t>(chunkCount) * j) / jobCount);
+		job.lastChunk = static_cast<unsigned>((static_cast<size_t>(chunkCount) * (j+1)) / jobCount);
+		job.m2 = 0;
+		job.histoMin = job.histoMax = 0;
+		job.histoInvStep = 0;
+	}
+
+	return true;
+}
+
+//! Computes the statistics of a job (two passes over each chunk, while it's in cache)
+static void ComputeChunksStats(SFChunksJob& job)
+{
+	ScalarField::Statistics& stats = job.stats;
+	stats = ScalarField::Statistics();
+	job.m2 = 0;
+
+	for (unsigned k=job.firstChunk; k<job.lastChunk; ++k)
+	{
+		const ScalarType* values = job.sf->chunkStartPtr(k);
+		unsigned count = job.sf->chunkSize(k);
+
+		//first pass: count, min, max and sum
+		unsigned validCount = 0;
+		ScalarType minVal = 0, maxVal = 0;
+		double sum = 0;
+		for (unsigned i=0; i<count; ++i)
+		{
+			ScalarType val = values[i];
+			if (!ScalarField::ValidValue(val))
+				continue;
+			if (validCount++ == 0)
+			{
+				minVal = maxVal = val;
+			}
+			else
+			{
+				minVal = std::min(minVal,val);
+				maxVal = std::max(maxVal,val);
+			}
+			sum += val;
+		}
+		if (validCount == 0)
+			continue;
+
+		//second pass: squared differences from the (chunk) mean
+		double mean = sum / validCount;
+		double m2 = 0;
+		for (unsigned i=0; i<count; ++i)
+		{
+			ScalarType val = values[i];
+			if (ScalarField::ValidValue(val))
+			{
+				double d = val - mean;
+				m2 += d*d;
+			}
+		}
+
+		//merge with the previous chunks (Chan et al.)
+		if (stats.validCount == 0)
+		{
+			stats.minVal = minVal;
+			stats.maxVal = maxVal;
+			stats.mean = mean;
+			job.m2 = m2;
+		}
+		else
+		{
+			double n = static_cast<double>(stats.validCount) + validCount;
+			double delta = mean - stats.mean;
+			stats.minVal = std::min(stats.minVal,minVal);
+			stats.maxVal = std::max(stats.maxVal,maxVal);
+			stats.mean += delta * validCount / n;
+			job.m2 += m2 + delta * delta * (static_cast<double>(stats.validCount) * validCount / n);
+		}
+		stats.validCount += validCount;
+	}
+}
+
+//! Computes the histogram of a job
+static void ComputeChunksHistogram(SFChunksJob& job)
+{
+	unsigned classCount = static_cast<unsigned>(job.histo.size());
+
+	for (unsigned k=job.firstChunk; k<job.lastChunk; ++k)
+	{
+		const ScalarType* values = job.sf->chunkStartPtr(k);
+		unsigned count = job.sf->chunkSize(k);
+
+		for (unsigned i=0; i<count; ++i)
+		{
+			ScalarType val = values[i];
+			//we ignore values outside of [min,max] (works for NaN values as well)
+			if (val >= job.histoMin && val <= job.histoMax)
+			{
+				unsigned bin = static_cast<unsigned>((val - job.histoMin) * job.histoInvStep);
+				++job.histo[std::min(bin,classCount-1)];
+			}
+		}
+	}
+}
+
+//! Runs the jobs (concurrently if possible)
+static void RunChunksJobs(std::vector<SFChunksJob>& jobs, void (*func)(SFChunksJob&))
+{
+#ifdef ENABLE_MT_SF_STATS
+	if (jobs.size() > 1)
+	{
+		QtConcurrent::blockingMap(jobs, func);
+		return;
+	}
+#endif
+	for (size_t j=0; j<jobs.size(); ++j)
+		func(jobs[j]);
+}
+
 ScalarField::ScalarField(const char* name/*=0*/)
 	: GenericChunkedArray<1,ScalarType>()
 {
@@ -37,69 +205,104 @@ void ScalarField::setName(const char* name)
 		strcpy(m_name,"Undefined");
 }
 
-void ScalarField::computeMeanAndVariance(ScalarType &mean, ScalarType* variance) const
+void ScalarField::computeStatistics(Statistics& stats) const
 {
-	double _mean = 0.0, _std2 = 0.0;
-	unsigned count = 0;
+	stats = Statistics();
 
-	for (unsigned i=0; i<currentSize(); ++i)
+	std::vector<SFChunksJob> jobs;
+	if (currentSize() == 0 || !PrepareChunksJobs(this,jobs))
+		return;
+
+	RunChunksJobs(jobs,ComputeChunksStats);
+
+	//merge the jobs results (Chan et al.)
+	double m2 = 0;
+	for (size_t j=0; j<jobs.size(); ++j)
 	{
-		const ScalarType& val = getValue(i);
-		if (ValidValue(val))
+		const SFChunksJob& job = jobs[j];
+		if (job.stats.validCount == 0)
+			continue;
+
+		if (stats.validCount == 0)
 		{
-			_mean += val;
-			_std2 += static_cast<double>(val) * val;
-			++count;
+			stats = job.stats;
+			m2 = job.m2;
+		}
+		else
+		{
+			double n = static_cast<double>(stats.validCount) + job.stats.validCount;
+			double delta = job.stats.mean - stats.mean;
+			stats.minVal = std::min(stats.minVal,job.stats.minVal);
+			stats.maxVal = std::max(stats.maxVal,job.stats.maxVal);
+			stats.mean += delta * job.stats.validCount / n;
+			m2 += job.m2 + delta * delta * (static_cast<double>(stats.validCount) * job.stats.validCount / n);
+			stats.validCount += job.stats.validCount;
 		}
 	}
 
-	if (count)
+	if (stats.validCount)
+		stats.variance = m2 / stats.validCount;
+}
+
+bool ScalarField::computeHistogram(ScalarType minVal, ScalarType maxVal, unsigned classCount, std::vector<unsigned>& histo) const
+{
+	histo.clear();
+	if (classCount == 0 || maxVal < minVal)
 	{
-		_mean /= count;
-		mean = static_cast<ScalarType>(_mean);
+		assert(false);
+		return false;
+	}
+
+	std::vector<SFChunksJob> jobs;
+	try
+	{
+		histo.resize(classCount,0);
+		if (currentSize() == 0)
+			return true;
+		if (!PrepareChunksJobs(this,jobs))
+			return false;
 
-		if (variance)
+		double invStep = (maxVal > minVal ? classCount / (static_cast<double>(maxVal) - minVal) : 0);
+		for (size_t j=0; j<jobs.size(); ++j)
 		{
-			_std2 = fabs(_std2/count - _mean*_mean);
-			*variance = static_cast<ScalarType>(_std2);
+			jobs[j].histoMin = minVal;
+			jobs[j].histoMax = maxVal;
+			jobs[j].histoInvStep = invStep;
+			jobs[j].histo.resize(classCount,0);
 		}
 	}
-	else
+	catch (const std::bad_alloc&)
 	{
-		mean = 0;
-		if (variance)
-			*variance = 0;
+		//not enough memory
+		histo.clear();
+		return false;
 	}
+
+	RunChunksJobs(jobs,ComputeChunksHistogram);
+
+	//merge the jobs histograms
+	for (size_t j=0; j<jobs.size(); ++j)
+		for (unsigned c=0; c<classCount; ++c)
+			histo[c] += jobs[j].histo[c];
+
+	return true;
+}
+
+void ScalarField::computeMeanAndVariance(ScalarType &mean, ScalarType* variance) const
+{
+	Statistics stats;
+	computeStatistics(stats);
+
+	mean = static_cast<ScalarType>(stats.mean);
+	if (variance)
+		*variance = static_cast<ScalarType>(stats.variance);
 }
 
 void ScalarField::computeMinAndMax()
 {
-	if (currentSize() != 0)
-	{
-		bool minMaxInitialized = false;
-		for (unsigned i=0; i<currentSize(); ++i)
-		{
-			const ScalarType& val = getValue(i);
-			if (ValidValue(val))
-			{
-				if (minMaxInitialized)
-				{
-					if (val < m_minVal)
-						m_minVal = val;
-					else if (val > m_maxVal)
-						m_maxVal = val;
-				}
-				else
-				{
-					//first valid value is used to init min and max
-					m_minVal = m_maxVal = val;
-					minMaxInitialized = true;
-				}
-			}
-		}
-	}
-	else //particular case: no value
-	{
-		m_minVal = m_maxVal = 0;
-	}
+	computeStatistics(m_statistics);
+
+	//particular case: no (valid) value --> min = max = 0
+	m_minVal = m_statistics.minVal;
+	m_maxVal = m_statistics.maxVal;
 }
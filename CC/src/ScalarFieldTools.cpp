@@ -30,6 +30,16 @@
 #include <assert.h>
 #include <stdio.h>
 #include <vector>
+#include <algorithm>
+
+#ifdef USE_QT
+#ifndef _DEBUG
+//enables multi-threading handling
+#define ENABLE_MT_SF_TOOLS
+#include <QThread>
+#include <QtConcurrentMap>
+#endif
+#endif
 
 using namespace CCLib;
 
@@ -438,39 +448,153 @@ void ScalarFieldTools::multiplyScalarFields(GenericIndexedCloud* firstCloud, Gen
 	}
 }
 
-void ScalarFieldTools::computeScalarFieldExtremas(const GenericCloud* theCloud, ScalarType& minV, ScalarType& maxV)
+//! Range of points of a generic cloud processed by a single job
+struct SFRangeJob
 {
-	assert(theCloud);
+	const GenericCloud* cloud;
+	unsigned firstIndex;
+	unsigned lastIndex; //excluded
+
+	//extremas
+	bool hasValidValue;
+	ScalarType minV;
+	ScalarType maxV;
+
+	//histogram
+	ScalarType histoMin;
+	ScalarType histoInvStep;
+	std::vector<int> histo;
+};
+
+//! Minimum number of points per job
+static const unsigned MIN_POINTS_PER_SF_JOB = 65536;
+
+//! Splits the cloud points in (balanced) jobs
+static bool PrepareRangeJobs(const GenericCloud* cloud, std::vector<SFRangeJob>& jobs)
+{
+	unsigned pointCount = cloud->size();
+	unsigned jobCount = 1;
+#ifdef ENABLE_MT_SF_TOOLS
+	//a few jobs per thread (so that they are balanced)
+	jobCount = std::max<unsigned>(1, std::min<unsigned>(pointCount / MIN_POINTS_PER_SF_JOB, static_cast<unsigned>(std::max(1,QThread::idealThreadCount())) * 4));
+#endif
 
-	minV = maxV = NAN_VALUE;
+	try
+	{
+		jobs.resize(jobCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
 
-	unsigned numberOfPoints = theCloud ? theCloud->size() : 0;
-	if (numberOfPoints == 0)
-		return;
+	for (unsigned j=0; j<jobCount; ++j)
+	{
+		SFRangeJob& job = jobs[j];
+		job.cloud = cloud;
+		job.firstIndex = static_cast<unsigned>((static_cast<size_t>(pointCount) * j) / jobCount);
+		job.lastIndex = static_cast<unsigned>((static_cast<size_t>(pointCount) * (j+1)) / jobCount);
+		job.hasValidValue = false;
+		job.minV = job.maxV = NAN_VALUE;
+		job.histoMin = job.histoInvStep = 0;
+	}
 
-	bool firstValidValue = true;
+	return true;
+}
 
-	for (unsigned i=0;i<numberOfPoints;++i)
+//! Computes the extremas of a job
+static void ComputeRangeExtremas(SFRangeJob& job)
+{
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
 	{
-		ScalarType V = theCloud->getPointScalarValue(i);
+		ScalarType V = job.cloud->getPointScalarValue(i);
 		if (ScalarField::ValidValue(V))
 		{
-			if (!firstValidValue)
+			if (job.hasValidValue)
 			{
-				if (V < minV)
-					minV = V;
-				else if (V > maxV)
-					maxV = V;
+				if (V < job.minV)
+					job.minV = V;
+				else if (V > job.maxV)
+					job.maxV = V;
 			}
 			else
 			{
-				minV = maxV = V;
-				firstValidValue = false;
+				job.minV = job.maxV = V;
+				job.hasValidValue = true;
 			}
 		}
 	}
 }
 
+//! Computes the histogram of a job
+static void ComputeRangeHistogram(SFRangeJob& job)
+{
+	int iNumberOfClasses = static_cast<int>(job.histo.size());
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		ScalarType V = job.cloud->getPointScalarValue(i);
+		if (ScalarField::ValidValue(V))
+		{
+			int aimClass = static_cast<int>((V-job.histoMin) * job.histoInvStep);
+			if (aimClass == iNumberOfClasses)
+				--aimClass; //sepcific case: V == maxV
+
+			++job.histo[aimClass];
+		}
+	}
+}
+
+//! Runs the jobs (concurrently if possible)
+static void RunRangeJobs(std::vector<SFRangeJob>& jobs, void (*func)(SFRangeJob&))
+{
+#ifdef ENABLE_MT_SF_TOOLS
+	if (jobs.size() > 1)
+	{
+		QtConcurrent::blockingMap(jobs, func);
+		return;
+	}
+#endif
+	for (size_t j=0; j<jobs.size(); ++j)
+		func(jobs[j]);
+}
+
+void ScalarFieldTools::computeScalarFieldExtremas(const GenericCloud* theCloud, ScalarType& minV, ScalarType& maxV)
+{
+	assert(theCloud);
+
+	minV = maxV = NAN_VALUE;
+
+	unsigned numberOfPoints = theCloud ? theCloud->size() : 0;
+	if (numberOfPoints == 0)
+		return;
+
+	std::vector<SFRangeJob> jobs;
+	if (!PrepareRangeJobs(theCloud,jobs))
+		return;
+
+	RunRangeJobs(jobs,ComputeRangeExtremas);
+
+	bool firstValidValue = true;
+	for (size_t j=0; j<jobs.size(); ++j)
+	{
+		const SFRangeJob& job = jobs[j];
+		if (!job.hasValidValue)
+			continue;
+
+		if (!firstValidValue)
+		{
+			minV = std::min(minV,job.minV);
+			maxV = std::max(maxV,job.maxV);
+		}
+		else
+		{
+			minV = job.minV;
+			maxV = job.maxV;
+			firstValidValue = false;
+		}
+	}
+}
+
 unsigned ScalarFieldTools::countScalarFieldValidValues(const GenericCloud* theCloud)
 {
 	assert(theCloud);
@@ -537,21 +661,34 @@ void ScalarFieldTools::computeScalarFieldHistogram(const GenericCloud* theCloud,
 	ScalarType invStep = (maxV > minV ? numberOfClasses / (maxV-minV) : 0);
 
 	//histogram computation
+	std::vector<SFRangeJob> jobs;
+	try
 	{
-		int iNumberOfClasses = static_cast<int>(numberOfClasses);
-		for (unsigned i=0; i<pointCount; ++i)
+		if (!PrepareRangeJobs(theCloud,jobs))
 		{
-			ScalarType V = theCloud->getPointScalarValue(i);
-			if (ScalarField::ValidValue(V))
-			{
-				int aimClass = static_cast<int>((V-minV) * invStep);
-				if (aimClass == iNumberOfClasses)
-					--aimClass; //sepcific case: V == maxV
-
-				++histo[aimClass];
-			}
+			histo.clear();
+			return;
+		}
+		for (size_t j=0; j<jobs.size(); ++j)
+		{
+			jobs[j].histoMin = minV;
+			jobs[j].histoInvStep = invStep;
+			jobs[j].histo.resize(numberOfClasses,0);
 		}
 	}
+	catch (const std::bad_alloc&)
+	{
+		//out of memory
+		histo.clear();
+		return;
+	}
+
+	RunRangeJobs(jobs,ComputeRangeHistogram);
+
+	//merge the jobs histograms
+	for (size_t j=0; j<jobs.size(); ++j)
+		for (unsigned c=0; c<numberOfClasses; ++c)
+			histo[c] += jobs[j].histo[c];
 }
 
 bool ScalarFieldTools::computeKmeans(	const GenericCloud* theCloud,
@@ -0,0 +1,570 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "TriangleBVH.h"
+
+//local
+#include "GenericIndexedMesh.h"
+#include "GenericProgressCallback.h"
+
+//system
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <math.h>
+#include <stdio.h> //for sprintf
+
+using namespace CCLib;
+
+//! Max number of triangles per leaf (if the SAH doesn't recommend bigger leaves)
+static const unsigned MAX_LEAF_SIZE = 4;
+//! Max number of triangles per leaf (whatever the SAH says)
+static const unsigned MAX_SAH_LEAF_SIZE = 16;
+//! Number of bins for SAH evaluation
+static const unsigned SAH_BIN_COUNT = 16;
+//! Depth after which nodes are simply split at the median (guarantees the tree max depth)
+static const unsigned MAX_SAH_DEPTH = 48;
+//! Traversal stack size (MAX_SAH_DEPTH + 32 median splits at most)
+static const unsigned TRAVERSAL_STACK_SIZE = 96;
+
+//! Node to be processed during the tree construction
+struct BuildTask
+{
+	//! First triangle (in the 'order' array)
+	unsigned begin;
+	//! Last triangle (excluded)
+	unsigned end;
+	//! Node depth
+	unsigned depth;
+	//! Index of the parent node if this node is a right child (-1 otherwise)
+	int parentIndex;
+};
+
+//! Half surface of a box (for SAH)
+static inline double HalfArea(const CCVector3& bbMin, const CCVector3& bbMax)
+{
+	double dx = bbMax.x - bbMin.x;
+	double dy = bbMax.y - bbMin.y;
+	double dz = bbMax.z - bbMin.z;
+	return dx*dy + dy*dz + dz*dx;
+}
+
+//! Extends a box with another one
+static inline void MergeBox(CCVector3& bbMin, CCVector3& bbMax, const CCVector3& otherMin, const CCVector3& otherMax)
+{
+	for (unsigned char k=0; k<3; ++k)
+	{
+		if (otherMin.u[k] < bbMin.u[k])
+			bbMin.u[k] = otherMin.u[k];
+		if (otherMax.u[k] > bbMax.u[k])
+			bbMax.u[k] = otherMax.u[k];
+	}
+}
+
+//! Returns whether a triangle centroid falls in the bins before a given one
+struct IsBeforeBin
+{
+	const std::vector<CCVector3>* centroids;
+	unsigned char dim;
+	PointCoordinateType minValue;
+	double scale;
+	unsigned splitBin;
+
+	inline bool operator()(unsigned index) const
+	{
+		unsigned bin = static_cast<unsigned>((static_cast<double>((*centroids)[index].u[dim]) - minValue) * scale);
+		return std::min(bin, SAH_BIN_COUNT-1) < splitBin;
+	}
+};
+
+//! Compares the centroids of two triangles along a given dimension
+struct IsCentroidBelow
+{
+	const std::vector<CCVector3>* centroids;
+	unsigned char dim;
+
+	inline bool operator()(unsigned a, unsigned b) const
+	{
+		return (*centroids)[a].u[dim] < (*centroids)[b].u[dim];
+	}
+};
+
+TriangleBVH::TriangleBVH()
+{
+}
+
+TriangleBVH::~TriangleBVH()
+{
+}
+
+void TriangleBVH::clear()
+{
+	m_nodes.clear();
+	m_triangles.clear();
+	m_triangleIndexes.clear();
+}
+
+bool TriangleBVH::build(GenericIndexedMesh* mesh, GenericProgressCallback* progressCb/*=0*/)
+{
+	clear();
+
+	if (!mesh || mesh->size() == 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned triCount = mesh->size();
+
+	//progress notification
+	NormalizedProgress nProgress(progressCb, triCount);
+	if (progressCb)
+	{
+		char buffer[64];
+		sprintf(buffer, "Triangles: %u", triCount);
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle("Build triangle BVH");
+		progressCb->start();
+	}
+
+	try
+	{
+		std::vector<Triangle> triangles(triCount);
+		std::vector<CCVector3> bbMins(triCount);
+		std::vector<CCVector3> bbMaxs(triCount);
+		std::vector<CCVector3> centroids(triCount);
+		std::vector<unsigned> order(triCount);
+
+		for (unsigned i=0; i<triCount; ++i)
+		{
+			Triangle& tri = triangles[i];
+			mesh->getTriangleVertices(i, tri.A, tri.B, tri.C);
+
+			for (unsigned char k=0; k<3; ++k)
+			{
+				bbMins[i].u[k] = std::min(tri.A.u[k], std::min(tri.B.u[k], tri.C.u[k]));
+				bbMaxs[i].u[k] = std::max(tri.A.u[k], std::max(tri.B.u[k], tri.C.u[k]));
+			}
+			centroids[i] = (tri.A + tri.B + tri.C) / 3;
+			order[i] = i;
+
+			if (!nProgress.oneStep())
+			{
+				//process cancelled by user
+				return false;
+			}
+		}
+
+		if (!buildNodes(bbMins, bbMaxs, centroids, order))
+		{
+			clear();
+			return false;
+		}
+
+		//we copy the triangles in leaf order
+		m_triangles.resize(triCount);
+		for (unsigned i=0; i<triCount; ++i)
+			m_triangles[i] = triangles[order[i]];
+		m_triangleIndexes.swap(order);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool TriangleBVH::buildNodes(	const std::vector<CCVector3>& bbMins,
+								const std::vector<CCVector3>& bbMaxs,
+								const std::vector<CCVector3>& centroids,
+								std::vector<unsigned>& order)
+{
+	unsigned triCount = static_cast<unsigned>(order.size());
+
+	std::vector<BuildTask> tasks;
+	try
+	{
+		m_nodes.reserve(2 * (triCount / MAX_LEAF_SIZE) + 1);
+		tasks.reserve(TRAVERSAL_STACK_SIZE);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	BuildTask root;
+	root.begin = 0;
+	root.end = triCount;
+	root.depth = 0;
+	root.parentIndex = -1;
+	tasks.push_back(root);
+
+	//the last pushed task is always the left child of the last created node
+	//(so that the left child of a node always follows it)
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		unsigned nodeIndex = static_cast<unsigned>(m_nodes.size());
+		m_nodes.push_back(Node());
+		if (task.parentIndex >= 0)
+			m_nodes[task.parentIndex].rightOrFirst = nodeIndex;
+
+		//node bounding box and centroids bounding box
+		CCVector3 bbMin = bbMins[order[task.begin]];
+		CCVector3 bbMax = bbMaxs[order[task.begin]];
+		CCVector3 cMin = centroids[order[task.begin]];
+		CCVector3 cMax = cMin;
+		for (unsigned i=task.begin+1; i<task.end; ++i)
+		{
+			unsigned index = order[i];
+			MergeBox(bbMin, bbMax, bbMins[index], bbMaxs[index]);
+			MergeBox(cMin, cMax, centroids[index], centroids[index]);
+		}
+
+		Node& node = m_nodes.back();
+		for (unsigned char k=0; k<3; ++k)
+		{
+			node.bbMin[k] = bbMin.u[k];
+			node.bbMax[k] = bbMax.u[k];
+		}
+
+		unsigned count = task.end - task.begin;
+		if (count <= MAX_LEAF_SIZE)
+		{
+			node.rightOrFirst = task.begin;
+			node.count = count;
+			continue;
+		}
+
+		unsigned middle = task.begin;
+
+		if (task.depth < MAX_SAH_DEPTH)
+		{
+			//look for the best split (binned SAH)
+			double bestCost = -1.0;
+			IsBeforeBin bestSplit;
+			bestSplit.centroids = &centroids;
+			bestSplit.dim = 0;
+			bestSplit.minValue = 0;
+			bestSplit.scale = 0;
+			bestSplit.splitBin = 0;
+
+			for (unsigned char dim=0; dim<3; ++dim)
+			{
+				double extent = static_cast<double>(cMax.u[dim]) - cMin.u[dim];
+				if (extent <= 0)
+					continue;
+
+				IsBeforeBin split;
+				split.centroids = &centroids;
+				split.dim = dim;
+				split.minValue = cMin.u[dim];
+				split.scale = SAH_BIN_COUNT / extent;
+
+				unsigned binCounts[SAH_BIN_COUNT];
+				CCVector3 binMins[SAH_BIN_COUNT];
+				CCVector3 binMaxs[SAH_BIN_COUNT];
+				for (unsigned b=0; b<SAH_BIN_COUNT; ++b)
+					binCounts[b] = 0;
+
+				for (unsigned i=task.begin; i<task.end; ++i)
+				{
+					unsigned index = order[i];
+					unsigned b = std::min(static_cast<unsigned>((static_cast<double>(centroids[index].u[dim]) - split.minValue) * split.scale), SAH_BIN_COUNT-1);
+					if (binCounts[b]++ == 0)
+					{
+						binMins[b] = bbMins[index];
+						binMaxs[b] = bbMaxs[index];
+					}
+					else
+					{
+						MergeBox(binMins[b], binMaxs[b], bbMins[index], bbMaxs[index]);
+					}
+				}
+
+				//sweep from the right to get the cost of each right part
+				double rightCosts[SAH_BIN_COUNT];
+				{
+					unsigned rightCount = 0;
+					CCVector3 rMin, rMax;
+					for (unsigned b=SAH_BIN_COUNT-1; b>0; --b)
+					{
+						if (binCounts[b] != 0)
+						{
+							if (rightCount == 0)
+							{
+								rMin = binMins[b];
+								rMax = binMaxs[b];
+							}
+							else
+							{
+								MergeBox(rMin, rMax, binMins[b], binMaxs[b]);
+							}
+							rightCount += binCounts[b];
+						}
+						rightCosts[b] = (rightCount != 0 ? rightCount * HalfArea(rMin, rMax) : -1.0);
+					}
+				}
+
+				//sweep from the left (split before bin 'b')
+				{
+					unsigned leftCount = 0;
+					CCVector3 lMin, lMax;
+					for (unsigned b=1; b<SAH_BIN_COUNT; ++b)
+					{
+						if (binCounts[b-1] != 0)
+						{
+							if (leftCount == 0)
+							{
+								lMin = binMins[b-1];
+								lMax = binMaxs[b-1];
+							}
+							else
+							{
+								MergeBox(lMin, lMax, binMins[b-1], binMaxs[b-1]);
+							}
+							leftCount += binCounts[b-1];
+						}
+						if (leftCount == 0 || rightCosts[b] < 0)
+							continue;
+
+						double cost = leftCount * HalfArea(lMin, lMax) + rightCosts[b];
+						if (bestCost < 0 || cost < bestCost)
+						{
+							bestCost = cost;
+							bestSplit = split;
+							bestSplit.splitBin = b;
+						}
+					}
+				}
+			}
+
+			if (bestCost >= 0)
+			{
+				//is it worth splitting?
+				double leafCost = count * HalfArea(bbMin, bbMax);
+				if (bestCost >= leafCost && count <= MAX_SAH_LEAF_SIZE)
+				{
+					node.rightOrFirst = task.begin;
+					node.count = count;
+					continue;
+				}
+
+				middle = static_cast<unsigned>(std::partition(order.begin() + task.begin, order.begin() + task.end, bestSplit) - order.begin());
+			}
+		}
+
+		if (middle == task.begin || middle == task.end)
+		{
+			//split at the median (along the largest dimension)
+			CCVector3 diag = cMax - cMin;
+			IsCentroidBelow compare;
+			compare.centroids = &centroids;
+			compare.dim = (diag.x >= diag.y ? (diag.x >= diag.z ? 0 : 2) : (diag.y >= diag.z ? 1 : 2));
+
+			middle = task.begin + count / 2;
+			std::nth_element(order.begin() + task.begin, order.begin() + middle, order.begin() + task.end, compare);
+		}
+
+		//inner node
+		node.count = 0;
+
+		BuildTask right;
+		right.begin = middle;
+		right.end = task.end;
+		right.depth = task.depth + 1;
+		right.parentIndex = static_cast<int>(nodeIndex);
+		tasks.push_back(right);
+
+		BuildTask left;
+		left.begin = task.begin;
+		left.end = middle;
+		left.depth = task.depth + 1;
+		left.parentIndex = -1;
+		tasks.push_back(left);
+	}
+
+	return true;
+}
+
+double TriangleBVH::ComputeSquareDistance(const CCVector3d& P, const CCVector3& A, const CCVector3& B, const CCVector3& C)
+{
+	//we do all computations with double precision (see DistanceComputationTools::computePoint2TriangleDistance)
+	//Voronoi regions based approach (see C. Ericson, Real-Time Collision Detection, section 5.1.5)
+	CCVector3d AB(static_cast<double>(B.x) - A.x, static_cast<double>(B.y) - A.y, static_cast<double>(B.z) - A.z);
+	CCVector3d AC(static_cast<double>(C.x) - A.x, static_cast<double>(C.y) - A.y, static_cast<double>(C.z) - A.z);
+	CCVector3d AP(P.x - A.x, P.y - A.y, P.z - A.z);
+
+	//vertex region A
+	double d1 = AB.dot(AP);
+	double d2 = AC.dot(AP);
+	if (d1 <= 0 && d2 <= 0)
+		return AP.norm2();
+
+	//vertex region B
+	CCVector3d BP(P.x - B.x, P.y - B.y, P.z - B.z);
+	double d3 = AB.dot(BP);
+	double d4 = AC.dot(BP);
+	if (d3 >= 0 && d4 <= d3)
+		return BP.norm2();
+
+	//edge region AB
+	double vc = d1*d4 - d3*d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+	{
+		double v = (d1 - d3 > 0 ? d1 / (d1 - d3) : 0);
+		return (AP - AB * v).norm2();
+	}
+
+	//vertex region C
+	CCVector3d CP(P.x - C.x, P.y - C.y, P.z - C.z);
+	double d5 = AB.dot(CP);
+	double d6 = AC.dot(CP);
+	if (d6 >= 0 && d5 <= d6)
+		return CP.norm2();
+
+	//edge region AC
+	double vb = d5*d2 - d1*d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+	{
+		double w = (d2 - d6 > 0 ? d2 / (d2 - d6) : 0);
+		return (AP - AC * w).norm2();
+	}
+
+	//edge region BC
+	double va = d3*d6 - d5*d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+	{
+		double denom = (d4 - d3) + (d5 - d6);
+		double w = (denom > 0 ? (d4 - d3) / denom : 0);
+		return (BP - (AC - AB) * w).norm2();
+	}
+
+	//face region
+	double sum = va + vb + vc;
+	if (sum <= 0)
+	{
+		//degenerate triangle: the nearest point is on one of its edges
+		return std::min((AP - AB * std::max(0.0, std::min(1.0, d1 / std::max(AB.norm2(), std::numeric_limits<double>::min())))).norm2(),
+						(AP - AC * std::max(0.0, std::min(1.0, d2 / std::max(AC.norm2(), std::numeric_limits<double>::min())))).norm2());
+	}
+	double v = vb / sum;
+	double w = vc / sum;
+	return (AP - AB * v - AC * w).norm2();
+}
+
+bool TriangleBVH::findNearestTriangle(	const CCVector3& P,
+										double maxSquareDist,
+										unsigned& triangleIndex,
+										double& squareDist,
+										double* signedDist/*=0*/) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	CCVector3d Pd(P.x, P.y, P.z);
+	double bestSquareDist = (maxSquareDist < 0 ? std::numeric_limits<double>::max() : maxSquareDist);
+	unsigned bestTriangle = 0;
+	bool found = false;
+
+	unsigned stack[TRAVERSAL_STACK_SIZE];
+	double stackDists[TRAVERSAL_STACK_SIZE];
+	unsigned stackSize = 0;
+
+	unsigned nodeIndex = 0;
+	if (m_nodes[0].squareDistTo(Pd) >= bestSquareDist)
+		return false;
+
+	while (true)
+	{
+		const Node& node = m_nodes[nodeIndex];
+		if (node.isLeaf())
+		{
+			const Triangle* tri = &(m_triangles[node.rightOrFirst]);
+			for (unsigned j=0; j<node.count; ++j, ++tri)
+			{
+				double d2 = ComputeSquareDistance(Pd, tri->A, tri->B, tri->C);
+				if (d2 < bestSquareDist)
+				{
+					bestSquareDist = d2;
+					bestTriangle = node.rightOrFirst + j;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			//we visit the nearest child first
+			unsigned nearChild = nodeIndex + 1;
+			unsigned farChild = node.rightOrFirst;
+			double nearDist = m_nodes[nearChild].squareDistTo(Pd);
+			double farDist = m_nodes[farChild].squareDistTo(Pd);
+			if (farDist < nearDist)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearDist, farDist);
+			}
+
+			if (nearDist < bestSquareDist)
+			{
+				if (farDist < bestSquareDist)
+				{
+					assert(stackSize < TRAVERSAL_STACK_SIZE);
+					stack[stackSize] = farChild;
+					stackDists[stackSize] = farDist;
+					++stackSize;
+				}
+				nodeIndex = nearChild;
+				continue;
+			}
+		}
+
+		//next node (the ones that are now farther than the current best distance are skipped)
+		while (stackSize != 0 && stackDists[stackSize-1] >= bestSquareDist)
+			--stackSize;
+		if (stackSize == 0)
+			break;
+		nodeIndex = stack[--stackSize];
+	}
+
+	if (!found)
+		return false;
+
+	triangleIndex = m_triangleIndexes[bestTriangle];
+	squareDist = bestSquareDist;
+
+	if (signedDist)
+	{
+		const Triangle& tri = m_triangles[bestTriangle];
+		CCVector3d AP(Pd.x - tri.A.x, Pd.y - tri.A.y, Pd.z - tri.A.z);
+		CCVector3d AB(static_cast<double>(tri.B.x) - tri.A.x, static_cast<double>(tri.B.y) - tri.A.y, static_cast<double>(tri.B.z) - tri.A.z);
+		CCVector3d AC(static_cast<double>(tri.C.x) - tri.A.x, static_cast<double>(tri.C.y) - tri.A.y, static_cast<double>(tri.C.z) - tri.A.z);
+
+		//we test the sign of the cross product of the triangle normal and the vector AP
+		double d = sqrt(bestSquareDist);
+		*signedDist = (AP.dot(AB.cross(AC)) < 0 ? -d : d);
+	}
+
+	return true;
+}
@@ -633,8 +633,14 @@ REAL iccerrboundA, iccerrboundB, iccerrboundC;
 REAL o3derrboundA, o3derrboundB, o3derrboundC;
 
 /* Random number seed is not constant, but I've made it global anyway.       */
+/* (CloudCompare: it is thread local, as several meshes can be triangulated  */
+/*  concurrently - see qFacets and Delaunay2dMesh::buildMeshByTiles)         */
 
-unsigned long randomseed;                     /* Current random number seed. */
+#ifdef _MSC_VER
+__declspec(thread) unsigned long randomseed;  /* Current random number seed. */
+#else
+__thread unsigned long randomseed;            /* Current random number seed. */
+#endif
 
 
 /* Mesh data structure.  Triangle operates on only one mesh, but the mesh    */
@@ -118,6 +118,9 @@ struct glDrawContext
 	//! Blending strategy (destination)
 	GLenum destBlend;
 
+	//! Entity whose elements (points or triangles) IDs are rendered (ID buffer picking only - 0 = entity IDs)
+	unsigned idBufferEntityID;
+
 	//Default constructor
 	glDrawContext()
 		: flags(0)
@@ -152,6 +155,7 @@ struct glDrawContext
 		, labelOpacity(100)
 		, sourceBlend(GL_SRC_ALPHA)
 		, destBlend(GL_ONE_MINUS_SRC_ALPHA)
+		, idBufferEntityID(0)
 	{}
 };
 typedef glDrawContext CC_DRAW_CONTEXT;
@@ -171,6 +175,8 @@ typedef glDrawContext CC_DRAW_CONTEXT;
 #define CC_DRAW_ANY_NAMES						0x03C0		// = CC_DRAW_ENTITY_NAMES | CC_DRAW_POINT_NAMES | CC_DRAW_TRI_NAMES
 #define CC_LOD_ACTIVATED						0x0400
 #define CC_VIRTUAL_TRANS_ENABLED				0x0800
+#define CC_DRAW_ID_BUFFER						0x1000		// IDs are rendered as colors (see ccGL::ColorID)
+#define CC_SKIP_ID_BUFFER_ENTITIES				0x2000		// entities picked via the ID buffer are skipped
 
 // Drawing flags testing macros (see ccDrawableObject)
 #define MACRO_Draw2D(context) (context.flags & CC_DRAW_2D)
@@ -186,6 +192,8 @@ typedef glDrawContext CC_DRAW_CONTEXT;
 #define MACRO_Foreground(context) (context.flags & CC_DRAW_FOREGROUND)
 #define MACRO_LODActivated(context) (context.flags & CC_LOD_ACTIVATED)
 #define MACRO_VirtualTransEnabled(context) (context.flags & CC_VIRTUAL_TRANS_ENABLED)
+#define MACRO_DrawIDBuffer(context) (context.flags & CC_DRAW_ID_BUFFER)
+#define MACRO_SkipIDBufferEntities(context) (context.flags & CC_SKIP_ID_BUFFER_ENTITIES)
 
 //! Generic interface for (3D) drawable entities
 class QCC_DB_LIB_API ccDrawableObject
@@ -658,6 +658,26 @@ void ccHObject::draw(CC_DRAW_CONTEXT& context)
 	drawInThisContext &= (	( !MACRO_DrawPointNames(context)	|| isKindOf(CC_TYPES::POINT_CLOUD) ) || 
 							( !MACRO_DrawTriangleNames(context)	|| isKindOf(CC_TYPES::MESH) ));
 
+	//only clouds and meshes are rendered in the ID buffer (the other entities are picked with OpenGL names)
+	if (MACRO_DrawIDBuffer(context))
+	{
+		bool isCloud = isA(CC_TYPES::POINT_CLOUD);
+		bool isMesh = isA(CC_TYPES::MESH);
+		if (MACRO_DrawPointNames(context) || MACRO_DrawTriangleNames(context))
+			drawInThisContext &= ((isCloud && MACRO_DrawPointNames(context)) || (isMesh && MACRO_DrawTriangleNames(context)));
+		else
+			drawInThisContext &= (isCloud || isMesh);
+
+		//elements IDs are only rendered for a single entity
+		if (context.idBufferEntityID != 0)
+			drawInThisContext &= (getUniqueIDForDisplay() == context.idBufferEntityID);
+	}
+	else if (MACRO_SkipIDBufferEntities(context))
+	{
+		//complementary OpenGL names picking (clouds and meshes have already been picked via the ID buffer)
+		drawInThisContext &= !(isA(CC_TYPES::POINT_CLOUD) || isA(CC_TYPES::MESH));
+	}
+
 	if (draw3D)
 	{
 		//apply 3D 'temporary' transformation (for display only)
@@ -73,6 +73,17 @@ public:
 	//type-less glColor3Xv call (X=f,ub)
 	static inline void Color3v(const unsigned char* v) { glColor3ubv(v); }
 	static inline void Color3v(const float* v) { glColor3fv(v); }
+
+	//ID buffer: encodes a 32 bits ID as a RGBA color (0 = no ID)
+	static inline void ColorID(unsigned ID) { glColor4ub(	static_cast<GLubyte>(ID & 0xFF),
+															static_cast<GLubyte>((ID >> 8) & 0xFF),
+															static_cast<GLubyte>((ID >> 16) & 0xFF),
+															static_cast<GLubyte>((ID >> 24) & 0xFF) ); }
+	//ID buffer: decodes a RGBA color (see ColorID)
+	static inline unsigned DecodeColorID(const GLubyte* rgba) { return	static_cast<unsigned>(rgba[0])
+																	|	(static_cast<unsigned>(rgba[1]) << 8)
+																	|	(static_cast<unsigned>(rgba[2]) << 16)
+																	|	(static_cast<unsigned>(rgba[3]) << 24); }
 };
 
 #endif //CC_INCLUDE_GL_HEADER
@@ -37,11 +37,15 @@
 
 //Qt
 #include <QGLFormat>
+#include <QThread>
+#include <QtConcurrentMap>
 
 //System
 #include <string.h>
 #include <assert.h>
 #include <math.h> //for modf
+#include <algorithm>
+#include <vector>
 
 static CCVector3 s_blankNorm(0,0,0);
 
@@ -542,6 +546,210 @@ void ccMesh::transformTriNormals(const ccGLMatrix& trans)
 	}
 }
 
+//! Minimum number of items (vertices or triangles) per job
+static const unsigned MIN_ITEMS_PER_MESH_JOB = 16384;
+
+//! Splits a range of items (vertices or triangles) in (balanced) jobs
+template <class Job> static bool PrepareMeshJobs(unsigned itemCount, const Job& prototype, std::vector<Job>& jobs)
+{
+	//a few jobs per thread (so that they are balanced)
+	unsigned jobCount = std::max<unsigned>(1, std::min<unsigned>(itemCount / MIN_ITEMS_PER_MESH_JOB, static_cast<unsigned>(std::max(1,QThread::idealThreadCount())) * 4));
+
+	try
+	{
+		jobs.resize(jobCount, prototype);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (unsigned j=0; j<jobCount; ++j)
+	{
+		jobs[j].firstIndex = static_cast<unsigned>((static_cast<size_t>(itemCount) * j) / jobCount);
+		jobs[j].lastIndex = static_cast<unsigned>((static_cast<size_t>(itemCount) * (j+1)) / jobCount);
+	}
+
+	return true;
+}
+
+//! Compact vertex adjacency (CSR layout)
+struct VertexAdjacency
+{
+	//! Index of the first neighbour of each vertex (size = vertex count + 1)
+	std::vector<unsigned> offsets;
+	//! Neighbours of all vertices (contiguous)
+	std::vector<unsigned> neighbours;
+	//! Number of triangles sharing each edge (vertex, neighbour)
+	std::vector<unsigned char> weights;
+};
+
+//! Vertex adjacency compaction job
+struct VertexAdjacencyJob
+{
+	VertexAdjacency* adjacency;
+	std::vector<unsigned>* uniqueCounts;
+	unsigned firstIndex;
+	unsigned lastIndex; //excluded
+};
+
+//! Sorts the neighbours of each vertex and merges the duplicates (as weights)
+static void CompactVertexNeighbours(VertexAdjacencyJob& job)
+{
+	VertexAdjacency& adjacency = *job.adjacency;
+	unsigned* neighbours = &(adjacency.neighbours[0]);
+	unsigned char* weights = &(adjacency.weights[0]);
+
+	for (unsigned v=job.firstIndex; v<job.lastIndex; ++v)
+	{
+		unsigned start = adjacency.offsets[v];
+		unsigned end = adjacency.offsets[v+1];
+		std::sort(neighbours+start, neighbours+end);
+
+		unsigned count = 0;
+		for (unsigned k=start; k<end; ++k)
+		{
+			unsigned last = start+count-1;
+			if (count != 0 && neighbours[last] == neighbours[k] && weights[last] != 255)
+			{
+				++weights[last];
+			}
+			else
+			{
+				neighbours[start+count] = neighbours[k];
+				weights[start+count] = 1;
+				++count;
+			}
+		}
+		(*job.uniqueCounts)[v] = count;
+	}
+}
+
+//! Builds the vertex adjacency of a set of triangles
+static bool BuildVertexAdjacency(const GenericChunkedArray<3,unsigned>* triIndexes, unsigned vertCount, VertexAdjacency& adjacency)
+{
+	assert(triIndexes);
+	unsigned faceCount = triIndexes->currentSize();
+
+	std::vector<unsigned> cursors;
+	try
+	{
+		adjacency.offsets.clear();
+		adjacency.offsets.resize(vertCount+1, 0);
+		adjacency.neighbours.resize(static_cast<size_t>(faceCount)*6);
+		adjacency.weights.resize(static_cast<size_t>(faceCount)*6);
+		cursors.resize(vertCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	//each triangle adds 2 neighbours to each of its vertices
+	for (unsigned j=0; j<faceCount; ++j)
+	{
+		const unsigned* tri = triIndexes->getValue(j);
+		adjacency.offsets[tri[0]+1] += 2;
+		adjacency.offsets[tri[1]+1] += 2;
+		adjacency.offsets[tri[2]+1] += 2;
+	}
+	for (unsigned v=0; v<vertCount; ++v)
+	{
+		adjacency.offsets[v+1] += adjacency.offsets[v];
+		cursors[v] = adjacency.offsets[v];
+	}
+
+	for (unsigned j=0; j<faceCount; ++j)
+	{
+		const unsigned* tri = triIndexes->getValue(j);
+		adjacency.neighbours[cursors[tri[0]]++] = tri[1];
+		adjacency.neighbours[cursors[tri[0]]++] = tri[2];
+		adjacency.neighbours[cursors[tri[1]]++] = tri[2];
+		adjacency.neighbours[cursors[tri[1]]++] = tri[0];
+		adjacency.neighbours[cursors[tri[2]]++] = tri[0];
+		adjacency.neighbours[cursors[tri[2]]++] = tri[1];
+	}
+
+	if (faceCount == 0)
+		return true;
+
+	//merge the duplicate neighbours (in parallel)
+	{
+		VertexAdjacencyJob prototype;
+		prototype.adjacency = &adjacency;
+		prototype.uniqueCounts = &cursors;
+		prototype.firstIndex = prototype.lastIndex = 0;
+
+		std::vector<VertexAdjacencyJob> jobs;
+		if (!PrepareMeshJobs(vertCount, prototype, jobs))
+			return false;
+		QtConcurrent::blockingMap(jobs, CompactVertexNeighbours);
+	}
+
+	//remove the gaps
+	unsigned pos = 0;
+	for (unsigned v=0; v<vertCount; ++v)
+	{
+		unsigned start = adjacency.offsets[v];
+		unsigned count = cursors[v];
+		adjacency.offsets[v] = pos;
+		if (pos != start && count != 0)
+		{
+			memmove(&(adjacency.neighbours[pos]), &(adjacency.neighbours[start]), sizeof(unsigned)*count);
+			memmove(&(adjacency.weights[pos]), &(adjacency.weights[start]), count);
+		}
+		pos += count;
+	}
+	adjacency.offsets[vertCount] = pos;
+
+	try
+	{
+		std::vector<unsigned>(adjacency.neighbours.begin(), adjacency.neighbours.begin()+pos).swap(adjacency.neighbours);
+		std::vector<unsigned char>(adjacency.weights.begin(), adjacency.weights.begin()+pos).swap(adjacency.weights);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not a big deal (we just keep the unused memory)
+	}
+
+	return true;
+}
+
+//! Laplacian smoothing job (Jacobi iteration)
+struct LaplacianSmoothJob
+{
+	const VertexAdjacency* adjacency;
+	const CCVector3* input;
+	CCVector3* output;
+	PointCoordinateType factor;
+	unsigned firstIndex;
+	unsigned lastIndex; //excluded
+};
+
+//! Moves each vertex towards the (weighted) barycenter of its neighbours
+static void LaplacianSmoothVertices(LaplacianSmoothJob& job)
+{
+	const VertexAdjacency& adjacency = *job.adjacency;
+
+	for (unsigned v=job.firstIndex; v<job.lastIndex; ++v)
+	{
+		const CCVector3& P = job.input[v];
+		unsigned start = adjacency.offsets[v];
+		unsigned end = adjacency.offsets[v+1];
+
+		CCVector3 d(0,0,0);
+		unsigned totalWeight = 0;
+		for (unsigned k=start; k<end; ++k)
+		{
+			unsigned char w = adjacency.weights[k];
+			d += (job.input[adjacency.neighbours[k]] - P) * static_cast<PointCoordinateType>(w);
+			totalWeight += w;
+		}
+
+		job.output[v] = (totalWeight != 0 ? P + d * (job.factor/static_cast<PointCoordinateType>(totalWeight)) : P);
+	}
+}
+
 bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 								PointCoordinateType factor,
 								CCLib::GenericProgressCallback* progressCb/*=0*/)
@@ -556,30 +764,42 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 	if (!vertCount || !faceCount)
 		return false;
 
-	GenericChunkedArray<3,PointCoordinateType>* verticesDisplacement = new GenericChunkedArray<3,PointCoordinateType>;
-	if (!verticesDisplacement->resize(vertCount))
+	//vertex adjacency (computed once)
+	VertexAdjacency adjacency;
+	if (!BuildVertexAdjacency(m_triVertIndexes, vertCount, adjacency))
 	{
 		//not enough memory
-		verticesDisplacement->release();
 		return false;
 	}
 
-	//compute the number of edges to which belong each vertex
-	unsigned* edgesCount = new unsigned[vertCount];
-	if (!edgesCount)
+	//positions (double buffer)
+	std::vector<CCVector3> positions;
+	std::vector<CCVector3> newPositions;
+	try
+	{
+		positions.resize(vertCount);
+		newPositions.resize(vertCount);
+	}
+	catch (const std::bad_alloc&)
 	{
 		//not enough memory
-		verticesDisplacement->release();
 		return false;
 	}
-	memset(edgesCount, 0, sizeof(unsigned)*vertCount);
-	placeIteratorAtBegining();
-	for(unsigned j=0; j<faceCount; j++)
+	for (unsigned i=0; i<vertCount; i++)
+		positions[i] = *m_associatedCloud->getPoint(i);
+
+	LaplacianSmoothJob prototype;
+	prototype.adjacency = &adjacency;
+	prototype.input = 0;
+	prototype.output = 0;
+	prototype.factor = factor;
+	prototype.firstIndex = prototype.lastIndex = 0;
+
+	std::vector<LaplacianSmoothJob> jobs;
+	if (!PrepareMeshJobs(vertCount, prototype, jobs))
 	{
-		const CCLib::VerticesIndexes* tri = getNextTriangleVertIndexes();
-		edgesCount[tri->i1]+=2;
-		edgesCount[tri->i2]+=2;
-		edgesCount[tri->i3]+=2;
+		//not enough memory
+		return false;
 	}
 
 	//progress dialog
@@ -596,29 +816,13 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 	//repeat Laplacian smoothing iterations
 	for (unsigned iter = 0; iter < nbIteration; iter++)
 	{
-		verticesDisplacement->fill(0);
-
-		//for each triangle
-		placeIteratorAtBegining();
-		for(unsigned j=0; j<faceCount; j++)
+		//all vertices are updated in parallel (from the previous positions)
+		for (size_t j=0; j<jobs.size(); ++j)
 		{
-			const CCLib::VerticesIndexes* tri = getNextTriangleVertIndexes();
-
-			const CCVector3* A = m_associatedCloud->getPoint(tri->i1);
-			const CCVector3* B = m_associatedCloud->getPoint(tri->i2);
-			const CCVector3* C = m_associatedCloud->getPoint(tri->i3);
-
-			CCVector3 dAB = (*B-*A);
-			CCVector3 dAC = (*C-*A);
-			CCVector3 dBC = (*C-*B);
-
-			CCVector3* dA = (CCVector3*)verticesDisplacement->getValue(tri->i1);
-			(*dA) += dAB+dAC;
-			CCVector3* dB = (CCVector3*)verticesDisplacement->getValue(tri->i2);
-			(*dB) += dBC-dAB;
-			CCVector3* dC = (CCVector3*)verticesDisplacement->getValue(tri->i3);
-			(*dC) -= dAC+dBC;
+			jobs[j].input = &(positions[0]);
+			jobs[j].output = &(newPositions[0]);
 		}
+		QtConcurrent::blockingMap(jobs, LaplacianSmoothVertices);
 
 		if (nProgress && !nProgress->oneStep())
 		{
@@ -626,15 +830,15 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 			break;
 		}
 
-		//apply displacement
-		verticesDisplacement->placeIteratorAtBegining();
-		for (unsigned i=0; i<vertCount; i++)
-		{
-			//this is a "persistent" pointer and we know what type of cloud is behind ;)
-			CCVector3* P = const_cast<CCVector3*>(m_associatedCloud->getPointPersistentPtr(i));
-			const CCVector3* d = (const CCVector3*)verticesDisplacement->getValue(i);
-			(*P) += (*d)*(factor/static_cast<PointCoordinateType>(edgesCount[i]));
-		}
+		positions.swap(newPositions);
+	}
+
+	//apply the new positions
+	for (unsigned i=0; i<vertCount; i++)
+	{
+		//this is a "persistent" pointer and we know what type of cloud is behind ;)
+		CCVector3* P = const_cast<CCVector3*>(m_associatedCloud->getPointPersistentPtr(i));
+		*P = positions[i];
 	}
 
 	m_associatedCloud->notifyGeometryUpdate();
@@ -642,14 +846,6 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 	if (hasNormals())
 		computeNormals(!hasTriNormals());
 
-	if (verticesDisplacement)
-		verticesDisplacement->release();
-	verticesDisplacement = 0;
-
-	if (edgesCount)
-		delete[] edgesCount;
-	edgesCount = 0;
-
 	if (nProgress)
 		delete nProgress;
 	nProgress = 0;
@@ -1433,6 +1629,67 @@ unsigned ccMesh::getUniqueIDForDisplay() const
 		return getUniqueID();
 }
 
+void ccMesh::drawIDBuffer(CC_DRAW_CONTEXT& context)
+{
+	unsigned triNum = m_triVertIndexes->currentSize();
+
+	//vertices visibility
+	const ccGenericPointCloud::VisibilityTableType* verticesVisibility = m_associatedCloud->getTheVisibilityArray();
+	bool visFiltering = (verticesVisibility && verticesVisibility->isAllocated());
+
+	//triangles with a hidden SF value can't be picked
+	ccScalarField* hiddenValuesSF = 0;
+	{
+		glDrawParams glParams;
+		getDrawingParameters(glParams);
+		if (glParams.showSF)
+		{
+			assert(m_associatedCloud->isA(CC_TYPES::POINT_CLOUD));
+			ccScalarField* sf = static_cast<ccPointCloud*>(m_associatedCloud)->getCurrentDisplayedScalarField();
+			if (sf && !sf->areNaNValuesShownInGrey() && sf->getColorScale())
+				hiddenValuesSF = sf;
+		}
+	}
+
+	//elements IDs or entity ID?
+	bool triangleIDs = (context.idBufferEntityID != 0);
+	if (!triangleIDs)
+		ccGL::ColorID(getUniqueIDForDisplay());
+
+	glBegin(GL_TRIANGLES);
+	m_triVertIndexes->placeIteratorAtBegining();
+	for (unsigned n=0; n<triNum; ++n)
+	{
+		const CCLib::VerticesIndexes* tsi = (CCLib::VerticesIndexes*)m_triVertIndexes->getCurrentValue();
+		m_triVertIndexes->forwardIterator();
+
+		if (visFiltering)
+		{
+			//we skip the triangle if at least one vertex is hidden
+			if ((verticesVisibility->getValue(tsi->i1) != POINT_VISIBLE) ||
+				(verticesVisibility->getValue(tsi->i2) != POINT_VISIBLE) ||
+				(verticesVisibility->getValue(tsi->i3) != POINT_VISIBLE))
+				continue;
+		}
+
+		if (hiddenValuesSF)
+		{
+			if (	!hiddenValuesSF->getValueColor(tsi->i1)
+				||	!hiddenValuesSF->getValueColor(tsi->i2)
+				||	!hiddenValuesSF->getValueColor(tsi->i3))
+				continue;
+		}
+
+		if (triangleIDs)
+			ccGL::ColorID(n+1); //0 = no triangle
+
+		ccGL::Vertex3v(m_associatedCloud->getPoint(tsi->i1)->u);
+		ccGL::Vertex3v(m_associatedCloud->getPoint(tsi->i2)->u);
+		ccGL::Vertex3v(m_associatedCloud->getPoint(tsi->i3)->u);
+	}
+	glEnd();
+}
+
 void ccMesh::drawMeOnly(CC_DRAW_CONTEXT& context)
 {
 	if (!m_associatedCloud)
@@ -1448,6 +1705,13 @@ void ccMesh::drawMeOnly(CC_DRAW_CONTEXT& context)
 		if (triNum == 0)
 			return;
 
+		//ID buffer rendering (picking)
+		if (MACRO_DrawIDBuffer(context))
+		{
+			drawIDBuffer(context);
+			return;
+		}
+
 		//L.O.D.
 		bool lodEnabled = (triNum > context.minLODTriangleCount && context.decimateMeshOnMove && MACRO_LODActivated(context));
 		unsigned decimStep = (lodEnabled ? static_cast<unsigned>(ceil(static_cast<double>(triNum*3) / context.minLODTriangleCount)) : 1);
@@ -3210,11 +3474,6 @@ bool ccMesh::getColorFromMaterial(unsigned triIndex, const CCVector3& P, ccColor
 	return true;
 }
 
-//we use as many static variables as we can to limit the size of the heap used by each recursion...
-static const unsigned s_defaultSubdivideGrowRate = 50;
-static PointCoordinateType s_maxSubdivideArea = 1;
-static QMap<qint64,unsigned> s_alreadyCreatedVertices; //map to store already created edges middle points
-
 static qint64 GenerateKey(unsigned edgeIndex1, unsigned edgeIndex2)
 {
 	if (edgeIndex1>edgeIndex2)
@@ -3223,171 +3482,265 @@ static qint64 GenerateKey(unsigned edgeIndex1, unsigned edgeIndex2)
 	return ((((qint64)edgeIndex1)<<32) | (qint64)edgeIndex2);
 }
 
-bool ccMesh::pushSubdivide(/*PointCoordinateType maxArea, */unsigned indexA, unsigned indexB, unsigned indexC)
-{
-	if (s_maxSubdivideArea/*maxArea*/ <= ZERO_TOLERANCE)
+//! Subdivision data shared by all jobs (for one pass)
+struct SubdivisionContext
+{
+	const ccPointCloud* vertices;
+	PointCoordinateType maxArea;
+	//! Triangles to subdivide (3 indexes per triangle)
+	const std::vector<unsigned>* triangles;
+	//! Subdivided triangles (3 indexes per triangle)
+	std::vector<unsigned>* newTriangles;
+	//! Edges to split during this pass (sorted keys)
+	const std::vector<qint64>* splitEdges;
+	//! Index of the middle point of the first split edge
+	unsigned firstNewVertex;
+	//! Middle points of the split edges
+	std::vector<CCVector3>* middlePoints;
+	//! Colors of the middle points (if any)
+	std::vector<ccColor::Rgb>* middleColors;
+};
+
+//! Subdivision job (range of triangles or edges)
+struct SubdivisionJob
+{
+	SubdivisionContext* context;
+	unsigned firstIndex;
+	unsigned lastIndex; //excluded
+	//! Edges to split (collected by this job)
+	std::vector<qint64> edges;
+	//! Number of subdivided triangles output by this job
+	unsigned outputCount;
+	//! Index of the first subdivided triangle output by this job
+	unsigned outputStart;
+	//! Whether the job could allocate enough memory
+	bool success;
+};
+
+//! Collects the edges of the triangles that are too big
+static void CollectSplitEdges(SubdivisionJob& job)
+{
+	const SubdivisionContext& context = *job.context;
+	const unsigned* triangles = &((*context.triangles)[0]);
+
+	try
 	{
-		ccLog::Error("[ccMesh::pushSubdivide] Invalid input argument!");
-		return false;
-	}
+		job.edges.clear();
+		for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+		{
+			const unsigned* tri = triangles + 3*i;
+			const CCVector3* A = context.vertices->getPoint(tri[0]);
+			const CCVector3* B = context.vertices->getPoint(tri[1]);
+			const CCVector3* C = context.vertices->getPoint(tri[2]);
 
-	if (!getAssociatedCloud() || !getAssociatedCloud()->isA(CC_TYPES::POINT_CLOUD))
+			//do we need to sudivide this triangle?
+			PointCoordinateType area = ((*B-*A)*(*C-*A)).norm()/2;
+			if (area > context.maxArea)
+			{
+				job.edges.push_back(GenerateKey(tri[0],tri[1]));
+				job.edges.push_back(GenerateKey(tri[1],tri[2]));
+				job.edges.push_back(GenerateKey(tri[2],tri[0]));
+			}
+		}
+		std::sort(job.edges.begin(), job.edges.end());
+		job.edges.erase(std::unique(job.edges.begin(), job.edges.end()), job.edges.end());
+		job.success = true;
+	}
+	catch (const std::bad_alloc&)
 	{
-		ccLog::Error("[ccMesh::pushSubdivide] Vertices set must be a true point cloud!");
-		return false;
+		job.success = false;
 	}
-	ccPointCloud* vertices = static_cast<ccPointCloud*>(getAssociatedCloud());
-	assert(vertices);
-	const CCVector3* A = vertices->getPoint(indexA);
-	const CCVector3* B = vertices->getPoint(indexB);
-	const CCVector3* C = vertices->getPoint(indexC);
+}
+
+//! Computes the middle points of a range of split edges
+static void ComputeMiddlePoints(SubdivisionJob& job)
+{
+	const SubdivisionContext& context = *job.context;
 
-	//do we need to sudivide this triangle?
-	PointCoordinateType area = ((*B-*A)*(*C-*A)).norm()/2;
-	if (area > s_maxSubdivideArea/*maxArea*/)
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
 	{
-		//we will add 3 new vertices, so we must be sure to have enough memory
-		if (vertices->size()+2 >= vertices->capacity())
+		qint64 key = (*context.splitEdges)[i];
+		unsigned i1 = static_cast<unsigned>(key >> 32);
+		unsigned i2 = static_cast<unsigned>(key & 0xFFFFFFFF);
+
+		(*context.middlePoints)[i] = (*context.vertices->getPoint(i1) + *context.vertices->getPoint(i2)) / static_cast<PointCoordinateType>(2);
+
+		if (context.middleColors)
 		{
-			assert(s_defaultSubdivideGrowRate>2);
-			if (!vertices->reserve(vertices->size()+s_defaultSubdivideGrowRate))
-			{
-				ccLog::Error("[ccMesh::pushSubdivide] Not enough memory!");
-				return false;
-			}
-			//We have to update pointers as they may have been wrangled by the 'reserve' call
-			A = vertices->getPoint(indexA);
-			B = vertices->getPoint(indexB);
-			C = vertices->getPoint(indexC);
+			const colorType* C1 = context.vertices->getPointColor(i1);
+			const colorType* C2 = context.vertices->getPointColor(i2);
+			ccColor::Rgb& C = (*context.middleColors)[i];
+			for (unsigned c=0; c<3; ++c)
+				C.rgb[c] = static_cast<colorType>((static_cast<unsigned>(C1[c]) + static_cast<unsigned>(C2[c]) + 1) / 2);
 		}
+	}
+}
 
-		//add new vertices
-		unsigned indexG1 = 0;
+//! Looks for the middle points of the (split) edges of a triangle
+/** \return the number of split edges (middle[k] is the middle point of edge (tri[k],tri[k+1]) if it is split)
+**/
+static unsigned GetMiddlePoints(const SubdivisionContext& context, const unsigned* tri, unsigned middle[3])
+{
+	const std::vector<qint64>& splitEdges = *context.splitEdges;
+
+	unsigned splitCount = 0;
+	for (unsigned k=0; k<3; ++k)
+	{
+		qint64 key = GenerateKey(tri[k],tri[(k+1)%3]);
+		std::vector<qint64>::const_iterator it = std::lower_bound(splitEdges.begin(), splitEdges.end(), key);
+		if (it != splitEdges.end() && *it == key)
 		{
-			qint64 key = GenerateKey(indexA,indexB);
-			QMap<qint64,unsigned>::const_iterator it = s_alreadyCreatedVertices.find(key);
-			if (it == s_alreadyCreatedVertices.end())
-			{
-				//generate new vertex
-				indexG1 = vertices->size();
-				CCVector3 G1 = (*A+*B)/(PointCoordinateType)2.0;
-				vertices->addPoint(G1);
-				//interpolate other features?
-				/*if (vertices->hasNormals())
-				{
-				//vertices->reserveTheNormsTable();
-				CCVector3 N(0.0,0.0,1.0);
-				<(indexA,indexB,indexC,G1,N);
-				vertices->addNorm(N);
-				}
-				//*/
-				if (vertices->hasColors())
-				{
-					ccColor::Rgb C;
-					interpolateColors(indexA,indexB,indexC,G1,C);
-					vertices->addRGBColor(C.rgb);
-				}
-				//and add it to the map
-				s_alreadyCreatedVertices.insert(key,indexG1);
-			}
-			else
-			{
-				indexG1 = it.value();
-			}
+			middle[k] = context.firstNewVertex + static_cast<unsigned>(it - splitEdges.begin());
+			++splitCount;
 		}
-		unsigned indexG2 = 0;
+		else
+		{
+			middle[k] = static_cast<unsigned>(-1);
+		}
+	}
+
+	return splitCount;
+}
+
+//! Counts the triangles output by a job
+static void CountSubdividedTriangles(SubdivisionJob& job)
+{
+	const SubdivisionContext& context = *job.context;
+	const unsigned* triangles = &((*context.triangles)[0]);
+
+	job.outputCount = 0;
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		unsigned middle[3];
+		//n split edges --> n+1 triangles
+		job.outputCount += GetMiddlePoints(context, triangles + 3*i, middle) + 1;
+	}
+}
+
+//! Subdivides the triangles of a job
+/** The triangles that are too big are split in 4. The triangles that share
+	one or two edges with them are split in 2 or 3 so that the mesh stays
+	conforming.
+**/
+static void WriteSubdividedTriangles(SubdivisionJob& job)
+{
+	const SubdivisionContext& context = *job.context;
+	const unsigned* triangles = &((*context.triangles)[0]);
+	unsigned* _out = &((*context.newTriangles)[3*static_cast<size_t>(job.outputStart)]);
+
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		const unsigned* tri = triangles + 3*i;
+		unsigned middle[3];
+		unsigned splitCount = GetMiddlePoints(context, tri, middle);
+
+		switch (splitCount)
 		{
-			qint64 key = GenerateKey(indexB,indexC);
-			QMap<qint64,unsigned>::const_iterator it = s_alreadyCreatedVertices.find(key);
-			if (it == s_alreadyCreatedVertices.end())
+		case 0:
 			{
-				//generate new vertex
-				indexG2 = vertices->size();
-				CCVector3 G2 = (*B+*C)/(PointCoordinateType)2.0;
-				vertices->addPoint(G2);
-				//interpolate other features?
-				/*if (vertices->hasNormals())
-				{
-				//vertices->reserveTheNormsTable();
-				CCVector3 N(0.0,0.0,1.0);
-				interpolateNormals(indexA,indexB,indexC,G2,N);
-				vertices->addNorm(N);
-				}
-				//*/
-				if (vertices->hasColors())
-				{
-					ccColor::Rgb C;
-					interpolateColors(indexA,indexB,indexC,G2,C);
-					vertices->addRGBColor(C.rgb);
-				}
-				//and add it to the map
-				s_alreadyCreatedVertices.insert(key,indexG2);
+				//we keep this triangle as is
+				*_out++ = tri[0]; *_out++ = tri[1]; *_out++ = tri[2];
 			}
-			else
+			break;
+
+		case 1:
 			{
-				indexG2 = it.value();
+				//relative index facing the split edge
+				unsigned i0 = (middle[0] != static_cast<unsigned>(-1) ? 2 : middle[1] != static_cast<unsigned>(-1) ? 0 : 1);
+				unsigned A = tri[i0];
+				unsigned B = tri[(i0+1)%3];
+				unsigned C = tri[(i0+2)%3];
+				unsigned G = middle[(i0+1)%3];
+				//split the triangle in 2
+				*_out++ = A; *_out++ = B; *_out++ = G;
+				*_out++ = A; *_out++ = G; *_out++ = C;
 			}
-		}
-		unsigned indexG3 = vertices->size();
-		{
-			qint64 key = GenerateKey(indexC,indexA);
-			QMap<qint64,unsigned>::const_iterator it = s_alreadyCreatedVertices.find(key);
-			if (it == s_alreadyCreatedVertices.end())
+			break;
+
+		case 2:
 			{
-				//generate new vertex
-				indexG3 = vertices->size();
-				CCVector3 G3 = (*C+*A)/(PointCoordinateType)2.0;
-				vertices->addPoint(G3);
-				//interpolate other features?
-				/*if (vertices->hasNormals())
-				{
-				//vertices->reserveTheNormsTable();
-				CCVector3 N(0.0,0.0,1.0);
-				interpolateNormals(indexA,indexB,indexC,G3,N);
-				vertices->addNorm(N);
-				}
-				//*/
-				if (vertices->hasColors())
-				{
-					ccColor::Rgb C;
-					interpolateColors(indexA,indexB,indexC,G3,C);
-					vertices->addRGBColor(C.rgb);
-				}
-				//and add it to the map
-				s_alreadyCreatedVertices.insert(key,indexG3);
+				//relative index of the edge that is not split
+				unsigned i0 = (middle[0] == static_cast<unsigned>(-1) ? 0 : middle[1] == static_cast<unsigned>(-1) ? 1 : 2);
+				unsigned A = tri[i0];
+				unsigned B = tri[(i0+1)%3];
+				unsigned C = tri[(i0+2)%3];
+				unsigned GBC = middle[(i0+1)%3];
+				unsigned GCA = middle[(i0+2)%3];
+				//the 'pointy' part
+				*_out++ = C; *_out++ = GCA; *_out++ = GBC;
+				//and the remaining 'trapezoid' split in 2
+				*_out++ = A; *_out++ = GBC; *_out++ = GCA;
+				*_out++ = A; *_out++ = B; *_out++ = GBC;
 			}
-			else
+			break;
+
+		case 3:
 			{
-				indexG3 = it.value();
+				unsigned G1 = middle[0]; //AB
+				unsigned G2 = middle[1]; //BC
+				unsigned G3 = middle[2]; //CA
+				//standard subdivision (4 quarters)
+				*_out++ = tri[0]; *_out++ = G1; *_out++ = G3;
+				*_out++ = tri[1]; *_out++ = G2; *_out++ = G1;
+				*_out++ = tri[2]; *_out++ = G3; *_out++ = G2;
+				*_out++ = G1; *_out++ = G2; *_out++ = G3;
 			}
-		}
+			break;
 
-		//add new triangles
-		if (!pushSubdivide(/*maxArea, */indexA, indexG1, indexG3))
-			return false;
-		if (!pushSubdivide(/*maxArea, */indexB, indexG2, indexG1))
-			return false;
-		if (!pushSubdivide(/*maxArea, */indexC, indexG3, indexG2))
-			return false;
-		if (!pushSubdivide(/*maxArea, */indexG1, indexG2, indexG3))
-			return false;
+		default:
+			assert(false);
+			break;
+		}
 	}
-	else
+}
+
+//! Merges the (sorted) edges collected by each job
+static bool MergeSplitEdges(std::vector<SubdivisionJob>& jobs, std::vector<qint64>& splitEdges)
+{
+	//concatenate the sorted runs
+	std::vector<size_t> runs;
+	try
 	{
-		//we will add one triangle, so we must be sure to have enough memory
-		if (size() == capacity())
+		size_t totalCount = 0;
+		for (size_t j=0; j<jobs.size(); ++j)
+			totalCount += jobs[j].edges.size();
+
+		splitEdges.clear();
+		splitEdges.reserve(totalCount);
+		for (size_t j=0; j<jobs.size(); ++j)
 		{
-			if (!reserve(size() + 3*s_defaultSubdivideGrowRate))
-			{
-				ccLog::Error("[ccMesh::pushSubdivide] Not enough memory!");
-				return false;
-			}
+			if (jobs[j].edges.empty())
+				continue;
+			runs.push_back(splitEdges.size());
+			splitEdges.insert(splitEdges.end(), jobs[j].edges.begin(), jobs[j].edges.end());
+			//release some memory
+			std::vector<qint64>().swap(jobs[j].edges);
 		}
+		runs.push_back(splitEdges.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
 
-		//we keep this triangle as is
-		addTriangle(indexA,indexB,indexC);
+	//merge them 2 by 2
+	while (runs.size() > 2)
+	{
+		std::vector<size_t> mergedRuns;
+		size_t runCount = runs.size()-1;
+		for (size_t r=0; r<runCount; r+=2)
+		{
+			mergedRuns.push_back(runs[r]);
+			if (r+1 < runCount)
+				std::inplace_merge(splitEdges.begin()+runs[r], splitEdges.begin()+runs[r+1], splitEdges.begin()+runs[r+2]);
+		}
+		mergedRuns.push_back(runs.back());
+		runs.swap(mergedRuns);
 	}
 
+	//shared edges appear once per job
+	splitEdges.erase(std::unique(splitEdges.begin(), splitEdges.end()), splitEdges.end());
+
 	return true;
 }
 
@@ -3398,7 +3751,6 @@ ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 		ccLog::Error("[ccMesh::subdivide] Invalid input argument!");
 		return 0;
 	}
-	s_maxSubdivideArea = maxArea;
 
 	unsigned triCount = size();
 	ccGenericPointCloud* vertices = getAssociatedCloud();
@@ -3419,176 +3771,164 @@ ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 	ccMesh* resultMesh = new ccMesh(resultVertices);
 	resultMesh->addChild(resultVertices);
 
-	if (!resultMesh->reserve(triCount))
+	//triangles (3 indexes per triangle)
+	std::vector<unsigned> triangles;
+	std::vector<unsigned> newTriangles;
+	std::vector<qint64> splitEdges;
+	std::vector<CCVector3> middlePoints;
+	std::vector<ccColor::Rgb> middleColors;
+	try
+	{
+		triangles.resize(3*static_cast<size_t>(triCount));
+	}
+	catch (const std::bad_alloc&)
 	{
 		ccLog::Error("[ccMesh::subdivide] Not enough memory!");
 		delete resultMesh;
 		return 0;
 	}
+	for (unsigned i=0; i<triCount; ++i)
+	{
+		const unsigned* tri = m_triVertIndexes->getValue(i);
+		triangles[3*i  ] = tri[0];
+		triangles[3*i+1] = tri[1];
+		triangles[3*i+2] = tri[2];
+	}
 
-	s_alreadyCreatedVertices.clear();
+	SubdivisionContext context;
+	context.vertices = resultVertices;
+	context.maxArea = maxArea;
+	context.triangles = &triangles;
+	context.newTriangles = &newTriangles;
+	context.splitEdges = &splitEdges;
+	context.firstNewVertex = 0;
+	context.middlePoints = &middlePoints;
+	context.middleColors = (resultVertices->hasColors() ? &middleColors : 0);
 
-	try
-	{		
-		for (unsigned i=0; i<triCount; ++i)
+	SubdivisionJob prototype;
+	prototype.context = &context;
+	prototype.firstIndex = prototype.lastIndex = 0;
+	prototype.outputCount = prototype.outputStart = 0;
+	prototype.success = true;
+
+	//each pass splits the edges of the triangles that are still too big
+	while (true)
+	{
+		unsigned currentTriCount = static_cast<unsigned>(triangles.size()/3);
+		
+		std::vector<SubdivisionJob> jobs;
+		if (!PrepareMeshJobs(currentTriCount, prototype, jobs))
 		{
-			const unsigned* tri = m_triVertIndexes->getValue(i);
-			if (!resultMesh->pushSubdivide(/*maxArea,*/tri[0],tri[1],tri[2]))
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return 0;
+		}
+
+		//edges to split
+		QtConcurrent::blockingMap(jobs, CollectSplitEdges);
+		bool success = true;
+		for (size_t j=0; j<jobs.size(); ++j)
+			success &= jobs[j].success;
+		if (!success || !MergeSplitEdges(jobs, splitEdges))
+		{
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return 0;
+		}
+		if (splitEdges.empty())
+		{
+			//all triangles are small enough
+			break;
+		}
+
+		//new vertices (edges middle points)
+		unsigned edgeCount = static_cast<unsigned>(splitEdges.size());
+		context.firstNewVertex = resultVertices->size();
+		if (static_cast<size_t>(context.firstNewVertex) + edgeCount >= static_cast<size_t>(static_cast<unsigned>(-1)))
+		{
+			ccLog::Error("[ccMesh::subdivide] Too many vertices!");
+			delete resultMesh;
+			return 0;
+		}
+		try
+		{
+			middlePoints.resize(edgeCount);
+			if (context.middleColors)
+				middleColors.resize(edgeCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return 0;
+		}
+		{
+			std::vector<SubdivisionJob> edgeJobs;
+			if (!PrepareMeshJobs(edgeCount, prototype, edgeJobs))
 			{
 				ccLog::Error("[ccMesh::subdivide] Not enough memory!");
 				delete resultMesh;
 				return 0;
 			}
+			QtConcurrent::blockingMap(edgeJobs, ComputeMiddlePoints);
 		}
-	}
-	catch(...)
-	{
-		ccLog::Error("[ccMesh::subdivide] An error occurred!");
-		delete resultMesh;
-		return 0;
-	}
-
-	//we must also 'fix' the triangles that share (at least) an edge with a subdivided triangle!
-	try
-	{
-		unsigned newTriCount = resultMesh->size();
-		for (unsigned i=0; i<newTriCount; ++i)
+		if (!resultVertices->reserve(context.firstNewVertex + edgeCount))
 		{
-			unsigned* _face = resultMesh->m_triVertIndexes->getValue(i); //warning: array might change at each call to reallocate!
-			unsigned indexA = _face[0];
-			unsigned indexB = _face[1];
-			unsigned indexC = _face[2];
-
-			//test all edges
-			int indexG1 = -1;
-			{
-				QMap<qint64,unsigned>::const_iterator it = s_alreadyCreatedVertices.find(GenerateKey(indexA,indexB));
-				if (it != s_alreadyCreatedVertices.end())
-					indexG1 = (int)it.value();
-			}
-			int indexG2 = -1;
-			{
-				QMap<qint64,unsigned>::const_iterator it = s_alreadyCreatedVertices.find(GenerateKey(indexB,indexC));
-				if (it != s_alreadyCreatedVertices.end())
-					indexG2 = (int)it.value();
-			}
-			int indexG3 = -1;
-			{
-				QMap<qint64,unsigned>::const_iterator it = s_alreadyCreatedVertices.find(GenerateKey(indexC,indexA));
-				if (it != s_alreadyCreatedVertices.end())
-					indexG3 = (int)it.value();
-			}
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return 0;
+		}
+		for (unsigned i=0; i<edgeCount; ++i)
+		{
+			resultVertices->addPoint(middlePoints[i]);
+			if (context.middleColors)
+				resultVertices->addRGBColor(middleColors[i].rgb);
+		}
 
-			//at least one edge is 'wrong'
-			unsigned brokenEdges =	(indexG1 < 0 ? 0:1)
-								+	(indexG2 < 0 ? 0:1)
-								+	(indexG3 < 0 ? 0:1);
+		//split the triangles (the ones that are too big, and their neighbours)
+		QtConcurrent::blockingMap(jobs, CountSubdividedTriangles);
+		size_t newTriCount = 0;
+		for (size_t j=0; j<jobs.size(); ++j)
+		{
+			jobs[j].outputStart = static_cast<unsigned>(newTriCount);
+			newTriCount += jobs[j].outputCount;
+		}
+		if (newTriCount >= static_cast<size_t>(static_cast<unsigned>(-1)))
+		{
+			ccLog::Error("[ccMesh::subdivide] Too many triangles!");
+			delete resultMesh;
+			return 0;
+		}
+		try
+		{
+			newTriangles.resize(3*newTriCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return 0;
+		}
+		QtConcurrent::blockingMap(jobs, WriteSubdividedTriangles);
 
-			if (brokenEdges == 1)
-			{
-				int indexG = indexG1;
-				unsigned char i1 = 2; //relative index facing the broken edge
-				if (indexG2 >= 0)
-				{
-					indexG = indexG2;
-					i1 = 0;
-				}
-				else if (indexG3 >= 0)
-				{
-					indexG = indexG3;
-					i1 = 1;
-				}
-				assert(indexG >= 0);
-				assert(i1<3);
+		triangles.swap(newTriangles);
+	}
 
-				unsigned indexes[3] = { indexA, indexB, indexC };
+	//release some memory
+	std::vector<unsigned>().swap(newTriangles);
+	std::vector<qint64>().swap(splitEdges);
+	std::vector<CCVector3>().swap(middlePoints);
+	std::vector<ccColor::Rgb>().swap(middleColors);
 
-				//replace current triangle by one half
-				_face[0] = indexes[i1];
-				_face[1] = indexG;
-				_face[2] = indexes[(i1+2)%3];
-				//and add the other half (we can use pushSubdivide as the area should alredy be ok!)
-				if (!resultMesh->pushSubdivide(/*maxArea,*/indexes[i1],indexes[(i1+1)%3],indexG))
-				{
-					ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-					delete resultMesh;
-					return 0;
-				}
-			}
-			else if (brokenEdges == 2)
-			{
-				if (indexG1 < 0) //broken edges: BC and CA
-				{
-					//replace current triangle by the 'pointy' part
-					_face[0] = indexC;
-					_face[1] = indexG3;
-					_face[2] = indexG2;
-					//split the remaining 'trapezoid' in 2
-					if (!resultMesh->pushSubdivide(/*maxArea, */indexA, indexG2, indexG3) ||
-						!resultMesh->pushSubdivide(/*maxArea, */indexA, indexB, indexG2))
-					{
-						ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-						delete resultMesh;
-						return 0;
-					}
-				}
-				else if (indexG2 < 0) //broken edges: AB and CA
-				{
-					//replace current triangle by the 'pointy' part
-					_face[0] = indexA;
-					_face[1] = indexG1;
-					_face[2] = indexG3;
-					//split the remaining 'trapezoid' in 2
-					if (!resultMesh->pushSubdivide(/*maxArea, */indexB, indexG3, indexG1) ||
-						!resultMesh->pushSubdivide(/*maxArea, */indexB, indexC, indexG3))
-					{
-						ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-						delete resultMesh;
-						return 0;
-					}
-				}
-				else /*if (indexG3 < 0)*/ //broken edges: AB and BC
-				{
-					//replace current triangle by the 'pointy' part
-					_face[0] = indexB;
-					_face[1] = indexG2;
-					_face[2] = indexG1;
-					//split the remaining 'trapezoid' in 2
-					if (!resultMesh->pushSubdivide(/*maxArea, */indexC, indexG1, indexG2) ||
-						!resultMesh->pushSubdivide(/*maxArea, */indexC, indexA, indexG1))
-					{
-						ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-						delete resultMesh;
-						return 0;
-					}
-				}
-			}
-			else if (brokenEdges == 3) //works just as a standard subdivision in fact!
-			{
-				//replace current triangle by one quarter
-				_face[0] = indexA;
-				_face[1] = indexG1;
-				_face[2] = indexG3;
-				//and add the other 3 quarters (we can use pushSubdivide as the area should alredy be ok!)
-				if (!resultMesh->pushSubdivide(/*maxArea, */indexB, indexG2, indexG1) ||
-					!resultMesh->pushSubdivide(/*maxArea, */indexC, indexG3, indexG2) ||
-					!resultMesh->pushSubdivide(/*maxArea, */indexG1, indexG2, indexG3))
-				{
-					ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-					delete resultMesh;
-					return 0;
-				}
-			}
-		}
-	}
-	catch(...)
+	unsigned finalTriCount = static_cast<unsigned>(triangles.size()/3);
+	if (!resultMesh->reserve(finalTriCount))
 	{
-		ccLog::Error("[ccMesh::subdivide] An error occurred!");
+		ccLog::Error("[ccMesh::subdivide] Not enough memory!");
 		delete resultMesh;
 		return 0;
 	}
-
-	s_alreadyCreatedVertices.clear();
+	for (unsigned i=0; i<finalTriCount; ++i)
+		resultMesh->addTriangle(triangles[3*i], triangles[3*i+1], triangles[3*i+2]);
 
 	resultMesh->shrinkToFit();
 	resultVertices->shrinkToFit();
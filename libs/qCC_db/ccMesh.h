@@ -382,6 +382,11 @@ protected:
 	virtual void onUpdateOf(ccHObject* obj);
 	virtual void onDeletionOf(const ccHObject* obj);
 
+	//! Renders the mesh ID or the triangles IDs in the ID buffer (picking)
+	/** See ccGL::ColorID and glDrawContext::idBufferEntityID.
+	**/
+	void drawIDBuffer(CC_DRAW_CONTEXT& context);
+
 	//! Same as other 'computeInterpolationWeights' method with a set of 3 vertices indexes
 	void computeInterpolationWeights(unsigned i1, unsigned i2, unsigned i3, const CCVector3& P, CCVector3d& weights) const;
 	//! Same as other 'interpolateNormals' method with a set of 3 vertices indexes
@@ -389,9 +394,6 @@ protected:
 	//! Same as other 'interpolateColors' method with a set of 3 vertices indexes
 	bool interpolateColors(unsigned i1, unsigned i2, unsigned i3, const CCVector3& P, ccColor::Rgb& C);
 
-	//! Used internally by 'subdivide'
-	bool pushSubdivide(/*PointCoordinateType maxArea, */unsigned indexA, unsigned indexB, unsigned indexC);
-
 	/*** EXTENDED CALL SCRIPTS (FOR CC_SUB_MESHES) ***/
 	
 	//0 parameter
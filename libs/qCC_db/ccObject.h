@@ -27,6 +27,7 @@
 #include <QString>
 #include <QVariant>
 #include <QSharedPointer>
+#include <QAtomicInt>
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
 #define CC_QT5
 #endif
@@ -153,6 +154,8 @@ public:
 };
 
 //! Unique ID generator (should be unique for the whole application instance - with plugins, etc.)
+/** Thread-safe: entities can be created concurrently.
+**/
 class QCC_DB_LIB_API ccUniqueIDGenerator
 {
 public:
@@ -164,16 +167,29 @@ public:
 	ccUniqueIDGenerator() : m_lastUniqueID(0) {}
 
 	//! Resets the unique ID
-	void reset() { m_lastUniqueID = 0; }
+	void reset() { m_lastUniqueID.fetchAndStoreOrdered(0); }
 	//! Returns a (new) unique ID
-	unsigned fetchOne() { return ++m_lastUniqueID; }
+	unsigned fetchOne() { return static_cast<unsigned>(m_lastUniqueID.fetchAndAddOrdered(1)) + 1; }
 	//! Returns the value of the last generated unique ID
-	unsigned getLast() const { return m_lastUniqueID; }
+#ifndef CC_QT5
+	unsigned getLast() const { return static_cast<unsigned>(static_cast<int>(m_lastUniqueID)); }
+#else
+	unsigned getLast() const { return static_cast<unsigned>(m_lastUniqueID.load()); }
+#endif
 	//! Updates the value of the last generated unique ID with the current one
-	void update(unsigned ID) { if (ID > m_lastUniqueID) m_lastUniqueID = ID; }
+	void update(unsigned ID)
+	{
+		while (ID > getLast())
+		{
+			int last = static_cast<int>(getLast());
+			if (m_lastUniqueID.testAndSetOrdered(last, static_cast<int>(ID)))
+				break;
+		}
+	}
 
 protected:
-	unsigned m_lastUniqueID;
+	//! Last generated unique ID (stored as an int)
+	QAtomicInt m_lastUniqueID;
 };
 
 //! Generic "CloudCompare Object" template
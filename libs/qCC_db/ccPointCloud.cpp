@@ -2256,6 +2256,58 @@ struct DisplayDesc : ccPointCloud::LodStruct::LevelDesc
 	unsigned decimStep;
 };
 
+void ccPointCloud::drawIDBuffer(CC_DRAW_CONTEXT& context)
+{
+	//points hidden by the visibility table or by the displayed SF can't be picked
+	bool visFiltering = isVisibilityTableInstantiated();
+	bool hiddenSFValues = false;
+	{
+		glDrawParams glParams;
+		getDrawingParameters(glParams);
+		if (glParams.showSF && !m_currentDisplayedScalarField->areNaNValuesShownInGrey())
+			hiddenSFValues = m_currentDisplayedScalarField->mayHaveHiddenValues() && m_currentDisplayedScalarField->getColorScale();
+	}
+
+	//elements IDs or entity ID?
+	bool pointIDs = (context.idBufferEntityID != 0);
+	if (!pointIDs)
+		ccGL::ColorID(getUniqueIDForDisplay());
+
+	//custom point size?
+	glPushAttrib(GL_POINT_BIT);
+	if (m_pointSize != 0)
+		glPointSize(static_cast<GLfloat>(m_pointSize));
+
+	if (!pointIDs && !visFiltering && !hiddenSFValues)
+	{
+		//a single color for the whole cloud: we can use display arrays
+		glEnableClientState(GL_VERTEX_ARRAY);
+		for (unsigned k=0; k<m_points->chunksCount(); ++k)
+		{
+			glChunkVertexPointer(k,1,context.useVBOs);
+			glDrawArrays(GL_POINTS,0,m_points->chunkSize(k));
+		}
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+	else
+	{
+		glBegin(GL_POINTS);
+		for (unsigned i=0; i<size(); ++i)
+		{
+			if (visFiltering && m_pointsVisibility->getValue(i) != POINT_VISIBLE)
+				continue;
+			if (hiddenSFValues && !getPointScalarValueColor(i))
+				continue;
+			if (pointIDs)
+				ccGL::ColorID(i+1); //0 = no point
+			ccGL::Vertex3v(m_points->getValue(i));
+		}
+		glEnd();
+	}
+
+	glPopAttrib(); //GL_POINT_BIT
+}
+
 void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 {
 	if (!m_points->isAllocated())
@@ -2263,6 +2315,13 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 
 	if (MACRO_Draw3D(context))
 	{
+		//ID buffer rendering (picking)
+		if (MACRO_DrawIDBuffer(context))
+		{
+			drawIDBuffer(context);
+			return;
+		}
+
 		//we get display parameters
 		glDrawParams glParams;
 		getDrawingParameters(glParams);
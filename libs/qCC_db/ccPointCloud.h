@@ -607,6 +607,11 @@ protected:
 	//inherited from ccHObject
 	virtual void drawMeOnly(CC_DRAW_CONTEXT& context);
 	virtual void applyGLTransformation(const ccGLMatrix& trans);
+
+	//! Renders the cloud ID or the points IDs in the ID buffer (picking)
+	/** See ccGL::ColorID and glDrawContext::idBufferEntityID.
+	**/
+	void drawIDBuffer(CC_DRAW_CONTEXT& context);
 	virtual bool toFile_MeOnly(QFile& out) const;
 	virtual bool fromFile_MeOnly(QFile& in, short dataVersion, int flags);
 	virtual void notifyGeometryUpdate();
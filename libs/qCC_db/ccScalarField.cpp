@@ -161,12 +161,8 @@ void ccScalarField::computeMinAndMax()
 
 			m_histogram.maxValue = 0;
 
-			//reserve memory
-			try
-			{
-				m_histogram.resize(numberOfClasses);
-			}
-			catch (const std::bad_alloc&)
+			//compute histogram (NaN values are ignored)
+			if (!computeHistogram(m_displayRange.min(),m_displayRange.max(),numberOfClasses,m_histogram))
 			{
 				ccLog::Warning("[ccScalarField::computeMinAndMax] Failed to update associated histogram!");
 				m_histogram.clear();
@@ -174,20 +170,6 @@ void ccScalarField::computeMinAndMax()
 
 			if (!m_histogram.empty())
 			{
-				std::fill(m_histogram.begin(),m_histogram.end(),0);
-
-				//compute histogram
-				{
-					ScalarType step = static_cast<ScalarType>(numberOfClasses)/m_displayRange.maxRange();
-					for (unsigned i=0; i<count; ++i)
-					{
-						const ScalarType& val = getValue(i);
-
-						unsigned bin = static_cast<unsigned>(floor((val-m_displayRange.min())*step));
-						++m_histogram[std::min(bin,numberOfClasses-1)];
-					}
-				}
-
 				//update 'maxValue'
 				m_histogram.maxValue = *std::max_element(m_histogram.begin(),m_histogram.end());
 			}
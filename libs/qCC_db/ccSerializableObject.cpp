@@ -0,0 +1,395 @@
+//##########################################################################
+//#                                                                        #
+//#                            CLOUDCOMPARE                                #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccSerializableObject.h"
+
+//Qt
+#include <QByteArray>
+#include <QThread>
+#include <QtConcurrentMap>
+
+//System
+#include <assert.h>
+
+//! Block codecs (dataVersion>=41)
+enum BlockCodec
+{
+	STORED_BLOCK			= 0,	/**< Raw data **/
+	DEFLATE_BLOCK			= 1,	/**< Deflated data **/
+	SHUFFLE_DEFLATE_BLOCK	= 2,	/**< Byte shuffled + deflated data **/
+};
+
+//! Block record header size (codec + raw size + encoded size)
+static const qint64 BLOCK_HEADER_SIZE = 9;
+
+//current save session
+static ccSerializationHelper::Compression s_compression = ccSerializationHelper::NO_COMPRESSION;
+static QFile* s_previousFile = 0;
+static const ccSerializationHelper::WrittenBlocks* s_previousBlocks = 0;
+static ccSerializationHelper::WrittenBlocks s_writtenBlocks;
+
+void ccSerializationHelper::BeginSaveSession(Compression compression, QFile* previousFile/*=0*/, const WrittenBlocks* previousBlocks/*=0*/)
+{
+	s_compression = compression;
+	s_previousFile = (previousFile && previousBlocks ? previousFile : 0);
+	s_previousBlocks = (s_previousFile ? previousBlocks : 0);
+	s_writtenBlocks.clear();
+}
+
+void ccSerializationHelper::EndSaveSession(WrittenBlocks* writtenBlocks/*=0*/)
+{
+	if (writtenBlocks)
+		writtenBlocks->swap(s_writtenBlocks);
+	s_writtenBlocks.clear();
+
+	s_compression = NO_COMPRESSION;
+	s_previousFile = 0;
+	s_previousBlocks = 0;
+}
+
+bool ccSerializationHelper::IsCompressionEnabled()
+{
+	return s_compression != NO_COMPRESSION;
+}
+
+//! Fast 64 bits hash of a memory block
+static ::uint64_t HashBlock(const char* data, size_t size)
+{
+	const ::uint64_t prime = 0x100000001B3ULL;
+	::uint64_t h = 0xCBF29CE484222325ULL ^ static_cast< ::uint64_t >(size);
+
+	//8 bytes at a time
+	size_t wordCount = size / 8;
+	for (size_t i=0; i<wordCount; ++i)
+	{
+		::uint64_t w;
+		memcpy(&w, data + i*8, 8);
+		h = (h ^ w) * prime;
+		h ^= (h >> 32);
+	}
+	//remaining bytes
+	for (size_t i=wordCount*8; i<size; ++i)
+		h = (h ^ static_cast<unsigned char>(data[i])) * prime;
+
+	//final mix
+	h ^= (h >> 33);
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= (h >> 33);
+	return h;
+}
+
+//! Byte shuffling (the n-th bytes of all values are stored contiguously)
+static void ShuffleBytes(const char* in, char* out, size_t size, size_t valueSize)
+{
+	size_t count = size / valueSize;
+	for (size_t b=0; b<valueSize; ++b)
+	{
+		char* _out = out + b*count;
+		const char* _in = in + b;
+		for (size_t i=0; i<count; ++i, _in += valueSize)
+			*_out++ = *_in;
+	}
+}
+
+//! Inverse of ShuffleBytes
+static void UnshuffleBytes(const char* in, char* out, size_t size, size_t valueSize)
+{
+	size_t count = size / valueSize;
+	for (size_t b=0; b<valueSize; ++b)
+	{
+		const char* _in = in + b*count;
+		char* _out = out + b;
+		for (size_t i=0; i<count; ++i, _out += valueSize)
+			*_out = *_in++;
+	}
+}
+
+//! Block encoding/decoding job
+struct BlockJob
+{
+	//raw data
+	const char* data;
+	size_t size;
+	size_t valueSize;
+
+	//incremental save
+	const ccSerializationHelper::WrittenBlock* previous;
+	::uint64_t hash;
+	bool reuse;
+
+	//encoded data
+	::uint8_t codec;
+	::uint32_t rawSize;
+	QByteArray payload;
+
+	//decoded data
+	QByteArray decoded;
+	bool success;
+
+	BlockJob()
+		: data(0)
+		, size(0)
+		, valueSize(1)
+		, previous(0)
+		, hash(0)
+		, reuse(false)
+		, codec(STORED_BLOCK)
+		, rawSize(0)
+		, success(true)
+	{}
+};
+
+static int s_compressionLevel_MT = 1;
+
+static void EncodeBlock(BlockJob& job)
+{
+	job.hash = HashBlock(job.data, job.size);
+
+	//unmodified block? (incremental save)
+	if (	job.previous
+		&&	job.previous->hash == job.hash
+		&&	job.previous->rawSize == static_cast< ::uint32_t >(job.size))
+	{
+		job.reuse = true;
+		return;
+	}
+
+	job.codec = STORED_BLOCK;
+	job.payload.clear();
+	if (job.size == 0)
+		return;
+
+	QByteArray compressed;
+	if (job.valueSize > 1 && (job.size % job.valueSize) == 0)
+	{
+		QByteArray shuffled(static_cast<int>(job.size), 0);
+		ShuffleBytes(job.data, shuffled.data(), job.size, job.valueSize);
+		compressed = qCompress(shuffled, s_compressionLevel_MT);
+		job.codec = SHUFFLE_DEFLATE_BLOCK;
+	}
+	else
+	{
+		compressed = qCompress(reinterpret_cast<const uchar*>(job.data), static_cast<int>(job.size), s_compressionLevel_MT);
+		job.codec = DEFLATE_BLOCK;
+	}
+
+	if (!compressed.isEmpty() && static_cast<size_t>(compressed.size()) < job.size)
+	{
+		job.payload = compressed;
+	}
+	else
+	{
+		//not worth it (or not enough memory): we store the raw data
+		job.codec = STORED_BLOCK;
+	}
+}
+
+static void DecodeBlock(BlockJob& job)
+{
+	job.success = false;
+
+	switch (job.codec)
+	{
+	case STORED_BLOCK:
+		job.decoded = job.payload;
+		break;
+	case DEFLATE_BLOCK:
+		job.decoded = qUncompress(job.payload);
+		break;
+	case SHUFFLE_DEFLATE_BLOCK:
+		{
+			QByteArray shuffled = qUncompress(job.payload);
+			if (job.valueSize == 0 || (shuffled.size() % job.valueSize) != 0)
+				return;
+			job.decoded.resize(shuffled.size());
+			if (job.decoded.size() != shuffled.size())
+				return;
+			UnshuffleBytes(shuffled.constData(), job.decoded.data(), shuffled.size(), job.valueSize);
+		}
+		break;
+	default:
+		return;
+	}
+	//release some memory
+	job.payload.clear();
+
+	job.success = (static_cast< ::uint32_t >(job.decoded.size()) == job.rawSize);
+}
+
+//! Number of blocks processed simultaneously
+static size_t BlocksBatchSize()
+{
+	return static_cast<size_t>(std::max(1, QThread::idealThreadCount())) * 2;
+}
+
+bool ccSerializationHelper::WriteArrayBlocks(QFile& out, const std::vector<ArrayBlock>& blocks, size_t valueSize, const void* arrayKey)
+{
+	//array encoding
+	::uint8_t encoding = BLOCKS_ARRAY;
+	if (out.write((const char*)&encoding,1) < 0)
+		return ccSerializableObject::WriteError();
+
+	//block count
+	::uint32_t blockCount = static_cast< ::uint32_t >(blocks.size());
+	if (out.write((const char*)&blockCount,4) < 0)
+		return ccSerializableObject::WriteError();
+
+	s_compressionLevel_MT = (s_compression == HIGH_COMPRESSION ? 9 : 1);
+
+	std::vector<BlockJob> jobs;
+	for (size_t start=0; start<blocks.size(); start+=BlocksBatchSize())
+	{
+		size_t batchSize = std::min(BlocksBatchSize(), blocks.size()-start);
+		try
+		{
+			jobs.clear();
+			jobs.resize(batchSize);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return ccSerializableObject::MemoryError();
+		}
+
+		for (size_t i=0; i<batchSize; ++i)
+		{
+			BlockJob& job = jobs[i];
+			job.data = blocks[start+i].data;
+			job.size = blocks[start+i].size;
+			job.valueSize = valueSize;
+			if (s_previousBlocks)
+			{
+				WrittenBlocks::const_iterator it = s_previousBlocks->find(std::make_pair(arrayKey,static_cast<unsigned>(start+i)));
+				if (it != s_previousBlocks->end())
+					job.previous = &(it->second);
+			}
+		}
+
+		//blocks are encoded in parallel
+		QtConcurrent::blockingMap(jobs, EncodeBlock);
+
+		//then written in order
+		for (size_t i=0; i<batchSize; ++i)
+		{
+			BlockJob& job = jobs[i];
+
+			WrittenBlock written;
+			written.hash = job.hash;
+			written.rawSize = static_cast< ::uint32_t >(job.size);
+			written.filePos = out.pos();
+
+			if (job.reuse)
+			{
+				//we copy the block record from the previous version of the file
+				assert(s_previousFile && job.previous);
+				if (!s_previousFile->seek(job.previous->filePos))
+					return ccSerializableObject::ReadError();
+				QByteArray record = s_previousFile->read(job.previous->recordSize);
+				if (record.size() != job.previous->recordSize)
+					return ccSerializableObject::ReadError();
+				if (out.write(record) < 0)
+					return ccSerializableObject::WriteError();
+			}
+			else
+			{
+				const char* payload = (job.codec == STORED_BLOCK ? job.data : job.payload.constData());
+				::uint32_t encodedSize = static_cast< ::uint32_t >(job.codec == STORED_BLOCK ? job.size : job.payload.size());
+				if (	out.write((const char*)&job.codec,1) < 0
+					||	out.write((const char*)&written.rawSize,4) < 0
+					||	out.write((const char*)&encodedSize,4) < 0
+					||	out.write(payload,encodedSize) < 0)
+				{
+					return ccSerializableObject::WriteError();
+				}
+			}
+
+			written.recordSize = out.pos() - written.filePos;
+			try
+			{
+				s_writtenBlocks[std::make_pair(arrayKey,static_cast<unsigned>(start+i))] = written;
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not a big deal (the next save won't be incremental for this block)
+			}
+
+			//release some memory
+			job.payload.clear();
+		}
+	}
+
+	return true;
+}
+
+bool ccSerializationHelper::ReadArrayBlocks(QFile& in, size_t valueSize, BlockConsumer& consumer)
+{
+	//block count
+	::uint32_t blockCount = 0;
+	if (in.read((char*)&blockCount,4) < 0)
+		return ccSerializableObject::ReadError();
+
+	std::vector<BlockJob> jobs;
+	for (size_t start=0; start<blockCount; start+=BlocksBatchSize())
+	{
+		size_t batchSize = std::min<size_t>(BlocksBatchSize(), blockCount-start);
+		try
+		{
+			jobs.clear();
+			jobs.resize(batchSize);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return ccSerializableObject::MemoryError();
+		}
+
+		//encoded blocks are read in order
+		for (size_t i=0; i<batchSize; ++i)
+		{
+			BlockJob& job = jobs[i];
+			job.valueSize = valueSize;
+
+			::uint32_t encodedSize = 0;
+			if (	in.read((char*)&job.codec,1) < 0
+				||	in.read((char*)&job.rawSize,4) < 0
+				||	in.read((char*)&encodedSize,4) < 0)
+			{
+				return ccSerializableObject::ReadError();
+			}
+			if (static_cast<qint64>(encodedSize) > in.size() - in.pos())
+				return ccSerializableObject::CorruptError();
+
+			job.payload = in.read(encodedSize);
+			if (static_cast< ::uint32_t >(job.payload.size()) != encodedSize)
+				return ccSerializableObject::ReadError();
+		}
+
+		//then decoded in parallel
+		QtConcurrent::blockingMap(jobs, DecodeBlock);
+
+		for (size_t i=0; i<batchSize; ++i)
+		{
+			BlockJob& job = jobs[i];
+			if (!job.success)
+				return ccSerializableObject::CorruptError();
+			if (!consumer.consume(job.decoded.constData(),static_cast<size_t>(job.decoded.size())))
+				return ccSerializableObject::CorruptError();
+			//release some memory
+			job.decoded.clear();
+		}
+	}
+
+	return true;
+}
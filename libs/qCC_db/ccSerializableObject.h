@@ -28,6 +28,10 @@
 //System
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <map>
 
 //Qt
 #include <QFile>
@@ -92,10 +96,48 @@ public:
 };
 
 //! Serialization helpers
-class ccSerializationHelper
+class QCC_DB_LIB_API ccSerializationHelper
 {
 public:
 
+	//! Arrays compression (dataVersion>=41)
+	/** Arrays are then saved by blocks, compressed in parallel.
+	**/
+	enum Compression
+	{
+		NO_COMPRESSION		= 0, /**< Raw data (fastest) **/
+		FAST_COMPRESSION	= 1, /**< Byte shuffling + fast deflate **/
+		HIGH_COMPRESSION	= 2, /**< Byte shuffling + best deflate **/
+	};
+
+	//! Compressed block already written in a file (incremental save)
+	struct WrittenBlock
+	{
+		//! Raw data hash
+		::uint64_t hash;
+		//! Raw data size (in bytes)
+		::uint32_t rawSize;
+		//! Position of the block record in the file
+		qint64 filePos;
+		//! Size of the block record in the file
+		qint64 recordSize;
+	};
+
+	//! Compressed blocks written in a file (key = array address + block index)
+	typedef std::map< std::pair<const void*,unsigned>, WrittenBlock > WrittenBlocks;
+
+	//! Starts a save session
+	/** \param compression arrays compression
+		\param previousFile previous version of the file being saved (incremental save, optional)
+		\param previousBlocks compressed blocks written in the previous version of the file (incremental save, optional)
+	**/
+	static void BeginSaveSession(Compression compression, QFile* previousFile = 0, const WrittenBlocks* previousBlocks = 0);
+
+	//! Ends the current save session
+	/** \param writtenBlocks compressed blocks written during the session (optional)
+	**/
+	static void EndSaveSession(WrittenBlocks* writtenBlocks = 0);
+
 	//! Reads one or several 'PointCoordinateType' values from a QDataStream either in float or double format depending on the 'flag' value
 	static void CoordsFromDataStream(QDataStream& stream, int flags, PointCoordinateType* out, unsigned count = 1)
 	{
@@ -164,6 +206,35 @@ public:
 		if (out.write((const char*)&elementCount,4) < 0)
 			return ccSerializableObject::WriteError();
 
+		//compressed array data (dataVersion>=41)
+		if (IsCompressionEnabled() && elementCount != 0)
+		{
+			//one block per chunk
+			std::vector<ArrayBlock> blocks;
+			try
+			{
+				blocks.resize(chunkArray.chunksCount());
+			}
+			catch (const std::bad_alloc&)
+			{
+				return ccSerializableObject::MemoryError();
+			}
+			unsigned remainingCount = elementCount;
+			for (unsigned i=0; i<chunkArray.chunksCount(); ++i)
+			{
+				unsigned count = std::min<unsigned>(remainingCount,chunkArray.chunkSize(i));
+				blocks[i].data = (char*)chunkArray.chunkStartPtr(i);
+				blocks[i].size = sizeof(ElementType)*N*count;
+				remainingCount -= count;
+			}
+			return WriteArrayBlocks(out,blocks,sizeof(ElementType),&chunkArray);
+		}
+
+		//array encoding (dataVersion>=41)
+		::uint8_t encoding = RAW_ARRAY;
+		if (out.write((const char*)&encoding,1) < 0)
+			return ccSerializableObject::WriteError();
+
 		//array data (dataVersion>=20)
 		{
 #ifdef CC_ENV_64
@@ -199,7 +270,8 @@ public:
 	{
 		::uint8_t componentCount = 0;
 		::uint32_t elementCount = 0;
-		if (!ReadArrayHeader(in,dataVersion,componentCount,elementCount))
+		::uint8_t encoding = RAW_ARRAY;
+		if (!ReadArrayHeader(in,dataVersion,componentCount,elementCount,encoding))
 			return false;
 		if (componentCount != N)
 			return ccSerializableObject::CorruptError();
@@ -210,7 +282,29 @@ public:
 			if (!chunkArray.resize(elementCount))
 				return ccSerializableObject::MemoryError();
 
+			//compressed array data (dataVersion>=41)
+			if (encoding == BLOCKS_ARRAY)
+			{
+				std::vector<ArrayBlock> blocks;
+				try
+				{
+					blocks.resize(chunkArray.chunksCount());
+				}
+				catch (const std::bad_alloc&)
+				{
+					return ccSerializableObject::MemoryError();
+				}
+				for (unsigned i=0; i<chunkArray.chunksCount(); ++i)
+				{
+					blocks[i].data = (char*)chunkArray.chunkStartPtr(i);
+					blocks[i].size = sizeof(ElementType)*N*chunkArray.chunkSize(i);
+				}
+				ArrayBlocksCopier copier(blocks);
+				if (!ReadArrayBlocks(in,sizeof(ElementType),copier) || !copier.complete())
+					return ccSerializableObject::CorruptError();
+			}
 			//array data (dataVersion>=20)
+			else
 			{
 #ifdef CC_ENV_64
 				if (in.read((char*)chunkArray.data(),sizeof(ElementType)*N*chunkArray.currentSize()) < 0)
@@ -241,7 +335,8 @@ public:
 	{
 		::uint8_t componentCount = 0;
 		::uint32_t elementCount = 0;
-		if (!ReadArrayHeader(in,dataVersion,componentCount,elementCount))
+		::uint8_t encoding = RAW_ARRAY;
+		if (!ReadArrayHeader(in,dataVersion,componentCount,elementCount,encoding))
 			return false;
 		if (componentCount != N)
 			return ccSerializableObject::CorruptError();
@@ -252,6 +347,19 @@ public:
 			if (!chunkArray.resize(elementCount))
 				return ccSerializableObject::MemoryError();
 
+			//compressed array data (dataVersion>=41)
+			if (encoding == BLOCKS_ARRAY)
+			{
+				//values are converted block by block
+				TypedArrayConverter<N,ElementType,FileElementType> converter(chunkArray);
+				if (!ReadArrayBlocks(in,sizeof(FileElementType),converter) || !converter.complete())
+					return ccSerializableObject::CorruptError();
+
+				//update array boundaries
+				chunkArray.computeMinAndMax();
+				return true;
+			}
+
 			//array data (dataVersion>=20)
 			//--> saldy we can't read it as a block...
 			//we must convert each element, value by value!
@@ -300,10 +408,119 @@ public:
 
 protected:
 
+	//! Array encoding (dataVersion>=41)
+	enum ArrayEncoding
+	{
+		RAW_ARRAY		= 0,	/**< Raw data **/
+		BLOCKS_ARRAY	= 1,	/**< Sequence of (compressed) blocks **/
+	};
+
+	//! Contiguous block of array data
+	struct ArrayBlock
+	{
+		char* data;
+		size_t size; //in bytes
+	};
+
+	//! Receives the decoded blocks (in order)
+	class BlockConsumer
+	{
+	public:
+		virtual ~BlockConsumer() {}
+		//! Consumes a decoded block
+		virtual bool consume(const char* data, size_t size) = 0;
+	};
+
+	//! Copies the decoded blocks in a set of (destination) blocks
+	class ArrayBlocksCopier : public BlockConsumer
+	{
+	public:
+		ArrayBlocksCopier(std::vector<ArrayBlock>& blocks) : m_blocks(blocks), m_blockIndex(0), m_blockPos(0) {}
+		virtual bool consume(const char* data, size_t size)
+		{
+			while (size != 0)
+			{
+				if (complete())
+					return false;
+				ArrayBlock& block = m_blocks[m_blockIndex];
+				size_t toCopy = std::min(size, block.size - m_blockPos);
+				memcpy(block.data + m_blockPos, data, toCopy);
+				data += toCopy;
+				size -= toCopy;
+				m_blockPos += toCopy;
+				if (m_blockPos == block.size)
+				{
+					++m_blockIndex;
+					m_blockPos = 0;
+				}
+			}
+			return true;
+		}
+		//! Returns whether all the destination blocks have been filled
+		bool complete() const { return m_blockIndex == m_blocks.size(); }
+	protected:
+		std::vector<ArrayBlock>& m_blocks;
+		size_t m_blockIndex;
+		size_t m_blockPos;
+	};
+
+	//! Converts the decoded blocks values (FileElementType) to the array type (ElementType)
+	template <int N, class ElementType, class FileElementType> class TypedArrayConverter : public BlockConsumer
+	{
+	public:
+		TypedArrayConverter(GenericChunkedArray<N,ElementType>& array) : m_array(array), m_chunkIndex(0), m_chunkPos(0) {}
+		virtual bool consume(const char* data, size_t size)
+		{
+			if (size % sizeof(FileElementType))
+				return false;
+			const FileElementType* values = reinterpret_cast<const FileElementType*>(data);
+			size_t count = size / sizeof(FileElementType);
+			for (size_t i=0; i<count; ++i)
+			{
+				if (complete())
+					return false;
+				m_array.chunkStartPtr(m_chunkIndex)[m_chunkPos] = static_cast<ElementType>(values[i]);
+				if (++m_chunkPos == static_cast<size_t>(m_array.chunkSize(m_chunkIndex)) * N)
+				{
+					++m_chunkIndex;
+					m_chunkPos = 0;
+				}
+			}
+			return true;
+		}
+		//! Returns whether the whole array has been filled
+		bool complete() const { return m_chunkIndex == m_array.chunksCount(); }
+	protected:
+		GenericChunkedArray<N,ElementType>& m_array;
+		unsigned m_chunkIndex;
+		size_t m_chunkPos;
+	};
+
+	//! Returns whether arrays should be compressed (current save session)
+	static bool IsCompressionEnabled();
+
+	//! Writes an array as a sequence of compressed blocks
+	/** \param out output file
+		\param blocks array data
+		\param valueSize size of a single value (for byte shuffling)
+		\param arrayKey array identifier (incremental save)
+		\return success
+	**/
+	static bool WriteArrayBlocks(QFile& out, const std::vector<ArrayBlock>& blocks, size_t valueSize, const void* arrayKey);
+
+	//! Reads an array saved as a sequence of compressed blocks
+	/** \param in input file
+		\param valueSize size of a single value (for byte unshuffling)
+		\param consumer receives the decoded blocks (in order)
+		\return success
+	**/
+	static bool ReadArrayBlocks(QFile& in, size_t valueSize, BlockConsumer& consumer);
+
 	static bool ReadArrayHeader(QFile& in,
 								short dataVersion,
 								::uint8_t &componentCount,
-								::uint32_t &elementCount)
+								::uint32_t &elementCount,
+								::uint8_t &encoding)
 	{
 		assert(in.isOpen() && (in.openMode() & QIODevice::ReadOnly));
 
@@ -318,6 +535,16 @@ protected:
 		if (in.read((char*)&elementCount,4) < 0)
 			return ccSerializableObject::ReadError();
 
+		//array encoding (dataVersion>=41)
+		encoding = RAW_ARRAY;
+		if (dataVersion >= 41)
+		{
+			if (in.read((char*)&encoding,1) < 0)
+				return ccSerializableObject::ReadError();
+			if (encoding != RAW_ARRAY && encoding != BLOCKS_ARRAY)
+				return ccSerializableObject::CorruptError();
+		}
+
 		return true;
 	}
 };
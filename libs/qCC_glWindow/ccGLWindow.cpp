@@ -67,6 +67,7 @@
 #include <string.h>
 #include <math.h>
 #include <algorithm>
+#include <vector>
 
 //Min and max zoom ratio (relative)
 const float CC_GL_MAX_ZOOM_RATIO = 1.0e6f;
@@ -160,6 +161,8 @@ ccGLWindow::ccGLWindow(	QWidget *parent,
 	, m_activeShader(0)
 	, m_shadersEnabled(false)
 	, m_fbo(0)
+	, m_pickingFbo(0)
+	, m_idBufferPickingEnabled(false)
 	, m_alwaysUseFBO(false)
 	, m_updateFBO(true)
 	, m_colorRampShader(0)
@@ -325,6 +328,9 @@ ccGLWindow::~ccGLWindow()
 
 	if (m_fbo)
 		delete m_fbo;
+
+	if (m_pickingFbo)
+		delete m_pickingFbo;
 }
 
 const ccGui::ParamStruct& ccGLWindow::getDisplayParameters() const
@@ -499,6 +505,9 @@ void ccGLWindow::initialize()
 		params.useVBOs = false;
 	}
 
+	//ID buffer picking (requires FBOs only)
+	m_idBufferPickingEnabled = ccFBOUtils::CheckFBOAvailability();
+
 	//Shaders and other OpenGL extensions
 	m_shadersEnabled = ccFBOUtils::CheckShadersAvailability();
 	if (!m_shadersEnabled)
@@ -3421,7 +3430,13 @@ void ccGLWindow::startPicking(PickingParameters& params)
 #ifdef THREADED_GL_WIDGET
 		//FIXME
 #else
-		startOpenGLPicking(params);
+		//clouds and meshes are picked via an ID buffer if possible (fast picking still relies on OpenGL names only)
+		if (	!m_idBufferPickingEnabled
+			||	params.mode == FAST_PICKING
+			||	!startIDBufferPicking(params))
+		{
+			startOpenGLPicking(params);
+		}
 #endif
 	}
 }
@@ -3509,6 +3524,22 @@ void ccGLWindow::processPickingResult(const PickingParameters& params, int selec
 
 void ccGLWindow::startOpenGLPicking(const PickingParameters& params)
 {
+	std::set<int> selectedIDs;
+	int selectedID = -1;
+	int subSelectedID = -1;
+	double selectedDepth = 1.0;
+	pickWithOpenGLNames(params, selectedID, subSelectedID, selectedIDs, selectedDepth);
+
+	//we must always emit a signal!
+	processPickingResult(params, selectedID, subSelectedID, &selectedIDs);
+}
+
+bool ccGLWindow::pickWithOpenGLNames(const PickingParameters& params, int& selectedID, int& subSelectedID, std::set<int>& selectedIDs, double& selectedDepth)
+{
+	selectedID = -1;
+	subSelectedID = -1;
+	selectedDepth = 1.0;
+
 	//OpenGL picking
 	makeCurrent();
 
@@ -3601,14 +3632,10 @@ void ccGLWindow::startOpenGLPicking(const PickingParameters& params)
 	if (hits < 0)
 	{
 		ccLog::Warning("[Picking] Too many items inside picking zone! Try to zoom in...");
-		//we must always emit a signal!
-		processPickingResult(params,-1,-1);
+		return false;
 	}
 
 	//process hits
-	std::set<int> selectedIDs;
-	int subSelectedID = -1;
-	int selectedID = -1;
 	try
 	{
 		GLuint minMinDepth = (~0);
@@ -3650,6 +3677,7 @@ void ccGLWindow::startOpenGLPicking(const PickingParameters& params)
 			&&	selectedID != -1)
 		{
 			selectedIDs.insert(selectedID);
+			selectedDepth = static_cast<double>(minMinDepth) / static_cast<double>(~GLuint(0));
 		}
 	}
 	catch (const std::bad_alloc&)
@@ -3658,8 +3686,211 @@ void ccGLWindow::startOpenGLPicking(const PickingParameters& params)
 		ccLog::Warning("[Picking] Not enough memory!");
 	}
 
+	return true;
+}
+
+bool ccGLWindow::startIDBufferPicking(const PickingParameters& params)
+{
+	if (params.pickWidth <= 0 || params.pickHeight <= 0)
+		return false;
+
+	bool rectPicking = (params.mode == ENTITY_RECT_PICKING);
+
+	//first pass: entities (clouds and meshes) IDs
+	std::set<int> selectedIDs;
+	int selectedID = -1;
+	double selectedDepth = 1.0;
+	if (!renderIDBuffer(params, 0, selectedID, selectedDepth, rectPicking ? &selectedIDs : 0))
+		return false;
+
+	int subSelectedID = -1;
+	if (params.mode == ENTITY_PICKING || rectPicking)
+	{
+		//the other entities (labels, polylines, sensors, 2D objects, etc.) are still picked with OpenGL names
+		PickingParameters namesParams = params;
+		namesParams.flags |= CC_SKIP_ID_BUFFER_ENTITIES;
+
+		std::set<int> namesIDs;
+		int namesID = -1;
+		int namesSubID = -1;
+		double namesDepth = 1.0;
+		if (pickWithOpenGLNames(namesParams, namesID, namesSubID, namesIDs, namesDepth))
+		{
+			if (rectPicking)
+			{
+				try
+				{
+					selectedIDs.insert(namesIDs.begin(),namesIDs.end());
+				}
+				catch (const std::bad_alloc&)
+				{
+					//not enough memory
+					ccLog::Warning("[Picking] Not enough memory!");
+				}
+			}
+			else if (namesID >= 0 && (selectedID < 0 || namesDepth <= selectedDepth))
+			{
+				selectedID = namesID;
+			}
+		}
+	}
+	else if (selectedID >= 0)
+	{
+		//second pass: elements (points or triangles) IDs of the nearest entity
+		int elementID = -1;
+		double elementDepth = 1.0;
+		if (renderIDBuffer(params, static_cast<unsigned>(selectedID), elementID, elementDepth) && elementID > 0)
+			subSelectedID = elementID-1; //IDs start at 1
+		else
+			selectedID = -1;
+	}
+
+	//standard output is made through the 'selectedIDs' set
+	if (!rectPicking && selectedID >= 0)
+		selectedIDs.insert(selectedID);
+
 	//we must always emit a signal!
 	processPickingResult(params, selectedID, subSelectedID, &selectedIDs);
+
+	return true;
+}
+
+bool ccGLWindow::renderIDBuffer(const PickingParameters& params, unsigned entityID, int& nearestID, double& nearestDepth, std::set<int>* allIDs/*=0*/)
+{
+	nearestID = -1;
+	nearestDepth = 1.0;
+
+	makeCurrent();
+
+	//the ID buffer only covers the picking area
+	unsigned w = static_cast<unsigned>(params.pickWidth);
+	unsigned h = static_cast<unsigned>(params.pickHeight);
+	if (!m_pickingFbo || m_pickingFbo->width() != w || m_pickingFbo->height() != h)
+	{
+		if (!m_pickingFbo)
+			m_pickingFbo = new ccFrameBufferObject();
+
+		if (	!m_pickingFbo->init(w,h)
+			||	!m_pickingFbo->initTexture(0,GL_RGBA8,GL_RGBA,GL_UNSIGNED_BYTE,GL_NEAREST)
+			||	!m_pickingFbo->initDepth(GL_CLAMP_TO_BORDER,GL_DEPTH_COMPONENT32,GL_NEAREST,GL_TEXTURE_2D))
+		{
+			ccLog::Warning("[Picking] Failed to initialize the ID buffer! OpenGL names will be used instead");
+			delete m_pickingFbo;
+			m_pickingFbo = 0;
+			m_idBufferPickingEnabled = false;
+			return false;
+		}
+	}
+
+	std::vector<GLubyte> colors;
+	std::vector<GLfloat> depths;
+	try
+	{
+		colors.resize(w*h*4);
+		depths.resize(w*h);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ccLog::Warning("[Picking] Not enough memory!");
+		return false;
+	}
+
+	//get viewport
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT,viewport);
+
+	//get context
+	CC_DRAW_CONTEXT CONTEXT;
+	getContext(CONTEXT);
+	CONTEXT.flags = CC_DRAW_3D | CC_DRAW_ID_BUFFER | params.flags;
+	CONTEXT.idBufferEntityID = entityID;
+
+	m_pickingFbo->start();
+	glViewport(0,0,w,h);
+
+	//IDs must be written 'as is'
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_LIGHTING_BIT | GL_POLYGON_BIT);
+	glDisable(GL_BLEND);
+	glDisable(GL_DITHER);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_FOG);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_POINT_SMOOTH);
+	glDisable(GL_LINE_SMOOTH);
+	glDisable(GL_POLYGON_SMOOTH);
+	glShadeModel(GL_FLAT);
+	glPolygonMode(GL_FRONT_AND_BACK,GL_FILL);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glClearColor(0,0,0,0);
+	glClearDepth(1.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//projection matrix
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	//restrict drawing to the picking area
+	glLoadIdentity();
+	gluPickMatrix(	static_cast<GLdouble>(params.centerX),
+					static_cast<GLdouble>(viewport[3]-params.centerY),
+					static_cast<GLdouble>(params.pickWidth),
+					static_cast<GLdouble>(params.pickHeight),
+					viewport);
+	glMultMatrixd(getProjectionMatd());
+
+	//model view matrix
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadMatrixd(getModelViewMatd());
+
+	//display 3D objects
+	if (m_globalDBRoot)
+		m_globalDBRoot->draw(CONTEXT);
+	if (m_winDBRoot)
+		m_winDBRoot->draw(CONTEXT);
+
+	glReadPixels(0,0,w,h,GL_RGBA,GL_UNSIGNED_BYTE,&(colors[0]));
+	glReadPixels(0,0,w,h,GL_DEPTH_COMPONENT,GL_FLOAT,&(depths[0]));
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+
+	m_pickingFbo->stop();
+	glViewport(viewport[0],viewport[1],viewport[2],viewport[3]);
+
+	ccGLUtils::CatchGLError("ccGLWindow::renderIDBuffer");
+
+	//process the IDs
+	try
+	{
+		for (unsigned i=0; i<w*h; ++i)
+		{
+			unsigned ID = ccGL::DecodeColorID(&(colors[4*i]));
+			if (ID == 0) //background
+				continue;
+
+			if (allIDs)
+				allIDs->insert(static_cast<int>(ID));
+
+			//we keep only the nearest
+			if (nearestID < 0 || depths[i] < nearestDepth)
+			{
+				nearestID = static_cast<int>(ID);
+				nearestDepth = depths[i];
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ccLog::Warning("[Picking] Not enough memory!");
+	}
+
+	return true;
 }
 
 void ccGLWindow::startCPUBasedPointPicking(const PickingParameters& params)
@@ -739,6 +739,7 @@ protected: //methods
 	//! Starts picking process
 	/** OpenGL is used by default (unless ccGui::ParamStruct::useOpenGLPointPicking
 		is false in which case a CPU based approach will be used for point picking).
+		Clouds and meshes are picked via an ID buffer if FBOs are supported.
 		\param params picking parameters
 	**/
 	void startPicking(PickingParameters& params);
@@ -746,6 +747,33 @@ protected: //methods
 	//! Performs the picking with OpenGL
 	void startOpenGLPicking(const PickingParameters& params);
 
+	//! Renders the picking area with OpenGL names (GL_SELECT mode) and processes the hits
+	/** \param params picking parameters
+		\param selectedID nearest picked entity ID (or -1)
+		\param subSelectedID nearest picked element (point or triangle) index (or -1)
+		\param selectedIDs all picked entities IDs (rectangular picking only)
+		\param selectedDepth depth of the nearest hit (between 0 and 1)
+		\return false if too many items are inside the picking zone
+	**/
+	bool pickWithOpenGLNames(const PickingParameters& params, int& selectedID, int& subSelectedID, std::set<int>& selectedIDs, double& selectedDepth);
+
+	//! Performs the picking with an ID buffer
+	/** Clouds and meshes IDs (then points or triangles IDs) are rendered as colors
+		in an offscreen buffer. The other entities are still picked with OpenGL names.
+		\return false if the ID buffer can't be used (nothing has been emitted then)
+	**/
+	bool startIDBufferPicking(const PickingParameters& params);
+
+	//! Renders the IDs in the picking ID buffer and reads them back
+	/** \param params picking parameters
+		\param entityID entity whose elements IDs should be rendered (0 = entities IDs)
+		\param nearestID nearest ID (or -1)
+		\param nearestDepth depth of the nearest ID (between 0 and 1)
+		\param allIDs all the rendered IDs (optional)
+		\return success
+	**/
+	bool renderIDBuffer(const PickingParameters& params, unsigned entityID, int& nearestID, double& nearestDepth, std::set<int>* allIDs = 0);
+
 	//! Starts OpenGL picking process
 	void startCPUBasedPointPicking(const PickingParameters& params);
 
@@ -954,6 +982,10 @@ protected: //members
 
 	//! Currently active FBO (frame buffer object)
 	ccFrameBufferObject* m_fbo;
+	//! FBO used as ID buffer for picking
+	ccFrameBufferObject* m_pickingFbo;
+	//! Whether picking can be done via an ID buffer
+	bool m_idBufferPickingEnabled;
 	//! Whether to always use FBO or only for GL filters
 	bool m_alwaysUseFBO;
 	//! Whether FBO should be updated (or simply displayed as a texture = faster!)
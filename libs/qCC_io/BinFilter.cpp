@@ -21,6 +21,7 @@
 #include <QMessageBox>
 #include <QApplication>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QtConcurrentRun>
 
 //CCLib
@@ -43,6 +44,7 @@
 
 //system
 #include <set>
+#include <map>
 #include <assert.h>
 #include <string.h>
 #if defined(CC_WINDOWS)
@@ -149,11 +151,131 @@ CC_FILE_ERROR _SaveFileV2()
 	return (s_file && s_container ? BinFilter::SaveFileV2(*s_file,s_container) : CC_FERR_BAD_ARGUMENT);
 }
 
+static ccSerializationHelper::Compression s_defaultCompression = ccSerializationHelper::NO_COMPRESSION;
+void BinFilter::SetDefaultCompression(ccSerializationHelper::Compression compression)
+{
+	s_defaultCompression = compression;
+}
+
+ccSerializationHelper::Compression BinFilter::GetDefaultCompression()
+{
+	return s_defaultCompression;
+}
+
+static bool s_incrementalSave = true;
+void BinFilter::SetIncrementalSave(bool state)
+{
+	s_incrementalSave = state;
+}
+
+//! Compressed file saved during this session (incremental save)
+struct SavedFile
+{
+	//! Compressed blocks written in the file
+	ccSerializationHelper::WrittenBlocks blocks;
+	//! File size (to detect external modifications)
+	qint64 fileSize;
+	//! Last modification date (to detect external modifications)
+	QDateTime lastModified;
+};
+//! Compressed files saved during this session (key = absolute filename)
+static std::map<QString, SavedFile> s_savedFiles;
+
 CC_FILE_ERROR BinFilter::saveToFile(ccHObject* root, QString filename, SaveParameters& parameters)
 {
 	if (!root || filename.isNull())
 		return CC_FERR_BAD_ARGUMENT;
 
+	ccSerializationHelper::Compression compression = s_defaultCompression;
+
+	QString absoluteFilename = QFileInfo(filename).absoluteFilePath();
+
+	//incremental save: we look for the blocks written the last time this file was saved
+	QFile previousFile(filename);
+	const ccSerializationHelper::WrittenBlocks* previousBlocks = 0;
+	if (compression != ccSerializationHelper::NO_COMPRESSION && s_incrementalSave)
+	{
+		std::map<QString, SavedFile>::const_iterator it = s_savedFiles.find(absoluteFilename);
+		if (it != s_savedFiles.end())
+		{
+			//the file shouldn't have been modified in the meantime!
+			QFileInfo fi(filename);
+			if (	fi.exists()
+				&&	fi.size() == it->second.fileSize
+				&&	fi.lastModified() == it->second.lastModified
+				&&	previousFile.open(QIODevice::ReadOnly))
+			{
+				previousBlocks = &(it->second.blocks);
+			}
+		}
+	}
+
+	ccSerializationHelper::BeginSaveSession(compression, previousBlocks ? &previousFile : 0, previousBlocks);
+
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	if (previousBlocks)
+	{
+		//we can't overwrite the previous file while we read it
+		QString tempFilename = filename + ".tmp";
+		result = SaveFile(root, tempFilename);
+		previousFile.close();
+
+		if (result == CC_FERR_NO_ERROR)
+		{
+			//the previous version is only removed once the new one is in place
+			QString backupFilename = filename + ".bak";
+			for (int i=1; QFile::exists(backupFilename); ++i)
+				backupFilename = QString("%1.bak%2").arg(filename).arg(i);
+
+			if (!QFile::rename(filename, backupFilename))
+			{
+				ccLog::Warning(QString("[BIN] Failed to replace '%1' by the temporary file '%2'").arg(filename).arg(tempFilename));
+				result = CC_FERR_WRITING;
+			}
+			else if (!QFile::rename(tempFilename, filename))
+			{
+				//restore the previous version
+				QFile::rename(backupFilename, filename);
+				ccLog::Warning(QString("[BIN] Failed to replace '%1' by the temporary file '%2'").arg(filename).arg(tempFilename));
+				result = CC_FERR_WRITING;
+			}
+			else
+			{
+				QFile::remove(backupFilename);
+			}
+		}
+		else
+		{
+			QFile::remove(tempFilename);
+		}
+	}
+	else
+	{
+		result = SaveFile(root, filename);
+	}
+
+	ccSerializationHelper::WrittenBlocks writtenBlocks;
+	ccSerializationHelper::EndSaveSession(&writtenBlocks);
+
+	//remember the written blocks (for the next incremental save)
+	if (result == CC_FERR_NO_ERROR && compression != ccSerializationHelper::NO_COMPRESSION && s_incrementalSave)
+	{
+		QFileInfo fi(filename);
+		SavedFile& savedFile = s_savedFiles[absoluteFilename];
+		savedFile.blocks.swap(writtenBlocks);
+		savedFile.fileSize = fi.size();
+		savedFile.lastModified = fi.lastModified();
+	}
+	else
+	{
+		s_savedFiles.erase(absoluteFilename);
+	}
+
+	return result;
+}
+
+CC_FILE_ERROR BinFilter::SaveFile(ccHObject* root, QString filename)
+{
 	QFile out(filename);
 	if (!out.open(QIODevice::WriteOnly))
 		return CC_FERR_WRITING;
@@ -20,6 +20,9 @@
 
 #include "FileIOFilter.h"
 
+//qCC_db
+#include <ccSerializableObject.h>
+
 //Qt
 #include <QFile>
 
@@ -32,6 +35,16 @@ public:
 	static inline QString GetFileFilter() { return "CloudCompare entities (*.bin)"; }
 	static inline QString GetDefaultExtension() { return "bin"; }
 
+	//! Sets the default arrays compression
+	static void SetDefaultCompression(ccSerializationHelper::Compression compression);
+	//! Returns the default arrays compression
+	static ccSerializationHelper::Compression GetDefaultCompression();
+	//! Sets whether files saved again (with compression) should reuse their unmodified blocks
+	/** The compressed blocks of the unmodified arrays are then copied from the
+		previous version of the file instead of being compressed again.
+	**/
+	static void SetIncrementalSave(bool state);
+
 	//inherited from FileIOFilter
 	virtual bool importSupported() const { return true; }
 	virtual bool exportSupported() const { return true; }
@@ -51,6 +64,11 @@ public:
 	//! new style BIN saving
 	static CC_FILE_ERROR SaveFileV2(QFile& out, ccHObject* object);
 
+protected:
+
+	//! Saves a file (with the current save session parameters)
+	static CC_FILE_ERROR SaveFile(ccHObject* root, QString filename);
+
 };
 
 #endif //CC_BIN_FILTER_HEADER
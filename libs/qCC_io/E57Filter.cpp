@@ -44,10 +44,19 @@
 #include <QMap>
 #include <QUuid>
 #include <QBuffer>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrentMap>
 
 //system
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 
 typedef double colorFieldType;
 //typedef boost::uint16_t colorFieldType;
@@ -132,7 +141,7 @@ void SavePoseInformation(e57::StructureNode& parentNode, e57::ImageFile& imf, co
 }
 
 static unsigned s_absoluteScanIndex = 0;
-static bool s_cancelRequestedByUser = false;
+static QAtomicInt s_cancelRequestedByUser(0);
 
 bool SaveScan(ccPointCloud* cloud, e57::StructureNode& scanNode, e57::ImageFile& imf, e57::VectorNode& data3D, QString& guidStr)
 {
@@ -496,7 +505,7 @@ bool SaveScan(ccPointCloud* cloud, e57::StructureNode& scanNode, e57::ImageFile&
 			if (!nprogress.oneStep())
 			{
 				QApplication::processEvents();
-				s_cancelRequestedByUser = true;
+				s_cancelRequestedByUser.fetchAndStoreOrdered(1);
 				break;
 			}
 		}
@@ -681,7 +690,7 @@ CC_FILE_ERROR E57Filter::saveToFile(ccHObject* entity, QString filename, SavePar
 		//necessary - for example to associate them with images)
 		QMap<ccHObject*,QString> scansGUID;
 		s_absoluteScanIndex = 0;
-		s_cancelRequestedByUser = false;
+		s_cancelRequestedByUser.fetchAndStoreOrdered(0);
 		for (size_t i=0; i<scans.size(); ++i)
 		{
 			ccPointCloud* cloud = scans[i];
@@ -700,7 +709,7 @@ CC_FILE_ERROR E57Filter::saveToFile(ccHObject* entity, QString filename, SavePar
 				break;
 			}
 
-			if (s_cancelRequestedByUser)
+			if (s_cancelRequestedByUser.fetchAndAddOrdered(0) != 0)
 			{
 				result = CC_FERR_CANCELED_BY_USER;
 				break;
@@ -737,7 +746,7 @@ CC_FILE_ERROR E57Filter::saveToFile(ccHObject* entity, QString filename, SavePar
 						++s_absoluteImageIndex;
 						if (!nprogress.oneStep())
 						{
-							s_cancelRequestedByUser = true;
+							s_cancelRequestedByUser.fetchAndStoreOrdered(1);
 							i = scanCount; //double break!
 							result = CC_FERR_CANCELED_BY_USER;
 							break;
@@ -1302,14 +1311,42 @@ bool GetPoseInformation(e57::StructureNode& node, ccGLMatrix& poseMat)
 	return validPoseMat;
 }
 
-static ScalarType s_maxIntensity = 0;
-static ScalarType s_minIntensity = 0;
-
-//for coordinate shift handling
-FileIOFilter::LoadParameters s_loadParameters;
+//! Scan loading context
+/** One per scan, so that several scans can be loaded concurrently.
+**/
+struct ScanLoadingContext
+{
+	//! Default constructor
+	ScanLoadingContext()
+		: scanIndex(0)
+		, loadParameters(0)
+		, hasIntensity(false)
+		, minIntensity(0)
+		, maxIntensity(0)
+		, scan(0)
+	{}
+
+	//! Absolute scan index
+	unsigned scanIndex;
+	//! Loading parameters (for coordinate shift handling)
+	FileIOFilter::LoadParameters* loadParameters;
+	//! Whether the scan has (valid) intensities
+	bool hasIntensity;
+	//! Min intensity
+	ScalarType minIntensity;
+	//! Max intensity
+	ScalarType maxIntensity;
+	//! Loaded scan (output)
+	ccHObject* scan;
+	//! Scan GUID (output)
+	QString guid;
+};
 
-ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=true*/)
+ccHObject* LoadScan(e57::Node& node, ScanLoadingContext& context, bool showProgressBar/*=true*/)
 {
+	assert(context.loadParameters);
+	QString& guidStr = context.guid;
+
 	if (node.type() != e57::E57_STRUCTURE)
 	{
 		ccLog::Warning("[E57Filter] Scan nodes should be STRUCTURES!");
@@ -1592,15 +1629,16 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 	//Read the point data
 	e57::CompressedVectorReader dataReader = points.reader(dbufs);
 
-	//local progress bar
-	ccProgressDialog pdlg(true);
+	//local progress bar (only in the main thread!)
+	ccProgressDialog* pdlg = 0;
 	CCLib::NormalizedProgress* nprogress = 0;
 	if (showProgressBar)
 	{
-		nprogress = new CCLib::NormalizedProgress(&pdlg,static_cast<unsigned>(pointCount)/chunkSize);
-		pdlg.setMethodTitle("Read E57 file");
-		pdlg.setInfo(qPrintable(QString("Scan #%1 - %2 points").arg(s_absoluteScanIndex).arg(pointCount)));
-		pdlg.start();
+		pdlg = new ccProgressDialog(true);
+		nprogress = new CCLib::NormalizedProgress(pdlg,static_cast<unsigned>(pointCount)/chunkSize);
+		pdlg->setMethodTitle("Read E57 file");
+		pdlg->setInfo(qPrintable(QString("Scan #%1 - %2 points").arg(context.scanIndex).arg(pointCount)));
+		pdlg->start();
 		QApplication::processEvents();
 	}
 
@@ -1652,7 +1690,7 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 			//first point: check for 'big' coordinates
 			if (realCount == 0)
 			{
-				if (FileIOFilter::HandleGlobalShift(Pd,Pshift,s_loadParameters))
+				if (FileIOFilter::HandleGlobalShift(Pd,Pshift,*context.loadParameters))
 				{
 					cloud->setGlobalShift(Pshift);
 					ccLog::Warning("[E57Filter::loadFile] Cloud %s has been recentered! Translation: (%.2f,%.2f,%.2f)",qPrintable(guidStr),Pshift.x,Pshift.y,Pshift.z);
@@ -1685,16 +1723,17 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 					intensitySF->setValue(static_cast<unsigned>(realCount),intensity);
 
 					//track max intensity (for proper visualization)
-					if (s_absoluteScanIndex != 0 || realCount != 0)
+					if (context.hasIntensity)
 					{
-						if (s_maxIntensity < intensity)
-							s_maxIntensity = intensity;
-						else if (s_minIntensity > intensity)
-							s_minIntensity = intensity;
+						if (context.maxIntensity < intensity)
+							context.maxIntensity = intensity;
+						else if (context.minIntensity > intensity)
+							context.minIntensity = intensity;
 					}
 					else
 					{
-						s_maxIntensity = s_minIntensity = intensity;
+						context.maxIntensity = context.minIntensity = intensity;
+						context.hasIntensity = true;
 					}
 				}
 				else
@@ -1730,9 +1769,12 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 		if (nprogress && !nprogress->oneStep())
 		{
 			QApplication::processEvents();
-			s_cancelRequestedByUser = true;
+			s_cancelRequestedByUser.fetchAndStoreOrdered(1);
 			break;
 		}
+		//process cancelled (by the user or by another loading thread)
+		if (s_cancelRequestedByUser.fetchAndAddOrdered(0) != 0)
+			break;
 	}
 
 	if (nprogress)
@@ -1740,6 +1782,11 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 		delete nprogress;
 		nprogress = 0;
 	}
+	if (pdlg)
+	{
+		delete pdlg;
+		pdlg = 0;
+	}
 
 	dataReader.close();
 
@@ -2030,10 +2077,121 @@ ccHObject* LoadImage(e57::Node& node, QString& associatedData3DGuid)
 	return imageObj;
 }
 
-CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
+/*** CONCURRENT SCANS LOADING ***/
+
+//! Memory budget for the scans being loaded concurrently (in bytes)
+static qint64 s_concurrentLoadingMemoryBudget = (static_cast<qint64>(2048) << 20); //2 Gb by default
+
+void E57Filter::SetConcurrentLoadingMemoryBudget(unsigned megaBytes)
+{
+	s_concurrentLoadingMemoryBudget = (static_cast<qint64>(megaBytes) << 20);
+}
+
+//! Estimates the memory required to load a given scan (in bytes)
+static qint64 EstimateScanMemory(e57::Node& node)
+{
+	if (node.type() != e57::E57_STRUCTURE)
+		return 0;
+	e57::StructureNode scanNode(node);
+	if (!scanNode.isDefined("points"))
+		return 0;
+
+	e57::CompressedVectorNode points(scanNode.get("points"));
+	qint64 pointCount = static_cast<qint64>(points.childCount());
+	qint64 fieldCount = static_cast<qint64>(e57::StructureNode(points.prototype()).childCount());
+
+	//coordinates + (roughly) one scalar value per additional field
+	qint64 bytesPerPoint = 3 * static_cast<qint64>(sizeof(PointCoordinateType)) + std::max<qint64>(fieldCount-3,0) * static_cast<qint64>(sizeof(ScalarType));
+	//+ the temporary buffers (see 'TempArrays')
+	qint64 bufferSize = std::min<qint64>(pointCount,(1 << 20)) * fieldCount * static_cast<qint64>(sizeof(double));
+
+	return pointCount * bytesPerPoint + bufferSize;
+}
+
+//! Scans loader (one per thread, each with its own file handle)
+struct ScansLoader_MT
+{
+	ScansLoader_MT() : imf(0) {}
+	e57::ImageFile* imf;
+};
+
+static std::vector<ScanLoadingContext>* s_scanContexts_MT = 0;
+static QAtomicInt s_nextScanIndex_MT(0);
+static QAtomicInt s_loadedScanCount_MT(0);
+static QAtomicInt s_libE57Error_MT(0);
+
+//memory budget handling
+static QMutex s_memoryBudgetMutex;
+static QWaitCondition s_memoryBudgetCondition;
+static qint64 s_memoryInFlight_MT = 0;
+static unsigned s_scansInFlight_MT = 0;
+
+static void AcquireMemoryBudget(qint64 memory)
+{
+	QMutexLocker locker(&s_memoryBudgetMutex);
+	//at least one scan can always be loaded (even if it exceeds the budget on its own)
+	while (s_scansInFlight_MT != 0 && s_memoryInFlight_MT + memory > s_concurrentLoadingMemoryBudget)
+		s_memoryBudgetCondition.wait(&s_memoryBudgetMutex);
+	s_memoryInFlight_MT += memory;
+	++s_scansInFlight_MT;
+}
+
+static void ReleaseMemoryBudget(qint64 memory)
+{
+	QMutexLocker locker(&s_memoryBudgetMutex);
+	s_memoryInFlight_MT -= memory;
+	--s_scansInFlight_MT;
+	s_memoryBudgetCondition.wakeAll();
+}
+
+static void LoadScans_MT(ScansLoader_MT& loader)
 {
-	s_loadParameters = parameters;
+	assert(loader.imf && s_scanContexts_MT);
+	int scanCount = static_cast<int>(s_scanContexts_MT->size());
+
+	try
+	{
+		e57::VectorNode data3D(loader.imf->root().get("/data3D"));
+
+		while (s_cancelRequestedByUser.fetchAndAddOrdered(0) == 0 && s_libE57Error_MT.fetchAndAddOrdered(0) == 0)
+		{
+			int scanIndex = s_nextScanIndex_MT.fetchAndAddOrdered(1);
+			if (scanIndex >= scanCount)
+				break;
+
+			e57::Node scanNode = data3D.get(scanIndex);
+			ScanLoadingContext& context = s_scanContexts_MT->at(scanIndex);
+
+			qint64 memory = EstimateScanMemory(scanNode);
+			AcquireMemoryBudget(memory);
+			try
+			{
+				context.scan = LoadScan(scanNode,context,false);
+			}
+			catch (...)
+			{
+				ReleaseMemoryBudget(memory);
+				throw;
+			}
+			ReleaseMemoryBudget(memory);
+
+			s_loadedScanCount_MT.fetchAndAddOrdered(1);
+		}
+	}
+	catch(const e57::E57Exception& e)
+	{
+		ccLog::Warning(QString("[E57] LibE57 has thrown an exception: %1").arg(e57::E57Utilities().errorCodeToString(e.errorCode()).c_str()));
+		s_libE57Error_MT.fetchAndStoreOrdered(1);
+	}
+	catch(...)
+	{
+		ccLog::Warning("[E57] LibE57 has thrown an unknown exception!");
+		s_libE57Error_MT.fetchAndStoreOrdered(1);
+	}
+}
 
+CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
+{
 	//Read file from disk
 	e57::ImageFile imf(qPrintable(filename), "r"); //DGM: warning, toStdString doesn't preserve "local" characters
 	if (!imf.isOpen())
@@ -2092,10 +2250,30 @@ CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadPa
 
 			unsigned scanCount = static_cast<unsigned>(data3D.childCount());
 
+			std::vector<ScanLoadingContext> contexts;
+			try
+			{
+				contexts.resize(scanCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return CC_FERR_NOT_ENOUGH_MEMORY;
+			}
+			for (unsigned i=0; i<scanCount; ++i)
+			{
+				contexts[i].scanIndex = i;
+				contexts[i].loadParameters = &parameters;
+			}
+
+			//how many scans can be loaded concurrently
+			unsigned threadCount = 1;
+			if (scanCount > 2 && s_concurrentLoadingMemoryBudget > 0)
+				threadCount = std::min(static_cast<unsigned>(std::max(QThread::idealThreadCount(),1)),scanCount-1);
+
 			//global progress bar
 			ccProgressDialog pdlg(true);
 			CCLib::NormalizedProgress* nprogress = 0;
-			bool showGlobalProgress = (scanCount > 10);
+			bool showGlobalProgress = (scanCount > 10 || threadCount > 1);
 			if (showGlobalProgress)
 			{
 				//Too many scans, will display a global progress bar
@@ -2106,35 +2284,133 @@ CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadPa
 				QApplication::processEvents();
 			}
 			//static states
-			s_absoluteScanIndex = 0;
-			s_cancelRequestedByUser = false;
-			s_minIntensity = s_maxIntensity = 0;
-			for (unsigned i=0; i<scanCount; ++i)
+			s_cancelRequestedByUser.fetchAndStoreOrdered(0);
+
+			//the first scan is always loaded in the main thread
+			//(as the user may be asked how to handle big coordinates)
+			unsigned loadedScanCount = 0;
+			try
+			{
+				for (unsigned i=0; i<scanCount; ++i)
+				{
+					e57::Node scanNode = data3D.get(i);
+					contexts[i].scan = LoadScan(scanNode,contexts[i],!showGlobalProgress);
+					++loadedScanCount;
+
+					if ((nprogress && !nprogress->oneStep()) || s_cancelRequestedByUser.fetchAndAddOrdered(0) != 0)
+						break;
+					if (threadCount > 1)
+						break;
+				}
+			}
+			catch (...)
 			{
-				e57::Node scanNode = data3D.get(i);
-				QString scanGUID;
-				ccHObject* scan = LoadScan(scanNode,scanGUID,!showGlobalProgress);
-				if (scan)
+				//release the already loaded scans
+				for (unsigned i=0; i<loadedScanCount; ++i)
+					delete contexts[i].scan;
+				if (nprogress)
+					delete nprogress;
+				throw;
+			}
+
+			//the other ones are loaded concurrently
+			if (loadedScanCount < scanCount && s_cancelRequestedByUser.fetchAndAddOrdered(0) == 0)
+			{
+				assert(threadCount > 1);
+
+				//they will use the same coordinate shift as the first one (without any dialog)
+				bool shiftEnabled = (parameters.coordinatesShiftEnabled && *parameters.coordinatesShiftEnabled && parameters.coordinatesShift);
+				CCVector3d shift(0,0,0);
+				if (shiftEnabled)
 				{
-					if (scan->getName().isEmpty())
+					shift = *parameters.coordinatesShift;
+				}
+				else
+				{
+					ccGenericPointCloud* firstCloud = ccHObjectCaster::ToGenericPointCloud(contexts.front().scan);
+					if (firstCloud && firstCloud->isShifted())
 					{
-						QString name("Scan ");
-						e57::ustring nodeName = scanNode.elementName();
-						if (nodeName.c_str() != 0 && nodeName.c_str()[0] != 0)
-							name += QString(nodeName.c_str());
-						else
-							name += QString::number(i);
-						scan->setName(name);
+						shift = firstCloud->getGlobalShift();
+						shiftEnabled = true;
+					}
+				}
+
+				LoadParameters concurrentParameters = parameters;
+				concurrentParameters.coordinatesShiftEnabled = &shiftEnabled;
+				concurrentParameters.coordinatesShift = &shift;
+				if (shiftEnabled || parameters.shiftHandlingMode != ccGlobalShiftManager::NO_DIALOG_AUTO_SHIFT)
+					concurrentParameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+				for (unsigned i=loadedScanCount; i<scanCount; ++i)
+					contexts[i].loadParameters = &concurrentParameters;
+
+				//one file handle per thread (libE57 is not thread safe)
+				std::vector<ScansLoader_MT> loaders;
+				for (unsigned t=0; t<threadCount; ++t)
+				{
+					ScansLoader_MT loader;
+					loader.imf = new e57::ImageFile(qPrintable(filename), "r");
+					if (!loader.imf->isOpen())
+					{
+						delete loader.imf;
+						break;
 					}
-					container.addChild(scan);
+					loader.imf->extensionsAdd("nor","http://www.libe57.org/E57_NOR_surface_normals.txt");
+					loaders.push_back(loader);
+				}
+				ccLog::Print(QString("[E57] Loading %1 scans with %2 thread(s)").arg(scanCount-loadedScanCount).arg(loaders.size()));
+
+				//make sure the color scales manager is instantiated in the main thread
+				ccColorScalesManager::GetUniqueInstance();
+
+				//static wrap
+				s_scanContexts_MT = &contexts;
+				s_nextScanIndex_MT.fetchAndStoreOrdered(static_cast<int>(loadedScanCount));
+				s_loadedScanCount_MT.fetchAndStoreOrdered(0);
+				s_libE57Error_MT.fetchAndStoreOrdered(0);
+				s_memoryInFlight_MT = 0;
+				s_scansInFlight_MT = 0;
+
+				QFuture<void> future = QtConcurrent::map(loaders, LoadScans_MT);
+
+				//wait in an event loop, woken up when the scans are loaded or periodically to update the progress
+				QFutureWatcher<void> watcher;
+				QEventLoop loop;
+				QTimer timer;
+				QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+				QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+				watcher.setFuture(future);
+				timer.start(100);
+
+				unsigned lastLoadedCount = 0;
+				while (!future.isFinished())
+				{
+					loop.exec();
 
-					//we also add the scan to the GUID/object map
-					if (!scanGUID.isEmpty())
-						scans.insert(scanGUID,scan);
+					unsigned count = static_cast<unsigned>(s_loadedScanCount_MT.fetchAndAddOrdered(0));
+					if (nprogress && count != lastLoadedCount)
+					{
+						if (!nprogress->steps(count-lastLoadedCount))
+							s_cancelRequestedByUser.fetchAndStoreOrdered(1);
+						lastLoadedCount = count;
+					}
+					if (pdlg.isCancelRequested())
+						s_cancelRequestedByUser.fetchAndStoreOrdered(1);
+				}
+				future.waitForFinished();
+				timer.stop();
+
+				s_scanContexts_MT = 0;
+				for (size_t t=0; t<loaders.size(); ++t)
+				{
+					loaders[t].imf->close();
+					delete loaders[t].imf;
+				}
+				loaders.clear();
+
+				if (s_libE57Error_MT.fetchAndAddOrdered(0) != 0)
+				{
+					result = CC_FERR_THIRD_PARTY_LIB_EXCEPTION;
 				}
-				if ((nprogress && !nprogress->oneStep()) || s_cancelRequestedByUser)
-					break;
-				++s_absoluteScanIndex;
 			}
 
 			if (nprogress)
@@ -2145,6 +2421,50 @@ CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadPa
 				nprogress = 0;
 			}
 
+			//add the scans to the container (in the file order)
+			bool hasIntensity = false;
+			ScalarType minIntensity = 0;
+			ScalarType maxIntensity = 0;
+			for (unsigned i=0; i<scanCount; ++i)
+			{
+				const ScanLoadingContext& context = contexts[i];
+				ccHObject* scan = context.scan;
+				if (!scan)
+					continue;
+
+				if (scan->getName().isEmpty())
+				{
+					QString name("Scan ");
+					e57::ustring nodeName = data3D.get(i).elementName();
+					if (nodeName.c_str() != 0 && nodeName.c_str()[0] != 0)
+						name += QString(nodeName.c_str());
+					else
+						name += QString::number(i);
+					scan->setName(name);
+				}
+				container.addChild(scan);
+
+				//we also add the scan to the GUID/object map
+				if (!context.guid.isEmpty())
+					scans.insert(context.guid,scan);
+
+				//global intensity range
+				if (context.hasIntensity)
+				{
+					if (hasIntensity)
+					{
+						minIntensity = std::min(minIntensity,context.minIntensity);
+						maxIntensity = std::max(maxIntensity,context.maxIntensity);
+					}
+					else
+					{
+						minIntensity = context.minIntensity;
+						maxIntensity = context.maxIntensity;
+						hasIntensity = true;
+					}
+				}
+			}
+
 			//set global max intensity (saturation) for proper display
 			for (unsigned i=0; i<container.getChildrenNumber(); ++i)
 			{
@@ -2154,17 +2474,15 @@ CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadPa
 					ccScalarField* sf = pc->getCurrentDisplayedScalarField();
 					if (sf)
 					{
-						sf->setSaturationStart(s_minIntensity);
-						sf->setSaturationStop(s_maxIntensity);
+						sf->setSaturationStart(minIntensity);
+						sf->setSaturationStop(maxIntensity);
 					}
 				}
 			}
 		}
 
-		parameters = s_loadParameters;
-
 		//Image data?
-		if (!s_cancelRequestedByUser && root.isDefined("/images2D"))
+		if (s_cancelRequestedByUser.fetchAndAddOrdered(0) == 0 && root.isDefined("/images2D"))
 		{
 			e57::Node n = root.get("/images2D"); //E57 standard: "images2D is a vector for storing two dimensional images"
 			if (n.type() != e57::E57_VECTOR)
@@ -2218,7 +2536,7 @@ CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadPa
 
 					if (!nprogress.oneStep())
 					{
-						s_cancelRequestedByUser = true;
+						s_cancelRequestedByUser.fetchAndStoreOrdered(1);
 						break;
 					}
 				}
@@ -2239,7 +2557,7 @@ CC_FILE_ERROR E57Filter::loadFile(QString filename, ccHObject& container, LoadPa
 	imf.close();
 
 	//special case: process has benn cancelled by user
-	if (result == CC_FERR_NO_ERROR && s_cancelRequestedByUser)
+	if (result == CC_FERR_NO_ERROR && s_cancelRequestedByUser.fetchAndAddOrdered(0) != 0)
 	{
 		result = CC_FERR_CANCELED_BY_USER;
 	}
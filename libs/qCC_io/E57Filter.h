@@ -31,6 +31,14 @@ public:
 	static inline QString GetFileFilter() { return "E57 cloud (*.e57)"; }
 	static inline QString GetDefaultExtension() { return "e57"; }
 
+	//! Sets the memory budget for the concurrent loading of scans (in Mb)
+	/** When a file contains several scans, they are decoded concurrently
+		(one reader per scan). This budget bounds the (estimated) memory
+		used by the scans being decoded at the same time. Set it to 0 to
+		load the scans sequentially.
+	**/
+	static void SetConcurrentLoadingMemoryBudget(unsigned megaBytes);
+
 	//inherited from FileIOFilter
 	virtual bool importSupported() const { return true; }
 	virtual bool exportSupported() const { return true; }
@@ -39,9 +39,12 @@
 #include <liblas/factory.hpp>	// liblas::ReaderFactory
 
 //Qt
+#include <QFile>
 #include <QFileInfo>
 #include <QSharedPointer>
 #include <QInputDialog>
+#include <QThread>
+#include <QtConcurrentMap>
 
 //Qt gui
 #include <ui_saveLASFileDlg.h>
@@ -510,48 +513,1825 @@ CC_FILE_ERROR LASFilter::saveToFile(ccHObject* entity, QString filename, SavePar
 
 QSharedPointer<LASOpenDlg> s_lasOpenDlg(0);
 
+void LASFilter::SetLoadFilters(const LASLoadFilters& filters)
+{
+	if (!s_lasOpenDlg)
+		s_lasOpenDlg = QSharedPointer<LASOpenDlg>(new LASOpenDlg());
+	s_lasOpenDlg->setFilters(filters);
+}
+
+LASLoadFilters LASFilter::GetLoadFilters()
+{
+	return s_lasOpenDlg ? s_lasOpenDlg->getFilters() : LASLoadFilters();
+}
+
+bool LASFilter::ReadBoundingBox(QString filename, CCVector3d& bbMin, CCVector3d& bbMax, unsigned* pointCount/*=0*/)
+{
+	std::ifstream ifs;
+	ifs.open(qPrintable(filename), std::ios::in | std::ios::binary);
+	if (ifs.fail())
+		return false;
+
+	try
+	{
+		liblas::Reader reader(liblas::ReaderFactory().CreateWithStream(ifs));
+		liblas::Header const& header = reader.GetHeader();
+
+		bbMin = CCVector3d(header.GetMinX(),header.GetMinY(),header.GetMinZ());
+		bbMax = CCVector3d(header.GetMaxX(),header.GetMaxY(),header.GetMaxZ());
+		if (pointCount)
+			*pointCount = header.GetPointRecordsCount();
+	}
+	catch (...)
+	{
+		ifs.close();
+		return false;
+	}
+
+	ifs.close();
+	return true;
+}
+
 //! LAS 1.4 EVLR record
 struct EVLR
 {
-	unsigned char reserved[2]; // 2 bytes 
-	unsigned char data_type; // 1 byte 
-	unsigned char options; // 1 byte 
-	static const unsigned NAME_MAX_LENGTH = 32;
-	char name[NAME_MAX_LENGTH]; // 32 bytes 
-	unsigned char unused[4]; // 4 bytes 
-	double no_data[3]; // 24 = 3*8 bytes 
-	double min[3]; // 24 = 3*8 bytes 
-	double max[3]; // 24 = 3*8 bytes 
-	double scale[3]; // 24 = 3*8 bytes 
-	double offset[3]; // 24 = 3*8 bytes 
-	static const unsigned DESC_MAX_LENGTH = 32;
-	char description[DESC_MAX_LENGTH]; // 32 bytes 
+	unsigned char reserved[2]; // 2 bytes 
+	unsigned char data_type; // 1 byte 
+	unsigned char options; // 1 byte 
+	static const unsigned NAME_MAX_LENGTH = 32;
+	char name[NAME_MAX_LENGTH]; // 32 bytes 
+	unsigned char unused[4]; // 4 bytes 
+	double no_data[3]; // 24 = 3*8 bytes 
+	double min[3]; // 24 = 3*8 bytes 
+	double max[3]; // 24 = 3*8 bytes 
+	double scale[3]; // 24 = 3*8 bytes 
+	double offset[3]; // 24 = 3*8 bytes 
+	static const unsigned DESC_MAX_LENGTH = 32;
+	char description[DESC_MAX_LENGTH]; // 32 bytes 
+
+	//! Returns the field name
+	QString getName() const
+	{
+		//if the name uses the full record length (32 bytes)
+		//we must add a 0 at the end so as to make a valid string!
+		char tempName[NAME_MAX_LENGTH+1];
+		memcpy(tempName,name,NAME_MAX_LENGTH);
+		tempName[NAME_MAX_LENGTH] = 0;
+		return QString(tempName);
+	}
+
+	//! Returns the field description
+	QString getDescription() const
+	{
+		//if the name uses the full record length (32 bytes)
+		//we must add a 0 at the end so as to make a valid string!
+		char tempDesc[DESC_MAX_LENGTH+1];
+		memcpy(tempDesc,description,DESC_MAX_LENGTH);
+		tempDesc[DESC_MAX_LENGTH] = 0;
+		return QString(tempDesc);
+	}
+}; // total of 192 bytes 
+
+//! Creates the descriptors of the fields to load (as selected in the open dialog)
+/** \param fieldsToLoad output descriptors
+	\param evlrs 'extra bytes' records
+	\param extraBytesOffset offset of the 'extra bytes' in each point record
+	\param extraBytesSize size of the 'extra bytes' in each point record
+**/
+static void CreateFieldsToLoad(	std::vector<LasField::Shared>& fieldsToLoad,
+								const std::vector<EVLR>& evlrs,
+								size_t extraBytesOffset,
+								size_t extraBytesSize)
+{
+	if (s_lasOpenDlg->doLoad(LAS_CLASSIFICATION))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIFICATION,0,0,255))); //unsigned char: between 0 and 255
+	if (s_lasOpenDlg->doLoad(LAS_CLASSIF_VALUE))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_VALUE,0,0,31))); //5 bits: between 0 and 31
+	if (s_lasOpenDlg->doLoad(LAS_CLASSIF_SYNTHETIC))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_SYNTHETIC,0,0,1))); //1 bit: 0 or 1
+	if (s_lasOpenDlg->doLoad(LAS_CLASSIF_KEYPOINT))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_KEYPOINT,0,0,1))); //1 bit: 0 or 1
+	if (s_lasOpenDlg->doLoad(LAS_CLASSIF_WITHHELD))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_WITHHELD,0,0,1))); //1 bit: 0 or 1
+	if (s_lasOpenDlg->doLoad(LAS_INTENSITY))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_INTENSITY,0,0,65535))); //16 bits: between 0 and 65536
+	if (s_lasOpenDlg->doLoad(LAS_TIME))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_TIME,0,0,-1.0))); //8 bytes (double)
+	if (s_lasOpenDlg->doLoad(LAS_RETURN_NUMBER))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_RETURN_NUMBER,1,1,7))); //3 bits: between 1 and 7
+	if (s_lasOpenDlg->doLoad(LAS_NUMBER_OF_RETURNS))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_NUMBER_OF_RETURNS,1,1,7))); //3 bits: between 1 and 7
+	if (s_lasOpenDlg->doLoad(LAS_SCAN_DIRECTION))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_SCAN_DIRECTION,0,0,1))); //1 bit: 0 or 1
+	if (s_lasOpenDlg->doLoad(LAS_FLIGHT_LINE_EDGE))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_FLIGHT_LINE_EDGE,0,0,1))); //1 bit: 0 or 1
+	if (s_lasOpenDlg->doLoad(LAS_SCAN_ANGLE_RANK))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_SCAN_ANGLE_RANK,0,-90,90))); //signed char: between -90 and +90
+	if (s_lasOpenDlg->doLoad(LAS_USER_DATA))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_USER_DATA,0,0,255))); //unsigned char: between 0 and 255
+	if (s_lasOpenDlg->doLoad(LAS_POINT_SOURCE_ID))
+		fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_POINT_SOURCE_ID,0,0,65535))); //16 bits: between 0 and 65536
+
+	//Extra fields
+	if (s_lasOpenDlg->doLoad(LAS_EXTRA))
+	{
+		if (!evlrs.empty() && extraBytesSize != 0)
+		{
+			size_t localOffset = 0;
+			for (size_t i=0; i<evlrs.size(); ++i)
+			{
+				unsigned char data_type = evlrs[i].data_type;
+				//We split the fields with mutliple values in multiple scalar fields!
+				unsigned subFieldCount = 1;
+				if (evlrs[i].data_type > 20)
+				{
+					subFieldCount = 3;
+					data_type -= 20;
+				}
+				else if (evlrs[i].data_type > 10)
+				{
+					subFieldCount = 2;
+					data_type -= 10;
+				}
+
+				for (unsigned j=0; j<subFieldCount; ++j)
+				{
+					size_t dataOffset = extraBytesOffset + localOffset;
+
+					//move forward (and check that the byte count is ok!
+					assert(data_type <= ExtraLasField::EXTRA_DOUBLE);
+					ExtraLasField::Type type = static_cast<ExtraLasField::Type>(data_type);
+					localOffset += ExtraLasField::GetSizeBytes(type);
+
+					if (localOffset <= extraBytesSize)
+					{
+						if (s_lasOpenDlg->doLoadEVLR(i))
+						{
+							QString fieldName(evlrs[i].getName());
+							if (subFieldCount > 1)
+								fieldName += QString(".%1").arg(j+1);
+
+							const unsigned char options = evlrs[i].options;
+
+							//read the first optional informations
+							double defaultVal = 0;
+							double minVal = 0;
+							double maxVal = -1.0;
+							//DGM: the first 3 (no_data, min and max) are a bit
+							//dangerous to use because we don't know if they have
+							//been saved as double values (as Laspy do!) or if
+							//the same type as ExtraLasField::Type is used!
+							if (false)
+							{
+								if (options & 1) //1st bit = no_data_bit
+									defaultVal = evlrs[i].no_data[j];
+								if (options & 2) //2nd bit = min_bit
+									minVal = evlrs[i].min[j];
+								if (options & 4) //3rd bit = max_bit
+									maxVal = evlrs[i].max[j];
+							}
+
+							ExtraLasField* eField = new ExtraLasField(fieldName,type,static_cast<int>(dataOffset),defaultVal,minVal,maxVal);
+
+							//read the other optional information (scale and offset)
+							{
+								if (options & 8) //4th bit = scale_bit
+									eField->scale = evlrs[i].scale[j];
+								if (options & 16) //5th bit = offset_bit
+									eField->offset = evlrs[i].offset[j];
+							}
+							fieldsToLoad.push_back(LasField::Shared(eField));
+						}
+					}
+					else
+					{
+						ccLog::Warning("[LAS] Internal consistency of extra fields is broken! (more values defined that available types...)");
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			//shouldn't happen:
+			assert(false);
+		}
+	}
+}
+
+//! Returns the (scaled) value of an 'extra bytes' field
+static double GetExtraFieldValue(const ExtraLasField* extraField, const uint8_t* v)
+{
+	//we must dynamically extract the value in the right format
+	double value = 0.0;
+	switch(extraField->valType)
+	{
+	case ExtraLasField::EXTRA_UINT8:
+		value = static_cast<double>(*(reinterpret_cast<const uint8_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_INT8:
+		value = static_cast<double>(*(reinterpret_cast<const int8_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_UINT16:
+		value = static_cast<double>(*(reinterpret_cast<const uint16_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_INT16:
+		value = static_cast<double>(*(reinterpret_cast<const int16_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_UINT32:
+		value = static_cast<double>(*(reinterpret_cast<const uint32_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_INT32:
+		value = static_cast<double>(*(reinterpret_cast<const int32_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_UINT64:
+		value = static_cast<double>(*(reinterpret_cast<const uint64_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_INT64:
+		value = static_cast<double>(*(reinterpret_cast<const int64_t*>(v)));
+		break;
+	case ExtraLasField::EXTRA_FLOAT:
+		value = static_cast<double>(*(reinterpret_cast<const float*>(v)));
+		break;
+	case ExtraLasField::EXTRA_DOUBLE:
+		value = static_cast<double>(*(reinterpret_cast<const double*>(v)));
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	return extraField->offset + extraField->scale * value;
+}
+
+//! Finalizes a loaded cloud chunk (scalar fields, name, meta-data) and adds it to the container
+/** The (empty) chunk is deleted otherwise. The fields are released in any case.
+**/
+static void FinalizeLASChunk(	ccPointCloud* loadedCloud,
+								std::vector<LasField::Shared>& fieldsToLoad,
+								bool loadColor,
+								const CCVector3d& lasScale,
+								ccHObject& container)
+{
+	if (loadedCloud->size() == 0)
+	{
+		//empty cloud?!
+		for (size_t i=0; i<fieldsToLoad.size(); ++i)
+		{
+			if (fieldsToLoad[i]->sf)
+			{
+				fieldsToLoad[i]->sf->release();
+				fieldsToLoad[i]->sf = 0;
+			}
+		}
+		fieldsToLoad.clear();
+		delete loadedCloud;
+		return;
+	}
+
+	bool thisChunkHasColors = loadedCloud->hasColors();
+	loadedCloud->showColors(thisChunkHasColors);
+	if (loadColor && !thisChunkHasColors)
+		ccLog::Warning("[LAS FILE] Color field was all black! We ignored it...");
+
+	while (!fieldsToLoad.empty())
+	{
+		LasField::Shared& field = fieldsToLoad.back();
+		if (field && field->sf)
+		{
+			field->sf->computeMinAndMax();
+
+			if (	field->type == LAS_CLASSIFICATION
+				||	field->type == LAS_CLASSIF_VALUE
+				||	field->type == LAS_CLASSIF_SYNTHETIC
+				||	field->type == LAS_CLASSIF_KEYPOINT
+				||	field->type == LAS_CLASSIF_WITHHELD
+				||	field->type == LAS_RETURN_NUMBER
+				||	field->type == LAS_NUMBER_OF_RETURNS)
+			{
+				int cMin = static_cast<int>(field->sf->getMin());
+				int cMax = static_cast<int>(field->sf->getMax());
+				field->sf->setColorRampSteps(std::min<int>(cMax-cMin+1,256));
+				//classifSF->setMinSaturation(cMin);
+			}
+			else if (field->type == LAS_INTENSITY)
+			{
+				field->sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::GREY));
+			}
+
+			int sfIndex = loadedCloud->addScalarField(field->sf);
+			if (!loadedCloud->hasDisplayedScalarField())
+			{
+				loadedCloud->setCurrentDisplayedScalarField(sfIndex);
+				loadedCloud->showSF(!thisChunkHasColors);
+			}
+			field->sf->release();
+			field->sf = 0;
+		}
+		else
+		{
+			ccLog::Warning(QString("[LAS FILE] All '%1' values were the same (%2)! We ignored them...").arg(field->type == LAS_EXTRA ? field->getName() : QString(LAS_FIELD_NAMES[field->type])).arg(field->firstValue));
+		}
+
+		fieldsToLoad.pop_back();
+	}
+
+	//if we have reserved too much memory
+	if (loadedCloud->size() < loadedCloud->capacity())
+		loadedCloud->resize(loadedCloud->size());
+
+	QString chunkName("unnamed - Cloud");
+	unsigned n = container.getChildrenNumber();
+	if (n != 0) //if we have more than one cloud, we append an index
+	{
+		if (n == 1)  //we must also update the first one!
+			container.getChild(0)->setName(chunkName+QString(" #1"));
+		chunkName += QString(" #%1").arg(n+1);
+	}
+	loadedCloud->setName(chunkName);
+
+	loadedCloud->setMetaData(LAS_SCALE_X_META_DATA,QVariant(lasScale.x));
+	loadedCloud->setMetaData(LAS_SCALE_Y_META_DATA,QVariant(lasScale.y));
+	loadedCloud->setMetaData(LAS_SCALE_Z_META_DATA,QVariant(lasScale.z));
+
+	container.addChild(loadedCloud);
+}
+
+/*** Native decoder of the uncompressed LAS point records ***/
+
+//! Standard size of the point records (for each point data format, from 0 to 10)
+static const unsigned LAS_STANDARD_RECORD_SIZES[11] = { 20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67 };
+
+//! Size of the blocks of records read at once by the native decoder
+static const size_t LAS_NATIVE_BLOCK_SIZE = (size_t(64) << 20); //64 Mb
+
+//! Minimum number of records per decoding task
+static const unsigned LAS_NATIVE_MIN_RECORDS_PER_TASK = 4096;
+
+//! Reads a little-endian value from a raw buffer
+template <typename T> static inline T ReadLE(const char* data)
+{
+	T value;
+	memcpy(&value,data,sizeof(T));
+	return value;
+}
+
+//! LAS public header (as read by the native decoder)
+struct LASNativeHeader
+{
+	LASNativeHeader()
+		: versionMajor(1)
+		, versionMinor(0)
+		, pointDataOffset(0)
+		, pointFormat(0)
+		, recordLength(0)
+		, pointCount(0)
+		, scale(1.0,1.0,1.0)
+		, offset(0,0,0)
+		, bbMin(0,0,0)
+		, bbMax(0,0,0)
+	{}
+
+	//! Returns whether the point records use the LAS 1.4 layout (formats 6 to 10)
+	inline bool isExtended() const { return pointFormat >= 6; }
+	//! Returns whether the point records have a GPS time
+	inline bool hasTime() const { return pointFormat != 0 && pointFormat != 2; }
+	//! Returns whether the point records have colors
+	inline bool hasColors() const { return pointFormat == 2 || pointFormat == 3 || pointFormat == 5 || pointFormat == 7 || pointFormat == 8 || pointFormat == 10; }
+	//! Returns the offset of the GPS time in each record
+	inline unsigned timeOffset() const { return isExtended() ? 22 : 20; }
+	//! Returns the offset of the colors in each record
+	inline unsigned colorOffset() const { return isExtended() ? 30 : (pointFormat == 2 ? 20 : 28); }
+	//! Returns the offset of the 'extra bytes' in each record
+	inline unsigned extraBytesOffset() const { return LAS_STANDARD_RECORD_SIZES[pointFormat]; }
+	//! Returns the size of the 'extra bytes' in each record
+	inline unsigned extraBytesSize() const { return recordLength - extraBytesOffset(); }
+
+	unsigned char versionMajor;
+	unsigned char versionMinor;
+	unsigned pointDataOffset;
+	unsigned char pointFormat;
+	unsigned recordLength;
+	unsigned pointCount;
+	CCVector3d scale;
+	CCVector3d offset;
+	CCVector3d bbMin;
+	CCVector3d bbMax;
+	std::vector<EVLR> evlrs;
+};
+
+//! Reads the LAS public header and the VLRs
+/** \return false if the file can't be handled by the native decoder (compressed, unknown format, etc.)
+**/
+static bool ReadNativeLASHeader(QFile& file, LASNativeHeader& header)
+{
+	static const qint64 LAS_14_HEADER_SIZE = 375;
+	static const qint64 LAS_MIN_HEADER_SIZE = 227;
+	static const qint64 VLR_HEADER_SIZE = 54;
+	static const int EB_RECORD_SIZE = 192;
+
+	if (sizeof(EVLR) != EB_RECORD_SIZE)
+		return false;
+
+	char buffer[LAS_14_HEADER_SIZE];
+	memset(buffer,0,LAS_14_HEADER_SIZE);
+	qint64 headerRead = file.read(buffer,LAS_14_HEADER_SIZE);
+	if (headerRead < LAS_MIN_HEADER_SIZE || strncmp(buffer,"LASF",4) != 0)
+		return false;
+
+	header.versionMajor = static_cast<unsigned char>(buffer[24]);
+	header.versionMinor = static_cast<unsigned char>(buffer[25]);
+	unsigned headerSize = ReadLE<quint16>(buffer+94);
+	header.pointDataOffset = ReadLE<quint32>(buffer+96);
+	unsigned vlrCount = ReadLE<quint32>(buffer+100);
+
+	//LASzip sets the 2 upper bits of the point format on compressed files
+	unsigned char pointFormat = static_cast<unsigned char>(buffer[104]);
+	if ((pointFormat & 0xC0) || pointFormat > 10)
+		return false;
+	header.pointFormat = pointFormat;
+	header.recordLength = ReadLE<quint16>(buffer+105);
+	if (header.recordLength < LAS_STANDARD_RECORD_SIZES[pointFormat])
+		return false;
+
+	quint64 pointCount = ReadLE<quint32>(buffer+107);
+	if (	header.versionMajor == 1
+		&&	header.versionMinor >= 4
+		&&	headerSize >= LAS_14_HEADER_SIZE
+		&&	headerRead == LAS_14_HEADER_SIZE)
+	{
+		quint64 extendedCount = ReadLE<quint64>(buffer+247);
+		if (extendedCount != 0)
+			pointCount = extendedCount;
+	}
+	//we don't trust the header blindly
+	if (file.size() < static_cast<qint64>(header.pointDataOffset))
+		return false;
+	pointCount = std::min<quint64>(pointCount, static_cast<quint64>(file.size()-header.pointDataOffset) / header.recordLength);
+	if (pointCount > static_cast<quint64>(static_cast<unsigned>(-1)))
+		return false;
+	header.pointCount = static_cast<unsigned>(pointCount);
+
+	header.scale = CCVector3d(ReadLE<double>(buffer+131), ReadLE<double>(buffer+139), ReadLE<double>(buffer+147));
+	header.offset = CCVector3d(ReadLE<double>(buffer+155), ReadLE<double>(buffer+163), ReadLE<double>(buffer+171));
+	header.bbMax = CCVector3d(ReadLE<double>(buffer+179), ReadLE<double>(buffer+195), ReadLE<double>(buffer+211));
+	header.bbMin = CCVector3d(ReadLE<double>(buffer+187), ReadLE<double>(buffer+203), ReadLE<double>(buffer+219));
+
+	//VLRs (we only need the 'extra bytes' ones)
+	qint64 vlrPos = headerSize;
+	for (unsigned i=0; i<vlrCount; ++i)
+	{
+		char vlrHeader[VLR_HEADER_SIZE];
+		if (!file.seek(vlrPos) || file.read(vlrHeader,VLR_HEADER_SIZE) != VLR_HEADER_SIZE)
+			return false;
+
+		char userId[17];
+		memcpy(userId,vlrHeader+2,16);
+		userId[16] = 0;
+		unsigned recordId = ReadLE<quint16>(vlrHeader+18);
+		int recordLength = ReadLE<quint16>(vlrHeader+20);
+		vlrPos += VLR_HEADER_SIZE + recordLength;
+
+		if (strcmp(userId,"LASF_Spec") == 0 && recordId == 4)
+		{
+			QByteArray vlrData = file.read(recordLength);
+			if (vlrData.size() != recordLength)
+				return false;
+
+			assert((recordLength % EB_RECORD_SIZE) == 0);
+			int count = recordLength / EB_RECORD_SIZE;
+			for (int j=0; j<count; ++j)
+			{
+				EVLR evlr;
+				memcpy(&evlr,vlrData.constData() + j*EB_RECORD_SIZE,EB_RECORD_SIZE);
+				header.evlrs.push_back(evlr);
+				ccLog::PrintDebug(QString("Extra bytes VLR found: %1 (%2)").arg(evlr.getName()).arg(evlr.getDescription()));
+			}
+		}
+	}
+
+	return true;
+}
+
+//! Returns the value of a (standard or extra) field from a raw point record
+static double GetNativeLASFieldValue(const LasField* field, const char* record, const LASNativeHeader& header)
+{
+	//the LAS 1.4 formats (6 to 10) have a different layout of the first bytes
+	bool extended = header.isExtended();
+	unsigned char returnByte = static_cast<unsigned char>(record[14]);
+	unsigned char flagsByte = static_cast<unsigned char>(record[extended ? 15 : 14]);
+	unsigned char classByte = static_cast<unsigned char>(record[extended ? 16 : 15]);
+
+	switch (field->type)
+	{
+	case LAS_INTENSITY:
+		return static_cast<double>(ReadLE<quint16>(record+12));
+	case LAS_RETURN_NUMBER:
+		return static_cast<double>(extended ? (returnByte & 15) : (returnByte & 7));
+	case LAS_NUMBER_OF_RETURNS:
+		return static_cast<double>(extended ? (returnByte >> 4) : ((returnByte >> 3) & 7));
+	case LAS_SCAN_DIRECTION:
+		return static_cast<double>((flagsByte >> 6) & 1);
+	case LAS_FLIGHT_LINE_EDGE:
+		return static_cast<double>((flagsByte >> 7) & 1);
+	case LAS_CLASSIFICATION:
+	case LAS_CLASSIF_VALUE:
+		//the LAS 1.4 formats have a full byte for the class
+		return static_cast<double>(extended ? classByte : (classByte & 31));
+	case LAS_CLASSIF_SYNTHETIC:
+		return static_cast<double>(extended ? (static_cast<unsigned char>(record[15]) & 1) : ((classByte >> 5) & 1));
+	case LAS_CLASSIF_KEYPOINT:
+		return static_cast<double>(extended ? ((static_cast<unsigned char>(record[15]) >> 1) & 1) : ((classByte >> 6) & 1));
+	case LAS_CLASSIF_WITHHELD:
+		return static_cast<double>(extended ? ((static_cast<unsigned char>(record[15]) >> 2) & 1) : ((classByte >> 7) & 1));
+	case LAS_SCAN_ANGLE_RANK:
+		//the LAS 1.4 formats store the angle in 0.006 degree increments
+		return extended ? ReadLE<qint16>(record+18) * 0.006 : static_cast<double>(static_cast<signed char>(record[16]));
+	case LAS_USER_DATA:
+		return static_cast<double>(static_cast<unsigned char>(record[17]));
+	case LAS_POINT_SOURCE_ID:
+		return static_cast<double>(ReadLE<quint16>(record + (extended ? 20 : 18)));
+	case LAS_TIME:
+		return ReadLE<double>(record + header.timeOffset());
+	case LAS_EXTRA:
+		{
+			const ExtraLasField* extraField = static_cast<const ExtraLasField*>(field);
+			assert(extraField->dataOffset < static_cast<int>(header.recordLength));
+			return GetExtraFieldValue(extraField,reinterpret_cast<const uint8_t*>(record + extraField->dataOffset));
+		}
+	default:
+		assert(false);
+		break;
+	}
+
+	return 0.0;
+}
+
+//! Returns whether a raw point record is accepted by the load filters
+static bool AcceptNativeLASRecord(const char* record, unsigned recordIndex, const LASNativeHeader& header, const LASLoadFilters& filters)
+{
+	if (!filters.acceptsRecordIndex(recordIndex))
+		return false;
+
+	bool extended = header.isExtended();
+
+	if (filters.useClassifications)
+	{
+		unsigned char classByte = static_cast<unsigned char>(record[extended ? 16 : 15]);
+		if (!filters.acceptsClassification(extended ? classByte : (classByte & 31)))
+			return false;
+	}
+
+	if (filters.returnFilter != LASLoadFilters::ALL_RETURNS)
+	{
+		unsigned char returnByte = static_cast<unsigned char>(record[14]);
+		unsigned returnIndex = extended ? (returnByte & 15) : (returnByte & 7);
+		unsigned numberOfReturns = extended ? (returnByte >> 4) : ((returnByte >> 3) & 7);
+		if (!filters.acceptsReturn(returnIndex,numberOfReturns))
+			return false;
+	}
+
+	if (filters.useBox)
+	{
+		if (!filters.acceptsPosition(	ReadLE<qint32>(record  ) * header.scale.x + header.offset.x,
+										ReadLE<qint32>(record+4) * header.scale.y + header.offset.y,
+										ReadLE<qint32>(record+8) * header.scale.z + header.offset.z ))
+			return false;
+	}
+
+	return true;
+}
+
+//! Block of point records handled by a single task
+struct LASRecordsBlock
+{
+	LASRecordsBlock()
+		: data(0)
+		, recordCount(0)
+		, firstRecord(0)
+		, count(0)
+		, firstIndex(0)
+		, nonBlackColor(false)
+	{}
+
+	//! Raw records
+	const char* data;
+	//! Number of records
+	unsigned recordCount;
+	//! Index of the first record in the file
+	unsigned firstRecord;
+	//! Records accepted by the load filters (relative indexes - only used if filters are enabled)
+	std::vector<unsigned> selection;
+	//! Number of points to decode
+	unsigned count;
+	//! Index of the first decoded point in the destination cloud
+	unsigned firstIndex;
+	//! Whether at least one (masked) color is not black
+	bool nonBlackColor;
+	//! Whether each field has at least one value different from its first value
+	std::vector<char> fieldVaries;
+};
+
+//! Cloud chunk being loaded by the native decoder
+struct LASNativeChunk
+{
+	LASNativeChunk()
+		: cloud(0)
+		, nonBlackColor(false)
+	{}
+
+	//! Destination cloud
+	ccPointCloud* cloud;
+	//! Loaded fields
+	std::vector<LasField::Shared> fields;
+	//! Whether each field has at least one value different from its first value
+	std::vector<char> fieldVaries;
+	//! Whether at least one (masked) color is not black
+	bool nonBlackColor;
+};
+
+static const LASNativeHeader* s_lasHeader_MT = 0;
+static const LASLoadFilters* s_lasFilters_MT = 0;
+static ccPointCloud* s_lasCloud_MT = 0;
+static const std::vector<LasField::Shared>* s_lasFields_MT = 0;
+static CCVector3d s_lasShift_MT(0,0,0);
+static bool s_lasLoadColor_MT = false;
+static unsigned short s_lasColorMask_MT[3] = {0,0,0};
+static unsigned char s_lasColorBitShift_MT = 0;
+
+//! Selects the records of a block accepted by the load filters
+static void SelectLASRecords_MT(LASRecordsBlock& block)
+{
+	const LASNativeHeader& header = *s_lasHeader_MT;
+
+	//the selection has already been reserved (no allocation here)
+	block.selection.clear();
+	const char* record = block.data;
+	for (unsigned i=0; i<block.recordCount; ++i, record += header.recordLength)
+	{
+		if (AcceptNativeLASRecord(record,block.firstRecord+i,header,*s_lasFilters_MT))
+			block.selection.push_back(i);
+	}
+	block.count = static_cast<unsigned>(block.selection.size());
+}
+
+//! Decodes a block of point records straight into the (pre-allocated) cloud and scalar fields
+static void DecodeLASRecords_MT(LASRecordsBlock& block)
+{
+	const LASNativeHeader& header = *s_lasHeader_MT;
+	const std::vector<LasField::Shared>& fields = *s_lasFields_MT;
+	ColorsTableType* colors = s_lasLoadColor_MT ? s_lasCloud_MT->rgbColors() : 0;
+	const unsigned colorOffset = header.colorOffset();
+	const bool selected = !block.selection.empty();
+
+	for (unsigned i=0; i<block.count; ++i)
+	{
+		const char* record = block.data + static_cast<size_t>(selected ? block.selection[i] : i) * header.recordLength;
+		unsigned index = block.firstIndex + i;
+
+		CCVector3* P = const_cast<CCVector3*>(s_lasCloud_MT->getPointPersistentPtr(index));
+		P->x = static_cast<PointCoordinateType>(ReadLE<qint32>(record  ) * header.scale.x + header.offset.x + s_lasShift_MT.x);
+		P->y = static_cast<PointCoordinateType>(ReadLE<qint32>(record+4) * header.scale.y + header.offset.y + s_lasShift_MT.y);
+		P->z = static_cast<PointCoordinateType>(ReadLE<qint32>(record+8) * header.scale.z + header.offset.z + s_lasShift_MT.z);
+
+		if (colors)
+		{
+			//Warning: LAS colors are stored on 16 bits!
+			colorType rgb[3];
+			for (unsigned c=0; c<3; ++c)
+			{
+				unsigned short col = ReadLE<quint16>(record + colorOffset + 2*c) & s_lasColorMask_MT[c];
+				if (col)
+					block.nonBlackColor = true;
+				rgb[c] = static_cast<colorType>(col >> s_lasColorBitShift_MT);
+			}
+			colors->setValue(index,rgb);
+		}
+
+		for (size_t j=0; j<fields.size(); ++j)
+		{
+			const LasField* field = fields[j].data();
+			double value = GetNativeLASFieldValue(field,record,header);
+			if (value != field->firstValue)
+				block.fieldVaries[j] = 1;
+			field->sf->setValue(index,static_cast<ScalarType>(value));
+		}
+	}
+}
+
+//! Gathers the flags of decoded blocks
+static void MergeDecodedLASBlocks(const std::vector<LASRecordsBlock>& blocks, LASNativeChunk& chunk)
+{
+	for (size_t i=0; i<blocks.size(); ++i)
+	{
+		const LASRecordsBlock& block = blocks[i];
+		chunk.nonBlackColor |= block.nonBlackColor;
+		for (size_t j=0; j<chunk.fieldVaries.size(); ++j)
+			chunk.fieldVaries[j] |= block.fieldVaries[j];
+	}
+}
+
+//! Returns whether the colors of the records of a block (to be decoded) use more than 8 bits
+static bool HasLAS16BitsColors(const LASRecordsBlock& block, const LASNativeHeader& header, const unsigned short colorMask[3])
+{
+	const bool selected = !block.selection.empty();
+	for (unsigned i=0; i<block.count; ++i)
+	{
+		const char* color = block.data + static_cast<size_t>(selected ? block.selection[i] : i) * header.recordLength + header.colorOffset();
+		if (	(ReadLE<quint16>(color  ) & colorMask[0] & 0xFF00)
+			||	(ReadLE<quint16>(color+2) & colorMask[1] & 0xFF00)
+			||	(ReadLE<quint16>(color+4) & colorMask[2] & 0xFF00))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//! Creates a new chunk (with the scalar fields to load)
+/** \param chunk output chunk
+	\param header LAS header
+	\param hasExtraBytes whether the 'extra bytes' fields can be loaded
+	\param expectedSize expected number of points (memory is reserved if not 0)
+	\param loadColor whether colors are loaded
+	\param Pshift global shift
+	\param firstRecord first record of the chunk (to track the first value of each field)
+	\return success
+**/
+static bool CreateNativeLASChunk(	LASNativeChunk& chunk,
+									const LASNativeHeader& header,
+									bool hasExtraBytes,
+									unsigned expectedSize,
+									bool loadColor,
+									const CCVector3d& Pshift,
+									const char* firstRecord)
+{
+	chunk.cloud = new ccPointCloud();
+	chunk.cloud->setGlobalShift(Pshift);
+	chunk.nonBlackColor = false;
+	chunk.fields.clear();
+
+	if (expectedSize != 0)
+	{
+		if (!chunk.cloud->reserveThePointsTable(expectedSize))
+		{
+			delete chunk.cloud;
+			chunk.cloud = 0;
+			return false;
+		}
+		if (loadColor && !chunk.cloud->reserveTheRGBTable())
+		{
+			delete chunk.cloud;
+			chunk.cloud = 0;
+			return false;
+		}
+	}
+
+	//the scalar fields are allocated right away (constant ones will be removed afterwards)
+	std::vector<LasField::Shared> requestedFields;
+	CreateFieldsToLoad(requestedFields,header.evlrs,hasExtraBytes ? header.extraBytesOffset() : 0,hasExtraBytes ? header.extraBytesSize() : 0);
+	for (size_t i=0; i<requestedFields.size(); ++i)
+	{
+		LasField::Shared& field = requestedFields[i];
+		field->sf = new ccScalarField(qPrintable(field->getName()));
+		field->sf->link();
+		if (expectedSize == 0 || field->sf->reserve(expectedSize))
+		{
+			//we track the first value of each field (see 'ignoreDefaultFields')
+			field->firstValue = GetNativeLASFieldValue(field.data(),firstRecord,header);
+			chunk.fields.push_back(field);
+		}
+		else
+		{
+			ccLog::Warning(QString("[LAS FILE] Not enough memory: '%1' field will be ignored!").arg(field->getName()));
+			field->sf->release();
+			field->sf = 0;
+		}
+	}
+	chunk.fieldVaries.clear();
+	chunk.fieldVaries.resize(chunk.fields.size(),0);
+
+	return true;
+}
+
+//! Resizes a chunk (cloud, colors and scalar fields)
+static bool ResizeNativeLASChunk(LASNativeChunk& chunk, unsigned newSize, bool loadColor)
+{
+	if (!chunk.cloud->resize(newSize))
+		return false;
+	if (loadColor && !chunk.cloud->hasColors() && !chunk.cloud->resizeTheRGBTable(false))
+		return false;
+	for (size_t j=0; j<chunk.fields.size(); ++j)
+	{
+		if (!chunk.fields[j]->sf->resize(newSize))
+			return false;
+	}
+	return true;
+}
+
+//! Closes a chunk and adds it to the container (see FinalizeLASChunk)
+static void CloseNativeLASChunk(	LASNativeChunk& chunk,
+									bool loadColor,
+									bool ignoreDefaultFields,
+									const CCVector3d& lasScale,
+									ccHObject& container)
+{
+	if (!chunk.cloud)
+		return;
+
+	chunk.cloud->invalidateBoundingBox();
+
+	//we ignore black colors
+	if (loadColor && !chunk.nonBlackColor)
+		chunk.cloud->unallocateColors();
+
+	//and the fields with only default values (if requested)
+	for (size_t j=0; j<chunk.fields.size(); ++j)
+	{
+		LasField::Shared& field = chunk.fields[j];
+		if (	ignoreDefaultFields
+			&&	!chunk.fieldVaries[j]
+			&&	(field->firstValue == field->defaultValue || field->firstValue < field->minValue))
+		{
+			field->sf->release();
+			field->sf = 0;
+		}
+	}
+
+	FinalizeLASChunk(chunk.cloud,chunk.fields,loadColor,lasScale,container);
+
+	chunk.cloud = 0;
+	chunk.fields.clear();
+	chunk.fieldVaries.clear();
+}
+
+CC_FILE_ERROR LASFilter::loadUncompressedFile(QString filename, ccHObject& container, LoadParameters& parameters, bool& handled)
+{
+	handled = false;
+
+#if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN)
+	//the native decoder reads the records as is
+	return CC_FERR_NO_ERROR;
+#endif
+
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly))
+		return CC_FERR_READING; //liblas will report the error
+
+	LASNativeHeader header;
+	if (!ReadNativeLASHeader(file,header))
+		return CC_FERR_NO_ERROR; //compressed or unhandled file: liblas will take care of it
+
+	handled = true;
+	ccLog::Print(QString("[LAS] %1 - version %2.%3 - point format %4").arg(filename).arg(header.versionMajor).arg(header.versionMinor).arg(header.pointFormat));
+
+	if (header.pointCount == 0)
+	{
+		//strange file ;)
+		return CC_FERR_NO_LOAD;
+	}
+
+	//fields present in file
+	std::vector<std::string> dimensions;
+	{
+		for (unsigned i=LAS_X; i<=LAS_POINT_SOURCE_ID; ++i)
+			dimensions.push_back(LAS_FIELD_NAMES[i]);
+		if (header.hasColors())
+		{
+			dimensions.push_back(LAS_FIELD_NAMES[LAS_RED]);
+			dimensions.push_back(LAS_FIELD_NAMES[LAS_GREEN]);
+			dimensions.push_back(LAS_FIELD_NAMES[LAS_BLUE]);
+		}
+		if (header.hasTime())
+			dimensions.push_back(LAS_FIELD_NAMES[LAS_TIME]);
+	}
+	bool hasExtraBytes = (!header.evlrs.empty() && header.extraBytesSize() != 0);
+
+	//dialog to choose the fields to load
+	if (!s_lasOpenDlg)
+		s_lasOpenDlg = QSharedPointer<LASOpenDlg>(new LASOpenDlg());
+	s_lasOpenDlg->setDimensions(dimensions);
+	s_lasOpenDlg->setBoundingBox(header.bbMin,header.bbMax);
+	s_lasOpenDlg->clearEVLRs();
+	if (hasExtraBytes)
+	{
+		for (size_t i=0; i<header.evlrs.size(); ++i)
+		{
+			s_lasOpenDlg->addEVLR(QString("%1 (%2)").arg(header.evlrs[i].getName()).arg(header.evlrs[i].getDescription()));
+		}
+	}
+
+	if (parameters.alwaysDisplayLoadDialog && !s_lasOpenDlg->autoSkipMode() && !s_lasOpenDlg->exec())
+	{
+		return CC_FERR_CANCELED_BY_USER;
+	}
+	bool ignoreDefaultFields = s_lasOpenDlg->ignoreDefaultFieldsCheckBox->isChecked();
+	bool forced8bitRgbMode = s_lasOpenDlg->forced8bitRgbMode();
+
+	//load-time filters
+	LASLoadFilters filters = s_lasOpenDlg->getFilters();
+	bool filtering = filters.isActive();
+	if (filters.rejectsBoundingBox(header.bbMin,header.bbMax))
+	{
+		ccLog::Print("[LAS] The file bounding box doesn't intersect the filtering box: file skipped");
+		return CC_FERR_NO_ERROR;
+	}
+
+	//RGB color
+	unsigned short colorMask[3] = {	static_cast<unsigned short>(s_lasOpenDlg->doLoad(LAS_RED) ? 0xFFFF : 0),
+									static_cast<unsigned short>(s_lasOpenDlg->doLoad(LAS_GREEN) ? 0xFFFF : 0),
+									static_cast<unsigned short>(s_lasOpenDlg->doLoad(LAS_BLUE) ? 0xFFFF : 0) };
+	bool loadColor = header.hasColors() && (colorMask[0] || colorMask[1] || colorMask[2]);
+
+	//global shift (set with the first accepted point)
+	CCVector3d Pshift(0,0,0);
+	bool shiftHandled = false;
+
+	if (!file.seek(header.pointDataOffset))
+		return CC_FERR_READING;
+
+	//reading buffers: the next block is read while the previous one is decoded
+	unsigned recordsPerBlock = std::max<unsigned>(1,static_cast<unsigned>(LAS_NATIVE_BLOCK_SIZE / header.recordLength));
+	recordsPerBlock = std::min(recordsPerBlock,header.pointCount);
+	std::vector<char> buffers[2];
+	try
+	{
+		buffers[0].resize(static_cast<size_t>(recordsPerBlock) * header.recordLength);
+		buffers[1].resize(static_cast<size_t>(recordsPerBlock) * header.recordLength);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	int threadCount = std::max(1,QThread::idealThreadCount());
+	unsigned recordsPerTask = std::max<unsigned>(LAS_NATIVE_MIN_RECORDS_PER_TASK,(recordsPerBlock + 4*threadCount - 1) / (4*threadCount));
+
+	//progress dialog
+	ccProgressDialog pdlg(true); //cancel available
+	CCLib::NormalizedProgress nprogress(&pdlg,header.pointCount);
+	pdlg.setMethodTitle("Open LAS file");
+	pdlg.setInfo(qPrintable(QString("Points: %1").arg(header.pointCount)));
+	pdlg.start();
+
+	s_lasHeader_MT = &header;
+	s_lasFilters_MT = &filters;
+	s_lasShift_MT = Pshift;
+	s_lasColorMask_MT[0] = colorMask[0];
+	s_lasColorMask_MT[1] = colorMask[1];
+	s_lasColorMask_MT[2] = colorMask[2];
+	//by default we read colors as triplets of 8 bits integers but we might dynamically change this
+	//if we encounter values using 16 bits (16 bits is the standard!)
+	s_lasColorBitShift_MT = 0;
+	s_lasLoadColor_MT = loadColor;
+
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	LASNativeChunk chunk;
+	std::vector<LASRecordsBlock> tasks[2];
+	QFuture<void> future;
+	bool pending = false;
+	int current = 0;
+	unsigned recordsRead = 0;
+	unsigned keptCount = 0;
+
+	while (recordsRead < header.pointCount)
+	{
+		unsigned recordCount = std::min(recordsPerBlock,header.pointCount-recordsRead);
+		char* data = &(buffers[current][0]);
+		qint64 byteCount = static_cast<qint64>(recordCount) * header.recordLength;
+		if (file.read(data,byteCount) != byteCount)
+		{
+			ccLog::Warning("[LAS] Failed to read the point records (truncated file?)");
+			result = CC_FERR_READING;
+			break;
+		}
+
+		//split the block in tasks
+		std::vector<LASRecordsBlock>& blocks = tasks[current];
+		try
+		{
+			blocks.clear();
+			for (unsigned first=0; first<recordCount; first+=recordsPerTask)
+			{
+				LASRecordsBlock block;
+				block.data = data + static_cast<size_t>(first) * header.recordLength;
+				block.recordCount = std::min(recordsPerTask,recordCount-first);
+				block.firstRecord = recordsRead + first;
+				block.count = block.recordCount;
+				block.fieldVaries.resize(chunk.fields.size(),0);
+				blocks.push_back(block);
+				if (filtering)
+					blocks.back().selection.reserve(block.recordCount);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			result = CC_FERR_NOT_ENOUGH_MEMORY;
+			break;
+		}
+
+		//the filters are evaluated before anything is decoded (this can overlap the decoding of the previous block)
+		if (filtering)
+			QtConcurrent::blockingMap(blocks,SelectLASRecords_MT);
+
+		unsigned blockKeptCount = 0;
+		for (size_t i=0; i<blocks.size(); ++i)
+			blockKeptCount += blocks[i].count;
+
+		//we test if the color components are on 16 bits (standard) or only on 8 bits (it happens ;)
+		bool switchTo16BitsColors = false;
+		if (loadColor && s_lasColorBitShift_MT == 0 && !forced8bitRgbMode)
+		{
+			for (size_t i=0; i<blocks.size() && !switchTo16BitsColors; ++i)
+				switchTo16BitsColors = HasLAS16BitsColors(blocks[i],header,colorMask);
+		}
+
+		//wait for the previous block to be decoded (the cloud can't be resized while it's being filled)
+		if (pending)
+		{
+			future.waitForFinished();
+			MergeDecodedLASBlocks(tasks[1-current],chunk);
+			pending = false;
+		}
+
+		if (switchTo16BitsColors)
+		{
+			//the color components are on 16 bits!
+			ccLog::Print("[LAS FILE] Color components are coded on 16 bits");
+			s_lasColorBitShift_MT = 8;
+			//we fix all the previously read colors
+			if (chunk.cloud && chunk.cloud->hasColors())
+			{
+				for (unsigned i=0; i<chunk.cloud->size(); ++i)
+					chunk.cloud->setPointColor(i,ccColor::black.rgba); //255 >> 8 = 0!
+			}
+		}
+
+		if (blockKeptCount != 0)
+		{
+			//max cloud size reached: we start a new chunk
+			if (chunk.cloud && chunk.cloud->size() + blockKeptCount > CC_MAX_NUMBER_OF_POINTS_PER_CLOUD)
+			{
+				CloseNativeLASChunk(chunk,loadColor,ignoreDefaultFields,header.scale,container);
+			}
+
+			if (!chunk.cloud)
+			{
+				//first record of the new chunk
+				const char* firstRecord = 0;
+				for (size_t i=0; i<blocks.size() && !firstRecord; ++i)
+				{
+					if (blocks[i].count != 0)
+						firstRecord = blocks[i].data + static_cast<size_t>(filtering ? blocks[i].selection.front() : 0) * header.recordLength;
+				}
+				assert(firstRecord);
+
+				//first (accepted) point: check for 'big' coordinates
+				if (!shiftHandled)
+				{
+					CCVector3d P(	ReadLE<qint32>(firstRecord  ) * header.scale.x + header.offset.x,
+									ReadLE<qint32>(firstRecord+4) * header.scale.y + header.offset.y,
+									ReadLE<qint32>(firstRecord+8) * header.scale.z + header.offset.z );
+					CCVector3d lasShift = -header.offset;
+
+					//backup input global parameters
+					ccGlobalShiftManager::Mode csModeBackup = parameters.shiftHandlingMode;
+					bool useLasShift = false;
+					//set the LAS shift as default shift (if none was provided)
+					if (lasShift.norm2() != 0 && (!parameters.coordinatesShiftEnabled || !*parameters.coordinatesShiftEnabled))
+					{
+						useLasShift = true;
+						Pshift = lasShift;
+						if (	csModeBackup != ccGlobalShiftManager::NO_DIALOG
+							&&	csModeBackup != ccGlobalShiftManager::NO_DIALOG_AUTO_SHIFT)
+						{
+							parameters.shiftHandlingMode = ccGlobalShiftManager::ALWAYS_DISPLAY_DIALOG;
+						}
+					}
+					if (HandleGlobalShift(P,Pshift,parameters,useLasShift))
+					{
+						ccLog::Warning("[LASFilter::loadFile] Cloud has been recentered! Translation: (%.2f,%.2f,%.2f)",Pshift.x,Pshift.y,Pshift.z);
+					}
+
+					//restore previous parameters
+					parameters.shiftHandlingMode = csModeBackup;
+
+					s_lasShift_MT = Pshift;
+					shiftHandled = true;
+				}
+
+				//without filters, we know the final size of the chunk
+				unsigned expectedSize = filtering ? 0 : std::min(header.pointCount-recordsRead,CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+				if (!CreateNativeLASChunk(chunk,header,hasExtraBytes,expectedSize,loadColor,Pshift,firstRecord))
+				{
+					ccLog::Warning("[LASFilter::loadFile] Not enough memory!");
+					result = CC_FERR_NOT_ENOUGH_MEMORY;
+					break;
+				}
+				s_lasCloud_MT = chunk.cloud;
+				s_lasFields_MT = &chunk.fields;
+				for (size_t i=0; i<blocks.size(); ++i)
+					blocks[i].fieldVaries.resize(chunk.fields.size(),0);
+			}
+
+			unsigned firstIndex = chunk.cloud->size();
+			if (!ResizeNativeLASChunk(chunk,firstIndex+blockKeptCount,loadColor))
+			{
+				ccLog::Warning("[LASFilter::loadFile] Not enough memory!");
+				ResizeNativeLASChunk(chunk,firstIndex,loadColor);
+				result = CC_FERR_NOT_ENOUGH_MEMORY;
+				break;
+			}
+			for (size_t i=0; i<blocks.size(); ++i)
+			{
+				blocks[i].firstIndex = firstIndex;
+				firstIndex += blocks[i].count;
+			}
+
+			future = QtConcurrent::map(blocks,DecodeLASRecords_MT);
+			pending = true;
+			current = 1-current;
+			keptCount += blockKeptCount;
+		}
+
+		recordsRead += recordCount;
+		if (!nprogress.steps(recordCount))
+			break; //cancel requested: we keep what we've read
+	}
+
+	if (pending)
+	{
+		future.waitForFinished();
+		MergeDecodedLASBlocks(tasks[1-current],chunk);
+	}
+
+	CloseNativeLASChunk(chunk,loadColor,ignoreDefaultFields,header.scale,container);
+
+	if (filtering)
+		ccLog::Print(QString("[LAS] %1 point(s) out of %2 kept by the load filters").arg(keptCount).arg(recordsRead));
+
+	s_lasHeader_MT = 0;
+	s_lasFilters_MT = 0;
+	s_lasCloud_MT = 0;
+	s_lasFields_MT = 0;
+
+	return result;
+}
+
+/*** Single pass split of uncompressed LAS files into tiles ***/
+
+//! Size of the records buffer of each tile (flushed to the tile file once full)
+static const size_t LAS_TILE_BUFFER_SIZE = (size_t(1) << 20); //1 Mb
+
+//! Writes a little-endian value in a raw buffer
+template <typename T> static inline void WriteLE(char* data, T value)
+{
+	memcpy(data,&value,sizeof(T));
+}
+
+//! Tile of a LAS file being split (see LASFilter::SplitIntoTiles)
+struct LASTileWriter
+{
+	LASTileWriter()
+		: pointCount(0)
+		, fileCreated(false)
+	{
+		memset(pointsByReturn,0,sizeof(pointsByReturn));
+		memset(rawMin,0,sizeof(rawMin));
+		memset(rawMax,0,sizeof(rawMax));
+	}
+
+	//! Adds a point record to the tile (the record is copied as is)
+	void addRecord(const char* record, const LASNativeHeader& header)
+	{
+		buffer.insert(buffer.end(),record,record+header.recordLength);
+
+		for (unsigned d=0; d<3; ++d)
+		{
+			qint32 v = ReadLE<qint32>(record+4*d);
+			if (pointCount == 0 || v < rawMin[d])
+				rawMin[d] = v;
+			if (pointCount == 0 || v > rawMax[d])
+				rawMax[d] = v;
+		}
+
+		unsigned char returnByte = static_cast<unsigned char>(record[14]);
+		unsigned returnNumber = header.isExtended() ? (returnByte & 15) : (returnByte & 7);
+		if (returnNumber != 0)
+			++pointsByReturn[returnNumber-1];
+
+		++pointCount;
+	}
+
+	//! Appends the buffered records to the tile file
+	/** The file is created (with a temporary header) at the first call.
+	**/
+	bool flush(const QByteArray& headerBlock)
+	{
+		if (buffer.empty())
+			return true;
+
+		QFile file(filename);
+		if (!file.open(fileCreated ? QFile::WriteOnly | QFile::Append : QFile::WriteOnly))
+			return false;
+		if (!fileCreated)
+		{
+			if (file.write(headerBlock) != headerBlock.size())
+				return false;
+			fileCreated = true;
+		}
+		if (file.write(&(buffer[0]),static_cast<qint64>(buffer.size())) != static_cast<qint64>(buffer.size()))
+			return false;
+
+		buffer.clear();
+		return true;
+	}
+
+	//! Writes the final header (point counts, bounds, no EVLR) at the beginning of the tile file
+	bool writeHeader(QByteArray headerBlock, const LASNativeHeader& header) const
+	{
+		assert(fileCreated);
+		char* data = headerBlock.data();
+		unsigned headerSize = ReadLE<quint16>(data+94);
+
+		//legacy point counts (null for the LAS 1.4 point formats)
+		quint32 legacyCount = (header.isExtended() || pointCount > 0xFFFFFFFF) ? 0 : static_cast<quint32>(pointCount);
+		WriteLE<quint32>(data+107,legacyCount);
+		for (unsigned r=0; r<5; ++r)
+			WriteLE<quint32>(data+111+4*r,legacyCount != 0 ? static_cast<quint32>(pointsByReturn[r]) : 0);
+
+		//bounds
+		WriteLE<double>(data+179,rawMax[0] * header.scale.x + header.offset.x);
+		WriteLE<double>(data+187,rawMin[0] * header.scale.x + header.offset.x);
+		WriteLE<double>(data+195,rawMax[1] * header.scale.y + header.offset.y);
+		WriteLE<double>(data+203,rawMin[1] * header.scale.y + header.offset.y);
+		WriteLE<double>(data+211,rawMax[2] * header.scale.z + header.offset.z);
+		WriteLE<double>(data+219,rawMin[2] * header.scale.z + header.offset.z);
+
+		//the waveform data packets stored after the points (LAS 1.3+) are not copied
+		if (header.versionMajor == 1 && header.versionMinor >= 3 && headerSize >= 235 && headerBlock.size() >= 235)
+		{
+			if (ReadLE<quint64>(data+227) >= header.pointDataOffset)
+			{
+				WriteLE<quint64>(data+227,0);
+				WriteLE<quint16>(data+6,ReadLE<quint16>(data+6) & ~2); //'internal waveform data' bit
+			}
+		}
+
+		//LAS 1.4: no EVLR and 64 bits point counts
+		if (header.versionMajor == 1 && header.versionMinor >= 4 && headerSize >= 375 && headerBlock.size() >= 375)
+		{
+			WriteLE<quint64>(data+235,0);
+			WriteLE<quint32>(data+243,0);
+			WriteLE<quint64>(data+247,pointCount);
+			for (unsigned r=0; r<15; ++r)
+				WriteLE<quint64>(data+255+8*r,pointsByReturn[r]);
+		}
+
+		QFile file(filename);
+		if (!file.open(QFile::ReadWrite) || !file.seek(0))
+			return false;
+		return (file.write(headerBlock) == headerBlock.size());
+	}
+
+	QString filename;
+	std::vector<char> buffer;
+	quint64 pointCount;
+	quint64 pointsByReturn[15];
+	qint32 rawMin[3];
+	qint32 rawMax[3];
+	bool fileCreated;
+};
+
+CC_FILE_ERROR LASFilter::SplitIntoTiles(	QString filename,
+											const CCVector3d& origin,
+											double tileSizeX,
+											double tileSizeY,
+											unsigned tileCountX,
+											unsigned tileCountY,
+											double halo,
+											const std::vector<QString>& tileFilenames,
+											std::vector<unsigned>& tilePointCounts)
+{
+#if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN)
+	//the records are read and written as is
+	return CC_FERR_NOT_IMPLEMENTED;
+#endif
+
+	size_t tileCount = static_cast<size_t>(tileCountX) * tileCountY;
+	if (tileCount == 0 || tileFilenames.size() != tileCount || tileSizeX <= 0 || tileSizeY <= 0 || halo < 0)
+		return CC_FERR_BAD_ARGUMENT;
+
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly))
+		return CC_FERR_READING;
+
+	LASNativeHeader header;
+	if (!ReadNativeLASHeader(file,header) || header.pointDataOffset < 227)
+		return CC_FERR_WRONG_FILE_TYPE; //compressed or unhandled file
+
+	//the public header and the VLRs are copied in each tile
+	if (!file.seek(0))
+		return CC_FERR_READING;
+	QByteArray headerBlock = file.read(header.pointDataOffset);
+	if (headerBlock.size() != static_cast<int>(header.pointDataOffset) || !file.seek(header.pointDataOffset))
+		return CC_FERR_READING;
+
+	unsigned recordsPerBlock = std::max<unsigned>(1,static_cast<unsigned>(LAS_NATIVE_BLOCK_SIZE / header.recordLength));
+	recordsPerBlock = std::max<unsigned>(1,std::min(recordsPerBlock,header.pointCount));
+	std::vector<char> buffer;
+	std::vector<LASTileWriter> tiles;
+	try
+	{
+		buffer.resize(static_cast<size_t>(recordsPerBlock) * header.recordLength);
+		tiles.resize(tileCount);
+		tilePointCounts.clear();
+		tilePointCounts.resize(tileCount,0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	for (size_t i=0; i<tileCount; ++i)
+		tiles[i].filename = tileFilenames[i];
+
+	//the load filters are applied to the records
+	LASLoadFilters filters = GetLoadFilters();
+
+	//progress dialog
+	ccProgressDialog pdlg(true); //cancel available
+	CCLib::NormalizedProgress nprogress(&pdlg,header.pointCount);
+	pdlg.setMethodTitle("Split LAS file into tiles");
+	pdlg.setInfo(qPrintable(QString("Points: %1 - Tiles: %2").arg(header.pointCount).arg(tileCount)));
+	pdlg.start();
+
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	unsigned recordsRead = 0;
+	try
+	{
+		while (recordsRead < header.pointCount && result == CC_FERR_NO_ERROR)
+		{
+			unsigned recordCount = std::min(recordsPerBlock,header.pointCount-recordsRead);
+			qint64 byteCount = static_cast<qint64>(recordCount) * header.recordLength;
+			if (file.read(&(buffer[0]),byteCount) != byteCount)
+			{
+				ccLog::Warning("[LAS] Failed to read the point records (truncated file?)");
+				result = CC_FERR_READING;
+				break;
+			}
+
+			for (unsigned k=0; k<recordCount; ++k)
+			{
+				const char* record = &(buffer[0]) + static_cast<size_t>(k) * header.recordLength;
+				if (!AcceptNativeLASRecord(record,recordsRead+k,header,filters))
+					continue;
+
+				//the point belongs to the tiles whose box (enlarged by the halo) contains it
+				double x = ReadLE<qint32>(record  ) * header.scale.x + header.offset.x - origin.x;
+				double y = ReadLE<qint32>(record+4) * header.scale.y + header.offset.y - origin.y;
+				double iMin = std::max(0.0,ceil((x - halo) / tileSizeX) - 1);
+				double iMax = std::min(static_cast<double>(tileCountX-1),floor((x + halo) / tileSizeX));
+				double jMin = std::max(0.0,ceil((y - halo) / tileSizeY) - 1);
+				double jMax = std::min(static_cast<double>(tileCountY-1),floor((y + halo) / tileSizeY));
+				if (iMin > iMax || jMin > jMax)
+					continue; //outside of the grid
+
+				for (unsigned j=static_cast<unsigned>(jMin); j<=static_cast<unsigned>(jMax); ++j)
+				{
+					for (unsigned i=static_cast<unsigned>(iMin); i<=static_cast<unsigned>(iMax); ++i)
+					{
+						LASTileWriter& tile = tiles[static_cast<size_t>(j) * tileCountX + i];
+						tile.addRecord(record,header);
+						if (tile.buffer.size() >= LAS_TILE_BUFFER_SIZE && !tile.flush(headerBlock))
+						{
+							ccLog::Warning(QString("[LAS] Failed to write tile file '%1'").arg(tile.filename));
+							result = CC_FERR_WRITING;
+						}
+					}
+				}
+			}
+
+			recordsRead += recordCount;
+			if (!nprogress.steps(recordCount))
+				result = CC_FERR_CANCELED_BY_USER;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		result = CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	//flush the remaining records and write the final headers
+	for (size_t i=0; i<tileCount && result == CC_FERR_NO_ERROR; ++i)
+	{
+		LASTileWriter& tile = tiles[i];
+		if (!tile.flush(headerBlock) || (tile.fileCreated && !tile.writeHeader(headerBlock,header)))
+		{
+			ccLog::Warning(QString("[LAS] Failed to write tile file '%1'").arg(tile.filename));
+			result = CC_FERR_WRITING;
+		}
+		tilePointCounts[i] = static_cast<unsigned>(tile.pointCount);
+	}
+
+	//don't leave incomplete tiles behind
+	if (result != CC_FERR_NO_ERROR)
+	{
+		for (size_t i=0; i<tileCount; ++i)
+		{
+			if (tiles[i].fileCreated)
+				QFile::remove(tiles[i].filename);
+			tilePointCounts[i] = 0;
+		}
+	}
+
+	return result;
+}
+
+/*** Streamed access to uncompressed LAS files (out-of-core processing) ***/
+
+LASStreamedCloud::LASStreamedCloud()
+	: m_pointDataOffset(0)
+	, m_recordLength(0)
+	, m_pointCount(0)
+	, m_scale(1.0,1.0,1.0)
+	, m_offset(0,0,0)
+	, m_shift(0,0,0)
+	, m_blockFirst(0)
+	, m_blockCount(0)
+	, m_next(0)
+	, m_P(0,0,0)
+	, m_bbMin(0,0,0)
+	, m_bbMax(0,0,0)
+	, m_validBB(false)
+	, m_readingFailed(false)
+{
+}
 
-	//! Returns the field name
-	QString getName() const
+CC_FILE_ERROR LASStreamedCloud::open(QString filename, const CCVector3d& shift)
+{
+#if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN)
+	//the records are read as is
+	return CC_FERR_NOT_IMPLEMENTED;
+#endif
+
+	if (m_file.isOpen())
+		m_file.close();
+	m_file.setFileName(filename);
+	if (!m_file.open(QFile::ReadOnly))
+		return CC_FERR_READING;
+
+	LASNativeHeader header;
+	if (!ReadNativeLASHeader(m_file,header))
+		return CC_FERR_WRONG_FILE_TYPE; //compressed or unhandled file
+
+	m_pointDataOffset = header.pointDataOffset;
+	m_recordLength = header.recordLength;
+	m_pointCount = header.pointCount;
+	m_scale = header.scale;
+	m_offset = header.offset;
+	m_shift = shift;
+	m_validBB = false;
+	m_readingFailed = false;
+
+	unsigned recordsPerBlock = std::max<unsigned>(1,static_cast<unsigned>(LAS_NATIVE_BLOCK_SIZE / m_recordLength));
+	recordsPerBlock = std::max<unsigned>(1,std::min(recordsPerBlock,m_pointCount));
+	try
 	{
-		//if the name uses the full record length (32 bytes)
-		//we must add a 0 at the end so as to make a valid string!
-		char tempName[NAME_MAX_LENGTH+1];
-		memcpy(tempName,name,NAME_MAX_LENGTH);
-		tempName[NAME_MAX_LENGTH] = 0;
-		return QString(tempName);
+		m_block.resize(static_cast<size_t>(recordsPerBlock) * m_recordLength);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
 	}
 
-	//! Returns the field description
-	QString getDescription() const
+	placeIteratorAtBegining();
+
+	return CC_FERR_NO_ERROR;
+}
+
+bool LASStreamedCloud::readBlock()
+{
+	m_blockFirst += m_blockCount;
+	m_blockCount = 0;
+	if (m_blockFirst >= m_pointCount)
+		return false;
+
+	unsigned recordsPerBlock = static_cast<unsigned>(m_block.size() / m_recordLength);
+	unsigned recordCount = std::min(recordsPerBlock,m_pointCount-m_blockFirst);
+	qint64 byteCount = static_cast<qint64>(recordCount) * m_recordLength;
+	if (	!m_file.seek(static_cast<qint64>(m_pointDataOffset) + static_cast<qint64>(m_blockFirst) * m_recordLength)
+		||	m_file.read(&(m_block[0]),byteCount) != byteCount)
 	{
-		//if the name uses the full record length (32 bytes)
-		//we must add a 0 at the end so as to make a valid string!
-		char tempDesc[DESC_MAX_LENGTH+1];
-		memcpy(tempDesc,description,DESC_MAX_LENGTH);
-		tempDesc[DESC_MAX_LENGTH] = 0;
-		return QString(tempDesc);
+		ccLog::Warning("[LAS] Failed to read the point records (truncated file?)");
+		m_readingFailed = true;
+		return false;
 	}
-}; // total of 192 bytes 
+
+	m_blockCount = recordCount;
+	return true;
+}
+
+void LASStreamedCloud::placeIteratorAtBegining()
+{
+	m_blockFirst = 0;
+	m_blockCount = 0;
+	m_next = 0;
+}
+
+const CCVector3* LASStreamedCloud::getNextPoint()
+{
+	if (m_next >= m_pointCount || m_block.empty())
+		return 0;
+
+	if (m_next >= m_blockFirst + m_blockCount)
+	{
+		if (!readBlock())
+			return 0;
+	}
+
+	const char* record = &(m_block[0]) + static_cast<size_t>(m_next - m_blockFirst) * m_recordLength;
+	m_P = CCVector3(	static_cast<PointCoordinateType>(ReadLE<qint32>(record  ) * m_scale.x + m_offset.x + m_shift.x),
+						static_cast<PointCoordinateType>(ReadLE<qint32>(record+4) * m_scale.y + m_offset.y + m_shift.y),
+						static_cast<PointCoordinateType>(ReadLE<qint32>(record+8) * m_scale.z + m_offset.z + m_shift.z) );
+	++m_next;
+
+	return &m_P;
+}
+
+void LASStreamedCloud::forEach(genericPointAction& action)
+{
+	//no scalar field: the action gets a dummy value
+	ScalarType value = NAN_VALUE;
+	placeIteratorAtBegining();
+	for (const CCVector3* P = getNextPoint(); P; P = getNextPoint())
+		action(*P,value);
+}
+
+void LASStreamedCloud::getBoundingBox(CCVector3& bbMin, CCVector3& bbMax)
+{
+	if (!m_validBB)
+	{
+		placeIteratorAtBegining();
+		const CCVector3* P = getNextPoint();
+		if (P)
+		{
+			m_bbMin = m_bbMax = *P;
+			for (P = getNextPoint(); P; P = getNextPoint())
+			{
+				m_bbMin.x = std::min(m_bbMin.x,P->x);
+				m_bbMin.y = std::min(m_bbMin.y,P->y);
+				m_bbMin.z = std::min(m_bbMin.z,P->z);
+				m_bbMax.x = std::max(m_bbMax.x,P->x);
+				m_bbMax.y = std::max(m_bbMax.y,P->y);
+				m_bbMax.z = std::max(m_bbMax.z,P->z);
+			}
+		}
+		else
+		{
+			m_bbMin = m_bbMax = CCVector3(0,0,0);
+		}
+		placeIteratorAtBegining();
+		m_validBB = !m_readingFailed;
+	}
+
+	bbMin = m_bbMin;
+	bbMax = m_bbMax;
+}
+
+//! Size of the output buffer of LASExtraFieldWriter (flushed to the file once full)
+static const size_t LAS_EXTRA_FIELD_BUFFER_SIZE = (size_t(16) << 20); //16 Mb
+
+LASExtraFieldWriter::LASExtraFieldWriter()
+	: m_recordLength(0)
+	, m_pointCount(0)
+	, m_written(0)
+	, m_inputBlockCount(0)
+	, m_inputBlockPos(0)
+	, m_error(false)
+{
+}
+
+CC_FILE_ERROR LASExtraFieldWriter::open(QString inputFilename, QString outputFilename, QString fieldName)
+{
+#if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN)
+	//the records are read and written as is
+	return CC_FERR_NOT_IMPLEMENTED;
+#endif
+
+	static const int VLR_HEADER_SIZE = 54;
+	static const int EB_RECORD_SIZE = 192;
+
+	m_inputFile.setFileName(inputFilename);
+	if (!m_inputFile.open(QFile::ReadOnly))
+		return CC_FERR_READING;
+
+	LASNativeHeader header;
+	if (!ReadNativeLASHeader(m_inputFile,header) || header.pointDataOffset < 227)
+		return CC_FERR_WRONG_FILE_TYPE; //compressed or unhandled file
+	m_recordLength = header.recordLength;
+	m_pointCount = header.pointCount;
+	m_written = 0;
+	m_error = false;
+
+	//the existing 'extra bytes' must all be described (the new field is added after them)
+	unsigned describedSize = 0;
+	for (size_t i=0; i<header.evlrs.size(); ++i)
+	{
+		unsigned char dataType = header.evlrs[i].data_type;
+		if (dataType == 0)
+		{
+			describedSize += header.evlrs[i].options; //'undocumented' bytes
+			continue;
+		}
+		unsigned subFieldCount = (dataType > 20 ? 3 : (dataType > 10 ? 2 : 1));
+		ExtraLasField::Type type = static_cast<ExtraLasField::Type>(dataType - 10*(subFieldCount-1));
+		describedSize += subFieldCount * static_cast<unsigned>(ExtraLasField::GetSizeBytes(type));
+	}
+	if (describedSize != header.extraBytesSize())
+	{
+		ccLog::Warning("[LAS] The 'extra bytes' of the input file are not fully described: can't add a new field after them");
+		return CC_FERR_MALFORMED_FILE;
+	}
+
+	//input header and VLRs
+	if (!m_inputFile.seek(0))
+		return CC_FERR_READING;
+	QByteArray headerBlock = m_inputFile.read(header.pointDataOffset);
+	if (headerBlock.size() != static_cast<int>(header.pointDataOffset))
+		return CC_FERR_READING;
+	unsigned headerSize = ReadLE<quint16>(headerBlock.constData()+94);
+	unsigned vlrCount = ReadLE<quint32>(headerBlock.constData()+100);
+
+	//look for the existing 'extra bytes' VLR
+	int vlrPos = static_cast<int>(headerSize);
+	int ebVlrPos = -1;
+	for (unsigned i=0; i<vlrCount; ++i)
+	{
+		if (vlrPos + VLR_HEADER_SIZE > headerBlock.size())
+			return CC_FERR_MALFORMED_FILE;
+		const char* vlrHeader = headerBlock.constData() + vlrPos;
+		char userId[17];
+		memcpy(userId,vlrHeader+2,16);
+		userId[16] = 0;
+		if (strcmp(userId,"LASF_Spec") == 0 && ReadLE<quint16>(vlrHeader+18) == 4)
+			ebVlrPos = vlrPos;
+		vlrPos += VLR_HEADER_SIZE + ReadLE<quint16>(vlrHeader+20);
+	}
+	if (vlrPos > headerBlock.size())
+		return CC_FERR_MALFORMED_FILE;
+
+	//descriptor of the new field (32 bits float)
+	QByteArray descriptor(EB_RECORD_SIZE,0);
+	{
+		EVLR evlr;
+		memset(&evlr,0,sizeof(EVLR));
+		evlr.data_type = static_cast<unsigned char>(ExtraLasField::EXTRA_FLOAT);
+		QByteArray name = fieldName.toLatin1().left(EVLR::NAME_MAX_LENGTH);
+		memcpy(evlr.name,name.constData(),name.size());
+		QByteArray description = QByteArray("Computed out-of-core").left(EVLR::DESC_MAX_LENGTH);
+		memcpy(evlr.description,description.constData(),description.size());
+		memcpy(descriptor.data(),&evlr,EB_RECORD_SIZE);
+	}
+
+	//the descriptor is appended to the existing 'extra bytes' VLR, or in a new one after the last VLR
+	QByteArray outputHeader;
+	if (ebVlrPos >= 0)
+	{
+		int ebVlrEnd = ebVlrPos + VLR_HEADER_SIZE + ReadLE<quint16>(headerBlock.constData()+ebVlrPos+20);
+		if (ReadLE<quint16>(headerBlock.constData()+ebVlrPos+20) + EB_RECORD_SIZE > 0xFFFF)
+			return CC_FERR_MALFORMED_FILE;
+		outputHeader = headerBlock.left(ebVlrEnd) + descriptor + headerBlock.mid(ebVlrEnd);
+		WriteLE<quint16>(outputHeader.data()+ebVlrPos+20,static_cast<quint16>(ReadLE<quint16>(headerBlock.constData()+ebVlrPos+20) + EB_RECORD_SIZE));
+	}
+	else
+	{
+		QByteArray vlrHeader(VLR_HEADER_SIZE,0);
+		memcpy(vlrHeader.data()+2,"LASF_Spec",9);
+		WriteLE<quint16>(vlrHeader.data()+18,4);
+		WriteLE<quint16>(vlrHeader.data()+20,static_cast<quint16>(EB_RECORD_SIZE));
+		memcpy(vlrHeader.data()+22,"Extra bytes",11);
+		outputHeader = headerBlock.left(vlrPos) + vlrHeader + descriptor + headerBlock.mid(vlrPos);
+		WriteLE<quint32>(outputHeader.data()+100,vlrCount+1);
+	}
+	char* data = outputHeader.data();
+	WriteLE<quint32>(data+96,static_cast<quint32>(outputHeader.size())); //point data offset
+	WriteLE<quint16>(data+105,static_cast<quint16>(m_recordLength + sizeof(float))); //record length
+
+	//the waveform data packets stored after the points (LAS 1.3+) are not copied
+	if (header.versionMajor == 1 && header.versionMinor >= 3 && headerSize >= 235)
+	{
+		if (ReadLE<quint64>(data+227) >= header.pointDataOffset)
+		{
+			WriteLE<quint64>(data+227,0);
+			WriteLE<quint16>(data+6,ReadLE<quint16>(data+6) & ~2); //'internal waveform data' bit
+		}
+	}
+	//nor the EVLRs (LAS 1.4)
+	if (header.versionMajor == 1 && header.versionMinor >= 4 && headerSize >= 375)
+	{
+		WriteLE<quint64>(data+235,0);
+		WriteLE<quint32>(data+243,0);
+	}
+
+	if (m_recordLength + sizeof(float) > 0xFFFF)
+		return CC_FERR_MALFORMED_FILE;
+
+	//buffers
+	unsigned recordsPerBlock = std::max<unsigned>(1,static_cast<unsigned>(LAS_NATIVE_BLOCK_SIZE / m_recordLength));
+	recordsPerBlock = std::max<unsigned>(1,std::min(recordsPerBlock,m_pointCount));
+	try
+	{
+		m_inputBlock.resize(static_cast<size_t>(recordsPerBlock) * m_recordLength);
+		m_outputBuffer.reserve(LAS_EXTRA_FIELD_BUFFER_SIZE + m_recordLength + sizeof(float));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	m_inputBlockCount = m_inputBlockPos = 0;
+	if (!m_inputFile.seek(header.pointDataOffset))
+		return CC_FERR_READING;
+
+	m_outputFile.setFileName(outputFilename);
+	if (!m_outputFile.open(QFile::WriteOnly))
+		return CC_FERR_WRITING;
+	if (m_outputFile.write(outputHeader) != outputHeader.size())
+		return CC_FERR_WRITING;
+
+	return CC_FERR_NO_ERROR;
+}
+
+bool LASExtraFieldWriter::addValue(ScalarType value)
+{
+	if (m_error || m_written >= m_pointCount || !m_outputFile.isOpen())
+		return false;
+
+	//next input record
+	if (m_inputBlockPos == m_inputBlockCount)
+	{
+		unsigned recordsPerBlock = static_cast<unsigned>(m_inputBlock.size() / m_recordLength);
+		unsigned recordCount = std::min(recordsPerBlock,m_pointCount-m_written);
+		qint64 byteCount = static_cast<qint64>(recordCount) * m_recordLength;
+		if (m_inputFile.read(&(m_inputBlock[0]),byteCount) != byteCount)
+		{
+			ccLog::Warning("[LAS] Failed to read the point records (truncated file?)");
+			m_error = true;
+			return false;
+		}
+		m_inputBlockCount = recordCount;
+		m_inputBlockPos = 0;
+	}
+	const char* record = &(m_inputBlock[0]) + static_cast<size_t>(m_inputBlockPos) * m_recordLength;
+	++m_inputBlockPos;
+
+	//the record is copied as is, followed by the value
+	char valueBytes[sizeof(float)];
+	WriteLE<float>(valueBytes,static_cast<float>(value));
+	m_outputBuffer.insert(m_outputBuffer.end(),record,record+m_recordLength);
+	m_outputBuffer.insert(m_outputBuffer.end(),valueBytes,valueBytes+sizeof(float));
+	++m_written;
+
+	if (m_outputBuffer.size() >= LAS_EXTRA_FIELD_BUFFER_SIZE)
+		return flush();
+
+	return true;
+}
+
+bool LASExtraFieldWriter::flush()
+{
+	if (!m_outputBuffer.empty())
+	{
+		if (m_outputFile.write(&(m_outputBuffer[0]),static_cast<qint64>(m_outputBuffer.size())) != static_cast<qint64>(m_outputBuffer.size()))
+		{
+			ccLog::Warning(QString("[LAS] Failed to write file '%1'").arg(m_outputFile.fileName()));
+			m_error = true;
+		}
+		m_outputBuffer.clear();
+	}
+	return !m_error;
+}
+
+CC_FILE_ERROR LASExtraFieldWriter::close()
+{
+	bool success = (m_outputFile.isOpen() && flush() && m_written == m_pointCount);
+
+	m_inputFile.close();
+	m_outputFile.close();
+	std::vector<char>().swap(m_inputBlock);
+	std::vector<char>().swap(m_outputBuffer);
+
+	return success ? CC_FERR_NO_ERROR : CC_FERR_WRITING;
+}
 
 CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
 {
+	//uncompressed files are decoded natively (and much faster)
+	{
+		bool handled = false;
+		CC_FILE_ERROR result = loadUncompressedFile(filename,container,parameters,handled);
+		if (handled)
+			return result;
+	}
+
 	//opening file
 	std::ifstream ifs;
 	ifs.open(qPrintable(filename), std::ios::in | std::ios::binary); //DGM: warning, toStdString doesn't preserve "local" characters
@@ -643,6 +2423,8 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		if (!s_lasOpenDlg)
 			s_lasOpenDlg = QSharedPointer<LASOpenDlg>(new LASOpenDlg());
 		s_lasOpenDlg->setDimensions(dimensions);
+		s_lasOpenDlg->setBoundingBox(	CCVector3d(header.GetMinX(),header.GetMinY(),header.GetMinZ()),
+										CCVector3d(header.GetMaxX(),header.GetMaxY(),header.GetMaxZ()) );
 		s_lasOpenDlg->clearEVLRs();
 		if (extraDimension)
 		{
@@ -660,6 +2442,17 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		}
 		bool ignoreDefaultFields = s_lasOpenDlg->ignoreDefaultFieldsCheckBox->isChecked();
 
+		//load-time filters
+		LASLoadFilters filters = s_lasOpenDlg->getFilters();
+		bool filtering = filters.isActive();
+		if (filters.rejectsBoundingBox(	CCVector3d(header.GetMinX(),header.GetMinY(),header.GetMinZ()),
+										CCVector3d(header.GetMaxX(),header.GetMaxY(),header.GetMaxZ()) ))
+		{
+			ccLog::Print("[LAS] The file bounding box doesn't intersect the filtering box: file skipped");
+			ifs.close();
+			return CC_FERR_NO_ERROR;
+		}
+
 		//RGB color
 		liblas::Color rgbColorMask; //(0,0,0) on construction
 		if (s_lasOpenDlg->doLoad(LAS_RED))
@@ -679,6 +2472,8 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 
 		//number of points read from the begining of the current cloud part
 		unsigned pointsRead = 0;
+		//number of records read from the file (see 'filters')
+		unsigned recordIndex = 0;
 		CCVector3d Pshift(0,0,0);
 
 		//by default we read colors as triplets of 8 bits integers but we might dynamically change this
@@ -708,86 +2503,24 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				break;
 			}
 
+			//rejected points are simply skipped
+			if (newPointAvailable && filtering)
+			{
+				const liblas::Point& p = reader.GetPoint();
+				bool accepted = (	filters.acceptsRecordIndex(recordIndex++)
+								&&	filters.acceptsClassification(p.GetClassification().GetClass())
+								&&	filters.acceptsReturn(p.GetReturnNumber(),p.GetNumberOfReturns())
+								&&	filters.acceptsPosition(p.GetX(),p.GetY(),p.GetZ()) );
+				if (!accepted)
+					continue;
+			}
+
 			if (!newPointAvailable || pointsRead == fileChunkPos+fileChunkSize)
 			{
 				if (loadedCloud)
 				{
-					if (loadedCloud->size())
-					{
-						bool thisChunkHasColors = loadedCloud->hasColors();
-						loadedCloud->showColors(thisChunkHasColors);
-						if (loadColor && !thisChunkHasColors)
-							ccLog::Warning("[LAS FILE] Color field was all black! We ignored it...");
-
-						while (!fieldsToLoad.empty())
-						{
-							LasField::Shared& field = fieldsToLoad.back();
-							if (field && field->sf)
-							{
-								field->sf->computeMinAndMax();
-
-								if (	field->type == LAS_CLASSIFICATION
-									||	field->type == LAS_CLASSIF_VALUE
-									||	field->type == LAS_CLASSIF_SYNTHETIC
-									||	field->type == LAS_CLASSIF_KEYPOINT
-									||	field->type == LAS_CLASSIF_WITHHELD
-									||	field->type == LAS_RETURN_NUMBER
-									||	field->type == LAS_NUMBER_OF_RETURNS)
-								{
-									int cMin = static_cast<int>(field->sf->getMin());
-									int cMax = static_cast<int>(field->sf->getMax());
-									field->sf->setColorRampSteps(std::min<int>(cMax-cMin+1,256));
-									//classifSF->setMinSaturation(cMin);
-								}
-								else if (field->type == LAS_INTENSITY)
-								{
-									field->sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::GREY));
-								}
-
-								int sfIndex = loadedCloud->addScalarField(field->sf);
-								if (!loadedCloud->hasDisplayedScalarField())
-								{
-									loadedCloud->setCurrentDisplayedScalarField(sfIndex);
-									loadedCloud->showSF(!thisChunkHasColors);
-								}
-								field->sf->release();
-								field->sf = 0;
-							}
-							else
-							{
-								ccLog::Warning(QString("[LAS FILE] All '%1' values were the same (%2)! We ignored them...").arg(field->type == LAS_EXTRA ? field->getName() : QString(LAS_FIELD_NAMES[field->type])).arg(field->firstValue));
-							}
-
-							fieldsToLoad.pop_back();
-						}
-
-						//if we have reserved too much memory
-						if (loadedCloud->size() < loadedCloud->capacity())
-							loadedCloud->resize(loadedCloud->size());
-
-						QString chunkName("unnamed - Cloud");
-						unsigned n = container.getChildrenNumber();
-						if (n != 0) //if we have more than one cloud, we append an index
-						{
-							if (n == 1)  //we must also update the first one!
-								container.getChild(0)->setName(chunkName+QString(" #1"));
-							chunkName += QString(" #%1").arg(n+1);
-						}
-						loadedCloud->setName(chunkName);
-
-						loadedCloud->setMetaData(LAS_SCALE_X_META_DATA,QVariant(lasScale.x));
-						loadedCloud->setMetaData(LAS_SCALE_Y_META_DATA,QVariant(lasScale.y));
-						loadedCloud->setMetaData(LAS_SCALE_Z_META_DATA,QVariant(lasScale.z));
-
-						container.addChild(loadedCloud);
-						loadedCloud = 0;
-					}
-					else
-					{
-						//empty cloud?!
-						delete loadedCloud;
-						loadedCloud = 0;
-					}
+					FinalizeLASChunk(loadedCloud,fieldsToLoad,loadColor,lasScale,container);
+					loadedCloud = 0;
 				}
 
 				if (!newPointAvailable)
@@ -807,122 +2540,7 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				loadedCloud->setGlobalShift(Pshift);
 
 				//DGM: from now on, we only enable scalar fields when we detect a valid value!
-				if (s_lasOpenDlg->doLoad(LAS_CLASSIFICATION))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIFICATION,0,0,255))); //unsigned char: between 0 and 255
-				if (s_lasOpenDlg->doLoad(LAS_CLASSIF_VALUE))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_VALUE,0,0,31))); //5 bits: between 0 and 31
-				if (s_lasOpenDlg->doLoad(LAS_CLASSIF_SYNTHETIC))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_SYNTHETIC,0,0,1))); //1 bit: 0 or 1
-				if (s_lasOpenDlg->doLoad(LAS_CLASSIF_KEYPOINT))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_KEYPOINT,0,0,1))); //1 bit: 0 or 1
-				if (s_lasOpenDlg->doLoad(LAS_CLASSIF_WITHHELD))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_CLASSIF_WITHHELD,0,0,1))); //1 bit: 0 or 1
-				if (s_lasOpenDlg->doLoad(LAS_INTENSITY))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_INTENSITY,0,0,65535))); //16 bits: between 0 and 65536
-				if (s_lasOpenDlg->doLoad(LAS_TIME))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_TIME,0,0,-1.0))); //8 bytes (double)
-				if (s_lasOpenDlg->doLoad(LAS_RETURN_NUMBER))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_RETURN_NUMBER,1,1,7))); //3 bits: between 1 and 7
-				if (s_lasOpenDlg->doLoad(LAS_NUMBER_OF_RETURNS))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_NUMBER_OF_RETURNS,1,1,7))); //3 bits: between 1 and 7
-				if (s_lasOpenDlg->doLoad(LAS_SCAN_DIRECTION))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_SCAN_DIRECTION,0,0,1))); //1 bit: 0 or 1
-				if (s_lasOpenDlg->doLoad(LAS_FLIGHT_LINE_EDGE))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_FLIGHT_LINE_EDGE,0,0,1))); //1 bit: 0 or 1
-				if (s_lasOpenDlg->doLoad(LAS_SCAN_ANGLE_RANK))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_SCAN_ANGLE_RANK,0,-90,90))); //signed char: between -90 and +90
-				if (s_lasOpenDlg->doLoad(LAS_USER_DATA))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_USER_DATA,0,0,255))); //unsigned char: between 0 and 255
-				if (s_lasOpenDlg->doLoad(LAS_POINT_SOURCE_ID))
-					fieldsToLoad.push_back(LasField::Shared(new LasField(LAS_POINT_SOURCE_ID,0,0,65535))); //16 bits: between 0 and 65536
-
-				//Extra fields
-				if (s_lasOpenDlg->doLoad(LAS_EXTRA))
-				{
-					if (extraDimension)
-					{
-						assert(!evlrs.empty());
-						const size_t extraBytesOffset = extraDimension->GetByteOffset();
-						size_t localOffset = 0;
-						for (size_t i=0; i<evlrs.size(); ++i)
-						{
-							unsigned char data_type = evlrs[i].data_type;
-							//We split the fields with mutliple values in multiple scalar fields!
-							unsigned subFieldCount = 1;
-							if (evlrs[i].data_type > 20)
-							{
-								subFieldCount = 3;
-								data_type -= 20;
-							}
-							else if (evlrs[i].data_type > 10)
-							{
-								subFieldCount = 2;
-								data_type -= 10;
-							}
-
-							for (unsigned j=0; j<subFieldCount; ++j)
-							{
-								size_t dataOffset = extraBytesOffset + localOffset;
-
-								//move forward (and check that the byte count is ok!
-								assert(data_type <= ExtraLasField::EXTRA_DOUBLE);
-								ExtraLasField::Type type = static_cast<ExtraLasField::Type>(data_type);
-								localOffset += ExtraLasField::GetSizeBytes(type);
-							
-								if (localOffset <= extraDimension->GetByteSize())
-								{
-									if (s_lasOpenDlg->doLoadEVLR(i))
-									{
-										QString fieldName(evlrs[i].getName());
-										if (subFieldCount > 1)
-											fieldName += QString(".%1").arg(j+1);
-
-										const unsigned char options = evlrs[i].options;
-
-										//read the first optional informations
-										double defaultVal = 0;
-										double minVal = 0;
-										double maxVal = -1.0;
-										//DGM: the first 3 (no_data, min and max) are a bit
-										//dangerous to use because we don't know if they have
-										//been saved as double values (as Laspy do!) or if
-										//the same type as ExtraLasField::Type is used!
-										if (false)
-										{
-											if (options & 1) //1st bit = no_data_bit
-												defaultVal = evlrs[i].no_data[j];
-											if (options & 2) //2nd bit = min_bit
-												minVal = evlrs[i].min[j];
-											if (options & 3) //3rd bit = max_bit
-												maxVal = evlrs[i].max[j];
-										}
-
-										ExtraLasField* eField = new ExtraLasField(fieldName,type,static_cast<int>(dataOffset),defaultVal,minVal,maxVal);
-
-										//read the other optional information (scale and offset)
-										{
-											if (options & 4) //4th bit = scale_bit
-												eField->scale = evlrs[i].scale[j];
-											if (options & 5) //5th bit = offset_bit
-												eField->offset = evlrs[i].offset[j];
-										}
-										fieldsToLoad.push_back(LasField::Shared(eField));
-									}
-								}
-								else
-								{
-									ccLog::Warning("[LAS] Internal consistency of extra fields is broken! (more values defined that available types...)");
-									break;
-								}
-							}
-						}
-					}
-					else
-					{
-						//shouldn't happen:
-						assert(false);
-					}
-				}
+				CreateFieldsToLoad(fieldsToLoad,evlrs,extraDimension ? extraDimension->GetByteOffset() : 0,extraDimension ? extraDimension->GetByteSize() : 0);
 			}
 
 			assert(newPointAvailable);
@@ -1070,44 +2688,7 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 						assert(extraDimension && extraField->dataOffset < static_cast<int>(p.GetData().size()));
 						const uint8_t* v = &(p.GetData()[extraField->dataOffset]);
 
-						switch(extraField->valType)
-						{
-						case ExtraLasField::EXTRA_UINT8:
-							value = static_cast<double>(*(reinterpret_cast<const uint8_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_INT8:
-							value = static_cast<double>(*(reinterpret_cast<const int8_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_UINT16:
-							value = static_cast<double>(*(reinterpret_cast<const uint16_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_INT16:
-							value = static_cast<double>(*(reinterpret_cast<const int16_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_UINT32:
-							value = static_cast<double>(*(reinterpret_cast<const uint32_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_INT32:
-							value = static_cast<double>(*(reinterpret_cast<const int32_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_UINT64:
-							value = static_cast<double>(*(reinterpret_cast<const uint64_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_INT64:
-							value = static_cast<double>(*(reinterpret_cast<const int64_t*>(v)));
-							break;
-						case ExtraLasField::EXTRA_FLOAT:
-							value = static_cast<double>(*(reinterpret_cast<const float*>(v)));
-							break;
-						case ExtraLasField::EXTRA_DOUBLE:
-							value = static_cast<double>(*(reinterpret_cast<const double*>(v)));
-							break;
-						default:
-							assert(false);
-							break;
-						}
-
-						value = extraField->offset + extraField->scale * value;
+						value = GetExtraFieldValue(extraField,v);
 					}
 					break;
 				case LAS_RED:
@@ -1122,13 +2703,14 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 					value = static_cast<double>(p.GetClassification().GetClass() & 31); //5 bits
 					break;
 				case LAS_CLASSIF_SYNTHETIC:
-					value = static_cast<double>(p.GetClassification().GetClass() & 32); //bit #6
+					//GetClass() only returns the 5 class bits
+					value = (p.GetClassification().IsSynthetic() ? 1.0 : 0.0); //bit #6
 					break;
 				case LAS_CLASSIF_KEYPOINT:
-					value = static_cast<double>(p.GetClassification().GetClass() & 64); //bit #7
+					value = (p.GetClassification().IsKeyPoint() ? 1.0 : 0.0); //bit #7
 					break;
 				case LAS_CLASSIF_WITHHELD:
-					value = static_cast<double>(p.GetClassification().GetClass() & 128); //bit #8
+					value = (p.GetClassification().IsWithheld() ? 1.0 : 0.0); //bit #8
 					break;
 				case LAS_INVALID:
 				default:
@@ -1175,6 +2757,9 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 
 			++pointsRead;
 		}
+
+		if (filtering)
+			ccLog::Print(QString("[LAS] %1 point(s) out of %2 kept by the load filters").arg(pointsRead).arg(recordIndex));
 	}
 	catch (const std::out_of_range& or)
 	{
@@ -22,6 +22,19 @@
 
 #ifdef CC_LAS_SUPPORT
 
+//local
+#include "LASLoadFilters.h"
+
+//CCLib
+#include <GenericCloud.h>
+#include <OutOfCoreOctree.h>
+
+//Qt
+#include <QFile>
+
+//system
+#include <vector>
+
 //! ASPRS LAS point cloud file I/O filter
 class QCC_IO_LIB_API LASFilter : public FileIOFilter
 {
@@ -31,6 +44,45 @@ public:
 	static inline QString GetFileFilter() { return "LAS cloud (*.las *.laz)"; }
 	static inline QString GetDefaultExtension() { return "las"; }
 
+	//! Sets the filters applied when loading the next LAS file(s)
+	/** Same as setting them in the loading dialog (e.g. for the command line mode).
+	**/
+	static void SetLoadFilters(const LASLoadFilters& filters);
+	//! Returns the filters applied when loading LAS files
+	static LASLoadFilters GetLoadFilters();
+
+	//! Reads the bounding box of a LAS file (from its header)
+	/** \return false if the file can't be read
+	**/
+	static bool ReadBoundingBox(QString filename, CCVector3d& bbMin, CCVector3d& bbMax, unsigned* pointCount = 0);
+
+	//! Splits an uncompressed LAS file into tiles in a single pass
+	/** The file is read once: each point record accepted by the current load filters
+		(see SetLoadFilters) is copied as is in the file of each tile whose box (enlarged
+		by the halo) contains it. The tile files keep the header and the VLRs of the input
+		file, with their own point counts and bounds (and without the EVLRs). Empty tiles
+		have no file.
+		\param filename input LAS file
+		\param origin min corner of the tiles grid (only X and Y are used)
+		\param tileSizeX tile dimension along X
+		\param tileSizeY tile dimension along Y
+		\param tileCountX number of tiles along X
+		\param tileCountY number of tiles along Y
+		\param halo width of the overlap added around each tile
+		\param tileFilenames output file of each tile (tile (i,j) is at index j * tileCountX + i)
+		\param tilePointCounts output number of points of each tile
+		\return error code (CC_FERR_WRONG_FILE_TYPE for compressed files)
+	**/
+	static CC_FILE_ERROR SplitIntoTiles(	QString filename,
+											const CCVector3d& origin,
+											double tileSizeX,
+											double tileSizeY,
+											unsigned tileCountX,
+											unsigned tileCountY,
+											double halo,
+											const std::vector<QString>& tileFilenames,
+											std::vector<unsigned>& tilePointCounts);
+
 	//inherited from FileIOFilter
 	virtual bool importSupported() const { return true; }
 	virtual bool exportSupported() const { return true; }
@@ -41,6 +93,154 @@ public:
 	virtual bool canLoadExtension(QString upperCaseExt) const;
 	virtual bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const;
 
+protected:
+
+	//! Loads an uncompressed LAS file with the native (multi-threaded) decoder
+	/** Compressed files (LAZ) and unknown point formats are left to liblas.
+		\param filename input filename
+		\param container output container
+		\param parameters loading parameters
+		\param handled whether the file has been handled by the native decoder (otherwise the returned error code is meaningless)
+		\return error code
+	**/
+	CC_FILE_ERROR loadUncompressedFile(QString filename, ccHObject& container, LoadParameters& parameters, bool& handled);
+
+};
+
+//! Streamed (read-only) cloud on an uncompressed LAS file
+/** The points are read by blocks with the cloud global iterator (see placeIteratorAtBegining
+	and getNextPoint), so that the file is never loaded as a whole. Meant for the out-of-core
+	processing of files larger than the memory (see CCLib::OutOfCoreOctree). The load filters
+	are not applied (point i is the i-th record of the file).
+	The coordinates are shifted (P + shift) so as to fit in the cloud coordinates type.
+**/
+class QCC_IO_LIB_API LASStreamedCloud : public CCLib::GenericCloud
+{
+public:
+
+	//! Default constructor
+	LASStreamedCloud();
+
+	//! Opens an uncompressed LAS file
+	/** \param filename input LAS file
+		\param shift shift applied to the points coordinates
+		\return error code (CC_FERR_WRONG_FILE_TYPE for compressed files)
+	**/
+	CC_FILE_ERROR open(QString filename, const CCVector3d& shift);
+
+	//! Returns the shift applied to the points coordinates
+	inline const CCVector3d& getShift() const { return m_shift; }
+
+	//! Returns whether an error occurred while reading the points (file truncated, etc.)
+	inline bool readingFailed() const { return m_readingFailed; }
+
+	//inherited from CCLib::GenericCloud
+	virtual unsigned size() const { return m_pointCount; }
+	virtual void forEach(genericPointAction& action);
+	//! Returns the (shifted) bounding box of the points
+	/** The file is read once to compute it (the header bounds are not trusted).
+	**/
+	virtual void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax);
+	virtual void placeIteratorAtBegining();
+	virtual const CCVector3* getNextPoint();
+	virtual bool enableScalarField() { return false; }
+	virtual bool isScalarFieldEnabled() const { return false; }
+	virtual void setPointScalarValue(unsigned pointIndex, ScalarType value) {}
+	virtual ScalarType getPointScalarValue(unsigned pointIndex) const { return NAN_VALUE; }
+
+protected:
+
+	//! Reads the next block of point records
+	bool readBlock();
+
+	//! Input file
+	QFile m_file;
+	//! Offset of the point records in the file
+	unsigned m_pointDataOffset;
+	//! Size of a point record
+	unsigned m_recordLength;
+	//! Number of points
+	unsigned m_pointCount;
+	//! Coordinates scale
+	CCVector3d m_scale;
+	//! Coordinates offset
+	CCVector3d m_offset;
+	//! Shift applied to the points coordinates
+	CCVector3d m_shift;
+
+	//! Block of point records
+	std::vector<char> m_block;
+	//! Index of the first point of the current block
+	unsigned m_blockFirst;
+	//! Number of points in the current block
+	unsigned m_blockCount;
+	//! Index of the next point
+	unsigned m_next;
+	//! Current point
+	CCVector3 m_P;
+
+	//! Bounding box (see getBoundingBox)
+	CCVector3 m_bbMin, m_bbMax;
+	//! Whether the bounding box has been computed
+	bool m_validBB;
+	//! Whether an error occurred while reading the points
+	bool m_readingFailed;
+};
+
+//! Copies an uncompressed LAS file with an additional 'extra bytes' field
+/** The point records are streamed from the input file and written with the values received
+	by addValue (one per point, in the same order) as a new 32 bits float field. Meant to save
+	the values computed out-of-core without loading the file (see CCLib::OutOfCoreOctree::exportValues).
+	The EVLRs and the waveform data of the input file (if any) are not copied.
+**/
+class QCC_IO_LIB_API LASExtraFieldWriter : public CCLib::OutOfCoreOctree::ValuesOutput
+{
+public:
+
+	//! Default constructor
+	LASExtraFieldWriter();
+
+	//! Opens the input and output files
+	/** \param inputFilename input (uncompressed) LAS file
+		\param outputFilename output LAS file
+		\param fieldName name of the new field
+		\return error code (CC_FERR_WRONG_FILE_TYPE for compressed files)
+	**/
+	CC_FILE_ERROR open(QString inputFilename, QString outputFilename, QString fieldName);
+
+	//! Writes the last records and closes the files
+	/** \return error code (CC_FERR_WRITING if the output file doesn't have a value for each point)
+	**/
+	CC_FILE_ERROR close();
+
+	//inherited from CCLib::OutOfCoreOctree::ValuesOutput
+	virtual bool addValue(ScalarType value);
+
+protected:
+
+	//! Writes the buffered records in the output file
+	bool flush();
+
+	//! Input file
+	QFile m_inputFile;
+	//! Output file
+	QFile m_outputFile;
+	//! Size of an input point record
+	unsigned m_recordLength;
+	//! Number of points
+	unsigned m_pointCount;
+	//! Number of points written
+	unsigned m_written;
+	//! Block of input point records
+	std::vector<char> m_inputBlock;
+	//! Number of records in the input block
+	unsigned m_inputBlockCount;
+	//! Index of the next record in the input block
+	unsigned m_inputBlockPos;
+	//! Output records buffer
+	std::vector<char> m_outputBuffer;
+	//! Whether an error occurred
+	bool m_error;
 };
 
 #endif //CC_LAS_SUPPORT
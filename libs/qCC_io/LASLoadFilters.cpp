@@ -0,0 +1,117 @@
+//##########################################################################
+//#                                                                        #
+//#                            CLOUDCOMPARE                                #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "LASLoadFilters.h"
+
+//Qt
+#include <QRegExp>
+#include <QStringList>
+
+//System
+#include <string.h>
+
+LASLoadFilters::LASLoadFilters()
+	: useBox(false)
+	, useBoxZ(false)
+	, boxMin(0,0,0)
+	, boxMax(0,0,0)
+	, useClassifications(false)
+	, returnFilter(ALL_RETURNS)
+	, returnNumber(1)
+	, decimationStep(1)
+{
+	memset(classifications,0,sizeof(classifications));
+}
+
+bool LASLoadFilters::isActive() const
+{
+	return useBox || useClassifications || returnFilter != ALL_RETURNS || decimationStep > 1;
+}
+
+bool LASLoadFilters::rejectsBoundingBox(const CCVector3d& bbMin, const CCVector3d& bbMax) const
+{
+	if (!useBox)
+		return false;
+
+	return	bbMax.x < boxMin.x || bbMin.x > boxMax.x
+		||	bbMax.y < boxMin.y || bbMin.y > boxMax.y
+		||	(useBoxZ && (bbMax.z < boxMin.z || bbMin.z > boxMax.z));
+}
+
+bool LASLoadFilters::setClassifications(const QString& list)
+{
+	bool values[256];
+	memset(values,0,sizeof(values));
+
+	QStringList tokens = list.split(QRegExp("[,;\\s]+"),QString::SkipEmptyParts);
+	for (int i=0; i<tokens.size(); ++i)
+	{
+		QStringList bounds = tokens[i].split('-');
+		if (bounds.size() > 2)
+			return false;
+
+		bool ok = true;
+		int first = bounds[0].toInt(&ok);
+		if (!ok)
+			return false;
+		int last = first;
+		if (bounds.size() == 2)
+		{
+			last = bounds[1].toInt(&ok);
+			if (!ok)
+				return false;
+		}
+		if (first < 0 || last > 255 || first > last)
+			return false;
+
+		for (int c=first; c<=last; ++c)
+			values[c] = true;
+	}
+
+	memcpy(classifications,values,sizeof(values));
+	useClassifications = !tokens.empty();
+
+	return true;
+}
+
+QString LASLoadFilters::getClassificationsList() const
+{
+	QStringList list;
+	if (useClassifications)
+	{
+		for (int c=0; c<256; )
+		{
+			if (!classifications[c])
+			{
+				++c;
+				continue;
+			}
+
+			//look for the end of the range
+			int last = c;
+			while (last+1 < 256 && classifications[last+1])
+				++last;
+
+			if (last == c)
+				list << QString::number(c);
+			else
+				list << QString("%1-%2").arg(c).arg(last);
+			c = last+1;
+		}
+	}
+	return list.join(",");
+}
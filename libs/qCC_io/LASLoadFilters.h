@@ -0,0 +1,123 @@
+//##########################################################################
+//#                                                                        #
+//#                            CLOUDCOMPARE                                #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_LAS_LOAD_FILTERS_HEADER
+#define CC_LAS_LOAD_FILTERS_HEADER
+
+//local
+#include "qCC_io.h"
+
+//CCLib
+#include <CCGeom.h>
+
+//Qt
+#include <QString>
+
+//! Filters applied to the LAS point records while they are decoded
+/** Rejected points are never added to the loaded cloud(s).
+	Coordinates are expressed in the file coordinate system (i.e. before any global shift).
+**/
+struct QCC_IO_LIB_API LASLoadFilters
+{
+	//! Return number filter
+	enum ReturnFilter {	ALL_RETURNS		= 0,	/**< no filtering **/
+						FIRST_RETURN	= 1,	/**< first return only **/
+						LAST_RETURN		= 2,	/**< last return only (return number == number of returns) **/
+						RETURN_NUMBER	= 3,	/**< specific return number (see LASLoadFilters::returnNumber) **/
+	};
+
+	//! Default constructor (no filtering)
+	LASLoadFilters();
+
+	//! Returns whether at least one filter is enabled
+	bool isActive() const;
+
+	//! Returns whether a bounding box (file coordinates) can't contain any accepted point
+	bool rejectsBoundingBox(const CCVector3d& bbMin, const CCVector3d& bbMax) const;
+
+	//! Returns whether a point (file coordinates) is accepted by the box filter
+	inline bool acceptsPosition(double x, double y, double z) const
+	{
+		return	!useBox
+			||	(	x >= boxMin.x && x <= boxMax.x
+				&&	y >= boxMin.y && y <= boxMax.y
+				&&	(!useBoxZ || (z >= boxMin.z && z <= boxMax.z)) );
+	}
+
+	//! Returns whether a classification value is accepted
+	inline bool acceptsClassification(unsigned char classValue) const
+	{
+		return !useClassifications || classifications[classValue];
+	}
+
+	//! Returns whether a return is accepted
+	inline bool acceptsReturn(unsigned returnIndex, unsigned numberOfReturns) const
+	{
+		switch (returnFilter)
+		{
+		case FIRST_RETURN:
+			return returnIndex == 1;
+		case LAST_RETURN:
+			return returnIndex == numberOfReturns;
+		case RETURN_NUMBER:
+			return returnIndex == returnNumber;
+		default:
+			break;
+		}
+		return true;
+	}
+
+	//! Returns whether a record is accepted by the decimation filter
+	inline bool acceptsRecordIndex(unsigned recordIndex) const
+	{
+		return decimationStep < 2 || (recordIndex % decimationStep) == 0;
+	}
+
+	//! Sets the accepted classification values from a list
+	/** Values are separated by commas or spaces. Ranges are accepted (e.g. "2,3-5 9").
+		An empty list disables the classification filter.
+		\return false if the list is malformed (the filter is left untouched in this case)
+	**/
+	bool setClassifications(const QString& list);
+
+	//! Returns the accepted classification values as a list (see setClassifications)
+	QString getClassificationsList() const;
+
+	//! Whether the box filter is enabled
+	bool useBox;
+	//! Whether the box filter also applies to Z (3D box) or not (2D box)
+	bool useBoxZ;
+	//! Box filter min corner
+	CCVector3d boxMin;
+	//! Box filter max corner
+	CCVector3d boxMax;
+
+	//! Whether the classification filter is enabled
+	bool useClassifications;
+	//! Accepted classification values
+	bool classifications[256];
+
+	//! Return number filter
+	ReturnFilter returnFilter;
+	//! Return number (for RETURN_NUMBER only)
+	unsigned returnNumber;
+
+	//! Decimation step (one record out of 'decimationStep' is kept - 0 or 1 = all records)
+	unsigned decimationStep;
+};
+
+#endif //CC_LAS_LOAD_FILTERS_HEADER
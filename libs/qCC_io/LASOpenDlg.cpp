@@ -23,6 +23,7 @@
 //System
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 
 LASOpenDlg::LASOpenDlg(QWidget* parent)
 	: QDialog(parent)
@@ -34,6 +35,12 @@ LASOpenDlg::LASOpenDlg(QWidget* parent)
 	clearEVLRs();
 
 	connect(applyAllButton, SIGNAL(clicked()), this, SLOT(onApplyAll()));
+	connect(boxFilterCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateFiltersState()));
+	connect(boxZCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateFiltersState()));
+	connect(classifFilterCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateFiltersState()));
+	connect(returnFilterComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateFiltersState()));
+
+	updateFiltersState();
 }
 
 void LASOpenDlg::onApplyAll()
@@ -164,3 +171,79 @@ bool LASOpenDlg::forced8bitRgbMode() const
 {
 	return force8bitRgbCheckBox->isChecked();
 }
+
+void LASOpenDlg::updateFiltersState()
+{
+	bool useBox = boxFilterCheckBox->isChecked();
+	boxMinXDoubleSpinBox->setEnabled(useBox);
+	boxMaxXDoubleSpinBox->setEnabled(useBox);
+	boxMinYDoubleSpinBox->setEnabled(useBox);
+	boxMaxYDoubleSpinBox->setEnabled(useBox);
+	boxZCheckBox->setEnabled(useBox);
+	boxMinZDoubleSpinBox->setEnabled(useBox && boxZCheckBox->isChecked());
+	boxMaxZDoubleSpinBox->setEnabled(useBox && boxZCheckBox->isChecked());
+
+	classifFilterLineEdit->setEnabled(classifFilterCheckBox->isChecked());
+	returnNumberSpinBox->setEnabled(returnFilterComboBox->currentIndex() == LASLoadFilters::RETURN_NUMBER);
+}
+
+LASLoadFilters LASOpenDlg::getFilters() const
+{
+	LASLoadFilters filters;
+	if (!filtersGroupBox->isChecked())
+		return filters;
+
+	filters.useBox = boxFilterCheckBox->isChecked();
+	filters.useBoxZ = boxZCheckBox->isChecked();
+	filters.boxMin = CCVector3d(boxMinXDoubleSpinBox->value(), boxMinYDoubleSpinBox->value(), boxMinZDoubleSpinBox->value());
+	filters.boxMax = CCVector3d(boxMaxXDoubleSpinBox->value(), boxMaxYDoubleSpinBox->value(), boxMaxZDoubleSpinBox->value());
+
+	if (classifFilterCheckBox->isChecked() && !filters.setClassifications(classifFilterLineEdit->text()))
+	{
+		QMessageBox::warning(0, "Invalid classes", QString("Invalid list of classes: '%1' (the classification filter is ignored)").arg(classifFilterLineEdit->text()));
+	}
+
+	filters.returnFilter = static_cast<LASLoadFilters::ReturnFilter>(returnFilterComboBox->currentIndex());
+	filters.returnNumber = static_cast<unsigned>(returnNumberSpinBox->value());
+	filters.decimationStep = static_cast<unsigned>(decimationSpinBox->value());
+
+	return filters;
+}
+
+void LASOpenDlg::setFilters(const LASLoadFilters& filters)
+{
+	filtersGroupBox->setChecked(filters.isActive());
+
+	boxFilterCheckBox->setChecked(filters.useBox);
+	boxZCheckBox->setChecked(filters.useBoxZ);
+	boxMinXDoubleSpinBox->setValue(filters.boxMin.x);
+	boxMinYDoubleSpinBox->setValue(filters.boxMin.y);
+	boxMinZDoubleSpinBox->setValue(filters.boxMin.z);
+	boxMaxXDoubleSpinBox->setValue(filters.boxMax.x);
+	boxMaxYDoubleSpinBox->setValue(filters.boxMax.y);
+	boxMaxZDoubleSpinBox->setValue(filters.boxMax.z);
+
+	classifFilterCheckBox->setChecked(filters.useClassifications);
+	if (filters.useClassifications)
+		classifFilterLineEdit->setText(filters.getClassificationsList());
+
+	returnFilterComboBox->setCurrentIndex(static_cast<int>(filters.returnFilter));
+	returnNumberSpinBox->setValue(static_cast<int>(filters.returnNumber));
+	decimationSpinBox->setValue(static_cast<int>(std::max<unsigned>(filters.decimationStep,1)));
+
+	updateFiltersState();
+}
+
+void LASOpenDlg::setBoundingBox(const CCVector3d& bbMin, const CCVector3d& bbMax)
+{
+	//we don't overwrite a box set by the user
+	if (filtersGroupBox->isChecked() && boxFilterCheckBox->isChecked())
+		return;
+
+	boxMinXDoubleSpinBox->setValue(bbMin.x);
+	boxMinYDoubleSpinBox->setValue(bbMin.y);
+	boxMinZDoubleSpinBox->setValue(bbMin.z);
+	boxMaxXDoubleSpinBox->setValue(bbMax.x);
+	boxMaxYDoubleSpinBox->setValue(bbMax.y);
+	boxMaxZDoubleSpinBox->setValue(bbMax.z);
+}
@@ -18,6 +18,9 @@
 #ifndef CC_LAS_OPEN_DIALOG
 #define CC_LAS_OPEN_DIALOG
 
+//local
+#include "LASLoadFilters.h"
+
 //GUIs generated by Qt Designer
 #include <ui_openLASFileDlg.h>
 
@@ -106,9 +109,21 @@ public:
 	//! Whether 8-bit RGB mode is forced or not
 	bool forced8bitRgbMode() const;
 
+	//! Returns the load-time filters
+	LASLoadFilters getFilters() const;
+
+	//! Sets the load-time filters
+	void setFilters(const LASLoadFilters& filters);
+
+	//! Sets the bounding box of the file to load (file coordinates)
+	/** Used as default box filter if the box filter is not enabled yet.
+	**/
+	void setBoundingBox(const CCVector3d& bbMin, const CCVector3d& bbMax);
+
 protected slots:
 
 	void onApplyAll();
+	void updateFiltersState();
 
 protected:
 
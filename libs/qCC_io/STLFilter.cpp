@@ -26,6 +26,9 @@
 #include <QString>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QThread>
+#include <QAtomicInt>
+#include <QtConcurrentMap>
 
 //qCC_db
 #include <ccLog.h>
@@ -37,6 +40,22 @@
 
 //System
 #include <string.h>
+#include <limits.h>
+#include <vector>
+#include <algorithm>
+
+//Default duplicated vertices fusion mode
+static STLFilter::VertexFusionMode s_vertexFusionMode = STLFilter::TOLERANCE_FUSION;
+
+void STLFilter::SetVertexFusionMode(VertexFusionMode mode)
+{
+	s_vertexFusionMode = mode;
+}
+
+STLFilter::VertexFusionMode STLFilter::GetVertexFusionMode()
+{
+	return s_vertexFusionMode;
+}
 
 bool STLFilter::canLoadExtension(QString upperCaseExt) const
 {
@@ -318,6 +337,220 @@ static bool TagDuplicatedVertices(	const CCLib::DgmOctree::octreeCell& cell,
 	return true;
 }
 
+//! Tags duplicated vertices with an octree (i.e. vertices closer than 'c_defaultSearchRadius')
+static bool TagDuplicatedVerticesWithOctree(ccPointCloud* vertices, GenericChunkedArray<1,int>* equivalentIndexes)
+{
+	assert(vertices && equivalentIndexes);
+
+	ccProgressDialog pDlg(true);
+	ccOctree* octree = vertices->computeOctree(&pDlg);
+	if (!octree)
+	{
+		ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
+		return false;
+	}
+
+	void* additionalParameters[] = { static_cast<void*>(equivalentIndexes) };
+	unsigned result = octree->executeFunctionForAllCellsAtLevel(10,
+																TagDuplicatedVertices,
+																additionalParameters,
+																false,
+																&pDlg,
+																"Tag duplicated vertices");
+	vertices->deleteOctree();
+	octree = 0;
+
+	if (result == 0)
+	{
+		ccLog::Warning("[STL] Duplicated vertices removal algorithm failed?!");
+		return false;
+	}
+
+	return true;
+}
+
+/*** EXACT DUPLICATED VERTICES FUSION (HASH-BASED) ***/
+
+//! Hashes the (exact) coordinates of a vertex
+static inline unsigned HashVertex(const CCVector3& P)
+{
+	//'-0' and '+0' must give the same hash as they are equal!
+	PointCoordinateType coords[3] = {	P.x == 0 ? 0 : P.x,
+										P.y == 0 ? 0 : P.y,
+										P.z == 0 ? 0 : P.z };
+
+	//FNV-1a
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(coords);
+	unsigned h = 2166136261U;
+	for (size_t i=0; i<sizeof(coords); ++i)
+	{
+		h ^= bytes[i];
+		h *= 16777619U;
+	}
+
+	//final mix (so that both the high and the low bits are well distributed)
+	h ^= (h >> 16);
+	h *= 0x85ebca6bU;
+	h ^= (h >> 13);
+	return h;
+}
+
+//! Set of vertices sharing the same hash high bits
+struct VertexBucket
+{
+	//! Position of the first vertex index in the (sorted) indexes array
+	unsigned first;
+	//! Number of vertices in this bucket
+	unsigned count;
+};
+
+static const unsigned c_emptySlot = static_cast<unsigned>(-1);
+static const ccPointCloud* s_vertices_MT = 0;
+static const unsigned* s_vertexHashes_MT = 0;
+static const unsigned* s_sortedIndexes_MT = 0;
+static GenericChunkedArray<1,int>* s_equivalentIndexes_MT = 0;
+static QAtomicInt s_tagBucket_MT_failed(0);
+
+static void TagExactDuplicatesInBucket_MT(const VertexBucket& bucket)
+{
+	//skip bucket if process has failed
+	if (s_tagBucket_MT_failed.fetchAndAddOrdered(0) != 0 || bucket.count == 0)
+		return;
+
+	//local hash table (open addressing with linear probing, load factor <= 0.5)
+	unsigned tableSize = 2;
+	while (tableSize < 2*bucket.count)
+		tableSize <<= 1;
+	const unsigned mask = tableSize-1;
+
+	std::vector<unsigned> table;
+	try
+	{
+		table.resize(tableSize,c_emptySlot);
+	}
+	catch (const std::bad_alloc&)
+	{
+		s_tagBucket_MT_failed.fetchAndStoreOrdered(1);
+		return;
+	}
+
+	//indexes are sorted in ascending order inside each bucket: the 'root' of
+	//a set of equivalent vertices is always its first occurrence in the file
+	const unsigned* indexes = s_sortedIndexes_MT + bucket.first;
+	for (unsigned j=0; j<bucket.count; ++j)
+	{
+		unsigned index = indexes[j];
+		const CCVector3* P = s_vertices_MT->getPoint(index);
+
+		unsigned slot = s_vertexHashes_MT[index] & mask;
+		while (true)
+		{
+			unsigned otherIndex = table[slot];
+			if (otherIndex == c_emptySlot)
+			{
+				//new root vertex
+				table[slot] = index;
+				s_equivalentIndexes_MT->setValue(index,static_cast<int>(index));
+				break;
+			}
+
+			const CCVector3* Q = s_vertices_MT->getPoint(otherIndex);
+			if (P->x == Q->x && P->y == Q->y && P->z == Q->z)
+			{
+				s_equivalentIndexes_MT->setValue(index,static_cast<int>(otherIndex));
+				break;
+			}
+
+			slot = ((slot+1) & mask);
+		}
+	}
+}
+
+//! Tags vertices with exactly the same coordinates
+/** Vertices are dispatched in independent buckets (based on their hash code)
+	so that each bucket can be processed in parallel.
+**/
+static bool TagDuplicatedVerticesWithHash(const ccPointCloud* vertices, GenericChunkedArray<1,int>* equivalentIndexes)
+{
+	assert(vertices && equivalentIndexes);
+	unsigned vertCount = vertices->size();
+	if (vertCount == 0)
+		return true;
+
+	//number of buckets (a power of 2, with several buckets per thread for a better load balancing)
+	unsigned bucketBits = 6;
+	while ((1U << bucketBits) < static_cast<unsigned>(std::max(QThread::idealThreadCount(),1)) * 16 && bucketBits < 16)
+		++bucketBits;
+	const unsigned bucketCount = (1U << bucketBits);
+
+	std::vector<unsigned> hashes;
+	std::vector<unsigned> sortedIndexes;
+	std::vector<VertexBucket> buckets;
+	try
+	{
+		hashes.resize(vertCount);
+		sortedIndexes.resize(vertCount);
+		buckets.resize(bucketCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
+		return false;
+	}
+
+	//compute the hash codes and the buckets population
+	{
+		for (unsigned b=0; b<bucketCount; ++b)
+		{
+			buckets[b].first = 0;
+			buckets[b].count = 0;
+		}
+		for (unsigned i=0; i<vertCount; ++i)
+		{
+			hashes[i] = HashVertex(*vertices->getPoint(i));
+			++buckets[hashes[i] >> (32-bucketBits)].count;
+		}
+	}
+
+	//dispatch the indexes in their bucket (counting sort, stable)
+	{
+		unsigned pos = 0;
+		for (unsigned b=0; b<bucketCount; ++b)
+		{
+			buckets[b].first = pos;
+			pos += buckets[b].count;
+			buckets[b].count = 0;
+		}
+		for (unsigned i=0; i<vertCount; ++i)
+		{
+			VertexBucket& bucket = buckets[hashes[i] >> (32-bucketBits)];
+			sortedIndexes[bucket.first + bucket.count++] = i;
+		}
+	}
+
+	//static wrap
+	s_vertices_MT = vertices;
+	s_vertexHashes_MT = &(hashes[0]);
+	s_sortedIndexes_MT = &(sortedIndexes[0]);
+	s_equivalentIndexes_MT = equivalentIndexes;
+	s_tagBucket_MT_failed.fetchAndStoreOrdered(0);
+
+	QtConcurrent::blockingMap(buckets, TagExactDuplicatesInBucket_MT);
+
+	s_vertices_MT = 0;
+	s_vertexHashes_MT = 0;
+	s_sortedIndexes_MT = 0;
+	s_equivalentIndexes_MT = 0;
+
+	if (s_tagBucket_MT_failed.fetchAndAddOrdered(0) != 0)
+	{
+		ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
+		return false;
+	}
+
+	return true;
+}
+
 CC_FILE_ERROR STLFilter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
 {
 	ccLog::Print(QString("[STL] Loading '%1'").arg(filename));
@@ -400,111 +633,96 @@ CC_FILE_ERROR STLFilter::loadFile(QString filename, ccHObject& container, LoadPa
 	}
 
 	//remove duplicated vertices
-	//if (false)
+	if (s_vertexFusionMode != NO_FUSION)
 	{
 		GenericChunkedArray<1,int>* equivalentIndexes = new GenericChunkedArray<1,int>;
 		const int razValue = -1;
 		if (equivalentIndexes && equivalentIndexes->resize(vertCount,true,razValue))
 		{
-			ccProgressDialog pDlg(true);
-			ccOctree* octree = vertices->computeOctree(&pDlg);
-			if (octree)
+			bool success = false;
+			if (s_vertexFusionMode == TOLERANCE_FUSION)
+				success = TagDuplicatedVerticesWithOctree(vertices,equivalentIndexes);
+			else
+				success = TagDuplicatedVerticesWithHash(vertices,equivalentIndexes);
+
+			if (success)
 			{
-				void* additionalParameters[] = { static_cast<void*>(equivalentIndexes) };
-				unsigned result = octree->executeFunctionForAllCellsAtLevel(10,
-																			TagDuplicatedVertices,
-																			additionalParameters,
-																			false,
-																			&pDlg,
-																			"Tag duplicated vertices");
-				vertices->deleteOctree();
-				octree = 0;
-
-				if (result != 0)
+				unsigned remainingCount = 0;
+				for (unsigned i=0; i<vertCount; ++i)
+				{
+					int eqIndex = equivalentIndexes->getValue(i);
+					assert(eqIndex >= 0);
+					if (eqIndex == static_cast<int>(i)) //root point
+					{
+						int newIndex = static_cast<int>(vertCount+remainingCount); //We replace the root index by its 'new' index (+ vertCount, to differentiate it later)
+						equivalentIndexes->setValue(i,newIndex);
+						++remainingCount;
+					}
+				}
+
+				ccPointCloud* newVertices = new ccPointCloud("vertices");
+				if (newVertices->reserve(remainingCount))
 				{
-					unsigned remainingCount = 0;
-					for (unsigned i=0; i<vertCount; ++i)
+					//copy root points in a new cloud
 					{
-						int eqIndex = equivalentIndexes->getValue(i);
-						assert(eqIndex >= 0);
-						if (eqIndex == static_cast<int>(i)) //root point
+						for (unsigned i=0; i<vertCount; ++i)
 						{
-							int newIndex = static_cast<int>(vertCount+remainingCount); //We replace the root index by its 'new' index (+ vertCount, to differentiate it later)
-							equivalentIndexes->setValue(i,newIndex);
-							++remainingCount;
+							int eqIndex = equivalentIndexes->getValue(i);
+							if (eqIndex >= static_cast<int>(vertCount)) //root point
+								newVertices->addPoint(*vertices->getPoint(i));
+							else
+								equivalentIndexes->setValue(i,equivalentIndexes->getValue(eqIndex)); //and update the other indexes
 						}
 					}
 
-					ccPointCloud* newVertices = new ccPointCloud("vertices");
-					if (newVertices->reserve(remainingCount))
+					//update face indexes
 					{
-						//copy root points in a new cloud
+						unsigned newFaceCount = 0;
+						for (unsigned i=0; i<faceCount; ++i)
 						{
-							for (unsigned i=0; i<vertCount; ++i)
+							CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
+							tri->i1 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i1))-vertCount;
+							tri->i2 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i2))-vertCount;
+							tri->i3 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i3))-vertCount;
+
+							//very small triangles (or flat ones) may be implicitly removed by vertex fusion!
+							if (tri->i1 != tri->i2 && tri->i1 != tri->i3 && tri->i2 != tri->i3)
 							{
-								int eqIndex = equivalentIndexes->getValue(i);
-								if (eqIndex >= static_cast<int>(vertCount)) //root point
-									newVertices->addPoint(*vertices->getPoint(i));
-								else
-									equivalentIndexes->setValue(i,equivalentIndexes->getValue(eqIndex)); //and update the other indexes
+								if (newFaceCount != i)
+									mesh->swapTriangles(i,newFaceCount);
+								++newFaceCount;
 							}
 						}
 
-						//update face indexes
+						if (newFaceCount == 0)
 						{
-							unsigned newFaceCount = 0;
-							for (unsigned i=0; i<faceCount; ++i)
-							{
-								CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
-								tri->i1 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i1))-vertCount;
-								tri->i2 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i2))-vertCount;
-								tri->i3 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i3))-vertCount;
-
-								//very small triangles (or flat ones) may be implicitly removed by vertex fusion!
-								if (tri->i1 != tri->i2 && tri->i1 != tri->i3 && tri->i2 != tri->i3)
-								{
-									if (newFaceCount != i)
-										mesh->swapTriangles(i,newFaceCount);
-									++newFaceCount;
-								}
-							}
-
-							if (newFaceCount == 0)
-							{
-								ccLog::Warning("[STL] After vertex fusion, all triangles would collapse! We'll keep the non-fused version...");
-								delete newVertices;
-								newVertices = 0;
-							}
-							else
-							{
-								mesh->resize(newFaceCount);
-							}
+							ccLog::Warning("[STL] After vertex fusion, all triangles would collapse! We'll keep the non-fused version...");
+							delete newVertices;
+							newVertices = 0;
 						}
-						
-						if (newVertices)
+						else
 						{
-							mesh->setAssociatedCloud(newVertices);
-							delete vertices;
-							vertices = newVertices;
-							vertCount = vertices->size();
-							ccLog::Print("[STL] Remaining vertices after auto-removal of duplicate ones: %i",vertCount);
-							ccLog::Print("[STL] Remaining faces after auto-removal of duplicate ones: %i",mesh->size());
+							mesh->resize(newFaceCount);
 						}
 					}
-					else
+					
+					if (newVertices)
 					{
-						ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
+						mesh->setAssociatedCloud(newVertices);
+						delete vertices;
+						vertices = newVertices;
+						vertCount = vertices->size();
+						ccLog::Print("[STL] Remaining vertices after auto-removal of duplicate ones: %i",vertCount);
+						ccLog::Print("[STL] Remaining faces after auto-removal of duplicate ones: %i",mesh->size());
 					}
 				}
 				else
 				{
-					ccLog::Warning("[STL] Duplicated vertices removal algorithm failed?!");
+					delete newVertices;
+					newVertices = 0;
+					ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
 				}
 			}
-			else
-			{
-				ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
-			}
 		}
 		else
 		{
@@ -878,14 +1096,40 @@ CC_FILE_ERROR STLFilter::loadBinaryFile(QFile& fp,
 		faceCount = tmpInt32;
 	}
 
+	//each facet is made of: REAL32[3] normal + 3 * REAL32[3] vertices + UINT16 attribute byte count
+	static const qint64 c_facetSize = 50;
+	if (fp.size() < 84 + static_cast<qint64>(faceCount) * c_facetSize)
+	{
+		ccLog::Warning("[STL] File is too small for the announced number of facets!");
+		return CC_FERR_MALFORMED_FILE;
+	}
+
 	if (!mesh->reserve(faceCount))
 		return CC_FERR_NOT_ENOUGH_MEMORY;
+	//3 vertices per facet (duplicated vertices are removed afterwards)
+	if (faceCount > UINT_MAX/3)
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	if (!vertices->reserve(3*faceCount))
+		return CC_FERR_NOT_ENOUGH_MEMORY;
 	NormsIndexesTableType* normals = mesh->getTriNormsTable();
 	if (normals && (!normals->reserve(faceCount) || !mesh->reservePerTriangleNormalIndexes()))
 	{
 		ccLog::Warning("[STL] Not enough memory: can't store normals!");
 		mesh->removePerTriangleNormalIndexes();
 		mesh->setTriNormsTable(0);
+		normals = 0;
+	}
+
+	//we read the facets by blocks (instead of reading each vector separately)
+	static const unsigned c_facetsPerBlock = (1 << 16);
+	std::vector<char> block;
+	try
+	{
+		block.resize(static_cast<size_t>(std::min(faceCount,c_facetsPerBlock) * c_facetSize));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
 	}
 
 	//progress dialog
@@ -899,99 +1143,69 @@ CC_FILE_ERROR STLFilter::loadBinaryFile(QFile& fp,
 	//current vertex shift
 	CCVector3d Pshift(0,0,0);
 
-	for (unsigned f=0; f<faceCount; ++f)
+	assert(sizeof(float) == 4);
+	for (unsigned f=0; f<faceCount; )
 	{
-		//REAL32[3] Normal vector
-		assert(sizeof(float) == 4);
-		CCVector3 N;
-		if (fp.read((char*)N.u,12) < 12)
+		unsigned blockFacetCount = std::min(faceCount-f,c_facetsPerBlock);
+		qint64 blockSize = static_cast<qint64>(blockFacetCount) * c_facetSize;
+		if (fp.read(&(block[0]),blockSize) < blockSize)
 			return CC_FERR_READING;
 
-		//3 vertices
-		unsigned vertIndexes[3];
-//		unsigned pointCountBefore=pointCount;
-		for (unsigned i=0; i<3; ++i)
+		const char* facet = &(block[0]);
+		for (unsigned j=0; j<blockFacetCount; ++j, facet += c_facetSize)
 		{
-			//REAL32[3] Vertex 1,2 & 3
-			float Pf[3];
-			if (fp.read((char*)Pf,12) < 0)
-				return CC_FERR_READING;
+			//REAL32[3] Normal vector
+			float Nf[3];
+			memcpy(Nf,facet,12);
 
-			//first point: check for 'big' coordinates
-			CCVector3d Pd( Pf[0], Pf[1], Pf[2] );
-			if (pointCount == 0)
+			//REAL32[3] Vertex 1,2 & 3
+			unsigned vertIndexes[3];
+			for (unsigned i=0; i<3; ++i)
 			{
-				if (HandleGlobalShift(Pd,Pshift,parameters))
+				float Pf[3];
+				memcpy(Pf,facet+12*(i+1),12);
+
+				//first point: check for 'big' coordinates
+				CCVector3d Pd( Pf[0], Pf[1], Pf[2] );
+				if (pointCount == 0)
 				{
-					vertices->setGlobalShift(Pshift);
-					ccLog::Warning("[STLFilter::loadFile] Cloud has been recentered! Translation: (%.2f,%.2f,%.2f)",Pshift.x,Pshift.y,Pshift.z);
+					if (HandleGlobalShift(Pd,Pshift,parameters))
+					{
+						vertices->setGlobalShift(Pshift);
+						ccLog::Warning("[STLFilter::loadFile] Cloud has been recentered! Translation: (%.2f,%.2f,%.2f)",Pshift.x,Pshift.y,Pshift.z);
+					}
 				}
-			}
-
-			CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
-
-			//look for existing vertices at the same place! (STL format is so dumb...)
-			{
-				//int equivalentIndex = -1;
-				//if (pointCount>2)
-				//{
-				//	//brute force!
-				//	for (int j=static_cast<int>(pointCountBefore)-1; j>=0; j--)
-				//	{
-				//		const CCVector3* Pj = vertices->getPoint(j);
-				//		if (Pj->x == P.x &&
-				//			Pj->y == P.y &&
-				//			Pj->z == P.z)
-				//		{
-				//			equivalentIndex = j;
-				//			break;
-				//		}
-				//	}
-				//}
 
-				////new point ?
-				//if (equivalentIndex < 0)
-				{
-					//cloud is already full?
-					if (vertices->capacity() == pointCount && !vertices->reserve(pointCount+1000))
-						return CC_FERR_NOT_ENOUGH_MEMORY;
+				CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
 
-					//insert new point
-					vertIndexes[i] = pointCount++;
-					vertices->addPoint(P);
-				}
-				//else
-				//{
-				//	vertIndexes[i] = static_cast<unsigned>(equivalentIndex);
-				//}
+				//insert new point (duplicated vertices will be removed afterwards)
+				vertIndexes[i] = pointCount++;
+				vertices->addPoint(P);
 			}
-		}
 
-		//UINT16 Attribute byte count (not used)
-		{
-			char a[2];
-			if (fp.read(a,2) < 0)
-				return CC_FERR_READING;
-		}
+			//UINT16 Attribute byte count (not used)
 
-		//we have successfully read the 3 vertices
-		//let's add a new triangle
-		{
+			//we have successfully read the 3 vertices
+			//let's add a new triangle
 			mesh->addTriangle(vertIndexes[0],vertIndexes[1],vertIndexes[2]);
-		}
 
-		//and a new normal?
-		if (normals)
-		{
-			//compress normal
-			int index = static_cast<int>(normals->currentSize());
-			normsType nIndex = ccNormalVectors::GetNormIndex(N.u);
-			normals->addElement(nIndex);
-			mesh->addTriangleNormalIndexes(index,index,index);
+			//and a new normal?
+			if (normals)
+			{
+				//compress normal
+				CCVector3 N(static_cast<PointCoordinateType>(Nf[0]),
+							static_cast<PointCoordinateType>(Nf[1]),
+							static_cast<PointCoordinateType>(Nf[2]));
+				int index = static_cast<int>(normals->currentSize());
+				normsType nIndex = ccNormalVectors::GetNormIndex(N.u);
+				normals->addElement(nIndex);
+				mesh->addTriangleNormalIndexes(index,index,index);
+			}
 		}
+		f += blockFacetCount;
 
 		//progress
-		if (!nProgress.oneStep())
+		if (!nProgress.steps(blockFacetCount))
 			break;
 	}
 
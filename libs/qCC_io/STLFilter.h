@@ -38,6 +38,19 @@ public:
 	static inline QString GetFileFilter() { return "STL mesh (*.stl)"; }
 	static inline QString GetDefaultExtension() { return "stl"; }
 
+	//! Duplicated vertices fusion mode (on import)
+	enum VertexFusionMode
+	{
+		NO_FUSION,			/**< vertices are kept as is (3 per facet) **/
+		EXACT_FUSION,		/**< vertices with exactly the same coordinates are merged (hash-based, faster) **/
+		TOLERANCE_FUSION,	/**< vertices closer than a small tolerance are merged (octree-based, default) **/
+	};
+
+	//! Sets the duplicated vertices fusion mode (on import)
+	static void SetVertexFusionMode(VertexFusionMode mode);
+	//! Returns the current duplicated vertices fusion mode (on import)
+	static VertexFusionMode GetVertexFusionMode();
+
 	//inherited from FileIOFilter
 	virtual bool importSupported() const { return true; }
 	virtual bool exportSupported() const { return true; }
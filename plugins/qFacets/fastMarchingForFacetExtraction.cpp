@@ -26,9 +26,12 @@
 
 //Qt
 #include <QApplication>
+#include <QThread>
+#include <QtConcurrentMap>
 
 //system
 #include <assert.h>
+#include <algorithm>
 
 //! 26-connexity neighbouring cells positions (common edges)
 const int c_3dNeighboursPosShift[] = {-1,-1,-1,
@@ -105,6 +108,46 @@ static bool ComputeCellStats(	CCLib::ReferenceCloud* subset,
 	return true;
 }
 
+//! Number of octree cells processed by each job of FastMarchingForFacetExtraction::init
+static const unsigned CELLS_PER_STATS_JOB = 1024;
+
+//! Statistics of an octree cell (see ComputeCellStats)
+struct CellStats
+{
+	CCVector3 N;
+	CCVector3 C;
+	ScalarType error;
+	//! 1 = valid, 0 = no point in cell, -1 = an error occurred
+	int state;
+};
+
+//! Job of FastMarchingForFacetExtraction::init (statistics of a range of octree cells)
+struct CellStatsJob
+{
+	const CCLib::DgmOctree* octree;
+	const CCLib::DgmOctree::cellCodesContainer* cellCodes;
+	unsigned char level;
+	CCLib::DistanceComputationTools::ERROR_MEASURES errorMeasure;
+	std::vector<CellStats>* stats;
+	unsigned firstIndex;
+	unsigned lastIndex;
+};
+
+static void ComputeCellStatsRange(CellStatsJob& job)
+{
+	CCLib::ReferenceCloud Yk(job.octree->associatedCloud());
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		CellStats& stats = job.stats->at(i);
+		if (!job.octree->getPointsInCell(job.cellCodes->at(i),job.level,&Yk,true))
+		{
+			stats.state = 0;
+			continue;
+		}
+		stats.state = (ComputeCellStats(&Yk,stats.N,stats.C,stats.error,job.errorMeasure) ? 1 : -1);
+	}
+}
+
 int FastMarchingForFacetExtraction::init(	ccGenericPointCloud* cloud,
 											CCLib::DgmOctree* theOctree,
 											unsigned char level,
@@ -141,40 +184,79 @@ int FastMarchingForFacetExtraction::init(	ccGenericPointCloud* cloud,
 		nProgress = new CCLib::NormalizedProgress(progressCb,static_cast<unsigned>(cellCount));
 	}
 
-	CCLib::ReferenceCloud Yk(theOctree->associatedCloud());
-	while (!cellCodes.empty())
+	std::vector<CellStats> cellStats;
+	try
 	{
-		if (theOctree->getPointsInCell(cellCodes.back(),level,&Yk,true))
+		cellStats.resize(cellCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		if (nProgress)
 		{
-			//convert the octree cell code to grid position
-			Tuple3i cellPos;
-			theOctree->getCellPos(cellCodes.back(),level,cellPos,true);
+			progressCb->stop();
+			delete nProgress;
+		}
+		return -11;
+	}
 
-			CCVector3 N,C;
-			ScalarType error;
-			if (ComputeCellStats(&Yk,N,C,error,m_errorMeasure))
-			{
-				//convert octree cell pos to FM cell pos index
-				unsigned gridPos = pos2index(cellPos);
-
-				//create corresponding cell
-				PlanarCell* aCell = new PlanarCell;
-				aCell->cellCode = cellCodes.back();
-				aCell->N = N;
-				aCell->C = C;
-				aCell->planarError = error;
-				m_theGrid[gridPos] = aCell;
-			}
-			else
+	CellStatsJob prototype;
+	prototype.octree = theOctree;
+	prototype.cellCodes = &cellCodes;
+	prototype.level = level;
+	prototype.errorMeasure = m_errorMeasure;
+	prototype.stats = &cellStats;
+
+	//the cells statistics (LS plane and error) are computed in parallel, by batches (so that the progress can be updated and the user can cancel the process)
+	unsigned jobsPerBatch = static_cast<unsigned>(std::max(1,QThread::idealThreadCount())) * 4;
+	std::vector<CellStatsJob> jobs;
+	for (unsigned first=0; first<static_cast<unsigned>(cellCount); )
+	{
+		jobs.clear();
+		for (unsigned j=0; j<jobsPerBatch && first<static_cast<unsigned>(cellCount); ++j)
+		{
+			CellStatsJob job = prototype;
+			job.firstIndex = first;
+			job.lastIndex = std::min(first + CELLS_PER_STATS_JOB, static_cast<unsigned>(cellCount));
+			jobs.push_back(job);
+			first = job.lastIndex;
+		}
+		QtConcurrent::blockingMap(jobs, ComputeCellStatsRange);
+
+		//create the corresponding cells
+		for (unsigned i=jobs.front().firstIndex; i<jobs.back().lastIndex; ++i)
+		{
+			const CellStats& stats = cellStats[i];
+			if (stats.state == 0)
+				continue;
+			if (stats.state < 0)
 			{
 				//an error occurred?!
+				if (nProgress)
+				{
+					progressCb->stop();
+					delete nProgress;
+				}
 				return -10;
 			}
-		}
 
-		cellCodes.pop_back();
+			//convert the octree cell code to grid position
+			Tuple3i cellPos;
+			theOctree->getCellPos(cellCodes[i],level,cellPos,true);
+
+			//convert octree cell pos to FM cell pos index
+			unsigned gridPos = pos2index(cellPos);
+
+			//create corresponding cell
+			PlanarCell* aCell = new PlanarCell;
+			aCell->cellCode = cellCodes[i];
+			aCell->N = stats.N;
+			aCell->C = stats.C;
+			aCell->planarError = stats.error;
+			m_theGrid[gridPos] = aCell;
+		}
 
-		if (nProgress && !nProgress->oneStep())
+		if (nProgress && !nProgress->steps(jobs.back().lastIndex - jobs.front().firstIndex))
 		{
 			//process cancelled by user
 			progressCb->stop();
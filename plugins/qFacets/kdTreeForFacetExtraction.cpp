@@ -27,6 +27,7 @@
 
 //Qt
 #include <QApplication>
+#include <QtConcurrentMap>
 
 //static bool AscendingLeafErrorComparison(const ccKdTree::Leaf* a, const ccKdTree::Leaf* b)
 //{
@@ -41,12 +42,13 @@ static bool DescendingLeafSizeComparison(const ccKdTree::Leaf* a, const ccKdTree
 struct Candidate
 {
 	ccKdTree::Leaf* leaf;
+	unsigned leafIndex;
 	PointCoordinateType dist;
 	PointCoordinateType radius;
 	CCVector3 centroid;
 
-	Candidate() : leaf(0), dist(PC_NAN), radius(0) {}
-	Candidate(ccKdTree::Leaf* l) : leaf(l), dist(PC_NAN), radius(0)
+	Candidate() : leaf(0), leafIndex(0), dist(PC_NAN), radius(0) {}
+	Candidate(ccKdTree::Leaf* l, unsigned index = 0) : leaf(l), leafIndex(index), dist(PC_NAN), radius(0)
 	{
 		if (leaf && leaf->points)
 		{
@@ -62,6 +64,54 @@ static bool CandidateDistAscendingComparison(const Candidate& a, const Candidate
 	return a.dist < b.dist;
 }
 
+//! Leaf with its index (sorted by leaf address first, as a ccKdTree::LeafSet)
+typedef std::pair<ccKdTree::Leaf*, unsigned> IndexedLeaf;
+
+//! Number of leaves processed by each adjacency job
+static const unsigned LEAVES_PER_ADJACENCY_JOB = 256;
+
+//! Job of ccKdTreeForFacetExtraction::FuseCells (adjacency graph and candidates of a range of leaves)
+struct LeafAdjacencyJob
+{
+	ccKdTree* kdTree;
+	const std::vector<ccKdTree::Leaf*>* leaves;
+	std::vector<Candidate>* candidates;
+	std::vector< std::vector<IndexedLeaf> >* neighbors;
+	unsigned firstIndex;
+	unsigned lastIndex;
+	bool success;
+};
+
+static void ComputeLeafAdjacency(LeafAdjacencyJob& job)
+{
+	job.success = true;
+	try
+	{
+		for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+		{
+			ccKdTree::Leaf* leaf = job.leaves->at(i);
+			job.candidates->at(i) = Candidate(leaf, i);
+
+			//all the neighbors are stored (their state is checked during the fusion process)
+			ccKdTree::LeafSet neighbors;
+			if (!job.kdTree->getNeighborLeaves(leaf, neighbors))
+			{
+				job.success = false;
+				return;
+			}
+
+			std::vector<IndexedLeaf>& leafNeighbors = job.neighbors->at(i);
+			leafNeighbors.reserve(neighbors.size());
+			for (ccKdTree::LeafSet::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+				leafNeighbors.push_back(IndexedLeaf(*it, static_cast<unsigned>((*it)->userData)));
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		job.success = false;
+	}
+}
+
 bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 											double maxError,
 											CCLib::DistanceComputationTools::ERROR_MEASURES errorMeasure,
@@ -98,16 +148,75 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 	//sort cells based on their population size (we start by the biggest ones)
 	std::sort(leaves.begin(),leaves.end(),DescendingLeafSizeComparison);
 
-	//set all 'userData' to -1 (i.e. unfused cells)
+	//set all 'userData' to the leaf index (temporarily)
 	{
 		for (size_t i=0; i<leaves.size(); ++i)
 		{
-			leaves[i]->userData = -1;
+			leaves[i]->userData = static_cast<int>(i);
 			//check by the way that the plane normal is unit!
 			assert(static_cast<double>(fabs(CCVector3(leaves[i]->planeEq).norm2()) - 1.0) < 1.0e-6);
 		}
 	}
 
+	//precompute the leaves adjacency graph and the candidate parameters (centroid and radius) of each leaf (in parallel)
+	std::vector<Candidate> leafCandidates;
+	std::vector< std::vector<IndexedLeaf> > leafNeighbors;
+	{
+		try
+		{
+			leafCandidates.resize(leaves.size());
+			leafNeighbors.resize(leaves.size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory!
+			ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+			delete nProgress;
+			return false;
+		}
+
+		//make sure the cloud bounding box is up to date (as it is used by all the neighborhood requests)
+		{
+			CCVector3 bbMin, bbMax;
+			pc->getBoundingBox(bbMin, bbMax);
+		}
+
+		std::vector<LeafAdjacencyJob> jobs;
+		{
+			LeafAdjacencyJob job;
+			job.kdTree = kdTree;
+			job.leaves = &leaves;
+			job.candidates = &leafCandidates;
+			job.neighbors = &leafNeighbors;
+			job.success = false;
+			unsigned leafCount = static_cast<unsigned>(leaves.size());
+			for (unsigned first=0; first<leafCount; first=job.lastIndex)
+			{
+				job.firstIndex = first;
+				job.lastIndex = std::min(first + LEAVES_PER_ADJACENCY_JOB, leafCount);
+				jobs.push_back(job);
+			}
+		}
+		QtConcurrent::blockingMap(jobs, ComputeLeafAdjacency);
+
+		for (size_t j=0; j<jobs.size(); ++j)
+		{
+			if (!jobs[j].success)
+			{
+				//not enough memory?
+				ccLog::Warning("[ccKdTreeForFacetExtraction] Failed to compute the leaves adjacency graph (not enough memory?)");
+				delete nProgress;
+				return false;
+			}
+		}
+	}
+
+	//set all 'userData' to -1 (i.e. unfused cells)
+	{
+		for (size_t i=0; i<leaves.size(); ++i)
+			leaves[i]->userData = -1;
+	}
+
 	// cosine of the max angle between fused 'planes'
 	const double c_minCosNormAngle = cos(maxAngle_deg * CC_DEG_TO_RAD);
 
@@ -148,8 +257,8 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 			std::list<Candidate> candidates;
 
 			//we are going to iteratively look for neighbor cells that could be fused to this one
-			ccKdTree::LeafVector cellsToTest;
-			cellsToTest.push_back(currentCell);
+			std::vector<unsigned> cellsToTest;
+			cellsToTest.push_back(static_cast<unsigned>(i));
 
 			if (nProgress && !nProgress->oneStep()) //process canceled by user
 			{
@@ -162,30 +271,38 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 				//get all neighbors around the 'waiting' cell(s)
 				if (!cellsToTest.empty())
 				{
-					ccKdTree::LeafSet neighbors;
-					while (!cellsToTest.empty())
+					std::set<IndexedLeaf> neighbors;
+					try
 					{
-						if (!kdTree->getNeighborLeaves(cellsToTest.back(), neighbors, &unvisitedNeighborValue)) //we only consider unvisited cells!
+						while (!cellsToTest.empty())
 						{
-							//an error occurred
-							return false;
+							const std::vector<IndexedLeaf>& cellNeighbors = leafNeighbors[cellsToTest.back()];
+							for (size_t j=0; j<cellNeighbors.size(); ++j)
+								if (cellNeighbors[j].first->userData == unvisitedNeighborValue) //we only consider unvisited cells!
+									neighbors.insert(cellNeighbors[j]);
+							cellsToTest.pop_back();
 						}
-						cellsToTest.pop_back();
+					}
+					catch (const std::bad_alloc&)
+					{
+						//not enough memory!
+						ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+						return false;
 					}
 
 					//add those (new) neighbors to the 'visitedNeighbors' set
 					//and to the candidates set by the way if they are not yet there
-					for (ccKdTree::LeafSet::iterator it=neighbors.begin(); it != neighbors.end(); ++it)
+					for (std::set<IndexedLeaf>::iterator it=neighbors.begin(); it != neighbors.end(); ++it)
 					{
-						ccKdTree::Leaf* neighbor = *it;
+						ccKdTree::Leaf* neighbor = it->first;
 						std::pair<ccKdTree::LeafSet::iterator,bool> ret = visitedNeighbors.insert(neighbor);
 						//neighbour not already in the set?
 						if (ret.second)
 						{
-							//we create the corresponding candidate
+							//we add the corresponding (precomputed) candidate
 							try
 							{
-								candidates.push_back(Candidate(neighbor));
+								candidates.push_back(leafCandidates[it->second]);
 							}
 							catch (const std::bad_alloc&)
 							{
@@ -319,7 +436,7 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 						//bestIt->leaf->userData = macroIndex++; //FIXME TEST
 
 						//we will test this cell's neighbors as well
-						cellsToTest.push_back(bestIt->leaf);
+						cellsToTest.push_back(bestIt->leafIndex);
 
 						if (nProgress && !nProgress->oneStep()) //process canceled by user
 						{
@@ -36,6 +36,8 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QTextStream>
+#include <QThread>
+#include <QtConcurrentMap>
 
 //qCC_db
 #include <ccFacet.h>
@@ -416,6 +418,60 @@ void qFacets::extractFacets(CellsFusionDlg::Algorithm algo)
 	m_app->redrawAll();
 }
 
+//! Job of qFacets::createFacets (one component)
+struct FacetCreationJob
+{
+	ccPointCloud* cloud;
+	CCLib::ReferenceCloud* compIndexes;
+	PointCoordinateType maxEdgeLength;
+	bool cloudHasNormal;
+	ccFacet* facet;
+	bool memoryError;
+};
+
+static void CreateFacet(FacetCreationJob& job)
+{
+	job.facet = 0;
+	job.memoryError = false;
+
+	ccPointCloud* facetCloud = job.cloud->partialClone(job.compIndexes);
+	if (!facetCloud)
+	{
+		//not enough  memory!
+		job.memoryError = true;
+		return;
+	}
+
+	ccFacet* facet = ccFacet::Create(facetCloud,job.maxEdgeLength,true);
+	if (!facet)
+	{
+		delete facetCloud;
+		return;
+	}
+
+	if (facet->getPolygon())
+	{
+		facet->getPolygon()->enableStippling(false);
+		facet->getPolygon()->showNormals(false);
+	}
+	if (facet->getContour())
+	{
+		facet->getContour()->setGlobalScale(facetCloud->getGlobalScale());
+		facet->getContour()->setGlobalShift(facetCloud->getGlobalShift());
+	}
+
+	//check the facet normal sign
+	if (job.cloudHasNormal)
+	{
+		CCVector3 N = ccOctree::ComputeAverageNorm(job.compIndexes,job.cloud);
+
+		if (N.dot(facet->getNormal()) < 0)
+			facet->invertNormal();
+	}
+
+	job.facet = facet;
+}
+
 ccHObject* qFacets::createFacets(	ccPointCloud* cloud,
 								CCLib::ReferenceCloudContainer& components,
 								unsigned minPointsPerComponent,
@@ -432,6 +488,11 @@ ccHObject* qFacets::createFacets(	ccPointCloud* cloud,
 	ccGroup->setVisible(true);
 
 	bool cloudHasNormal = cloud->hasNormals();
+	if (cloudHasNormal)
+	{
+		//make sure the normals table is ready before the facets are created concurrently
+		ccNormalVectors::GetUniqueInstance();
+	}
 
 	//number of input components
 	size_t componentCount = components.size();
@@ -444,86 +505,88 @@ ccHObject* qFacets::createFacets(	ccPointCloud* cloud,
 	pDlg.show();
 	QApplication::processEvents();
 
+	FacetCreationJob prototype;
+	prototype.cloud = cloud;
+	prototype.compIndexes = 0;
+	prototype.maxEdgeLength = static_cast<PointCoordinateType>(maxEdgeLength);
+	prototype.cloudHasNormal = cloudHasNormal;
+	prototype.facet = 0;
+	prototype.memoryError = false;
+
+	//the facets (plane fitting, contour and polygon) are created in parallel, by batches of components
+	//(they are then added to the group in the same order as before)
+	size_t jobsPerBatch = static_cast<size_t>(std::max(1,QThread::idealThreadCount())) * 16;
+	std::vector<FacetCreationJob> jobs;
+
 	//for each component
 	error = false;
 	while (!components.empty())
 	{
-		CCLib::ReferenceCloud* compIndexes = components.back();
-		components.pop_back();
-
-		//if it has enough points
-		if (compIndexes && compIndexes->size() >= minPointsPerComponent)
+		jobs.clear();
+		while (!components.empty() && jobs.size() < jobsPerBatch)
 		{
-			ccPointCloud* facetCloud = cloud->partialClone(compIndexes);
-			if (!facetCloud)
+			CCLib::ReferenceCloud* compIndexes = components.back();
+			components.pop_back();
+
+			//if it has enough points
+			if (compIndexes && compIndexes->size() >= minPointsPerComponent)
 			{
-				//not enough  memory!
-				error = true;
-				delete facetCloud;
-				facetCloud = 0;
+				FacetCreationJob job = prototype;
+				job.compIndexes = compIndexes;
+				jobs.push_back(job);
 			}
-			else
+			else if (compIndexes)
 			{
-				ccFacet* facet = ccFacet::Create(facetCloud,static_cast<PointCoordinateType>(maxEdgeLength),true);
-				if (facet)
-				{
-					QString facetName = QString("facet %1 (rms=%2)").arg(ccGroup->getChildrenNumber()).arg(facet->getRMS());
-					facet->setName(facetName);
-					if (facet->getPolygon())
-					{
-						facet->getPolygon()->enableStippling(false);
-						facet->getPolygon()->showNormals(false);
-					}
-					if (facet->getContour())
-					{
-						facet->getContour()->setGlobalScale(facetCloud->getGlobalScale());
-						facet->getContour()->setGlobalShift(facetCloud->getGlobalShift());
-					}
-
-					//check the facet normal sign
-					if (cloudHasNormal)
-					{
-						CCVector3 N = ccOctree::ComputeAverageNorm(compIndexes,cloud);
-
-						if (N.dot(facet->getNormal()) < 0)
-							facet->invertNormal();
-					}
+				delete compIndexes;
+			}
+		}
+
+		QtConcurrent::blockingMap(jobs, CreateFacet);
+
+		for (size_t i=0; i<jobs.size(); ++i)
+		{
+			if (jobs[i].memoryError)
+				error = true;
+
+			ccFacet* facet = jobs[i].facet;
+			if (facet)
+			{
+				QString facetName = QString("facet %1 (rms=%2)").arg(ccGroup->getChildrenNumber()).arg(facet->getRMS());
+				facet->setName(facetName);
 
 #ifdef _DEBUG
-					facet->showNormalVector(true);
+				facet->showNormalVector(true);
 #endif
 
-					//shall we colorize it with a random color?
-					ccColor::Rgb col, darkCol;
-					if (randomColors)
-					{
-						col = ccColor::Generator::Random();
-						assert(c_darkColorValue <= 1.0);
-						darkCol.r = static_cast<colorType>(static_cast<double>(col.r) * c_darkColorValue);
-						darkCol.g = static_cast<colorType>(static_cast<double>(col.g) * c_darkColorValue);
-						darkCol.b = static_cast<colorType>(static_cast<double>(col.b) * c_darkColorValue);
-					}
-					else
-					{
-						//use normal-based HSV coloring
-						CCVector3 N = facet->getNormal();
-						PointCoordinateType dip, dipDir;
-						ccNormalVectors::ConvertNormalToDipAndDipDir(N, dip, dipDir);
-						FacetsClassifier::GenerateSubfamilyColor(col,dip,dipDir,0,1,&darkCol);
-					}
-					facet->setColor(col);
-					if (facet->getContour())
-					{
-						facet->getContour()->setColor(darkCol);
-						facet->getContour()->setWidth(2);
-					}
-					ccGroup->addChild(facet);
+				//shall we colorize it with a random color?
+				ccColor::Rgb col, darkCol;
+				if (randomColors)
+				{
+					col = ccColor::Generator::Random();
+					assert(c_darkColorValue <= 1.0);
+					darkCol.r = static_cast<colorType>(static_cast<double>(col.r) * c_darkColorValue);
+					darkCol.g = static_cast<colorType>(static_cast<double>(col.g) * c_darkColorValue);
+					darkCol.b = static_cast<colorType>(static_cast<double>(col.b) * c_darkColorValue);
 				}
+				else
+				{
+					//use normal-based HSV coloring
+					CCVector3 N = facet->getNormal();
+					PointCoordinateType dip, dipDir;
+					ccNormalVectors::ConvertNormalToDipAndDipDir(N, dip, dipDir);
+					FacetsClassifier::GenerateSubfamilyColor(col,dip,dipDir,0,1,&darkCol);
+				}
+				facet->setColor(col);
+				if (facet->getContour())
+				{
+					facet->getContour()->setColor(darkCol);
+					facet->getContour()->setWidth(2);
+				}
+				ccGroup->addChild(facet);
 			}
 
-			if (compIndexes)
-				delete compIndexes;
-			compIndexes = 0;
+			delete jobs[i].compIndexes;
+			jobs[i].compIndexes = 0;
 		}
 
 		pDlg.setValue(static_cast<int>(componentCount-components.size()));
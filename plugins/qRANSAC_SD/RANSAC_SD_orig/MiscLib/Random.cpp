@@ -7,6 +7,9 @@
  */
 #include <stdio.h>
 #include "Random.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace MiscLib;
 
@@ -22,7 +25,16 @@ using namespace MiscLib;
 size_t MiscLib::rn_buf[MiscLib_RN_BUFSIZE];
 size_t MiscLib::rn_point = MiscLib_RN_BUFSIZE;
 
-void MiscLib::rn_setseed(size_t seed)
+/* last seed and number of calls to rn_setseed (shared) */
+static size_t rn_seed = 0;
+static size_t rn_seedCount = 0;
+/* number of calls to rn_setseed when the stream of this thread was seeded */
+static size_t rn_streamSeedCount = 0;
+#ifdef _OPENMP
+#pragma omp threadprivate(rn_streamSeedCount)
+#endif
+
+static void rn_seedstream(size_t seed)
 {
   register int t, j;
   size_t x[KK+KK-1];
@@ -52,10 +64,34 @@ void MiscLib::rn_setseed(size_t seed)
   }
   for (j=0;j<LL;j++) rn_buf[j+KK-LL]=x[j];
   for (;j<KK;j++) rn_buf[j-LL]=x[j];  
+  rn_point=MiscLib_RN_BUFSIZE;
+  rn_streamSeedCount=rn_seedCount;
+}
+
+static size_t rn_threadnum()
+{
+#ifdef _OPENMP
+  return (size_t)omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+/* must be called outside of any parallel region: the other threads
+   (re)seed their own stream at their next draw */
+void MiscLib::rn_setseed(size_t seed)
+{
+  rn_seed=seed;
+  ++rn_seedCount;
+  rn_seedstream(rn_seed+rn_threadnum());
 }
 
 size_t MiscLib::rn_refresh()
 {
+  /* the stream of this thread hasn't been seeded with the last seed yet */
+  if (rn_streamSeedCount!=rn_seedCount)
+    rn_seedstream(rn_seed+rn_threadnum());
+
 /* You remember Duff's device? If it would help then it should be used here */
   rn_point=1;
 
@@ -13,8 +13,13 @@
 
 namespace MiscLib
 {
-	extern size_t rn_buf[];
+	// each OpenMP thread draws from its own stream (seeded with
+	// the seed + the thread number, see rn_refresh)
+	extern size_t rn_buf[MiscLib_RN_BUFSIZE];
 	extern size_t rn_point;
+#ifdef _OPENMP
+	#pragma omp threadprivate(rn_buf, rn_point)
+#endif
 	void rn_setseed(size_t);
 	size_t rn_refresh(void);
 	inline size_t rn_rand()
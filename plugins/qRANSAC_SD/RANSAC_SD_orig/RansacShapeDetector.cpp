@@ -107,7 +107,9 @@ void RansacShapeDetector::GenerateCandidates(
 	for(int candIter = 0; candIter < 200; ++candIter)
 	{
 		// pick a sample level
-		double s = ((double)rand()) / (double)RAND_MAX;
+		// (rand() is not guaranteed to be thread-safe, and with some
+		// implementations each thread would draw the same sequence)
+		double s = ((double)rn_rand()) / (double)(MiscLib_RN_RAND_MOD - 1);
 		size_t sampleLevel = 0;
 		for(; sampleLevel < sampleLevelProbSum.size() - 1; ++sampleLevel)
 			if(sampleLevelProbSum[sampleLevel] >= s)
@@ -199,6 +201,9 @@ bool RansacShapeDetector::FindBestCandidate(CandidatesType &candidates,
 {
 	if(!candidates.size())
 		return false;
+	// the candidates are refined one at a time here, but each ImproveBounds
+	// call scores the points of the large subsets in parallel (DOPARALLEL, see
+	// ScoreAACubeTreeStrategy::Score)
 	size_t maxImproveSubsetDuringMaxSearch = octrees.size();
 	// sort by expected value
 	std::sort(candidates.begin(), candidates.end());
@@ -709,8 +714,8 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 				}
 
 				// reindex global octree
+				// (sequential: the remaining indices are compacted in place)
 				size_t minInvalidIndex = currentSize - numInvalid + beginIdx;
-				#pragma omp parallel for schedule(static)
 				for(size_t i = 0, j = 0; i < globalOctreeIndices.size(); ++i)
 					if(shapeIndex[globalOctreeIndices[i]] < minInvalidIndex)
 						globalOctreeIndices[j++] = shapeIndex[globalOctreeIndices[i]];
@@ -718,7 +723,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 
 				// reindex candidates (this also recomputes the bounds)
 				#pragma omp parallel for schedule(static)
-				for(size_t i = 0; i < candidates.size(); ++i)
+				for(intptr_t i = 0; i < (intptr_t)candidates.size(); ++i)
 					candidates[i].Reindex(shapeIndex, minInvalidIndex, mergedSubsets,
 						subsetSizes, pc, currentSize - numInvalid, m_options.m_epsilon,
 						m_options.m_normalThresh, m_options.m_bitmapEpsilon);
@@ -754,12 +759,12 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 						reindex[shuffleIndices[i]] = i;
 					// reindex global octree
 					#pragma omp parallel for schedule(static)
-					for(size_t i = 0; i < globalOctreeIndices.size(); ++i)
+					for(intptr_t i = 0; i < (intptr_t)globalOctreeIndices.size(); ++i)
 						if(globalOctreeIndices[i] < reindex.size())
 							globalOctreeIndices[i] = reindex[globalOctreeIndices[i]];
 					// reindex candidates
 					#pragma omp parallel for schedule(static, 100)
-					for(size_t i = 0; i < candidates.size(); ++i)
+					for(intptr_t i = 0; i < (intptr_t)candidates.size(); ++i)
 						candidates[i].Reindex(reindex);
 					for(size_t i = 1, begin = subsetSizes[0] + beginIdx;
 						i < octrees.size(); begin += subsetSizes[i], ++i)
@@ -797,11 +802,17 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			{
 				// the bounds of the candidates have become invalid and have to be
 				// recomputed
-				#pragma omp parallel for schedule(static, 100)
-				for(size_t i = 0; i < candidates.size(); ++i)
-					candidates[i].RecomputeBounds(octrees, pc, subsetScoreVisitor,
+				#pragma omp parallel
+				{
+				// the score visitor keeps the current octree and indices: one per thread
+				ScorePrimitiveShapeVisitor< FlatNormalThreshPointCompatibilityFunc,
+					ImmediateOctreeType > subsetScoreVisitorCopy(subsetScoreVisitor);
+				#pragma omp for schedule(static, 100)
+				for(intptr_t i = 0; i < (intptr_t)candidates.size(); ++i)
+					candidates[i].RecomputeBounds(octrees, pc, subsetScoreVisitorCopy,
 						currentSize - numInvalid, m_options.m_epsilon,
 						m_options.m_normalThresh, m_options.m_bitmapEpsilon);
+				}
 			}
 			// remove all candidates that have become obsolete
 			std::sort(candidates.begin(), candidates.end(), std::greater< Candidate >());
@@ -5,6 +5,10 @@
 #include <GfxTL/NullClass.h>
 #include <GfxTL/ScalarTypeDeferer.h>
 #include <MiscLib/Random.h>
+#include <vector>
+#ifdef DOPARALLEL
+#include <omp.h>
+#endif
 
 template< unsigned int DimT, class InheritedStrategyT >
 struct ScoreAACubeTreeStrategy
@@ -48,6 +52,31 @@ struct ScoreAACubeTreeStrategy
 				CellCenterTraversalInformation< tibT > TraversalInformation;
 			TraversalInformation ti;
 			this->InitRootTraversalInformation(*BaseType::Root(), &ti);
+#ifdef DOPARALLEL
+			// outside of the parallel regions (e.g. when the best candidate is
+			// refined), the points of the large octrees are tested in parallel
+			if(BaseType::Root()->Size() >= 20000 && !omp_in_parallel()
+				&& omp_get_max_threads() > 1)
+			{
+				// gather the points of the traversed leaves (in the traversal order)
+				PointsGatherer< ScoreT > gatherer(*score);
+				gatherer.m_points.reserve(BaseType::Root()->Size());
+				Score(*BaseType::Root(), ti, shape, &gatherer);
+				const std::vector< DereferencedType > &points = gatherer.m_points;
+				if(points.empty())
+					return;
+				// test them in parallel
+				std::vector< char > compatible(points.size());
+				#pragma omp parallel for schedule(static, 1024)
+				for(intptr_t i = 0; i < (intptr_t)points.size(); ++i)
+					compatible[i] = score->IsCompatible(shape, *this, points[i]) ? 1 : 0;
+				// and add the compatible ones in the same order as the sequential traversal
+				for(size_t i = 0; i < points.size(); ++i)
+					if(compatible[i])
+						score->Add(points[i]);
+				return;
+			}
+#endif
 			Score(*BaseType::Root(), ti, shape, /*maxCellSize,*/ score);
 		}
 
@@ -68,6 +97,23 @@ struct ScoreAACubeTreeStrategy
 		}
 
 	private:
+		typedef typename BaseType::DereferencedType DereferencedType;
+
+		// stands for the score during the traversal: only keeps the points of the traversed leaves
+		template< class ScoreT >
+		struct PointsGatherer
+		{
+			PointsGatherer(const ScoreT &score) : m_epsilon(score.Epsilon()) {}
+			ScalarType Epsilon() const { return m_epsilon; }
+			template< class ShapeT, class OctT >
+			void operator()(const ShapeT &, const OctT &, DereferencedType i)
+			{
+				m_points.push_back(i);
+			}
+			ScalarType m_epsilon;
+			std::vector< DereferencedType > m_points;
+		};
+
 		template< class TraversalInformationT, class ShapeT, class ScoreT >
 		void Score(const CellType &cell, const TraversalInformationT &ti,
 			const ShapeT &shape, /*size_t maxCellSize,*/ ScoreT *score) const
@@ -39,11 +39,16 @@ public:
 	template< class ShapeT, class OctT >
 	void operator()(const ShapeT &shape, const OctT &oct, size_t i)
 	{
-		if((*m_shapeIndex)[i] != -1)
-			return;
-		if(m_pointComp(shape, oct, i))
+		if(IsCompatible(shape, oct, i))
 			m_indices->push_back(i);
 	}
+	// the point test alone (thread-safe) and the insertion of a compatible point
+	template< class ShapeT, class OctT >
+	bool IsCompatible(const ShapeT &shape, const OctT &oct, size_t i) const
+	{
+		return (*m_shapeIndex)[i] == -1 && m_pointComp(shape, oct, i);
+	}
+	void Add(size_t i) { m_indices->push_back(i); }
 	float Epsilon() const { return m_pointComp.DistanceThresh(); }
 	//size_t &UpperBound() { return m_upperBound; }
 	//size_t &SampledPoints() { return m_sampled; }
@@ -50,6 +50,7 @@
 #include <ccCylinder.h>
 #include <ccCone.h>
 #include <ccTorus.h>
+#include <ccProgressDialog.h>
 
 //CCLib
 #include <ScalarField.h>
@@ -140,53 +141,8 @@ void qRansacSD::doAction()
 	const CCVector3d& globalShift = pc->getGlobalShift();
 	double globalScale = pc->getGlobalScale();
 
-	//Convert CC point cloud to RANSAC_SD type
-	PointCloud cloud;
-	{
-		try
-		{
-			cloud.reserve(count);
-		}
-		catch(...)
-		{
-			m_app->dispToConsole("Not enough memory!",ccMainAppInterface::ERR_CONSOLE_MESSAGE);
-			return;
-		}
-
-		//default point & normal
-		Point Pt;
-		Pt.normal[0] = 0.0;
-		Pt.normal[1] = 0.0;
-		Pt.normal[2] = 0.0;
-		for (unsigned i=0; i<count; ++i)
-		{
-			const CCVector3* P = pc->getPoint(i);
-			Pt.pos[0] = static_cast<float>(P->x);
-			Pt.pos[1] = static_cast<float>(P->y);
-			Pt.pos[2] = static_cast<float>(P->z);
-			if (hasNorms)
-			{
-				const CCVector3& N = pc->getPointNormal(i);
-				Pt.normal[0] = static_cast<float>(N.x);
-				Pt.normal[1] = static_cast<float>(N.y);
-				Pt.normal[2] = static_cast<float>(N.z);
-			}
-			cloud.push_back(Pt);
-		}
-		
-		//manually set bounding box!
-		Vec3f cbbMin,cbbMax;
-		cbbMin[0] = static_cast<float>(bbMin.x);
-		cbbMin[1] = static_cast<float>(bbMin.y);
-		cbbMin[2] = static_cast<float>(bbMin.z);
-		cbbMax[0] = static_cast<float>(bbMax.x);
-		cbbMax[1] = static_cast<float>(bbMax.y);
-		cbbMax[2] = static_cast<float>(bbMax.z);
-		cloud.setBBox(cbbMin,cbbMax);
-	}
-
-	//cloud scale (useful for setting several parameters
-	const float scale = cloud.getScale();
+	//cloud scale (useful for setting several parameters)
+	const float scale = std::max(std::max(bbMax.x-bbMin.x, bbMax.y-bbMin.y), bbMax.z-bbMin.z);
 
 	//init dialog with default values
 	ccRansacSDDlg rsdDlg(m_app->getMainWindow());
@@ -242,33 +198,59 @@ void qRansacSD::doAction()
 
 	if (!hasNorms)
 	{
-		QProgressDialog pDlg("Computing normals (please wait)",QString(),0,0,m_app->getMainWindow());
-		pDlg.setWindowTitle("Ransac Shape Detection");
-		pDlg.show();
-		QApplication::processEvents();
+		//we compute the normals directly on the CC cloud (multi-threaded octree based process)
+		//so that they don't have to be converted back afterwards
+		bool hadOctree = (pc->getOctree() != 0);
+		ccProgressDialog pDlg(false,m_app->getMainWindow());
+		if (!pc->computeNormalsWithOctree(LS, ccNormalVectors::UNDEFINED, .01f * scale, &pDlg))
+		{
+			m_app->dispToConsole("Failed to compute normals (not enough memory?)",ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+			return;
+		}
+		if (!hadOctree)
+			pc->deleteOctree();
+		pc->showNormals(true);
 
-		cloud.calcNormals(.01f * scale);
+		//currently selected entities appearance may have changed!
+		pc->prepareDisplayForRefresh_recursive();
+	}
 
-		if (pc->reserveTheNormsTable())
+	//Convert CC point cloud to RANSAC_SD type
+	//(the detector reorders the points in place, so it must work on its own copy)
+	PointCloud cloud;
+	{
+		try
 		{
-			for (unsigned i=0; i<count; ++i)
-			{
-				Vec3f& Nvi = cloud[i].normal;
-				CCVector3 Ni = CCVector3::fromArray(Nvi);
-				//normalize the vector in case of
-				Ni.normalize();
-				pc->addNorm(Ni);
-			}
-			pc->showNormals(true);
-			
-			//currently selected entities appearance may have changed!
-			pc->prepareDisplayForRefresh_recursive();
+			cloud.resize(count);
 		}
-		else
+		catch(...)
 		{
-			m_app->dispToConsole("Not enough memory to compute normals!",ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+			m_app->dispToConsole("Not enough memory!",ccMainAppInterface::ERR_CONSOLE_MESSAGE);
 			return;
 		}
+
+		for (unsigned i=0; i<count; ++i)
+		{
+			const CCVector3* P = pc->getPoint(i);
+			const CCVector3& N = pc->getPointNormal(i);
+			Point& Pt = cloud[i];
+			Pt.pos[0] = static_cast<float>(P->x);
+			Pt.pos[1] = static_cast<float>(P->y);
+			Pt.pos[2] = static_cast<float>(P->z);
+			Pt.normal[0] = static_cast<float>(N.x);
+			Pt.normal[1] = static_cast<float>(N.y);
+			Pt.normal[2] = static_cast<float>(N.z);
+		}
+
+		//manually set bounding box!
+		Vec3f cbbMin,cbbMax;
+		cbbMin[0] = static_cast<float>(bbMin.x);
+		cbbMin[1] = static_cast<float>(bbMin.y);
+		cbbMin[2] = static_cast<float>(bbMin.z);
+		cbbMax[0] = static_cast<float>(bbMax.x);
+		cbbMax[1] = static_cast<float>(bbMax.y);
+		cbbMax[2] = static_cast<float>(bbMax.z);
+		cloud.setBBox(cbbMin,cbbMax);
 	}
 
 	// set which primitives are to be detected by adding the respective constructors
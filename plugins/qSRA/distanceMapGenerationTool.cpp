@@ -35,6 +35,11 @@
 #include <QFile>
 #include <QTextStream>
 #include <QMainWindow>
+#include <QThread>
+#include <QtConcurrentMap>
+
+//system
+#include <algorithm>
 
 //Meta-data key for profile (polyline) axis
 const char REVOLUTION_AXIS_KEY[]  = "RevolutionAxis";
@@ -60,6 +65,311 @@ static inline double ComputeLatitude_rad(	PointCoordinateType x,
 	return atan(z / sqrt(static_cast<double>(r)));
 }
 
+//! Profile segments indexed by height
+/** The profile is expressed in its 2D frame (X = radius, Y = height). Its height range
+	is divided in regular bins and each (non horizontal) segment is referenced by all the
+	bins its height interval overlaps. The segments facing a given height are then searched
+	among the (few) ones of the corresponding bin instead of the whole profile.
+	The candidates are tested (and sorted) exactly as a full scan of the profile would do.
+**/
+class ProfileSegmentIndex
+{
+public:
+
+	//! Profile segment
+	struct Segment
+	{
+		CCVector2 A, B;
+	};
+
+	//! Default constructor
+	ProfileSegmentIndex() : m_yMin(0), m_binSize(1.0) {}
+
+	//! Indexes the segments of a profile
+	bool init(CCLib::GenericIndexedCloudPersist* vertices)
+	{
+		m_segments.clear();
+		m_binOffsets.clear();
+		m_binSegments.clear();
+
+		unsigned vertexCount = (vertices ? vertices->size() : 0);
+		if (vertexCount < 2)
+			return false;
+
+		try
+		{
+			m_segments.resize(vertexCount-1);
+			double yMax = 0;
+			for (unsigned j=1; j<vertexCount; ++j)
+			{
+				const CCVector3* A = vertices->getPoint(j-1);
+				const CCVector3* B = vertices->getPoint(j);
+				m_segments[j-1].A = CCVector2(A->x, A->y);
+				m_segments[j-1].B = CCVector2(B->x, B->y);
+
+				double y = static_cast<double>(A->y);
+				if (j == 1 || y < m_yMin)
+					m_yMin = y;
+				if (j == 1 || y > yMax)
+					yMax = y;
+				y = static_cast<double>(B->y);
+				if (y < m_yMin)
+					m_yMin = y;
+				if (y > yMax)
+					yMax = y;
+			}
+
+			//roughly one segment per bin
+			unsigned binCount = static_cast<unsigned>(m_segments.size());
+			m_binSize = (yMax - m_yMin) / binCount;
+			if (m_binSize <= 0)
+			{
+				//flat profile: a single bin (whatever its size)
+				binCount = 1;
+				m_binSize = 1.0;
+			}
+
+			//count the segments per bin (CSR layout)
+			std::vector<unsigned> firstBins(m_segments.size());
+			std::vector<unsigned> lastBins(m_segments.size());
+			m_binOffsets.resize(binCount+1, 0);
+			for (size_t k=0; k<m_segments.size(); ++k)
+			{
+				const Segment& seg = m_segments[k];
+				//horizontal segments never face any height (see radialDist)
+				if (seg.A.y == seg.B.y)
+				{
+					firstBins[k] = 1;
+					lastBins[k] = 0;
+					continue;
+				}
+				//small margin to be robust to rounding errors at the segment ends
+				double margin = 1.0e-6 * m_binSize;
+				firstBins[k] = bin(std::min<double>(seg.A.y, seg.B.y) - margin);
+				lastBins[k] = bin(std::max<double>(seg.A.y, seg.B.y) + margin);
+				for (unsigned b=firstBins[k]; b<=lastBins[k]; ++b)
+					++m_binOffsets[b+1];
+			}
+			for (unsigned b=0; b<binCount; ++b)
+				m_binOffsets[b+1] += m_binOffsets[b];
+
+			//fill the bins (the segments remain sorted in each bin)
+			m_binSegments.resize(m_binOffsets.back());
+			std::vector<unsigned> cursors(m_binOffsets.begin(), m_binOffsets.end()-1);
+			for (size_t k=0; k<m_segments.size(); ++k)
+				for (unsigned b=firstBins[k]; b<=lastBins[k]; ++b)
+					m_binSegments[cursors[b]++] = static_cast<unsigned>(k);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			m_segments.clear();
+			m_binOffsets.clear();
+			m_binSegments.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	//! Returns the radial distance between a point and the nearest segment facing its height
+	/** \param height point height (in the profile frame)
+		\param radius point radius (in the profile frame)
+		\return the (signed) distance or NAN_VALUE if no segment faces this height
+	**/
+	ScalarType radialDist(double height, double radius) const
+	{
+		ScalarType minDist = NAN_VALUE;
+
+		unsigned b = bin(height);
+		for (unsigned k=m_binOffsets[b]; k<m_binOffsets[b+1]; ++k)
+		{
+			const Segment& seg = m_segments[m_binSegments[k]];
+
+			double alpha = (height - seg.A.y)/(seg.B.y - seg.A.y);
+			if (alpha >= 0.0 && alpha <= 1.0)
+			{
+				//we deduce the right radius by linear interpolation
+				double radius_th = seg.A.x + alpha * (seg.B.x - seg.A.x);
+				double dist = radius - radius_th;
+
+				//we look at the closest segment (if the polyline is concave!)
+				if (!CCLib::ScalarField::ValidValue(minDist) || dist*dist < minDist*minDist)
+				{
+					minDist = static_cast<ScalarType>(dist);
+				}
+			}
+		}
+
+		return minDist;
+	}
+
+	//! Returns the first segment (in the profile order) facing a given height (or 0 if none)
+	const Segment* firstSegment(double height) const
+	{
+		unsigned b = bin(height);
+		for (unsigned k=m_binOffsets[b]; k<m_binOffsets[b+1]; ++k)
+		{
+			const Segment& seg = m_segments[m_binSegments[k]];
+			double alpha = (height - seg.A.y)/(seg.B.y - seg.A.y);
+			if (alpha >= 0.0 && alpha <= 1.0)
+				return &seg;
+		}
+		return 0;
+	}
+
+protected:
+
+	//! Returns the bin corresponding to a given height (heights outside the profile range are clamped)
+	inline unsigned bin(double height) const
+	{
+		double b = floor((height - m_yMin) / m_binSize);
+		if (b <= 0)
+			return 0;
+		unsigned binCount = static_cast<unsigned>(m_binOffsets.size()) - 1;
+		return (b < binCount ? static_cast<unsigned>(b) : binCount-1);
+	}
+
+	//! Segments
+	std::vector<Segment> m_segments;
+	//! Index of the first segment of each bin in 'm_binSegments' (size = bin count + 1)
+	std::vector<unsigned> m_binOffsets;
+	//! Segments of each bin
+	std::vector<unsigned> m_binSegments;
+	//! Min height
+	double m_yMin;
+	//! Bins height
+	double m_binSize;
+};
+
+//! Number of points processed by each job
+static const unsigned POINTS_PER_SRA_JOB = 16384;
+
+//! Job of DistanceMapGenerationTool::ComputeRadialDist (a range of points)
+struct RadialDistJob
+{
+	const ccPointCloud* cloud;
+	const ProfileSegmentIndex* profileIndex;
+	CCVector3d profileOrigin;
+	unsigned char revolDim, dim1, dim2;
+	ccScalarField* sf;
+	ccScalarField* radiiSf;
+	unsigned firstIndex;
+	unsigned lastIndex;
+};
+
+static void ComputeRadialDistRange(RadialDistJob& job)
+{
+	for (unsigned i=job.firstIndex; i<job.lastIndex; ++i)
+	{
+		const CCVector3* P = job.cloud->getPoint(i);
+
+		//relative point position
+		CCVector3d Prel(P->x - job.profileOrigin.x,
+						P->y - job.profileOrigin.y,
+						P->z - job.profileOrigin.z);
+
+		//deduce point height and radius (i.e. in profile 2D 'frame')
+		double height = Prel.u[job.revolDim];
+		//TODO FIXME: we assume the surface of revolution is smooth!
+		double radius = sqrt(Prel.u[job.dim1]*Prel.u[job.dim1] + Prel.u[job.dim2]*Prel.u[job.dim2]);
+
+		if (job.radiiSf)
+		{
+			ScalarType radiusVal = static_cast<ScalarType>(radius);
+			job.radiiSf->setValue(i,radiusVal);
+		}
+
+		//search nearest "segment" in polyline
+		job.sf->setValue(i,job.profileIndex->radialDist(height,radius));
+	}
+}
+
+//! Job of DistanceMapGenerationTool::CreateMap (projection of a range of points)
+struct MapProjectionJob
+{
+	const ccPointCloud* cloud;
+	const ccScalarField* sf;
+	CCVector3d revolutionOrigin;
+	unsigned char X, Y, Z;
+	bool spherical;
+	double ccw;
+	const DistanceMapGenerationTool::Map* grid;
+	//! Output cell index of each point of the range (or -1 if the point is skipped)
+	int* cellIndexes;
+	unsigned firstIndex;
+	unsigned lastIndex;
+};
+
+static void ProjectPointsOnMap(MapProjectionJob& job)
+{
+	const DistanceMapGenerationTool::Map& grid = *job.grid;
+
+	for (unsigned n=job.firstIndex; n<job.lastIndex; ++n)
+	{
+		int& cellIndex = job.cellIndexes[n-job.firstIndex];
+		cellIndex = -1;
+
+		//we skip invalid values
+		const ScalarType& val = job.sf->getValue(n);
+		if (!CCLib::ScalarField::ValidValue(val))
+			continue;
+
+		const CCVector3* P = job.cloud->getPoint(n);
+		CCVector3 relativePos(	P->x - static_cast<PointCoordinateType>(job.revolutionOrigin.x),
+								P->y - static_cast<PointCoordinateType>(job.revolutionOrigin.y),
+								P->z - static_cast<PointCoordinateType>(job.revolutionOrigin.z) );
+
+		//convert to cylindrical or spherical coordinates
+		double x = job.ccw * atan2(relativePos.u[job.X],relativePos.u[job.Y]); //longitude
+		if (x < 0.0)
+			x += 2.0 * M_PI;
+		
+		double y = 0.0;
+		if (job.spherical)
+		{
+			y = ComputeLatitude_rad(relativePos.u[job.X],relativePos.u[job.Y],relativePos.u[job.Z]); //latitude between 0 and pi/2
+		}
+		else
+		{
+			y = relativePos.u[job.Z]; //height
+		}
+
+		int i = static_cast<int>((x-grid.xMin)/grid.xStep);
+		int j = static_cast<int>((y-grid.yMin)/grid.yStep);
+
+		//if we fall exactly on the max corner of the grid box
+		if (i == static_cast<int>(grid.xSteps))
+			--i;
+		if (j == static_cast<int>(grid.ySteps))
+			--j;
+
+		//we skip points outside the box!
+		if (	i < 0 || i >= static_cast<int>(grid.xSteps)
+			||	j < 0 || j >= static_cast<int>(grid.ySteps) )
+		{
+			continue;
+		}
+		assert(i >= 0 && j >= 0);
+
+		cellIndex = j*static_cast<int>(grid.xSteps)+i;
+	}
+}
+
+//! Prepares the jobs of the next batch of points
+template <class Job> static void PrepareNextBatch(const Job& prototype, unsigned& first, unsigned pointCount, unsigned jobsPerBatch, std::vector<Job>& jobs)
+{
+	jobs.clear();
+	for (unsigned j=0; j<jobsPerBatch && first<pointCount; ++j)
+	{
+		Job job = prototype;
+		job.firstIndex = first;
+		job.lastIndex = (pointCount - first > POINTS_PER_SRA_JOB ? first + POINTS_PER_SRA_JOB : pointCount);
+		jobs.push_back(job);
+		first = job.lastIndex;
+	}
+}
+
 void DistanceMapGenerationTool::SetPoylineAxis(ccPolyline* polyline, int axisDim)
 {
 	assert(polyline);
@@ -210,60 +520,44 @@ bool DistanceMapGenerationTool::ComputeRadialDist(	ccPointCloud* cloud,
 			}
 		}
 
+		//index the profile segments by height
+		ProfileSegmentIndex profileIndex;
+		if (!profileIndex.init(vertices))
+		{
+			if (app)
+				app->dispToConsole(QString("Not enough memory!"),ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+			return false;
+		}
+
 		ccProgressDialog dlg(true, app ? app->getMainWindow() : 0);
 		dlg.setMethodTitle("Cloud to profile radial distance");
 		dlg.setInfo(qPrintable(QString("Polyline: %1 vertices\nCloud: %2 points").arg(vertexCount).arg(pointCount)));
 		dlg.start();
 		CCLib::NormalizedProgress nProgress(static_cast<CCLib::GenericProgressCallback*>(&dlg),pointCount);
 
-		for (unsigned i=0; i<pointCount; ++i)
+		RadialDistJob prototype;
+		prototype.cloud = cloud;
+		prototype.profileIndex = &profileIndex;
+		prototype.profileOrigin = profileOrigin;
+		prototype.revolDim = static_cast<unsigned char>(revolDim);
+		prototype.dim1 = dim1;
+		prototype.dim2 = dim2;
+		prototype.sf = sf;
+		prototype.radiiSf = radiiSf;
+		prototype.firstIndex = prototype.lastIndex = 0;
+
+		//the points are processed in parallel, by batches (so that the progress can be updated and the user can cancel the process)
+		unsigned jobsPerBatch = static_cast<unsigned>(std::max(1,QThread::idealThreadCount())) * 4;
+		std::vector<RadialDistJob> jobs;
+		for (unsigned first=0; first<pointCount; )
 		{
-			const CCVector3* P = cloud->getPoint(i);
+			PrepareNextBatch(prototype, first, pointCount, jobsPerBatch, jobs);
+			QtConcurrent::blockingMap(jobs, ComputeRadialDistRange);
 
-			//relative point position
-			CCVector3d Prel(P->x - profileOrigin.x,
-							P->y - profileOrigin.y,
-							P->z - profileOrigin.z);
-
-			//deduce point height and radius (i.e. in profile 2D 'frame')
-			double height = Prel.u[revolDim];
-			//TODO FIXME: we assume the surface of revolution is smooth!
-			double radius = sqrt(Prel.u[dim1]*Prel.u[dim1] + Prel.u[dim2]*Prel.u[dim2]);
-
-			if (radiiSf)
-			{
-				ScalarType radiusVal = static_cast<ScalarType>(radius);
-				radiiSf->setValue(i,radiusVal);
-			}
-
-			//search nearest "segment" in polyline
-			ScalarType minDist = NAN_VALUE;
-			for (unsigned j=1; j<vertexCount; ++j)
-			{
-				const CCVector3* A = vertices->getPoint(j-1);
-				const CCVector3* B = vertices->getPoint(j);
-
-				double alpha = (height - A->y)/(B->y - A->y);
-				if (alpha >= 0.0 && alpha <= 1.0)
-				{
-					//we deduce the right radius by linear interpolation
-					double radius_th = A->x + alpha * (B->x - A->x);
-					double dist = radius - radius_th;
-
-					//we look at the closest segment (if the polyline is concave!)
-					if (!CCLib::ScalarField::ValidValue(minDist) || dist*dist < minDist*minDist)
-					{
-						minDist = static_cast<ScalarType>(dist);
-					}
-				}
-			}
-
-			sf->setValue(i,minDist);
-
-			if (!nProgress.oneStep())
+			if (!nProgress.steps(jobs.back().lastIndex - jobs.front().firstIndex))
 			{
 				//cancelled by user
-				for (unsigned j=i; j<pointCount; ++j)
+				for (unsigned j=first; j<pointCount; ++j)
 					sf->setValue(j,NAN_VALUE);
 
 				break;
@@ -451,83 +745,80 @@ QSharedPointer<DistanceMapGenerationTool::Map> DistanceMapGenerationTool::Create
 	grid->counterclockwise = counterclockwise;
 	double ccw = (counterclockwise ? -1.0 : 1.0);
 
-	for (unsigned n=0; n<count; ++n)
+	//the points are projected in parallel (by batches) and then accumulated in the cells in their original order
+	MapProjectionJob prototype;
+	prototype.cloud = cloud;
+	prototype.sf = sf;
+	prototype.revolutionOrigin = revolutionOrigin;
+	prototype.X = X;
+	prototype.Y = Y;
+	prototype.Z = Z;
+	prototype.spherical = spherical;
+	prototype.ccw = ccw;
+	prototype.grid = grid.data();
+	prototype.cellIndexes = 0;
+	prototype.firstIndex = prototype.lastIndex = 0;
+
+	unsigned jobsPerBatch = static_cast<unsigned>(std::max(1,QThread::idealThreadCount())) * 4;
+	std::vector<MapProjectionJob> jobs;
+	std::vector<int> cellIndexes;
+	try
 	{
-		//we skip invalid values
-		const ScalarType& val = sf->getValue(n);
-		if (!CCLib::ScalarField::ValidValue(val))
-			continue;
-
-		const CCVector3* P = cloud->getPoint(n);
-		CCVector3 relativePos(	P->x - static_cast<PointCoordinateType>(revolutionOrigin.x),
-								P->y - static_cast<PointCoordinateType>(revolutionOrigin.y),
-								P->z - static_cast<PointCoordinateType>(revolutionOrigin.z) );
-
-		//convert to cylindrical or spherical coordinates
-		double x = ccw * atan2(relativePos.u[X],relativePos.u[Y]); //longitude
-		if (x < 0.0)
-			x += 2.0 * M_PI;
-		
-		double y = 0.0;
-		if (spherical)
-		{
-			y = ComputeLatitude_rad(relativePos.u[X],relativePos.u[Y],relativePos.u[Z]); //latitude between 0 and pi/2
-		}
-		else
-		{
-			y = relativePos.u[Z]; //height
-		}
-
-		int i = static_cast<int>((x-grid->xMin)/grid->xStep);
-		int j = static_cast<int>((y-grid->yMin)/grid->yStep);
+		cellIndexes.resize(std::min<size_t>(count, static_cast<size_t>(jobsPerBatch) * POINTS_PER_SRA_JOB));
+	}
+	catch (const std::bad_alloc&)
+	{
+		if (app)
+			app->dispToConsole(QString("[DistanceMapGenerationTool] Not enough memory!"),ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return QSharedPointer<Map>(0);
+	}
 
-		//if we fall exactly on the max corner of the grid box
-		if (i == static_cast<int>(grid->xSteps))
-			--i;
-		if (j == static_cast<int>(grid->ySteps))
-			--j;
+	for (unsigned first=0; first<count; )
+	{
+		PrepareNextBatch(prototype, first, count, jobsPerBatch, jobs);
+		unsigned batchStart = jobs.front().firstIndex;
+		for (size_t k=0; k<jobs.size(); ++k)
+			jobs[k].cellIndexes = &(cellIndexes[jobs[k].firstIndex - batchStart]);
+		QtConcurrent::blockingMap(jobs, ProjectPointsOnMap);
 
-		//we skip points outside the box!
-		if (	i < 0 || i >= static_cast<int>(grid->xSteps)
-			||	j < 0 || j >= static_cast<int>(grid->ySteps) )
+		for (unsigned n=batchStart; n<first; ++n)
 		{
-			continue;
-		}
-		assert(i >= 0 && j >= 0);
+			int cellIndex = cellIndexes[n-batchStart];
+			if (cellIndex < 0)
+				continue;
 
-		MapCell& cell = (*grid)[j*static_cast<int>(grid->xSteps)+i];
-		if (cell.count) //if there's already values projected in this cell
-		{
-			switch (fillStrategy)
+			const ScalarType& val = sf->getValue(n);
+			MapCell& cell = (*grid)[cellIndex];
+			if (cell.count) //if there's already values projected in this cell
 			{
-			case FILL_STRAT_MIN_DIST:
-				// Set the minimum SF value
-				if (val < cell.value)
-					cell.value = val;
-				break;
-			case FILL_STRAT_AVG_DIST:
-				// Sum the values
-				cell.value += static_cast<double>(val);
-				break;
-			case FILL_STRAT_MAX_DIST:
-				// Set the maximum SF value
-				if (val > cell.value)
-					cell.value = val;
-				break;
-			default:
-				assert(false);
-				break;
+				switch (fillStrategy)
+				{
+				case FILL_STRAT_MIN_DIST:
+					// Set the minimum SF value
+					if (val < cell.value)
+						cell.value = val;
+					break;
+				case FILL_STRAT_AVG_DIST:
+					// Sum the values
+					cell.value += static_cast<double>(val);
+					break;
+				case FILL_STRAT_MAX_DIST:
+					// Set the maximum SF value
+					if (val > cell.value)
+						cell.value = val;
+					break;
+				default:
+					assert(false);
+					break;
+				}
 			}
+			else
+			{
+				//for the first point, we simply have to store its associated value (whatever the case)
+				cell.value = val;
+			}
+			++cell.count;
 		}
-		else
-		{
-			//for the first point, we simply have to store its associated value (whatever the case)
-			cell.value = val;
-		}
-		++cell.count;
-
-		//if (progressCb)
-		//	progressCb->update(30.0 * (float)n / (float)cloud->size());
 	}
 
 	//we need to finish the average values computation
@@ -943,6 +1234,11 @@ bool DistanceMapGenerationTool::ComputeSurfacesAndVolumes(	const QSharedPointer<
 	if (revolDim < 0)
 		return false;
 
+	//index the profile segments by height
+	ProfileSegmentIndex profileIndex;
+	if (!profileIndex.init(vertices))
+		return false;
+
 	//constant factors
 	const double surfPart = map->xStep / 2.0;				//perimeter of a portion of circle of angle alpha = alpha * r (* height to get the external surface)
 	const double volPart = map->yStep * map->xStep / 6.0;	//area of a portion of circle of angle alpha = alpha/2 * r^2 (* height to get the volume)
@@ -959,18 +1255,14 @@ bool DistanceMapGenerationTool::ComputeSurfacesAndVolumes(	const QSharedPointer<
 		
 		//search nearest "segment" in polyline
 		double height_middle = (height1 + height2)/2.0;
-		for (unsigned k=1; k<vertexCount; ++k)
+		//FIXME: we hope that there's only one segment facing this particular height?!
+		const ProfileSegmentIndex::Segment* seg = profileIndex.firstSegment(height_middle);
+		if (seg)
 		{
-			const CCVector3* A = vertices->getPoint(k-1);
-			const CCVector3* B = vertices->getPoint(k);
-
-			double alpha = (height_middle - A->y)/(B->y - A->y);
-			if (alpha >= 0.0 && alpha <= 1.0)
-			{
-				r_th1 = A->x + (height1 - A->y)/(B->y - A->y) * (B->x - A->x);
-				r_th2 = A->x + (height2 - A->y)/(B->y - A->y) * (B->x - A->x);
-				break; //FIXME: we hope that there's only one segment facing this particular height?!
-			}
+			const CCVector2& A = seg->A;
+			const CCVector2& B = seg->B;
+			r_th1 = A.x + (height1 - A.y)/(B.y - A.y) * (B.x - A.x);
+			r_th2 = A.x + (height2 - A.y)/(B.y - A.y) * (B.x - A.x);
 		}
 
 		if (r_th1 >= 0.0 /* && r_th2 >= 0.0*/)
@@ -2,10 +2,14 @@
 
 //CCLib
 #include <CloudSamplingTools.h>
+#include <DistanceComputationTools.h>
+#include <GeometricalAnalysisTools.h>
+#include <OutOfCoreOctree.h>
 #include <WeibullDistribution.h>
 #include <NormalDistribution.h>
 #include <StatisticalTestingTools.h>
 #include <Neighbourhood.h>
+#include <ReferenceCloud.h>
 
 //qCC_db
 #include <ccProgressDialog.h>
@@ -21,6 +25,8 @@
 #include <FBXFilter.h>
 #include <BinFilter.h>
 #include <PlyFilter.h>
+#include <LASFilter.h>
+#include <STLFilter.h>
 
 //qCC
 #include "ccCommon.h"
@@ -37,6 +43,10 @@
 #include <QDialog>
 #include <QFile>
 #include <QFileInfo>
+#include <QDir>
+#include <QProcess>
+#include <QThread>
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QElapsedTimer>
 #include <QStringList>
@@ -49,6 +59,13 @@ static const char COMMAND_SILENT_MODE[]						= "SILENT";
 static const char COMMAND_OPEN[]							= "O";				//+file name
 static const char COMMAND_OPEN_SKIP_LINES[]					= "SKIP";			//+number of lines to skip
 static const char COMMAND_OPEN_SHIFT_ON_LOAD[]				= "GLOBAL_SHIFT";	//+global shift
+static const char COMMAND_OPEN_LAS_BBOX_2D[]				= "LAS_BBOX_2D";	//+xmin ymin xmax ymax
+static const char COMMAND_OPEN_LAS_BBOX_3D[]				= "LAS_BBOX_3D";	//+xmin ymin zmin xmax ymax zmax
+static const char COMMAND_OPEN_LAS_CLASSIF[]				= "LAS_CLASSIF";	//+list of classes (e.g. "2,3-5")
+static const char COMMAND_OPEN_LAS_RETURN[]					= "LAS_RETURN";		//+FIRST/LAST/return number
+static const char COMMAND_OPEN_LAS_DECIMATE[]				= "LAS_DECIMATE";	//+decimation step
+static const char COMMAND_OPEN_LAS_NO_FILTER[]				= "LAS_NO_FILTER";
+static const char COMMAND_OPEN_STL_FUSION[]					= "STL_FUSION";		//+NONE/EXACT/TOLERANCE
 static const char COMMAND_KEYWORD_AUTO[]					= "AUTO";			//"AUTO" keyword
 static const char COMMAND_SUBSAMPLE[]						= "SS";				//+ method (RANDOM/SPATIAL/OCTREE) + parameter (resp. point count / spatial step / octree level)
 static const char COMMAND_CURVATURE[]						= "CURV";			//+ curvature type (MEAN/GAUSS) +
@@ -64,11 +81,20 @@ static const char COMMAND_BUNDLER_UNDISTORT[]				= "UNDISTORT";
 static const char COMMAND_BUNDLER_COLOR_DTM[]				= "COLOR_DTM";
 static const char COMMAND_C2M_DIST[]						= "C2M_DIST";
 static const char COMMAND_C2M_DIST_FLIP_NORMALS[]			= "FLIP_NORMS";
+static const char COMMAND_C2M_DIST_BVH[]					= "BVH";
 static const char COMMAND_C2C_DIST[]						= "C2C_DIST";
 static const char COMMAND_C2C_SPLIT_XYZ[]					= "SPLIT_XYZ";
 static const char COMMAND_C2C_LOCAL_MODEL[]					= "MODEL";
 static const char COMMAND_MAX_DISTANCE[]					= "MAX_DIST";
 static const char COMMAND_OCTREE_LEVEL[]					= "OCTREE_LEVEL";
+static const char COMMAND_M3C2[]							= "M3C2";			//distances along the local normals between the first two clouds
+static const char COMMAND_M3C2_NORMAL_SCALE[]				= "NORMAL_SCALE";	//+ diameter(s) of the normals neighbourhoods (comma separated)
+static const char COMMAND_M3C2_PROJ_SCALE[]					= "PROJ_SCALE";		//+ diameter of the projection cylinders
+static const char COMMAND_M3C2_MAX_DEPTH[]					= "MAX_DEPTH";		//+ (half) length of the projection cylinders
+static const char COMMAND_M3C2_CORE_POINTS[]				= "CORE_POINTS";	//+ min distance between core points (spatial subsampling of the first cloud)
+static const char COMMAND_M3C2_REG_ERROR[]					= "REG_ERROR";		//+ registration error
+static const char COMMAND_M3C2_USE_MEDIAN[]					= "USE_MEDIAN";
+static const char COMMAND_M3C2_ORIENT[]						= "ORIENT";			//+ preferred orientation of the normals (X Y Z)
 static const char COMMAND_SAMPLE_MESH[]						= "SAMPLE_MESH";
 static const char COMMAND_MERGE_CLOUDS[]					= "MERGE_CLOUDS";
 static const char COMMAND_STAT_TEST[]						= "STAT_TEST";
@@ -92,12 +118,15 @@ static const char COMMAND_ICP_RANDOM_SAMPLING_LIMIT[]		= "RANDOM_SAMPLING_LIMIT"
 static const char COMMAND_ICP_ENABLE_FARTHEST_REMOVAL[]		= "FARTHEST_REMOVAL";
 static const char COMMAND_ICP_USE_MODEL_SF_AS_WEIGHT[]		= "MODEL_SF_AS_WEIGHTS";
 static const char COMMAND_ICP_USE_DATA_SF_AS_WEIGHT[]		= "DATA_SF_AS_WEIGHTS";
+static const char COMMAND_ICP_RMS_MATRIX[]					= "ICP_RMS_MATRIX";
+static const char COMMAND_ICP_RMS_MATRIX_ANGULAR_STEP[]		= "ANGULAR_STEP";
 static const char COMMAND_CLOUD_EXPORT_FORMAT[]				= "C_EXPORT_FMT";
 static const char COMMAND_ASCII_EXPORT_PRECISION[]			= "PREC";
 static const char COMMAND_ASCII_EXPORT_SEPARATOR[]			= "SEP";
 static const char COMMAND_ASCII_EXPORT_ADD_COL_HEADER[]		= "ADD_HEADER";
 static const char COMMAND_ASCII_EXPORT_ADD_PTS_COUNT[]		= "ADD_PTS_COUNT";
 static const char COMMAND_PLY_EXPORT_FORMAT[]				= "PLY_EXPORT_FMT";
+static const char COMMAND_BIN_COMPRESSION[]					= "BIN_COMPRESSION";
 static const char COMMAND_FBX_EXPORT_FORMAT[]				= "FBX_EXPORT_FMT";
 static const char COMMAND_MESH_EXPORT_FORMAT[]				= "M_EXPORT_FMT";
 static const char COMMAND_EXPORT_EXTENSION[]				= "EXT";
@@ -121,6 +150,21 @@ static const char COMMAND_CROSS_SECTION[]					= "CROSS_SECTION";
 static const char COMMAND_LOG_FILE[]						= "LOG_FILE";
 static const char COMMAND_SF_ARITHMETIC[]					= "SF_ARITHMETIC";
 static const char COMMAND_SOR_FILTER[]						= "SOR";
+static const char COMMAND_BATCH[]							= "BATCH";			//+ input files + commands to apply to each file
+static const char COMMAND_BATCH_WORKERS[]					= "WORKERS";		//+ number of parallel workers
+static const char COMMAND_BATCH_MAX_MEMORY[]				= "MAX_MEMORY";		//+ memory budget (in Mb)
+static const char COMMAND_BATCH_MEMORY_RATIO[]				= "MEMORY_RATIO";	//+ estimated memory consumption / input file size
+static const char COMMAND_BATCH_REPORT[]					= "REPORT";			//+ report filename
+static const char COMMAND_BATCH_FILE_LIST[]					= "FILE_LIST";		//+ text file (one input filename per line)
+static const char BATCH_FILE_TOKEN[]						= "{FILE}";
+static const char COMMAND_TILES[]							= "TILES";			//+ input LAS file + commands to apply to each tile (the file is split in a single pass)
+static const char COMMAND_TILES_SIZE[]						= "TILE_SIZE";		//+ tile dimensions (X and Y)
+static const char COMMAND_TILES_HALO[]						= "HALO";			//+ halo width (overlap between tiles)
+static const char COMMAND_TILES_OUTPUT_DIR[]				= "OUTPUT_DIR";		//+ output directory
+static const char COMMAND_OUT_OF_CORE[]						= "OUT_OF_CORE";	//+ input LAS file + DENSITY, ROUGH or C2C_DIST (computed without loading the file)
+static const char COMMAND_OUT_OF_CORE_MEMORY[]				= "MEMORY";			//+ memory limit (in Mb)
+static const char COMMAND_OUT_OF_CORE_TEMP_DIR[]			= "TEMP_DIR";		//+ directory of the temporary files
+static const char COMMAND_OUT_OF_CORE_OUTPUT[]				= "OUTPUT";			//+ output LAS file
 
 static const char OPTION_ALL_AT_ONCE[]						= "ALL_AT_ONCE";
 static const char OPTION_ON[]								= "ON";
@@ -494,6 +538,11 @@ bool ccCommandLineParser::commandLoad(QStringList& arguments)
 
 	//optional parameters
 	int skipLines = 0;
+#ifdef CC_LAS_SUPPORT
+	//LAS load-time filters (persistent, as the other loading options)
+	LASLoadFilters lasFilters = LASFilter::GetLoadFilters();
+	bool lasFiltersChanged = false;
+#endif
 	while (!arguments.empty())
 	{
 		QString argument = arguments.front();
@@ -554,12 +603,142 @@ bool ccCommandLineParser::commandLoad(QStringList& arguments)
 				s_loadParameters.m_coordinatesShift = shiftOnLoadVec;
 			}
 		}
+#ifdef CC_LAS_SUPPORT
+		else if (IsCommand(argument,COMMAND_OPEN_LAS_BBOX_2D) || IsCommand(argument,COMMAND_OPEN_LAS_BBOX_3D))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			bool use3D = IsCommand(argument,COMMAND_OPEN_LAS_BBOX_3D);
+			int valueCount = use3D ? 6 : 4;
+			if (arguments.size() < valueCount)
+				return Error(QString("Missing parameter: box after '%1' (%2 values expected)").arg(argument).arg(valueCount));
+
+			double values[6] = {0,0,0,0,0,0};
+			for (int i=0; i<valueCount; ++i)
+			{
+				bool ok;
+				values[i] = arguments.takeFirst().toDouble(&ok);
+				if (!ok)
+					return Error(QString("Invalid parameter: box coordinate #%1 after '%2'").arg(i+1).arg(argument));
+			}
+
+			lasFilters.useBox = true;
+			lasFilters.useBoxZ = use3D;
+			if (use3D)
+			{
+				lasFilters.boxMin = CCVector3d(values[0],values[1],values[2]);
+				lasFilters.boxMax = CCVector3d(values[3],values[4],values[5]);
+			}
+			else
+			{
+				lasFilters.boxMin = CCVector3d(values[0],values[1],0);
+				lasFilters.boxMax = CCVector3d(values[2],values[3],0);
+			}
+			if (lasFilters.boxMin.x > lasFilters.boxMax.x || lasFilters.boxMin.y > lasFilters.boxMax.y || lasFilters.boxMin.z > lasFilters.boxMax.z)
+				return Error(QString("Invalid parameter: empty box after '%1' (min values must be followed by max values)").arg(argument));
+			lasFiltersChanged = true;
+		}
+		else if (IsCommand(argument,COMMAND_OPEN_LAS_CLASSIF))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: list of classes after '%1'").arg(COMMAND_OPEN_LAS_CLASSIF));
+
+			QString list = arguments.takeFirst();
+			if (!lasFilters.setClassifications(list))
+				return Error(QString("Invalid parameter: list of classes after '%1' (e.g. 2,3-5)").arg(COMMAND_OPEN_LAS_CLASSIF));
+			lasFiltersChanged = true;
+		}
+		else if (IsCommand(argument,COMMAND_OPEN_LAS_RETURN))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: FIRST, LAST or return number after '%1'").arg(COMMAND_OPEN_LAS_RETURN));
+
+			QString returnStr = arguments.takeFirst().toUpper();
+			if (returnStr == "FIRST")
+			{
+				lasFilters.returnFilter = LASLoadFilters::FIRST_RETURN;
+			}
+			else if (returnStr == "LAST")
+			{
+				lasFilters.returnFilter = LASLoadFilters::LAST_RETURN;
+			}
+			else
+			{
+				bool ok;
+				int returnNumber = returnStr.toInt(&ok);
+				if (!ok || returnNumber < 1 || returnNumber > 15)
+					return Error(QString("Invalid parameter: FIRST, LAST or return number (1-15) expected after '%1'").arg(COMMAND_OPEN_LAS_RETURN));
+				lasFilters.returnFilter = LASLoadFilters::RETURN_NUMBER;
+				lasFilters.returnNumber = static_cast<unsigned>(returnNumber);
+			}
+			lasFiltersChanged = true;
+		}
+		else if (IsCommand(argument,COMMAND_OPEN_LAS_DECIMATE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: decimation step after '%1'").arg(COMMAND_OPEN_LAS_DECIMATE));
+
+			bool ok;
+			int step = arguments.takeFirst().toInt(&ok);
+			if (!ok || step < 1)
+				return Error(QString("Invalid parameter: decimation step after '%1' (positive integer expected)").arg(COMMAND_OPEN_LAS_DECIMATE));
+			lasFilters.decimationStep = static_cast<unsigned>(step);
+			lasFiltersChanged = true;
+		}
+		else if (IsCommand(argument,COMMAND_OPEN_LAS_NO_FILTER))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			lasFilters = LASLoadFilters();
+			lasFiltersChanged = true;
+		}
+#endif
+		else if (IsCommand(argument,COMMAND_OPEN_STL_FUSION))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: NONE, EXACT or TOLERANCE after '%1'").arg(COMMAND_OPEN_STL_FUSION));
+
+			QString fusionStr = arguments.takeFirst().toUpper();
+			if (fusionStr == "NONE")
+				STLFilter::SetVertexFusionMode(STLFilter::NO_FUSION);
+			else if (fusionStr == "EXACT")
+				STLFilter::SetVertexFusionMode(STLFilter::EXACT_FUSION);
+			else if (fusionStr == "TOLERANCE")
+				STLFilter::SetVertexFusionMode(STLFilter::TOLERANCE_FUSION);
+			else
+				return Error(QString("Invalid parameter: NONE, EXACT or TOLERANCE expected after '%1'").arg(COMMAND_OPEN_STL_FUSION));
+		}
 		else
 		{
 			break;
 		}
 	}
 
+#ifdef CC_LAS_SUPPORT
+	if (lasFiltersChanged)
+	{
+		LASFilter::SetLoadFilters(lasFilters);
+		if (lasFilters.isActive())
+			Print("LAS files will be filtered while loading");
+		else
+			Print("LAS load-time filters disabled");
+	}
+#endif
+
 	if (skipLines > 0)
 	{
 		QSharedPointer<AsciiOpenDlg> openDialog = AsciiFilter::GetOpenDialog();
@@ -573,7 +752,17 @@ bool ccCommandLineParser::commandLoad(QStringList& arguments)
 
 	ccHObject* db = FileIOFilter::LoadFromFile(filename,s_loadParameters,QString());
 	if (!db)
+	{
+#ifdef CC_LAS_SUPPORT
+		//with load-time filters, a LAS file may legitimately be skipped
+		if (LASFilter::GetLoadFilters().isActive() && QFileInfo(filename).suffix().toUpper().startsWith("LA"))
+		{
+			Print("No point left after filtering: file ignored");
+			return true;
+		}
+#endif
 		return false/*Error(QString("Failed to open file '%1'").arg(filename))*/;
+	}
 
 	std::set<unsigned> verticesIDs;
 	//first look for meshes inside loaded DB (so that we don't consider mesh vertices as clouds!)
@@ -2416,6 +2605,7 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 
 	//inner loop for Distance computation options
 	bool flipNormals = false;
+	bool useBVH = false;
 	double maxDist = 0.0;
 	unsigned octreeLevel = 0;
 
@@ -2437,6 +2627,16 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 			if (!cloud2meshDist)
 				ccConsole::Warning("Parameter \"-%1\" ignored: only for C2M distance!");
 		}
+		else if (IsCommand(argument,COMMAND_C2M_DIST_BVH))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			useBVH = true;
+
+			if (!cloud2meshDist)
+				ccConsole::Warning("Parameter \"-%1\" ignored: only for C2M distance!");
+		}
 		else if (IsCommand(argument,COMMAND_MAX_DISTANCE))
 		{
 			//local option confirmed, we can move on
@@ -2554,6 +2754,8 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 	{
 		if (flipNormals)
 			compDlg.flipNormalsCheckBox->setChecked(true);
+		if (useBVH)
+			compDlg.bvhCheckBox->setChecked(true);
 	}
 	//C2C-only parameters
 	else
@@ -2605,6 +2807,282 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 	return true;
 }
 
+bool ccCommandLineParser::commandM3C2(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
+{
+	Print("[M3C2 DISTANCES]");
+
+	if (m_clouds.size() < 2)
+		return Error(QString("Two point clouds are needed. Be sure to open or generate them before \"-%1\"!").arg(COMMAND_M3C2));
+	else if (m_clouds.size() > 2)
+		ccConsole::Warning("More than 2 point clouds loaded! We take the first two by default");
+
+	CCLib::DistanceComputationTools::M3C2Params params;
+	double coreStep = 0;
+
+	while (!arguments.empty())
+	{
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_M3C2_NORMAL_SCALE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: value(s) after \"-%1\"").arg(COMMAND_M3C2_NORMAL_SCALE));
+			QStringList scales = arguments.takeFirst().split(',',QString::SkipEmptyParts);
+			params.normalScales.clear();
+			for (int i=0; i<scales.size(); ++i)
+			{
+				bool conversionOk = false;
+				double scale = scales[i].toDouble(&conversionOk);
+				if (!conversionOk || scale <= 0)
+					return Error(QString("Invalid parameter: value(s) after \"-%1\"").arg(COMMAND_M3C2_NORMAL_SCALE));
+				params.normalScales.push_back(static_cast<PointCoordinateType>(scale));
+			}
+		}
+		else if (IsCommand(argument,COMMAND_M3C2_PROJ_SCALE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_M3C2_PROJ_SCALE));
+			bool conversionOk = false;
+			params.projectionScale = static_cast<PointCoordinateType>(arguments.takeFirst().toDouble(&conversionOk));
+			if (!conversionOk || params.projectionScale <= 0)
+				return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_M3C2_PROJ_SCALE));
+		}
+		else if (IsCommand(argument,COMMAND_M3C2_MAX_DEPTH))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_M3C2_MAX_DEPTH));
+			bool conversionOk = false;
+			params.maxDepth = static_cast<PointCoordinateType>(arguments.takeFirst().toDouble(&conversionOk));
+			if (!conversionOk || params.maxDepth <= 0)
+				return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_M3C2_MAX_DEPTH));
+		}
+		else if (IsCommand(argument,COMMAND_M3C2_CORE_POINTS))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: min distance after \"-%1\"").arg(COMMAND_M3C2_CORE_POINTS));
+			bool conversionOk = false;
+			coreStep = arguments.takeFirst().toDouble(&conversionOk);
+			if (!conversionOk || coreStep <= 0)
+				return Error(QString("Invalid parameter: min distance after \"-%1\"").arg(COMMAND_M3C2_CORE_POINTS));
+		}
+		else if (IsCommand(argument,COMMAND_M3C2_REG_ERROR))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_M3C2_REG_ERROR));
+			bool conversionOk = false;
+			params.registrationError = arguments.takeFirst().toDouble(&conversionOk);
+			if (!conversionOk || params.registrationError < 0)
+				return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_M3C2_REG_ERROR));
+		}
+		else if (IsCommand(argument,COMMAND_M3C2_USE_MEDIAN))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			params.useMedian = true;
+		}
+		else if (IsCommand(argument,COMMAND_M3C2_ORIENT))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.size() < 3)
+				return Error(QString("Missing parameter: X Y Z after \"-%1\"").arg(COMMAND_M3C2_ORIENT));
+			CCVector3d N;
+			for (unsigned char k=0; k<3; ++k)
+			{
+				bool conversionOk = false;
+				N.u[k] = arguments.takeFirst().toDouble(&conversionOk);
+				if (!conversionOk)
+					return Error(QString("Invalid parameter: X Y Z after \"-%1\"").arg(COMMAND_M3C2_ORIENT));
+			}
+			if (N.norm2() == 0)
+				return Error(QString("Invalid parameter: null vector after \"-%1\"").arg(COMMAND_M3C2_ORIENT));
+			params.preferredOrientation = CCVector3::fromArray(N.u);
+		}
+		else
+		{
+			break; //as soon as we encounter an unrecognized argument, we break the local loop to go back on the main one!
+		}
+	}
+
+	if (params.normalScales.empty())
+		return Error(QString("Missing option: \"-%1\" + normal scale(s)").arg(COMMAND_M3C2_NORMAL_SCALE));
+	if (params.projectionScale <= 0)
+		return Error(QString("Missing option: \"-%1\" + projection scale").arg(COMMAND_M3C2_PROJ_SCALE));
+	if (params.maxDepth <= 0)
+		return Error(QString("Missing option: \"-%1\" + max depth").arg(COMMAND_M3C2_MAX_DEPTH));
+
+	ccPointCloud* cloud1 = m_clouds[0].pc;
+	ccPointCloud* cloud2 = m_clouds[1].pc;
+
+	//compute the octrees if necessary
+	ccOctree* octree1 = cloud1->getOctree();
+	if (!octree1)
+	{
+		octree1 = cloud1->computeOctree(pDlg);
+		if (!octree1)
+			return Error(QString("Couldn't compute octree for cloud '%1'!").arg(cloud1->getName()));
+	}
+	ccOctree* octree2 = cloud2->getOctree();
+	if (!octree2)
+	{
+		octree2 = cloud2->computeOctree(pDlg);
+		if (!octree2)
+			return Error(QString("Couldn't compute octree for cloud '%1'!").arg(cloud2->getName()));
+	}
+
+	//core points
+	ccPointCloud* corePoints = cloud1;
+	if (coreStep > 0)
+	{
+		CCLib::CloudSamplingTools::SFModulationParams modParams(false);
+		CCLib::ReferenceCloud* refCloud = CCLib::CloudSamplingTools::resampleCloudSpatially(cloud1,static_cast<PointCoordinateType>(coreStep),modParams,octree1,pDlg);
+		if (!refCloud)
+			return Error("Core points subsampling failed!");
+
+		corePoints = cloud1->partialClone(refCloud);
+		delete refCloud;
+		refCloud = 0;
+
+		if (!corePoints)
+			return Error("Not enough memory!");
+		corePoints->setName(cloud1->getName() + QString(".core_points"));
+	}
+	Print(QString("\tCore points: %1").arg(corePoints->size()));
+
+	//output scalar fields
+	static const unsigned SF_COUNT = 8;
+	static const char* s_sfNames[SF_COUNT] = {	"M3C2 distance",
+												"distance uncertainty",
+												"significant change",
+												"STD cloud1",
+												"STD cloud2",
+												"Npoints cloud1",
+												"Npoints cloud2",
+												"normal scale" };
+	//remove the fields of a previous computation (if any)
+	for (unsigned k=0; k<SF_COUNT; ++k)
+	{
+		int formerIndex = corePoints->getScalarFieldIndexByName(s_sfNames[k]);
+		if (formerIndex >= 0)
+			corePoints->deleteScalarField(formerIndex);
+	}
+
+	int sfIndexes[SF_COUNT];
+	CCLib::ScalarField* sfs[SF_COUNT];
+	bool success = true;
+	for (unsigned k=0; k<SF_COUNT; ++k)
+	{
+		sfIndexes[k] = -1;
+		sfs[k] = 0;
+
+		//the 'normal scale' field is only relevant with multiple scales
+		if (k+1 == SF_COUNT && params.normalScales.size() < 2)
+			continue;
+
+		sfIndexes[k] = corePoints->addScalarField(s_sfNames[k]);
+		if (sfIndexes[k] < 0)
+		{
+			success = false;
+			break;
+		}
+		sfs[k] = corePoints->getScalarField(sfIndexes[k]);
+	}
+
+	std::vector<CCVector3> normals;
+	if (success)
+	{
+		try
+		{
+			normals.resize(corePoints->size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			success = false;
+		}
+	}
+	if (!success)
+	{
+		if (corePoints != cloud1)
+			delete corePoints;
+		return Error("Not enough memory!");
+	}
+
+	corePoints->setCurrentInScalarField(sfIndexes[0]);
+	params.uncertaintySF = sfs[1];
+	params.significantChangeSF = sfs[2];
+	params.stdDev1SF = sfs[3];
+	params.stdDev2SF = sfs[4];
+	params.pointCount1SF = sfs[5];
+	params.pointCount2SF = sfs[6];
+	params.normalScaleSF = sfs[7];
+	params.normals = &normals;
+
+	int result = CCLib::DistanceComputationTools::computeM3C2Distances(corePoints,cloud1,cloud2,params,pDlg,octree1,octree2);
+	if (result < 0)
+	{
+		if (corePoints != cloud1)
+			delete corePoints;
+		return Error(QString("An error occured during M3C2 distances computation! (error code: %1)").arg(result));
+	}
+
+	for (unsigned k=0; k<SF_COUNT; ++k)
+		if (sfs[k])
+			sfs[k]->computeMinAndMax();
+	corePoints->setCurrentDisplayedScalarField(sfIndexes[0]);
+	corePoints->showSF(true);
+
+	//save the normals used for the projections
+	//(but never overwrite the original normals of the first cloud when it is used as core points)
+	if (corePoints == cloud1 && cloud1->hasNormals())
+	{
+		Print("\tThe first cloud already has normals: the M3C2 normals are not saved");
+	}
+	else if (corePoints->resizeTheNormsTable())
+	{
+		for (unsigned i=0; i<corePoints->size(); ++i)
+			corePoints->setPointNormal(i,normals[i]);
+		corePoints->showNormals(true);
+	}
+	else
+	{
+		ccConsole::Warning("Not enough memory to save the normals!");
+	}
+
+	if (corePoints != cloud1)
+	{
+		m_clouds.push_back(CloudDesc(corePoints,m_clouds[0].basename+QString("_M3C2"),m_clouds[0].path,m_clouds[0].indexInFile));
+	}
+	else
+	{
+		m_clouds[0].basename += QString("_M3C2");
+	}
+
+	if (s_autoSaveMode)
+	{
+		QString errorStr = Export(corePoints != cloud1 ? m_clouds.back() : m_clouds[0]);
+		if (!errorStr.isEmpty())
+			return Error(errorStr);
+	}
+
+	return true;
+}
+
 bool ccCommandLineParser::commandStatTest(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
 {
 	Print("[STATISTICAL TEST]");
@@ -3175,37 +3653,130 @@ bool ccCommandLineParser::commandICP(QStringList& arguments, QDialog* parent/*=0
 	return true;
 }
 
-QString ccCommandLineParser::GetFileFormatFilter(QStringList& arguments, QString& defaultExt)
+bool ccCommandLineParser::commandICPRmsMatrix(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
 {
-	QString fileFilter;
-	defaultExt = QString();
+	Print("[ICP RMS MATRIX]");
 
-	if (!arguments.isEmpty())
+	//look for local options
+	ccRegistrationTools::BestICPRmsMatrixParams params;
+
+	while (!arguments.empty())
 	{
-		//test if the specified format corresponds to a known file type
-		QString argument = arguments.front().toUpper();
-		arguments.pop_front();
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_ICP_RMS_MATRIX_ANGULAR_STEP))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
 
-		const FileIOFilter::FilterContainer& filters = FileIOFilter::GetFilters();
-		for (size_t i=0; i<filters.size(); ++i)
+			if (arguments.empty())
+				return Error(QString("Missing parameter: angular step after '%1'").arg(COMMAND_ICP_RMS_MATRIX_ANGULAR_STEP));
+			bool ok;
+			params.angularStep_deg = arguments.takeFirst().toDouble(&ok);
+			if (!ok || params.angularStep_deg <= 0 || params.angularStep_deg > 180.0)
+				return Error(QString("Invalid angular step! (after %1)").arg(COMMAND_ICP_RMS_MATRIX_ANGULAR_STEP));
+		}
+		else if (IsCommand(argument,COMMAND_ICP_MIN_ERROR_DIIF))
 		{
-			if (argument == QString(filters[i]->getDefaultExtension()).toUpper())
-			{
-				//found
-				fileFilter = filters[i]->getFileFilters(false).first(); //Take the first 'output' file filter by default (could we be smarter?)
-				defaultExt = filters[i]->getDefaultExtension();
-				break;
-			}
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: min error difference after '%1'").arg(COMMAND_ICP_MIN_ERROR_DIIF));
+			bool ok;
+			params.minRMSDecrease = arguments.takeFirst().toDouble(&ok);
+			if (!ok || params.minRMSDecrease <= 0)
+				return Error(QString("Invalid value for min. error difference! (after %1)").arg(COMMAND_ICP_MIN_ERROR_DIIF));
 		}
+		else if (IsCommand(argument,COMMAND_ICP_RANDOM_SAMPLING_LIMIT))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
 
-		//haven't found anything?
-		if (fileFilter.isEmpty())
+			if (arguments.empty())
+				return Error(QString("Missing parameter: random sampling limit value after '%1'").arg(COMMAND_ICP_RANDOM_SAMPLING_LIMIT));
+			bool ok;
+			params.randomSamplingLimit = arguments.takeFirst().toUInt(&ok);
+			if (!ok || params.randomSamplingLimit < 3)
+				return Error(QString("Invalid random sampling limit! (after %1)").arg(COMMAND_ICP_RANDOM_SAMPLING_LIMIT));
+		}
+		else
 		{
-			ccConsole::Error(QString("Unhandled format specifier (%1)").arg(argument));
+			break; //as soon as we encounter an unrecognized argument, we break the local loop to go back on the main one!
 		}
 	}
-	else
-	{
+
+	if (m_clouds.size() < 2)
+		return Error("Not enough loaded clouds (expect at least 2!)");
+
+	std::vector<ccPointCloud*> clouds;
+	try
+	{
+		clouds.reserve(m_clouds.size());
+		for (size_t i=0; i<m_clouds.size(); ++i)
+			clouds.push_back(m_clouds[i].pc);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return Error("Not enough memory!");
+	}
+
+	//output files (next to the first cloud)
+	QString matrixFilename = QString("%1/%2_%3").arg(m_clouds[0].path).arg(m_clouds[0].basename).arg("ICP_RMS_MATRIX");
+	if (s_addTimestamp)
+		matrixFilename += QString("_%1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh'h'mm"));
+	matrixFilename += QString(".csv");
+
+	//each pair is written as soon as it is processed
+	QString pairsFilename = ccRegistrationTools::GetBestICPRmsPairsFilename(matrixFilename);
+	QFile pairsFile(pairsFilename);
+	if (!pairsFile.open(QIODevice::WriteOnly | QIODevice::Text))
+		return Error(QString("Failed to open file '%1' for writing!").arg(pairsFilename));
+	QTextStream pairsStream(&pairsFile);
+
+	std::vector<ccRegistrationTools::ICPPairResult> results;
+	if (!ccRegistrationTools::ComputeBestICPRmsMatrix(clouds, params, results, &pairsStream, pDlg))
+		return Error("Failed to compute the ICP RMS matrix!");
+	pairsFile.close();
+	Print(QString("Pairs saved to: %1").arg(pairsFilename));
+
+	if (!ccRegistrationTools::SaveBestICPRmsMatrix(matrixFilename, clouds, results))
+		return Error("Failed to save the ICP RMS matrix!");
+	Print(QString("RMS matrix saved to: %1").arg(matrixFilename));
+
+	return true;
+}
+
+QString ccCommandLineParser::GetFileFormatFilter(QStringList& arguments, QString& defaultExt)
+{
+	QString fileFilter;
+	defaultExt = QString();
+
+	if (!arguments.isEmpty())
+	{
+		//test if the specified format corresponds to a known file type
+		QString argument = arguments.front().toUpper();
+		arguments.pop_front();
+
+		const FileIOFilter::FilterContainer& filters = FileIOFilter::GetFilters();
+		for (size_t i=0; i<filters.size(); ++i)
+		{
+			if (argument == QString(filters[i]->getDefaultExtension()).toUpper())
+			{
+				//found
+				fileFilter = filters[i]->getFileFilters(false).first(); //Take the first 'output' file filter by default (could we be smarter?)
+				defaultExt = filters[i]->getDefaultExtension();
+				break;
+			}
+		}
+
+		//haven't found anything?
+		if (fileFilter.isEmpty())
+		{
+			ccConsole::Error(QString("Unhandled format specifier (%1)").arg(argument));
+		}
+	}
+	else
+	{
 		ccConsole::Error("Missing file format specifier!");
 	}
 
@@ -3415,6 +3986,25 @@ bool ccCommandLineParser::commandChangePLYExportFormat(QStringList& arguments)
 	return true;
 }
 
+bool ccCommandLineParser::commandChangeBINCompression(QStringList& arguments)
+{
+	if (arguments.empty())
+		return Error(QString("Missing parameter: compression (NONE, FAST or HIGH) after '%1'").arg(COMMAND_BIN_COMPRESSION));
+
+	QString compression = arguments.takeFirst().toUpper();
+
+	if (compression == "NONE")
+		BinFilter::SetDefaultCompression(ccSerializationHelper::NO_COMPRESSION);
+	else if (compression == "FAST")
+		BinFilter::SetDefaultCompression(ccSerializationHelper::FAST_COMPRESSION);
+	else if (compression == "HIGH")
+		BinFilter::SetDefaultCompression(ccSerializationHelper::HIGH_COMPRESSION);
+	else
+		return Error(QString("Invalid BIN compression! ('%1')").arg(compression));
+
+	return true;
+}
+
 bool ccCommandLineParser::commandForceNormalsComputation(QStringList& arguments)
 {
 	//simply change the default filter behavior
@@ -3510,6 +4100,863 @@ bool ccCommandLineParser::commandLogFile(QStringList& arguments)
 	return ccConsole::TheInstance() ? ccConsole::TheInstance()->setLogFile(filename) : false;
 }
 
+//! Batch job (one input file processed by a dedicated worker process)
+struct BatchJob
+{
+	BatchJob()
+		: process(0)
+		, estimatedMemory(0)
+		, exitCode(-1)
+		, crashed(false)
+		, warningCount(0)
+		, errorCount(0)
+		, duration_ms(0)
+	{}
+
+	//! Input filename
+	QString filename;
+	//! Worker process
+	QProcess* process;
+	//! Estimated memory footprint (in bytes)
+	qint64 estimatedMemory;
+	//! Exit code
+	int exitCode;
+	//! Whether the process has crashed
+	bool crashed;
+	//! Number of warnings reported by the worker
+	int warningCount;
+	//! Number of errors reported by the worker
+	int errorCount;
+	//! Last error reported by the worker
+	QString lastError;
+	//! Pending (incomplete) output line
+	QString pendingOutput;
+	//! Timer
+	QElapsedTimer timer;
+	//! Processing duration (in ms)
+	qint64 duration_ms;
+};
+
+//! Forwards the output of a batch job (each line is prefixed by the job index)
+static void ForwardBatchJobOutput(BatchJob& job, int jobIndex, bool flush)
+{
+	job.pendingOutput += QString::fromLocal8Bit(job.process->readAll());
+	QStringList lines = job.pendingOutput.split('\n');
+	//the last line may be incomplete
+	job.pendingOutput = flush ? QString() : lines.takeLast();
+
+	for (int i=0; i<lines.size(); ++i)
+	{
+		QString line = lines[i].trimmed();
+		if (line.isEmpty())
+			continue;
+
+		QString message = QString("[#%1 %2] %3").arg(jobIndex+1).arg(QFileInfo(job.filename).fileName()).arg(line);
+		if (line.startsWith("[ERROR]"))
+		{
+			++job.errorCount;
+			job.lastError = line.mid(7).trimmed();
+			Warning(message);
+		}
+		else if (line.startsWith("[WARNING]"))
+		{
+			++job.warningCount;
+			Warning(message);
+		}
+		else
+		{
+			Print(message);
+		}
+	}
+}
+
+bool ccCommandLineParser::commandBatch(QStringList& arguments)
+{
+	Print("[BATCH]");
+
+	//look for local options and input files
+	int workerCount = std::max(1,QThread::idealThreadCount());
+	qint64 memoryBudget = 0; //no limit
+	double memoryRatio = 3.0;
+	QString reportFilename;
+	QStringList inputFiles;
+
+	while (!arguments.empty())
+	{
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_BATCH_WORKERS))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: number of workers after '%1'").arg(COMMAND_BATCH_WORKERS));
+			bool ok;
+			workerCount = arguments.takeFirst().toInt(&ok);
+			if (!ok || workerCount < 1)
+				return Error(QString("Invalid number of workers! (after %1)").arg(COMMAND_BATCH_WORKERS));
+		}
+		else if (IsCommand(argument,COMMAND_BATCH_MAX_MEMORY))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: memory budget (in Mb) after '%1'").arg(COMMAND_BATCH_MAX_MEMORY));
+			bool ok;
+			double budget_mb = arguments.takeFirst().toDouble(&ok);
+			if (!ok || budget_mb <= 0)
+				return Error(QString("Invalid memory budget! (after %1)").arg(COMMAND_BATCH_MAX_MEMORY));
+			memoryBudget = static_cast<qint64>(budget_mb * (1 << 20));
+		}
+		else if (IsCommand(argument,COMMAND_BATCH_MEMORY_RATIO))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: memory ratio after '%1'").arg(COMMAND_BATCH_MEMORY_RATIO));
+			bool ok;
+			memoryRatio = arguments.takeFirst().toDouble(&ok);
+			if (!ok || memoryRatio <= 0)
+				return Error(QString("Invalid memory ratio! (after %1)").arg(COMMAND_BATCH_MEMORY_RATIO));
+		}
+		else if (IsCommand(argument,COMMAND_BATCH_REPORT))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: report filename after '%1'").arg(COMMAND_BATCH_REPORT));
+			reportFilename = arguments.takeFirst();
+		}
+		else if (IsCommand(argument,COMMAND_BATCH_FILE_LIST))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: list filename after '%1'").arg(COMMAND_BATCH_FILE_LIST));
+			QString listFilename = arguments.takeFirst();
+			QFile listFile(listFilename);
+			if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text))
+				return Error(QString("Failed to open file '%1'").arg(listFilename));
+			QTextStream stream(&listFile);
+			while (!stream.atEnd())
+			{
+				QString line = stream.readLine().trimmed();
+				if (!line.isEmpty() && !line.startsWith("#"))
+					inputFiles << line;
+			}
+		}
+		else if (!argument.startsWith("-"))
+		{
+			//input file(s)
+			arguments.pop_front();
+
+			QFileInfo fi(argument);
+			if (fi.fileName().contains('*') || fi.fileName().contains('?'))
+			{
+				QDir dir = fi.absoluteDir();
+				QStringList files = dir.entryList(QStringList(fi.fileName()),QDir::Files,QDir::Name);
+				if (files.empty())
+					Warning(QString("No file matches '%1'").arg(argument));
+				for (int i=0; i<files.size(); ++i)
+					inputFiles << dir.absoluteFilePath(files[i]);
+			}
+			else
+			{
+				inputFiles << argument;
+			}
+		}
+		else
+		{
+			break; //as soon as we encounter an unrecognized argument, we break the local loop to go back on the main one!
+		}
+	}
+
+	if (inputFiles.empty())
+		return Error("No input file for the batch mode!");
+
+	//the remaining commands are applied to each file (the main loop won't see them)
+	QStringList commands = arguments;
+	arguments.clear();
+	if (commands.empty())
+		return Error("No command to apply in batch mode!");
+
+	//the input file is loaded first, unless the '{FILE}' token is used (e.g. to set some loading options)
+	bool hasFileToken = commands.contains(BATCH_FILE_TOKEN);
+
+	//build the job list
+	std::vector<BatchJob> jobs;
+	try
+	{
+		jobs.resize(static_cast<size_t>(inputFiles.size()));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return Error("Not enough memory!");
+	}
+	for (int i=0; i<inputFiles.size(); ++i)
+	{
+		jobs[i].filename = inputFiles[i];
+		//rough estimation of the memory consumption of the job
+		jobs[i].estimatedMemory = static_cast<qint64>(QFileInfo(inputFiles[i]).size() * memoryRatio);
+	}
+
+	workerCount = std::min(workerCount,inputFiles.size());
+	Print(QString("%1 file(s) to process with %2 worker(s)").arg(inputFiles.size()).arg(workerCount));
+	if (memoryBudget > 0)
+		Print(QString("Memory budget: %1 Mb").arg(memoryBudget / (1 << 20)));
+
+	QString executable = QCoreApplication::applicationFilePath();
+
+	QElapsedTimer eTimer;
+	eTimer.start();
+
+	std::vector<size_t> running;
+	size_t nextJob = 0;
+	qint64 usedMemory = 0;
+	unsigned successCount = 0;
+	while (nextJob < jobs.size() || !running.empty())
+	{
+		//launch as many jobs as possible
+		while (nextJob < jobs.size() && running.size() < static_cast<size_t>(workerCount))
+		{
+			BatchJob& job = jobs[nextJob];
+			//respect the memory budget (but we always let at least one job run)
+			if (memoryBudget > 0 && !running.empty() && usedMemory + job.estimatedMemory > memoryBudget)
+				break;
+
+			QStringList jobArguments;
+			jobArguments << QString("-%1").arg(COMMAND_SILENT_MODE);
+			if (hasFileToken)
+			{
+				for (int i=0; i<commands.size(); ++i)
+					jobArguments << (commands[i] == BATCH_FILE_TOKEN ? job.filename : commands[i]);
+			}
+			else
+			{
+				jobArguments << QString("-%1").arg(COMMAND_OPEN) << job.filename << commands;
+			}
+
+			job.process = new QProcess();
+			job.process->setProcessChannelMode(QProcess::MergedChannels);
+			job.timer.start();
+			job.process->start(executable,jobArguments);
+			if (!job.process->waitForStarted())
+			{
+				Warning(QString("[#%1] Failed to start the worker process for file '%2'").arg(nextJob+1).arg(job.filename));
+				job.crashed = true;
+				job.lastError = "failed to start";
+				delete job.process;
+				job.process = 0;
+			}
+			else
+			{
+				Print(QString("[#%1] Processing '%2'").arg(nextJob+1).arg(job.filename));
+				usedMemory += job.estimatedMemory;
+				running.push_back(nextJob);
+			}
+			++nextJob;
+		}
+
+		//poll the running jobs
+		for (size_t i=0; i<running.size(); )
+		{
+			size_t jobIndex = running[i];
+			BatchJob& job = jobs[jobIndex];
+
+			bool finished = job.process->waitForFinished(running.size() > 1 ? 10 : 100);
+			ForwardBatchJobOutput(job,static_cast<int>(jobIndex),finished);
+
+			if (!finished && job.process->state() != QProcess::NotRunning)
+			{
+				++i;
+				continue;
+			}
+
+			job.duration_ms = job.timer.elapsed();
+			job.crashed = (job.process->exitStatus() != QProcess::NormalExit);
+			job.exitCode = job.process->exitCode();
+			if (!job.crashed && job.exitCode == EXIT_SUCCESS)
+			{
+				++successCount;
+				Print(QString("[#%1] Done in %2 s.").arg(jobIndex+1).arg(job.duration_ms / 1.0e3,0,'f',2));
+			}
+			else
+			{
+				Warning(QString("[#%1] Failed to process '%2' (%3)").arg(jobIndex+1).arg(job.filename).arg(job.crashed ? QString("crashed") : QString("exit code: %1").arg(job.exitCode)));
+			}
+
+			usedMemory -= job.estimatedMemory;
+			delete job.process;
+			job.process = 0;
+			running.erase(running.begin()+i);
+		}
+
+		QCoreApplication::processEvents();
+	}
+
+	Print(QString("Batch finished in %1 s.: %2 file(s) processed successfully out of %3").arg(eTimer.elapsed() / 1.0e3,0,'f',2).arg(successCount).arg(jobs.size()));
+
+	//summary report
+	if (!reportFilename.isEmpty())
+	{
+		QFile reportFile(reportFilename);
+		if (!reportFile.open(QIODevice::WriteOnly | QIODevice::Text))
+			return Error(QString("Failed to open file '%1' for writing!").arg(reportFilename));
+
+		QTextStream stream(&reportFile);
+		stream << "File;Status;Exit code;Duration (s);Warnings;Errors;Last error" << endl;
+		for (size_t i=0; i<jobs.size(); ++i)
+		{
+			const BatchJob& job = jobs[i];
+			bool success = (!job.crashed && job.exitCode == EXIT_SUCCESS);
+			stream << job.filename << ";";
+			stream << (success ? "OK" : (job.crashed ? "CRASHED" : "FAILED")) << ";";
+			stream << job.exitCode << ";";
+			stream << QString::number(job.duration_ms / 1.0e3,'f',2) << ";";
+			stream << job.warningCount << ";";
+			stream << job.errorCount << ";";
+			stream << QString(job.lastError).replace(';',',') << endl;
+		}
+		Print(QString("Batch report saved to: %1").arg(reportFilename));
+	}
+
+	if (successCount != jobs.size())
+		return Error(QString("%1 file(s) failed to be processed").arg(jobs.size()-successCount));
+
+	return true;
+}
+
+//! Returns whether a command can be applied tile by tile (see ccCommandLineParser::commandTiles)
+static bool IsTileCompatibleCommand(const QStringList& commands, int index)
+{
+	const QString& argument = commands[index];
+
+	//commands that need the whole cloud (or other entities)
+	static const char* s_nonLocalCommands[] = {	COMMAND_OPEN, COMMAND_BUNDLER, COMMAND_C2M_DIST, COMMAND_C2C_DIST, COMMAND_M3C2,
+												COMMAND_SAMPLE_MESH, COMMAND_MERGE_CLOUDS, COMMAND_CLEAR_CLOUDS, COMMAND_POP_CLOUDS,
+												COMMAND_CLEAR_MESHES, COMMAND_POP_MESHES, COMMAND_CLEAR, COMMAND_BEST_FIT_PLANE,
+												COMMAND_MATCH_BB_CENTERS, COMMAND_ICP, COMMAND_ICP_RMS_MATRIX, COMMAND_APPLY_TRANSFORMATION,
+												COMMAND_DELAUNAY, COMMAND_CROSS_SECTION, COMMAND_SAVE_CLOUDS, COMMAND_SAVE_MESHES,
+												COMMAND_AUTO_SAVE, COMMAND_BATCH, COMMAND_TILES, COMMAND_OUT_OF_CORE, 0 };
+	for (unsigned i=0; s_nonLocalCommands[i]; ++i)
+		if (IsCommand(argument,s_nonLocalCommands[i]))
+			return false;
+
+	//random subsampling (with a global point count) can't be applied per tile
+	if (IsCommand(argument,COMMAND_SUBSAMPLE) && index+1 < commands.size() && commands[index+1].toUpper() == "RANDOM")
+		return false;
+
+	return true;
+}
+
+bool ccCommandLineParser::commandTiles(QStringList& arguments, QDialog* parent/*=0*/)
+{
+	Print("[TILES]");
+
+	//look for local options and the input file
+	double tileSizeX = 0;
+	double tileSizeY = 0;
+	double halo = 0;
+	QString outputDir;
+	QString filename;
+
+	while (!arguments.empty())
+	{
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_TILES_SIZE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.size() < 2)
+				return Error(QString("Missing parameter: tile dimensions (X and Y) after '%1'").arg(COMMAND_TILES_SIZE));
+			bool okX, okY;
+			tileSizeX = arguments.takeFirst().toDouble(&okX);
+			tileSizeY = arguments.takeFirst().toDouble(&okY);
+			if (!okX || !okY || tileSizeX <= 0 || tileSizeY <= 0)
+				return Error(QString("Invalid tile dimensions! (after %1)").arg(COMMAND_TILES_SIZE));
+		}
+		else if (IsCommand(argument,COMMAND_TILES_HALO))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: halo width after '%1'").arg(COMMAND_TILES_HALO));
+			bool ok;
+			halo = arguments.takeFirst().toDouble(&ok);
+			if (!ok || halo < 0)
+				return Error(QString("Invalid halo width! (after %1)").arg(COMMAND_TILES_HALO));
+		}
+		else if (IsCommand(argument,COMMAND_TILES_OUTPUT_DIR))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: output directory after '%1'").arg(COMMAND_TILES_OUTPUT_DIR));
+			outputDir = arguments.takeFirst();
+			if (!QDir(outputDir).exists() && !QDir().mkpath(outputDir))
+				return Error(QString("Failed to create the output directory '%1'").arg(outputDir));
+		}
+		else if (!argument.startsWith("-") && filename.isEmpty())
+		{
+			//input file
+			filename = arguments.takeFirst();
+		}
+		else
+		{
+			break; //as soon as we encounter an unrecognized argument, we break the local loop to go back on the main one!
+		}
+	}
+
+	if (filename.isEmpty())
+		return Error("No input file for the tiled mode!");
+	if (tileSizeX <= 0)
+		return Error(QString("Tile dimensions must be set (with '%1')").arg(COMMAND_TILES_SIZE));
+
+	//the remaining commands are applied to each tile (the main loop won't see them)
+	QStringList commands = arguments;
+	arguments.clear();
+	for (int i=0; i<commands.size(); ++i)
+	{
+		if (commands[i].startsWith("-") && !IsTileCompatibleCommand(commands,i))
+			return Error(QString("Command '%1' can't be applied tile by tile").arg(commands[i]));
+	}
+
+#ifdef CC_LAS_SUPPORT
+	//the input file is split in a single pass (the LAS records are copied as is in the tile files)
+	QFileInfo fi(filename);
+	if (fi.suffix().toUpper() != "LAS")
+		return Error(QString("Only uncompressed LAS files can be processed tile by tile (convert '%1' to LAS first)").arg(filename));
+
+	CCVector3d bbMin, bbMax;
+	unsigned pointCount = 0;
+	if (!LASFilter::ReadBoundingBox(filename,bbMin,bbMax,&pointCount))
+		return Error(QString("Failed to read the header of '%1'").arg(filename));
+
+	unsigned tileCountX = std::max(1,static_cast<int>(ceil((bbMax.x - bbMin.x) / tileSizeX)));
+	unsigned tileCountY = std::max(1,static_cast<int>(ceil((bbMax.y - bbMin.y) / tileSizeY)));
+	unsigned tileCount = tileCountX * tileCountY;
+	Print(QString("%1 points - %2 x %3 tile(s) (halo: %4)").arg(pointCount).arg(tileCountX).arg(tileCountY).arg(halo));
+
+	QString basename = fi.completeBaseName();
+	if (outputDir.isEmpty())
+		outputDir = fi.path();
+
+	//temporary tile files
+	QDir tempDir(outputDir);
+	QString tempDirName = QString("%1_tiles_tmp").arg(basename);
+	if (!tempDir.mkpath(tempDirName) || !tempDir.cd(tempDirName))
+		return Error(QString("Failed to create the temporary directory '%1'").arg(tempDirName));
+	std::vector<QString> tileFilenames;
+	for (unsigned j=0; j<tileCountY; ++j)
+		for (unsigned i=0; i<tileCountX; ++i)
+			tileFilenames.push_back(tempDir.absoluteFilePath(QString("tile_%1_%2.las").arg(i).arg(j)));
+
+	//the tile files get a slightly larger halo so that the core test below (on the loaded
+	//coordinates, which may have been rounded) can't miss the points lying on the borders
+	double splitHalo = halo + 0.01 * std::min(tileSizeX,tileSizeY);
+
+	//the current load filters are applied while splitting
+	std::vector<unsigned> tilePointCounts;
+	CC_FILE_ERROR splitResult = LASFilter::SplitIntoTiles(filename,bbMin,tileSizeX,tileSizeY,tileCountX,tileCountY,splitHalo,tileFilenames,tilePointCounts);
+	if (splitResult != CC_FERR_NO_ERROR)
+	{
+		tempDir.cdUp();
+		tempDir.rmdir(tempDirName);
+		if (splitResult == CC_FERR_WRONG_FILE_TYPE)
+			return Error(QString("Only uncompressed LAS files can be processed tile by tile (convert '%1' to LAS first)").arg(filename));
+		FileIOFilter::DisplayErrorMessage(splitResult,"splitting",filename);
+		return false;
+	}
+
+	//backup the global state modified by the tiles processing
+	LASLoadFilters filtersBackup = LASFilter::GetLoadFilters();
+	bool autoSaveModeBackup = s_autoSaveMode;
+	//the tile files are loaded as a whole
+	LASFilter::SetLoadFilters(LASLoadFilters());
+
+	bool success = true;
+	unsigned savedTileCount = 0;
+	for (unsigned j=0; j<tileCountY; ++j)
+	{
+		for (unsigned i=0; i<tileCountX; ++i)
+		{
+			unsigned tileIndex = j*tileCountX+i;
+			if (!success || tilePointCounts[tileIndex] == 0)
+			{
+				QFile::remove(tileFilenames[tileIndex]);
+				continue; //empty tile (or previous error)
+			}
+
+			//tile core (points on the max. border belong to the next tile, except for the last ones)
+			CCVector3d coreMin(bbMin.x + i * tileSizeX, bbMin.y + j * tileSizeY, bbMin.z);
+			CCVector3d coreMax(	i+1 == tileCountX ? bbMax.x : coreMin.x + tileSizeX,
+								j+1 == tileCountY ? bbMax.y : coreMin.y + tileSizeY,
+								bbMax.z );
+			bool lastX = (i+1 == tileCountX);
+			bool lastY = (j+1 == tileCountY);
+
+			Print(QString("[Tile %1/%2] X = [%3 ; %4] - Y = [%5 ; %6] - %7 point(s) with the halo").arg(tileIndex+1).arg(tileCount).arg(coreMin.x,0,'f',3).arg(coreMax.x,0,'f',3).arg(coreMin.y,0,'f',3).arg(coreMax.y,0,'f',3).arg(tilePointCounts[tileIndex]));
+
+			//load the tile and its halo
+			ccCommandLineParser tileParser;
+			QStringList loadArguments(tileFilenames[tileIndex]);
+			bool loaded = tileParser.commandLoad(loadArguments);
+			QFile::remove(tileFilenames[tileIndex]);
+			if (!loaded)
+			{
+				success = Error(QString("Failed to load tile (%1,%2)").arg(i).arg(j));
+				continue;
+			}
+			if (tileParser.m_clouds.empty())
+				continue; //empty tile
+
+			//apply the commands (without the intermediate saves)
+			s_autoSaveMode = false;
+			QStringList tileCommands = commands;
+			success = (tileParser.parse(tileCommands,parent) == EXIT_SUCCESS);
+			s_autoSaveMode = autoSaveModeBackup;
+			if (!success)
+			{
+				Error(QString("Failed to process tile (%1,%2)").arg(i).arg(j));
+				continue;
+			}
+
+			//remove the halo and save the tile
+			for (size_t k=0; k<tileParser.m_clouds.size(); ++k)
+			{
+				CloudDesc& desc = tileParser.m_clouds[k];
+				ccPointCloud* pc = desc.pc;
+
+				CCLib::ReferenceCloud coreSelection(pc);
+				if (!coreSelection.reserve(pc->size()))
+				{
+					success = Error("Not enough memory!");
+					break;
+				}
+				for (unsigned n=0; n<pc->size(); ++n)
+				{
+					CCVector3d P = pc->toGlobal3d(*pc->getPoint(n));
+					if (	P.x >= coreMin.x && (P.x < coreMax.x || (lastX && P.x <= coreMax.x))
+						&&	P.y >= coreMin.y && (P.y < coreMax.y || (lastY && P.y <= coreMax.y)) )
+					{
+						coreSelection.addPointIndex(n);
+					}
+				}
+				if (coreSelection.size() == 0)
+					continue;
+
+				if (coreSelection.size() != pc->size())
+				{
+					ccPointCloud* corePC = pc->partialClone(&coreSelection);
+					if (!corePC)
+					{
+						success = Error("Not enough memory!");
+						break;
+					}
+					delete desc.pc;
+					desc.pc = corePC;
+				}
+
+				desc.basename = QString("%1_TILE_%2_%3").arg(basename).arg(i).arg(j);
+				if (tileParser.m_clouds.size() > 1)
+					desc.basename += QString("_%1").arg(k);
+				desc.path = outputDir;
+
+				QString errorStr = Export(desc);
+				if (!errorStr.isEmpty())
+				{
+					success = Error(errorStr);
+					break;
+				}
+				++savedTileCount;
+			}
+		}
+	}
+
+	//restore the global state
+	LASFilter::SetLoadFilters(filtersBackup);
+	s_autoSaveMode = autoSaveModeBackup;
+	tempDir.cdUp();
+	tempDir.rmdir(tempDirName);
+
+	if (success)
+		Print(QString("%1 tile(s) saved in '%2'").arg(savedTileCount).arg(outputDir));
+
+	return success;
+#else
+	return Error("The tiled mode requires the LAS I/O filter (not available in this version)");
+#endif
+}
+
+//! Returns the name of a density field (same as the GUI)
+static QString GetDensityFieldName(CCLib::GeometricalAnalysisTools::Density densityType, PointCoordinateType kernelRadius)
+{
+	switch (densityType)
+	{
+	case CCLib::GeometricalAnalysisTools::DENSITY_KNN:
+		return CC_LOCAL_KNN_DENSITY_FIELD_NAME;
+	case CCLib::GeometricalAnalysisTools::DENSITY_2D:
+		return QString(CC_LOCAL_SURF_DENSITY_FIELD_NAME) + QString(" (r=%1)").arg(kernelRadius);
+	case CCLib::GeometricalAnalysisTools::DENSITY_3D:
+		return QString(CC_LOCAL_VOL_DENSITY_FIELD_NAME) + QString(" (r=%1)").arg(kernelRadius);
+	default:
+		assert(false);
+		break;
+	}
+	return CC_DEFAULT_SF_NAME;
+}
+
+bool ccCommandLineParser::commandOutOfCore(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
+{
+	Print("[OUT-OF-CORE]");
+
+	//look for local options and the input file
+	size_t memoryLimit = CCLib::OutOfCoreOctree::DEFAULT_MEMORY_LIMIT;
+	QString tempDir;
+	QString outputFilename;
+	QString filename;
+
+	while (!arguments.empty())
+	{
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_OUT_OF_CORE_MEMORY))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: memory limit (in Mb) after '%1'").arg(COMMAND_OUT_OF_CORE_MEMORY));
+			bool ok;
+			unsigned memoryMb = arguments.takeFirst().toUInt(&ok);
+			if (!ok || memoryMb == 0)
+				return Error(QString("Invalid memory limit! (after %1)").arg(COMMAND_OUT_OF_CORE_MEMORY));
+			memoryLimit = static_cast<size_t>(memoryMb) << 20;
+		}
+		else if (IsCommand(argument,COMMAND_OUT_OF_CORE_TEMP_DIR))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: temporary files directory after '%1'").arg(COMMAND_OUT_OF_CORE_TEMP_DIR));
+			tempDir = arguments.takeFirst();
+			if (!QDir(tempDir).exists() && !QDir().mkpath(tempDir))
+				return Error(QString("Failed to create the temporary files directory '%1'").arg(tempDir));
+		}
+		else if (IsCommand(argument,COMMAND_OUT_OF_CORE_OUTPUT))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: output file after '%1'").arg(COMMAND_OUT_OF_CORE_OUTPUT));
+			outputFilename = arguments.takeFirst();
+		}
+		else if (!argument.startsWith("-") && filename.isEmpty())
+		{
+			//input file
+			filename = arguments.takeFirst();
+		}
+		else
+		{
+			break; //the process (and its own options) comes next
+		}
+	}
+
+	if (filename.isEmpty())
+		return Error("No input file for the out-of-core mode!");
+	QFileInfo fi(filename);
+	if (fi.suffix().toUpper() != "LAS")
+		return Error(QString("Only uncompressed LAS files can be processed out-of-core (convert '%1' to LAS first)").arg(filename));
+
+	//process (only one)
+	enum OutOfCoreProcess { OOC_DENSITY, OOC_ROUGHNESS, OOC_C2C_DIST };
+	OutOfCoreProcess process = OOC_DENSITY;
+	PointCoordinateType kernelRadius = 0;
+	CCLib::GeometricalAnalysisTools::Density densityType = CCLib::GeometricalAnalysisTools::DENSITY_3D;
+	QString referenceFilename;
+	ScalarType maxDist = -1;
+	unsigned octreeLevel = 0;
+	QString processName;
+
+	if (arguments.empty())
+		return Error(QString("Missing process after '%1' (%2, %3 or %4)").arg(COMMAND_OUT_OF_CORE).arg(COMMAND_DENSITY).arg(COMMAND_ROUGHNESS).arg(COMMAND_C2C_DIST));
+	QString argument = arguments.takeFirst();
+	if (IsCommand(argument,COMMAND_DENSITY) || IsCommand(argument,COMMAND_ROUGHNESS))
+	{
+		process = IsCommand(argument,COMMAND_DENSITY) ? OOC_DENSITY : OOC_ROUGHNESS;
+		processName = (process == OOC_DENSITY ? "DENSITY" : "ROUGHNESS");
+
+		if (arguments.empty())
+			return Error(QString("Missing parameter: sphere radius after \"-%1\"").arg(argument.mid(1)));
+		bool paramOk = false;
+		QString kernelStr = arguments.takeFirst();
+		kernelRadius = static_cast<PointCoordinateType>(kernelStr.toDouble(&paramOk));
+		if (!paramOk || kernelRadius <= 0)
+			return Error(QString("Failed to read a numerical parameter: sphere radius (after \"-%1\"). Got '%2' instead.").arg(argument.mid(1)).arg(kernelStr));
+		Print(QString("\tSphere radius: %1").arg(kernelRadius));
+
+		//optional parameter: density type
+		if (process == OOC_DENSITY && !arguments.empty() && IsCommand(arguments.front(),COMMAND_DENSITY_TYPE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+			if (arguments.empty())
+				return Error(QString("Missing parameter: density type after \"-%1\" (KNN/SURFACE/VOLUME)").arg(COMMAND_DENSITY_TYPE));
+			if (!ReadDensityType(arguments,densityType))
+				return false;
+		}
+	}
+	else if (IsCommand(argument,COMMAND_C2C_DIST))
+	{
+		process = OOC_C2C_DIST;
+		processName = "C2C_DIST";
+
+		if (arguments.empty() || arguments.front().startsWith("-"))
+			return Error(QString("Missing parameter: reference LAS file after \"-%1\"").arg(COMMAND_C2C_DIST));
+		referenceFilename = arguments.takeFirst();
+
+		while (!arguments.empty())
+		{
+			QString option = arguments.front();
+			if (IsCommand(option,COMMAND_MAX_DISTANCE))
+			{
+				//local option confirmed, we can move on
+				arguments.pop_front();
+
+				if (arguments.empty())
+					return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_MAX_DISTANCE));
+				bool conversionOk = false;
+				maxDist = static_cast<ScalarType>(arguments.takeFirst().toDouble(&conversionOk));
+				if (!conversionOk)
+					return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_MAX_DISTANCE));
+			}
+			else if (IsCommand(option,COMMAND_OCTREE_LEVEL))
+			{
+				//local option confirmed, we can move on
+				arguments.pop_front();
+
+				if (arguments.empty())
+					return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_OCTREE_LEVEL));
+				bool conversionOk = false;
+				octreeLevel = arguments.takeFirst().toUInt(&conversionOk);
+				if (!conversionOk || octreeLevel > CCLib::DgmOctree::MAX_OCTREE_LEVEL)
+					return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_OCTREE_LEVEL));
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+	else
+	{
+		return Error(QString("Command '%1' can't be applied out-of-core (%2, %3 or %4 only)").arg(argument).arg(COMMAND_DENSITY).arg(COMMAND_ROUGHNESS).arg(COMMAND_C2C_DIST));
+	}
+
+#ifdef CC_LAS_SUPPORT
+	CCVector3d bbMin, bbMax;
+	unsigned pointCount = 0;
+	if (!LASFilter::ReadBoundingBox(filename,bbMin,bbMax,&pointCount))
+		return Error(QString("Failed to read the header of '%1'").arg(filename));
+	Print(QString("%1 points - memory limit: %2 Mb").arg(pointCount).arg(memoryLimit >> 20));
+
+	//the coordinates are shifted (around the center of the input file) so as to fit in the cloud coordinates type
+	CCVector3d center = (bbMin + bbMax) / 2;
+	CCVector3d shift(-floor(center.x), -floor(center.y), -floor(center.z));
+
+	LASStreamedCloud cloud;
+	CC_FILE_ERROR result = cloud.open(filename,shift);
+	LASStreamedCloud reference;
+	if (result == CC_FERR_NO_ERROR && process == OOC_C2C_DIST)
+	{
+		filename = referenceFilename;
+		result = (QFileInfo(referenceFilename).suffix().toUpper() == "LAS" ? reference.open(referenceFilename,shift) : CC_FERR_WRONG_FILE_TYPE);
+	}
+	if (result != CC_FERR_NO_ERROR)
+	{
+		if (result == CC_FERR_WRONG_FILE_TYPE)
+			return Error(QString("Only uncompressed LAS files can be processed out-of-core (convert '%1' to LAS first)").arg(filename));
+		FileIOFilter::DisplayErrorMessage(result,"loading",filename);
+		return false;
+	}
+
+	if (outputFilename.isEmpty())
+		outputFilename = fi.absoluteDir().absoluteFilePath(QString("%1_%2.las").arg(fi.completeBaseName()).arg(processName));
+	if (tempDir.isEmpty())
+		tempDir = QFileInfo(outputFilename).absolutePath();
+
+	CCLib::OutOfCoreOctree octree(qPrintable(tempDir),memoryLimit);
+	QString fieldName;
+	bool success = true;
+	switch (process)
+	{
+	case OOC_DENSITY:
+		fieldName = GetDensityFieldName(densityType,kernelRadius);
+		if (octree.build(&cloud,pDlg) <= 0)
+			success = Error("Failed to build the out-of-core octree");
+		else if (CCLib::GeometricalAnalysisTools::computeLocalDensity(&octree,densityType,kernelRadius,pDlg) < 0)
+			success = Error("Failed to compute the density");
+		break;
+	case OOC_ROUGHNESS:
+		fieldName = CC_ROUGHNESS_FIELD_NAME;
+		if (octree.build(&cloud,pDlg) <= 0)
+			success = Error("Failed to build the out-of-core octree");
+		else if (CCLib::GeometricalAnalysisTools::computeRoughness(&octree,kernelRadius,pDlg) < 0)
+			success = Error("Failed to compute the roughness");
+		break;
+	case OOC_C2C_DIST:
+		{
+			fieldName = CC_CLOUD2CLOUD_DISTANCES_DEFAULT_SF_NAME;
+			CCLib::OutOfCoreOctree referenceOctree(qPrintable(tempDir),memoryLimit);
+			if (CCLib::DistanceComputationTools::synchronizeOctrees(&cloud,&reference,octree,referenceOctree,static_cast<PointCoordinateType>(maxDist),pDlg) != CCLib::DistanceComputationTools::SYNCHRONIZED)
+				success = Error("Failed to build the out-of-core octrees");
+			else if (CCLib::DistanceComputationTools::computeCloud2CloudDistance(&octree,&referenceOctree,static_cast<unsigned char>(octreeLevel),maxDist,pDlg) < 0)
+				success = Error("Failed to compute the distances");
+			if (reference.readingFailed())
+				success = Error(QString("Failed to read the points of '%1'").arg(referenceFilename));
+		}
+		break;
+	}
+	if (success && cloud.readingFailed())
+		success = Error(QString("Failed to read the points of '%1'").arg(fi.filePath()));
+
+	//the values are saved in a copy of the input file (as a new 'extra bytes' field)
+	if (success)
+	{
+		LASExtraFieldWriter writer;
+		result = writer.open(fi.filePath(),outputFilename,fieldName);
+		if (result == CC_FERR_NO_ERROR && !octree.exportValues(writer,pDlg))
+			result = CC_FERR_WRITING;
+		CC_FILE_ERROR closeResult = writer.close();
+		if (result == CC_FERR_NO_ERROR)
+			result = closeResult;
+
+		if (result != CC_FERR_NO_ERROR)
+		{
+			FileIOFilter::DisplayErrorMessage(result,"saving",outputFilename);
+			QFile::remove(outputFilename);
+			success = false;
+		}
+		else
+		{
+			Print(QString("Output file: '%1' (new field: '%2')").arg(outputFilename).arg(fieldName));
+		}
+	}
+
+	return success;
+#else
+	return Error("The out-of-core mode requires the LAS I/O filter (not available in this version)");
+#endif
+}
+
 int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 {
 	ccProgressDialog progressDlg(false,parent);
@@ -3577,6 +5024,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			success = commandDist(arguments,false,parent);
 		}
+		//M3C2 distances
+		else if (IsCommand(argument,COMMAND_M3C2))
+		{
+			success = commandM3C2(arguments,&progressDlg);
+		}
 		//Mesh sampling
 		else if (IsCommand(argument,COMMAND_SAMPLE_MESH))
 		{
@@ -3617,6 +5069,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			success = commandICP(arguments,parent);
 		}
+		//ICP RMS matrix (all pairs)
+		else if (IsCommand(argument,COMMAND_ICP_RMS_MATRIX))
+		{
+			success = commandICPRmsMatrix(arguments,&progressDlg);
+		}
 		//Delaunay 2.5D triangulation
 		else if (IsCommand(argument,COMMAND_DELAUNAY))
 		{
@@ -3661,6 +5118,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			success = commandChangePLYExportFormat(arguments);
 		}
+		//Set default BIN compression
+		else if (IsCommand(argument,COMMAND_BIN_COMPRESSION))
+		{
+			success = commandChangeBINCompression(arguments);
+		}
 		//Set default FBX output format
 		else if (IsCommand(argument,COMMAND_FBX_EXPORT_FORMAT))
 		{
@@ -3727,6 +5189,21 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			s_addTimestamp = false;
 		}
+		//batch mode (the remaining commands are applied to each input file)
+		else if (IsCommand(argument,COMMAND_BATCH))
+		{
+			success = commandBatch(arguments);
+		}
+		//tiled mode (the remaining commands are applied to each tile)
+		else if (IsCommand(argument,COMMAND_TILES))
+		{
+			success = commandTiles(arguments,parent);
+		}
+		//out-of-core mode (the file is never loaded)
+		else if (IsCommand(argument,COMMAND_OUT_OF_CORE))
+		{
+			success = commandOutOfCore(arguments,&progressDlg);
+		}
 		//log file
 		else if (IsCommand(argument,COMMAND_LOG_FILE))
 		{
@@ -37,6 +37,7 @@ protected:
 	bool commandSampleMesh					(QStringList& arguments, ccProgressDialog* pDlg = 0);
 	bool commandBundler						(QStringList& arguments);
 	bool commandDist						(QStringList& arguments, bool cloud2meshDist, QDialog* parent = 0);
+	bool commandM3C2						(QStringList& arguments, ccProgressDialog* pDlg = 0);
 	bool commandFilterSFByValue				(QStringList& arguments);
 	bool commandMergeClouds					(QStringList& arguments);
 	bool commandStatTest					(QStringList& arguments, ccProgressDialog* pDlg = 0);
@@ -48,10 +49,12 @@ protected:
 	bool matchBBCenters						(QStringList& arguments);
 	bool commandSfArithmetic				(QStringList& arguments);
 	bool commandICP							(QStringList& arguments, QDialog* parent = 0);
+	bool commandICPRmsMatrix				(QStringList& arguments, ccProgressDialog* pDlg = 0);
 	bool commandDelaunay					(QStringList& arguments, QDialog* parent = 0);
 	bool commandChangeCloudOutputFormat		(QStringList& arguments);
 	bool commandChangeMeshOutputFormat		(QStringList& arguments);
 	bool commandChangePLYExportFormat		(QStringList& arguments);
+	bool commandChangeBINCompression		(QStringList& arguments);
 	bool commandChangeFBXOutputFormat		(QStringList& arguments);
 	bool commandForceNormalsComputation		(QStringList& arguments);
 	bool commandSaveClouds					(QStringList& arguments);
@@ -62,6 +65,9 @@ protected:
 	bool commandApplyTransformation			(QStringList& arguments);
 	bool commandLogFile						(QStringList& arguments);
 	bool commandSORFilter					(QStringList& arguments, ccProgressDialog* pDlg = 0);
+	bool commandBatch						(QStringList& arguments);
+	bool commandTiles						(QStringList& arguments, QDialog* parent = 0);
+	bool commandOutOfCore					(QStringList& arguments, ccProgressDialog* pDlg = 0);
 
 protected:
 
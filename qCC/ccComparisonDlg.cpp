@@ -116,6 +116,7 @@ ccComparisonDlg::ccComparisonDlg(	ccHObject* compEntity,
 		localModelingTab->setEnabled(false);
 		signedDistFrame->setEnabled(true);
 		signedDistCheckBox->setChecked(true);
+		bvhCheckBox->setEnabled(true);
 	}
 	else
 	{
@@ -394,9 +395,9 @@ int ccComparisonDlg::computeApproxResults()
 		ccLog::Print("[computeApproxResults] Time: %3.2f s.",static_cast<double>(elapsedTime_ms)/1.0e3);
 
 		//display approx. dist. statistics
-		ScalarType mean,variance;
 		sf->computeMinAndMax();
-		sf->computeMeanAndVariance(mean,&variance);
+		ScalarType mean = static_cast<ScalarType>(sf->getStatistics().mean);
+		ScalarType variance = static_cast<ScalarType>(sf->getStatistics().variance);
 
 		approxStats->setColumnCount(2);
 		approxStats->setRowCount(5);
@@ -732,6 +733,18 @@ bool ccComparisonDlg::compute()
 
 	case CLOUDMESH_DIST: //cloud-mesh
 
+		if (bvhCheckBox->isEnabled() && bvhCheckBox->isChecked())
+		{
+			result = CCLib::DistanceComputationTools::computeCloud2MeshDistanceWithBVH(	m_compCloud,
+																						m_refMesh,
+																						maxSearchDist,
+																						signedDistances,
+																						flipNormals,
+																						multiThread,
+																						&progressDlg);
+			break;
+		}
+
 		if (multiThread && maxSearchDistSpinBox->isEnabled())
 			ccLog::Warning("[Cloud/Mesh comparison] Max search distance is not supported in multi-thread mode! Switching to single thread mode...");
 		
@@ -756,9 +769,9 @@ bool ccComparisonDlg::compute()
 		ccLog::Print("[ComputeDistances] Time: %3.2f s.",static_cast<double>(elapsedTime_ms)/1.0e3);
 
 		//display some statics about the computed distances
-		ScalarType mean,variance;
 		sf->computeMinAndMax();
-		sf->computeMeanAndVariance(mean,&variance);
+		ScalarType mean = static_cast<ScalarType>(sf->getStatistics().mean);
+		ScalarType variance = static_cast<ScalarType>(sf->getStatistics().variance);
 		ccLog::Print("[ComputeDistances] Mean distance = %f / std deviation = %f",mean,sqrt(variance));
 
 		m_compCloud->setCurrentDisplayedScalarField(sfIdx);
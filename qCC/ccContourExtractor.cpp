@@ -36,6 +36,8 @@
 //System
 #include <assert.h>
 #include <set>
+#include <map>
+#include <algorithm>
 #include <math.h>
 
 //list of already used point to avoid hull's inner loops
@@ -51,31 +53,297 @@ typedef std::list<Vertex2D*>::const_iterator ConstVertexIterator;
 
 struct Edge
 {
-	Edge() : nearestPointIndex(0), nearestPointSquareDist(-1.0f) {}
+	Edge() : nearestPointIndex(0), nearestPointSquareDist(-1.0f), order(0) {}
 	
 	Edge(const VertexIterator& A, unsigned _nearestPointIndex, float _nearestPointSquareDist)
 		: itA(A)
 		, nearestPointIndex(_nearestPointIndex)
 		, nearestPointSquareDist(_nearestPointSquareDist)
+		, order(0)
 	{}
 
-	//operator
-	inline bool operator< (const Edge& e) const { return nearestPointSquareDist < e.nearestPointSquareDist; }
+	//operator (equal distances: first in, first out)
+	inline bool operator< (const Edge& e) const { return nearestPointSquareDist < e.nearestPointSquareDist || (nearestPointSquareDist == e.nearestPointSquareDist && order < e.order); }
 
 	VertexIterator itA;
 	unsigned nearestPointIndex;
 	float nearestPointSquareDist;
+	//! Insertion order (see PushEdge)
+	unsigned order;
 };
 
+typedef std::multiset<Edge> EdgeSet;
+//! Edges sorted by nearest (candidate) point
+typedef std::multimap<unsigned, EdgeSet::iterator> EdgesByCandidate;
+
+//! Adds an edge to the processing queue
+void PushEdge(Edge e, EdgeSet& edges, EdgesByCandidate& edgesByCandidate, unsigned& insertionCount)
+{
+	e.order = insertionCount++;
+	EdgeSet::iterator it = edges.insert(e);
+	edgesByCandidate.insert(std::make_pair(e.nearestPointIndex,it));
+}
+
+//! Removes an edge from the processing queue
+void RemoveEdge(EdgeSet::iterator it, EdgeSet& edges, EdgesByCandidate& edgesByCandidate)
+{
+	std::pair<EdgesByCandidate::iterator,EdgesByCandidate::iterator> range = edgesByCandidate.equal_range(it->nearestPointIndex);
+	for (EdgesByCandidate::iterator itC = range.first; itC != range.second; ++itC)
+	{
+		if (itC->second == it)
+		{
+			edgesByCandidate.erase(itC);
+			break;
+		}
+	}
+	edges.erase(it);
+}
+
+
+//! Uniform 2D grid over the (projected) points and the hull edges
+/** Used to look for the candidate points in the vicinity of an edge
+	and for the hull edges that could intersect a new segment, instead
+	of scanning the whole set of points (or the whole hull) each time.
+**/
+class HullGrid2D
+{
+public:
+
+	//! Default constructor
+	HullGrid2D() : m_cellSize(1), m_margin(0), m_width(1), m_height(1) {}
+
+	//! Builds the grid
+	/** \warning the points shouldn't be moved (or sorted) afterwards
+		\param points input set of points
+		\param minP min corner of the points bounding box
+		\param maxP max corner of the points bounding box
+		\return success
+	**/
+	bool init(const std::vector<Vertex2D>& points, const CCVector2& minP, const CCVector2& maxP)
+	{
+		unsigned pointCount = static_cast<unsigned>(points.size());
+
+		m_minP = minP;
+		m_maxP = maxP;
+
+		//we target ~4 points per cell
+		PointCoordinateType targetCellCount = static_cast<PointCoordinateType>(std::max<unsigned>(1,pointCount/4));
+		CCVector2 D = maxP - minP;
+		PointCoordinateType maxSide = std::max(D.x,D.y);
+		if (maxSide > 0)
+		{
+			m_cellSize = sqrt(D.x * D.y / targetCellCount);
+			//for (nearly) flat sets
+			m_cellSize = std::max(m_cellSize, maxSide / targetCellCount);
+		}
+		else
+		{
+			m_cellSize = 1;
+		}
+		m_width = static_cast<unsigned>(D.x / m_cellSize) + 1;
+		m_height = static_cast<unsigned>(D.y / m_cellSize) + 1;
+		//safety margin for the cells selection (see getCells)
+		m_margin = std::max(m_cellSize / 8, D.norm() * static_cast<PointCoordinateType>(1.0e-5));
+
+		try
+		{
+			//cells content (counting sort)
+			m_cellStart.clear();
+			m_cellStart.resize(static_cast<size_t>(m_width) * m_height + 1, 0);
+			m_cellPoints.resize(pointCount);
+
+			for (unsigned i=0; i<pointCount; ++i)
+				++m_cellStart[cellIndex(points[i]) + 1];
+			for (size_t c=1; c<m_cellStart.size(); ++c)
+				m_cellStart[c] += m_cellStart[c-1];
+
+			std::vector<unsigned> cellFill(m_cellStart.begin(), m_cellStart.end()-1);
+			for (unsigned i=0; i<pointCount; ++i)
+				m_cellPoints[cellFill[cellIndex(points[i])]++] = i;
+
+			m_cellEdges.clear();
+			m_cellEdges.resize(static_cast<size_t>(m_width) * m_height);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			m_cellStart.clear();
+			m_cellPoints.clear();
+			m_cellEdges.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	//! Returns the cells size
+	inline PointCoordinateType cellSize() const { return m_cellSize; }
+
+	//! Returns the max (signed) distance between a line and the grid bounding box
+	PointCoordinateType maxDistanceToLine(const CCVector2& O, const CCVector2& N) const
+	{
+		PointCoordinateType maxDist = std::max(	std::max(N.dot(m_minP - O), N.dot(CCVector2(m_maxP.x,m_minP.y) - O)),
+												std::max(N.dot(m_maxP - O), N.dot(CCVector2(m_minP.x,m_maxP.y) - O)) );
+		return maxDist + m_margin;
+	}
+
+	//! Returns the (conservative) list of the cells intersecting a convex quadrilateral
+	const std::vector<unsigned>& getCells(const CCVector2 quad[4])
+	{
+		m_cells.clear();
+
+		PointCoordinateType yMin = quad[0].y;
+		PointCoordinateType yMax = quad[0].y;
+		for (unsigned k=1; k<4; ++k)
+		{
+			yMin = std::min(yMin,quad[k].y);
+			yMax = std::max(yMax,quad[k].y);
+		}
+		if (yMax + m_margin < m_minP.y || yMin - m_margin > m_maxP.y)
+			return m_cells;
+
+		unsigned j0 = row(yMin - m_margin);
+		unsigned j1 = row(yMax + m_margin);
+		for (unsigned j=j0; j<=j1; ++j)
+		{
+			//extent of the quadrilateral inside the current row
+			PointCoordinateType ya = m_minP.y + j * m_cellSize - m_margin;
+			PointCoordinateType yb = ya + m_cellSize + 2 * m_margin;
+			PointCoordinateType xMin = 0;
+			PointCoordinateType xMax = 0;
+			bool found = false;
+			for (unsigned k=0; k<4; ++k)
+			{
+				const CCVector2& P = quad[k];
+				const CCVector2& Q = quad[(k+1) & 3];
+				PointCoordinateType t0 = 0;
+				PointCoordinateType t1 = 1;
+				if (P.y != Q.y)
+				{
+					PointCoordinateType ta = (ya - P.y) / (Q.y - P.y);
+					PointCoordinateType tb = (yb - P.y) / (Q.y - P.y);
+					t0 = std::max(t0, std::min(ta,tb));
+					t1 = std::min(t1, std::max(ta,tb));
+					if (t0 > t1)
+						continue;
+				}
+				else if (P.y < ya || P.y > yb)
+				{
+					continue;
+				}
+
+				PointCoordinateType x0 = P.x + t0 * (Q.x - P.x);
+				PointCoordinateType x1 = P.x + t1 * (Q.x - P.x);
+				if (!found)
+				{
+					xMin = xMax = x0;
+					found = true;
+				}
+				xMin = std::min(xMin, std::min(x0,x1));
+				xMax = std::max(xMax, std::max(x0,x1));
+			}
+
+			if (!found || xMax + m_margin < m_minP.x || xMin - m_margin > m_maxP.x)
+				continue;
+
+			unsigned i0 = col(xMin - m_margin);
+			unsigned i1 = col(xMax + m_margin);
+			for (unsigned i=i0; i<=i1; ++i)
+				m_cells.push_back(j * m_width + i);
+		}
+
+		return m_cells;
+	}
+
+	//! Returns the (conservative) list of the cells crossed by a segment
+	inline const std::vector<unsigned>& getCells(const CCVector2& A, const CCVector2& B)
+	{
+		CCVector2 quad[4] = { A, B, B, A };
+		return getCells(quad);
+	}
+
+	//! Returns the indexes of the points inside a given cell
+	inline const unsigned* cellBegin(unsigned cellIndex) const { return &m_cellPoints[0] + m_cellStart[cellIndex]; }
+	inline const unsigned* cellEnd(unsigned cellIndex) const { return &m_cellPoints[0] + m_cellStart[cellIndex+1]; }
+
+	//! Registers a hull edge (AB)
+	/** \warning may throw std::bad_alloc
+	**/
+	void addEdge(const VertexIterator& itA, const CCVector2& A, const CCVector2& B)
+	{
+		const std::vector<unsigned>& cells = getCells(A,B);
+		for (size_t c=0; c<cells.size(); ++c)
+			m_cellEdges[cells[c]].push_back(itA);
+	}
+
+	//! Unregisters a hull edge (AB must be the same as when the edge was registered)
+	void removeEdge(const VertexIterator& itA, const CCVector2& A, const CCVector2& B)
+	{
+		const std::vector<unsigned>& cells = getCells(A,B);
+		for (size_t c=0; c<cells.size(); ++c)
+		{
+			std::vector<VertexIterator>& cellEdges = m_cellEdges[cells[c]];
+			for (size_t k=0; k<cellEdges.size(); ++k)
+			{
+				if (cellEdges[k] == itA)
+				{
+					cellEdges[k] = cellEdges.back();
+					cellEdges.pop_back();
+					break;
+				}
+			}
+		}
+	}
+
+	//! Returns the hull edges registered in a given cell
+	inline const std::vector<VertexIterator>& cellEdges(unsigned cellIndex) const { return m_cellEdges[cellIndex]; }
+
+protected:
+
+	//! Returns the (clamped) column of a given abscissa
+	inline unsigned col(PointCoordinateType x) const
+	{
+		PointCoordinateType i = floor((x - m_minP.x) / m_cellSize);
+		return i <= 0 ? 0 : std::min(static_cast<unsigned>(i), m_width-1);
+	}
+	//! Returns the (clamped) row of a given ordinate
+	inline unsigned row(PointCoordinateType y) const
+	{
+		PointCoordinateType j = floor((y - m_minP.y) / m_cellSize);
+		return j <= 0 ? 0 : std::min(static_cast<unsigned>(j), m_height-1);
+	}
+	//! Returns the index of the cell containing a given point
+	inline unsigned cellIndex(const CCVector2& P) const { return row(P.y) * m_width + col(P.x); }
+
+	//! Bounding box
+	CCVector2 m_minP, m_maxP;
+	//! Cells size
+	PointCoordinateType m_cellSize;
+	//! Safety margin for the cells selection
+	PointCoordinateType m_margin;
+	//! Grid dimensions
+	unsigned m_width, m_height;
+	//! Start of each cell in m_cellPoints (+ end of the last one)
+	std::vector<unsigned> m_cellStart;
+	//! Points indexes (sorted by cell)
+	std::vector<unsigned> m_cellPoints;
+	//! Hull edges crossing each cell (identified by their first vertex)
+	std::vector< std::vector<VertexIterator> > m_cellEdges;
+	//! Cells buffer (see getCells)
+	std::vector<unsigned> m_cells;
+};
 
 //! Finds the nearest (available) point to an edge
-/** \return The nearest point distance (or -1 if no point was found!)
+/** The grid is used to scan strips of increasing width along the edge
+	(the result is the same as with an exhaustive search).
+	\return The nearest point distance (or -1 if no point was found!)
 **/
 PointCoordinateType FindNearestCandidate(	unsigned& minIndex,
 											const VertexIterator& itA,
 											const VertexIterator& itB,
 											const std::vector<Vertex2D>& points,
 											const std::vector<HullPointFlags>& pointFlags,
+											HullGrid2D& grid,
 											PointCoordinateType minSquareEdgeLength,
 											PointCoordinateType maxSquareEdgeLength,
 											bool allowLongerChunks = false)
@@ -84,47 +352,76 @@ PointCoordinateType FindNearestCandidate(	unsigned& minIndex,
 	PointCoordinateType minDist2 = -1;
 	CCVector2 AB = **itB-**itA;
 	PointCoordinateType squareLengthAB = AB.norm2();
-	unsigned pointCount = static_cast<unsigned>(points.size());
-	for (unsigned i=0; i<pointCount; ++i)
-	{
-		const Vertex2D& P = points[i];
-		if (pointFlags[P.index] != POINT_NOT_USED)
-			continue;
+	PointCoordinateType lengthAB = sqrt(squareLengthAB);
+	if (lengthAB == 0)
+		return minDist2;
 
-		//skip the edge vertices!
-		if (P.index == (*itA)->index || P.index == (*itB)->index)
-			continue;
+	//'inner' side normal
+	CCVector2 N(-AB.y / lengthAB, AB.x / lengthAB);
+	PointCoordinateType maxHeight = grid.maxDistanceToLine(**itA,N);
 
-		//we only consider 'inner' points
-		CCVector2 AP = P-**itA;
-		if (AB.x * AP.y - AB.y * AP.x < 0)
-		{
-			continue;
-		}
+	PointCoordinateType h0 = 0;
+	PointCoordinateType h1 = grid.cellSize();
+	while (true)
+	{
+		//current strip
+		CCVector2 quad[4] = { **itA + N * h0, **itB + N * h0, **itB + N * h1, **itA + N * h1 };
+		const std::vector<unsigned>& cells = grid.getCells(quad);
 
-		PointCoordinateType dot = AB.dot(AP); // = cos(PAB) * ||AP|| * ||AB||
-		if (dot >= 0 && dot <= squareLengthAB)
+		for (size_t c=0; c<cells.size(); ++c)
 		{
-			CCVector2 HP = AP - AB * (dot / squareLengthAB);
-			PointCoordinateType dist2 = HP.norm2();
-			if (minDist2 < 0 || dist2 < minDist2)
+			for (const unsigned* it = grid.cellBegin(cells[c]); it != grid.cellEnd(cells[c]); ++it)
 			{
-				//the 'nearest' point must also be a valid candidate
-				//(i.e. at least one of the created edges is smaller than the original one
-				//and we don't create too small edges!)
-				PointCoordinateType squareLengthAP = AP.norm2();
-				PointCoordinateType squareLengthBP = (P-**itB).norm2();
-				if (	squareLengthAP >= minSquareEdgeLength
-					&&	squareLengthBP >= minSquareEdgeLength
-					&&	(allowLongerChunks || (squareLengthAP < squareLengthAB || squareLengthBP < squareLengthAB))
-					)
+				unsigned i = *it;
+				const Vertex2D& P = points[i];
+				if (pointFlags[P.index] != POINT_NOT_USED)
+					continue;
+
+				//skip the edge vertices!
+				if (P.index == (*itA)->index || P.index == (*itB)->index)
+					continue;
+
+				//we only consider 'inner' points
+				CCVector2 AP = P-**itA;
+				if (AB.x * AP.y - AB.y * AP.x < 0)
 				{
-					minDist2 = dist2;
-					minIndex = i;
+					continue;
+				}
+
+				PointCoordinateType dot = AB.dot(AP); // = cos(PAB) * ||AP|| * ||AB||
+				if (dot >= 0 && dot <= squareLengthAB)
+				{
+					CCVector2 HP = AP - AB * (dot / squareLengthAB);
+					PointCoordinateType dist2 = HP.norm2();
+					//same choice as a sequential scan in case of equality (i.e. the first point)
+					if (minDist2 < 0 || dist2 < minDist2 || (dist2 == minDist2 && i < minIndex))
+					{
+						//the 'nearest' point must also be a valid candidate
+						//(i.e. at least one of the created edges is smaller than the original one
+						//and we don't create too small edges!)
+						PointCoordinateType squareLengthAP = AP.norm2();
+						PointCoordinateType squareLengthBP = (P-**itB).norm2();
+						if (	squareLengthAP >= minSquareEdgeLength
+							&&	squareLengthBP >= minSquareEdgeLength
+							&&	(allowLongerChunks || (squareLengthAP < squareLengthAB || squareLengthBP < squareLengthAB))
+							)
+						{
+							minDist2 = dist2;
+							minIndex = i;
+						}
+					}
 				}
 			}
 		}
+
+		//any nearer point would be inside the strips already scanned
+		if ((minDist2 >= 0 && minDist2 <= h1*h1) || h1 >= maxHeight)
+			break;
+
+		h0 = h1;
+		h1 *= 2;
 	}
+
 	return (minDist2 < 0 ? minDist2 : minDist2/squareLengthAB);
 }
 
@@ -158,6 +455,7 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 
 	//hack: compute the theoretical 'minimal' edge length
 	PointCoordinateType minSquareEdgeLength = 0;
+	HullGrid2D grid;
 	{
 		CCVector2 minP,maxP;
 		for (size_t i=0; i<pointCount; ++i)
@@ -178,6 +476,13 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 		minSquareEdgeLength = (maxP-minP).norm2() / static_cast<PointCoordinateType>(1.0e7); //10^-7 of the max bounding rectangle side
 		minSquareEdgeLength = std::min(minSquareEdgeLength, maxSquareEdgeLength/10);
 
+		//grid used to look for the candidate points
+		if (!grid.init(points,minP,maxP))
+		{
+			//not enough memory
+			return false;
+		}
+
 		//we remove very small edges
 		for (VertexIterator itA = hullPoints.begin(); itA != hullPoints.end(); ++itA)
 		{
@@ -309,6 +614,28 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 		debugDialog.refresh();
 	}
 
+	//register the hull edges in the grid (for the intersection tests)
+	try
+	{
+		size_t edgeCount = hullPoints.size();
+		if (contourType != FULL)
+			--edgeCount;
+
+		VertexIterator itB = hullPoints.begin();
+		for (size_t i=0; i<edgeCount; ++i)
+		{
+			VertexIterator itA = itB; ++itB;
+			if (itB == hullPoints.end())
+				itB = hullPoints.begin();
+			grid.addEdge(itA,**itA,**itB);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
 	//Warning: high STL containers usage ahead ;)
 	unsigned step = 0;
 	bool somethingHasChanged = true;
@@ -327,7 +654,9 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 			//}
 
 			//build the initial edge list & flag the convex hull points
-			std::multiset<Edge> edges;
+			EdgeSet edges;
+			EdgesByCandidate edgesByCandidate;
+			unsigned edgeInsertionCount = 0;
 			//initial number of edges
 			assert(hullPoints.size() >= 2);
 			size_t initEdgeCount = hullPoints.size();
@@ -351,6 +680,7 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 						itB,
 						points,
 						pointFlags,
+						grid,
 						minSquareEdgeLength,
 						maxSquareEdgeLength,
 						step > 1);
@@ -358,7 +688,7 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 					if (minSquareDist >= 0)
 					{
 						Edge e(itA,nearestPointIndex,minSquareDist);
-						edges.insert(e);
+						PushEdge(e,edges,edgesByCandidate,edgeInsertionCount);
 					}
 				}
 
@@ -374,7 +704,7 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 				//current edge (AB)
 				//this should be the edge with the nearest 'candidate'
 				Edge e = *edges.begin();
-				edges.erase(edges.begin());
+				RemoveEdge(edges.begin(),edges,edgesByCandidate);
 
 				VertexIterator itA = e.itA;
 				VertexIterator itB = itA; ++itB;
@@ -435,24 +765,34 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 				//}
 
 				//last check: the new segments must not intersect with the actual hull!
+				//(only the hull edges registered in the cells crossed by the new segments need to be tested)
 				bool intersect = false;
-				//if (false)
+				for (unsigned s=0; s<2 && !intersect; ++s)
 				{
-					for (VertexIterator itJ = hullPoints.begin(), itI = itJ++; itI != hullPoints.end(); ++itI, ++itJ)
+					//segments AP and PB
+					const Vertex2D& S1 = (s == 0 ? **itA : P);
+					const Vertex2D& S2 = (s == 0 ? P : **itB);
+					unsigned sharedIndex = (s == 0 ? (*itA)->index : (*itB)->index);
+
+					const std::vector<unsigned>& cells = grid.getCells(S1,S2);
+					for (size_t c=0; c<cells.size() && !intersect; ++c)
 					{
-						if (itJ == hullPoints.end())
+						const std::vector<VertexIterator>& cellEdges = grid.cellEdges(cells[c]);
+						for (size_t k=0; k<cellEdges.size(); ++k)
 						{
-							if (contourType == FULL)
+							VertexIterator itI = cellEdges[k];
+							VertexIterator itJ = itI; ++itJ;
+							if (itJ == hullPoints.end())
+							{
+								assert(contourType == FULL);
 								itJ = hullPoints.begin();
-							else
-								break;
-						}
+							}
 
-						if (	((*itI)->index != (*itA)->index && (*itJ)->index != (*itA)->index && CCLib::PointProjectionTools::segmentIntersect(**itI,**itJ,**itA,P))
-							||	((*itI)->index != (*itB)->index && (*itJ)->index != (*itB)->index && CCLib::PointProjectionTools::segmentIntersect(**itI,**itJ,P,**itB)) )
-						{
-							intersect = true;
-							break;
+							if ((*itI)->index != sharedIndex && (*itJ)->index != sharedIndex && CCLib::PointProjectionTools::segmentIntersect(**itI,**itJ,S1,S2))
+							{
+								intersect = true;
+								break;
+							}
 						}
 					}
 				}
@@ -461,6 +801,11 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 					//add point to concave hull
 					VertexIterator itP = hullPoints.insert(itB == hullPoints.begin() ? hullPoints.end() : itB, &points[e.nearestPointIndex]);
 
+					//update the hull edges in the grid (AB --> AP + PB)
+					grid.removeEdge(itA,**itA,**itB);
+					grid.addEdge(itA,**itA,P);
+					grid.addEdge(itP,P,**itB);
+
 					//we won't use P anymore!
 					pointFlags[P.index] = POINT_USED;
 
@@ -489,33 +834,21 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 					//update all edges that were having 'P' as their nearest candidate as well
 					if (!edges.empty())
 					{
-						std::vector<VertexIterator> removed;
-						std::multiset<Edge>::const_iterator lastValidIt = edges.end();
-						for (std::multiset<Edge>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+						std::vector<Edge> removed;
+						std::pair<EdgesByCandidate::iterator,EdgesByCandidate::iterator> range = edgesByCandidate.equal_range(e.nearestPointIndex);
+						for (EdgesByCandidate::iterator it = range.first; it != range.second; ++it)
 						{
-							if ((*it).nearestPointIndex == e.nearestPointIndex)
-							{
-								//we'll have to put them back afterwards!
-								removed.push_back((*it).itA);
-							
-								edges.erase(it);
-								if (edges.empty())
-									break;
-								if (lastValidIt != edges.end())
-									it = lastValidIt;
-								else
-									it = edges.begin();
-							}
-							else
-							{
-								lastValidIt = it;
-							}
+							//we'll have to put them back afterwards!
+							removed.push_back(*(it->second));
+							edges.erase(it->second);
 						}
+						edgesByCandidate.erase(range.first,range.second);
 
-						//update the removed edges info and put them back in the main list
+						//update the removed edges info and put them back in the main list (in the same order as they were)
+						std::sort(removed.begin(),removed.end());
 						for (size_t i=0; i<removed.size(); ++i)
 						{
-							VertexIterator itC = removed[i];
+							VertexIterator itC = removed[i].itA;
 							VertexIterator itD = itC; ++itD;
 							if (itD == hullPoints.end())
 								itD = hullPoints.begin();
@@ -527,13 +860,14 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 								itD,
 								points,
 								pointFlags,
+								grid,
 								minSquareEdgeLength,
 								maxSquareEdgeLength);
 
 							if (minSquareDist >= 0)
 							{
 								Edge e(itC,nearestPointIndex,minSquareDist);
-								edges.insert(e);
+								PushEdge(e,edges,edgesByCandidate,edgeInsertionCount);
 							}
 						}
 					}
@@ -548,13 +882,14 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 							itP,
 							points,
 							pointFlags,
+							grid,
 							minSquareEdgeLength,
 							maxSquareEdgeLength);
 
 						if (minSquareDist >= 0)
 						{
 							Edge e(itA,nearestPointIndex,minSquareDist);
-							edges.insert(e);
+							PushEdge(e,edges,edgesByCandidate,edgeInsertionCount);
 						}
 					}
 					if ((**itB-P).norm2() > maxSquareEdgeLength)
@@ -566,13 +901,14 @@ bool ccContourExtractor::ExtractConcaveHull2D(	std::vector<Vertex2D>& points,
 							itB,
 							points,
 							pointFlags,
+							grid,
 							minSquareEdgeLength,
 							maxSquareEdgeLength);
 
 						if (minSquareDist >= 0)
 						{
 							Edge e(itP,nearestPointIndex,minSquareDist);
-							edges.insert(e);
+							PushEdge(e,edges,edgesByCandidate,edgeInsertionCount);
 						}
 					}
 				}
@@ -239,36 +239,31 @@ bool ccHistogramWindow::computeBinArrayFromSF(size_t binCount)
 		return true;
 	}
 
-	//(try to) create new array
-	try
-	{
-		m_histoValues.resize(binCount,0);
-	}
-	catch (const std::bad_alloc&)
-	{
-		ccLog::Warning("[ccHistogramWindow::computeBinArrayFromSF] Not enough memory!");
-		return false;
-	}
-
 	double range = m_maxVal - m_minVal;
 	if (range > 0.0)
 	{
-		unsigned count = m_associatedSF->currentSize();
-		double step = range/static_cast<double>(binCount);
-		for (unsigned i=0; i<count; ++i)
+		//values outside of [m_minVal,m_maxVal] are ignored (as well as NaN values)
+		if (!m_associatedSF->computeHistogram(	static_cast<ScalarType>(m_minVal),
+												static_cast<ScalarType>(m_maxVal),
+												static_cast<unsigned>(binCount),
+												m_histoValues))
 		{
-			double val = static_cast<double>(m_associatedSF->getValue(i));
-
-			//we ignore values outside of [m_minVal,m_maxVal] (works fro NaN values as well)
-			if (/*ccScalarField::ValidValue(val) &&*/val >= m_minVal && val <= m_maxVal)
-			{
-				size_t bin = static_cast<size_t>( floor((val-m_minVal) / step) );
-				++m_histoValues[std::min(bin,binCount-1)];
-			}
+			ccLog::Warning("[ccHistogramWindow::computeBinArrayFromSF] Not enough memory!");
+			return false;
 		}
 	}
 	else
 	{
+		//(try to) create new array
+		try
+		{
+			m_histoValues.resize(binCount,0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[ccHistogramWindow::computeBinArrayFromSF] Not enough memory!");
+			return false;
+		}
 		m_histoValues[0] = m_associatedSF->currentSize();
 	}
 
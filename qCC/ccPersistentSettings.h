@@ -36,6 +36,8 @@ public:
 	static inline const QString SelectedOutputFilterMesh    () { return "selectedOutputFilterMesh"; }
 	static inline const QString SelectedOutputFilterImage   () { return "selectedOutputFilterImage"; }
 	static inline const QString SelectedOutputFilterPoly    () { return "selectedOutputFilterPoly"; }
+	static inline const QString BinCompression              () { return "binCompression"; }
+	static inline const QString StlVertexFusion             () { return "stlVertexFusion"; }
 	static inline const QString DuplicatePointsGroup        () { return "duplicatePoints"; }
 	static inline const QString DuplicatePointsMinDist      () { return "minDist"; }
 	static inline const QString HeightGridGeneration        () { return "HeightGridGeneration"; }
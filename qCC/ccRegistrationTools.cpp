@@ -27,6 +27,8 @@
 #include <RegistrationTools.h>
 #include <DistanceComputationTools.h>
 #include <CloudSamplingTools.h>
+#include <ChunkedPointCloud.h>
+#include <ReferenceCloud.h>
 #include <Garbage.h>
 
 //qCC_db
@@ -37,8 +39,21 @@
 #include <ccScalarField.h>
 #include <ccLog.h>
 
+//Qt
+#include <QAtomicInt>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QTextStream>
+#include <QTimer>
+#include <QtConcurrentMap>
+
 //system
 #include <set>
+#include <stdio.h>
 
 //! Default number of points sampled on the 'model' mesh (if any)
 static const unsigned s_defaultSampledPointsOnModelMesh = 100000;
@@ -320,3 +335,416 @@ bool ccRegistrationTools::ICP(	ccHObject* data,
 
 	return (result < CCLib::ICPRegistrationTools::ICP_ERROR);
 }
+
+//! Pair of clouds to register (see ccRegistrationTools::ComputeBestICPRmsMatrix)
+struct ICPPairJob
+{
+	unsigned modelIndex;
+	unsigned dataIndex;
+};
+
+//shared (read-only) structures for ComputeBestICPRms_MT
+static const std::vector<CCLib::ChunkedPointCloud*>* s_sampledClouds_MT = 0;
+static const std::vector<CCVector3>* s_cloudCenters_MT = 0;
+static const std::vector<ccGLMatrix>* s_rotations_MT = 0;
+static const std::vector< std::pair<double,double> >* s_rotationAngles_MT = 0;
+static ccRegistrationTools::BestICPRmsMatrixParams s_bestICPParams_MT;
+//finished pairs (not yet handled by the calling thread)
+static std::vector<ccRegistrationTools::ICPPairResult> s_finishedPairs_MT;
+static QMutex s_finishedPairsMutex_MT;
+static QAtomicInt s_processedSteps_MT;
+static QAtomicInt s_cancelRequested_MT;
+
+//! Copies a cloud (optionally transformed)
+static bool CopyCloud(const CCLib::ChunkedPointCloud* source, CCLib::ChunkedPointCloud& dest, const ccGLMatrix* trans = 0)
+{
+	unsigned count = source->size();
+	dest.clear();
+	if (!dest.reserve(count))
+		return false;
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		CCVector3 P = *source->getPoint(i);
+		if (trans)
+			trans->apply(P);
+		dest.addPoint(P);
+	}
+	return true;
+}
+
+static void ComputeBestICPRms_MT(const ICPPairJob& job)
+{
+	const std::vector<ccGLMatrix>& rotations = *s_rotations_MT;
+
+	ccRegistrationTools::ICPPairResult result;
+	result.modelIndex = job.modelIndex;
+	result.dataIndex = job.dataIndex;
+
+	if (s_cancelRequested_MT.fetchAndAddOrdered(0) == 0)
+	{
+		//each job works on its own copies (the ICP process is not read-only)
+		CCLib::ChunkedPointCloud model, data;
+		if (CopyCloud((*s_sampledClouds_MT)[job.modelIndex], model))
+		{
+			ccGLMatrix transBToZero;
+			transBToZero.toIdentity();
+			transBToZero.setTranslation(-(*s_cloudCenters_MT)[job.dataIndex]);
+
+			ccGLMatrix transFromZeroToA;
+			transFromZeroToA.toIdentity();
+			transFromZeroToA.setTranslation((*s_cloudCenters_MT)[job.modelIndex]);
+
+			for (size_t k = 0; k < rotations.size(); ++k)
+			{
+				if (s_cancelRequested_MT.fetchAndAddOrdered(0) != 0)
+					break;
+
+				ccGLMatrix BtoA = transFromZeroToA * rotations[k] * transBToZero;
+				if (!CopyCloud((*s_sampledClouds_MT)[job.dataIndex], data, &BtoA))
+				{
+					//not enough memory
+					result.rms = -1.0;
+					break;
+				}
+
+				double finalRMS = 0;
+				unsigned finalPointCount = 0;
+				CCLib::ICPRegistrationTools::ScaledTransformation registerTrans;
+				CCLib::ICPRegistrationTools::RESULT_TYPE icpResult = CCLib::ICPRegistrationTools::RegisterClouds(	&model,
+																													&data,
+																													registerTrans,
+																													CCLib::ICPRegistrationTools::MAX_ERROR_CONVERGENCE,
+																													s_bestICPParams_MT.minRMSDecrease,
+																													0,
+																													finalRMS,
+																													finalPointCount,
+																													false,
+																													0,
+																													false,
+																													s_bestICPParams_MT.randomSamplingLimit,
+																													1.0,
+																													0,
+																													0,
+																													CCLib::ICPRegistrationTools::SKIP_NONE,
+																													false); //several registrations are run concurrently
+
+				s_processedSteps_MT.fetchAndAddOrdered(1);
+
+				if (icpResult >= CCLib::ICPRegistrationTools::ICP_ERROR)
+				{
+					//the whole pair is considered as invalid
+					result.rms = -1.0;
+					break;
+				}
+
+				if (result.rms < 0 || finalRMS < result.rms)
+				{
+					result.rms = finalRMS;
+					result.pointCount = finalPointCount;
+					result.phi_deg = (*s_rotationAngles_MT)[k].first;
+					result.theta_deg = (*s_rotationAngles_MT)[k].second;
+					result.initialTrans = BtoA;
+				}
+			}
+		}
+	}
+
+	s_finishedPairsMutex_MT.lock();
+	s_finishedPairs_MT.push_back(result);
+	s_finishedPairsMutex_MT.unlock();
+}
+
+bool ccRegistrationTools::ComputeBestICPRmsMatrix(	const std::vector<ccPointCloud*>& clouds,
+													const BestICPRmsMatrixParams& params,
+													std::vector<ICPPairResult>& results,
+													QTextStream* stream/*=0*/,
+													CCLib::GenericProgressCallback* progressCb/*=0*/)
+{
+	results.clear();
+
+	size_t cloudCount = clouds.size();
+	if (cloudCount < 2)
+	{
+		ccLog::Error("[BestICPRmsMatrix] Need at least two clouds!");
+		return false;
+	}
+
+	//init all possible transformations
+	std::vector<ccGLMatrix> matrices;
+	std::vector< std::pair<double,double> > matrixAngles;
+	std::vector<ICPPairJob> jobs;
+	std::vector<CCVector3> centers;
+	try
+	{
+		unsigned phiSteps = static_cast<unsigned>(360.0/params.angularStep_deg);
+		unsigned thetaSteps = static_cast<unsigned>(180.0/params.angularStep_deg);
+		if (phiSteps == 0 || thetaSteps == 0)
+		{
+			ccLog::Error("[BestICPRmsMatrix] Invalid angular step!");
+			return false;
+		}
+		unsigned rotCount = phiSteps * (thetaSteps-1) + 2;
+		matrices.reserve(rotCount);
+		matrixAngles.reserve(rotCount);
+
+		for (unsigned j=0; j<=thetaSteps; ++j)
+		{
+			//we want to cover the full [0-180] interval! ([-90;90] in fact)
+			double theta_deg = j * params.angularStep_deg - 90.0;
+			for (unsigned i=0; i<phiSteps; ++i)
+			{
+				double phi_deg = i * params.angularStep_deg;
+				ccGLMatrix trans;
+				trans.initFromParameters(	static_cast<float>(phi_deg * CC_DEG_TO_RAD),
+											static_cast<float>(theta_deg * CC_DEG_TO_RAD),
+											0,
+											CCVector3(0,0,0) );
+				matrices.push_back(trans);
+				matrixAngles.push_back( std::pair<double,double>(phi_deg,theta_deg) );
+
+				//for poles, no need to rotate!
+				if (j == 0 || j == thetaSteps)
+					break;
+			}
+		}
+
+		jobs.reserve((cloudCount*(cloudCount-1))/2);
+		for (size_t i=0; i<cloudCount-1; ++i)
+		{
+			for (size_t j=i+1; j<cloudCount; ++j)
+			{
+				ICPPairJob job;
+				job.modelIndex = static_cast<unsigned>(i);
+				job.dataIndex = static_cast<unsigned>(j);
+				jobs.push_back(job);
+			}
+		}
+
+		centers.resize(cloudCount);
+		results.reserve(jobs.size());
+		s_finishedPairs_MT.clear();
+		s_finishedPairs_MT.reserve(jobs.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("Not enough memory!");
+		return false;
+	}
+
+	//subsampled versions of the clouds (computed once and for all, and shared by all jobs)
+	Garbage<CCLib::GenericIndexedCloudPersist> cloudGarbage;
+	std::vector<CCLib::ChunkedPointCloud*> sampledClouds(cloudCount,0);
+	for (size_t i=0; i<cloudCount; ++i)
+	{
+		ccPointCloud* cloud = clouds[i];
+		centers[i] = cloud->getOwnBB().getCenter();
+
+		if (cloud->size() > params.randomSamplingLimit)
+		{
+			CCLib::ReferenceCloud* sampled = CCLib::CloudSamplingTools::subsampleCloudRandomly(cloud,params.randomSamplingLimit);
+			CCLib::ChunkedPointCloud* sampledCopy = sampled ? new CCLib::ChunkedPointCloud() : 0;
+			if (sampledCopy && sampledCopy->reserve(sampled->size()))
+			{
+				for (unsigned k=0; k<sampled->size(); ++k)
+					sampledCopy->addPoint(*sampled->getPoint(k));
+			}
+			else
+			{
+				delete sampledCopy;
+				sampledCopy = 0;
+			}
+			delete sampled;
+
+			if (!sampledCopy)
+			{
+				ccLog::Error("Not enough memory!");
+				return false;
+			}
+			cloudGarbage.add(sampledCopy);
+			sampledClouds[i] = sampledCopy;
+		}
+		else
+		{
+			//no need to subsample
+			sampledClouds[i] = cloud;
+		}
+	}
+
+	if (stream)
+	{
+		*stream << "Model;Data;RMS;Points;Phi;Theta" << endl;
+	}
+
+	//let's start!
+	s_sampledClouds_MT = &sampledClouds;
+	s_cloudCenters_MT = &centers;
+	s_rotations_MT = &matrices;
+	s_rotationAngles_MT = &matrixAngles;
+	s_bestICPParams_MT = params;
+	s_processedSteps_MT.fetchAndStoreOrdered(0);
+	s_cancelRequested_MT.fetchAndStoreOrdered(0);
+
+	unsigned totalSteps = static_cast<unsigned>(jobs.size() * matrices.size());
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Testing all possible positions");
+		char buffer[256];
+		sprintf(buffer,"%u clouds and %u positions",static_cast<unsigned>(cloudCount),static_cast<unsigned>(matrices.size()));
+		progressCb->setInfo(buffer);
+		progressCb->start();
+	}
+
+	QFuture<void> future = QtConcurrent::map(jobs, ComputeBestICPRms_MT);
+
+	//the main thread waits in an event loop, woken up when the process ends
+	//or periodically to collect the finished pairs and update the progress
+	QFutureWatcher<void> watcher;
+	QEventLoop loop;
+	QTimer timer;
+	QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+	QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+	watcher.setFuture(future);
+	timer.start(100);
+
+	bool cancelled = false;
+	while (true)
+	{
+		//must be tested before retrieving the last results
+		bool finished = future.isFinished();
+
+		std::vector<ICPPairResult> finishedPairs;
+		s_finishedPairsMutex_MT.lock();
+		finishedPairs.swap(s_finishedPairs_MT);
+		s_finishedPairsMutex_MT.unlock();
+
+		for (size_t i=0; i<finishedPairs.size(); ++i)
+		{
+			const ICPPairResult& result = finishedPairs[i];
+			if (cancelled)
+				continue; //partial results are meaningless
+
+			results.push_back(result);
+			if (result.rms >= 0)
+			{
+				ccLog::Print(QString("[BestICPRmsMatrix] Comparison #%1 / #%2: min RMS = %3 (phi = %4 / theta = %5 deg.)").arg(result.modelIndex+1).arg(result.dataIndex+1).arg(result.rms).arg(result.phi_deg).arg(result.theta_deg));
+			}
+			else
+			{
+				ccLog::Warning(QString("[BestICPRmsMatrix] Comparison #%1 / #%2: INVALID").arg(result.modelIndex+1).arg(result.dataIndex+1));
+			}
+
+			if (stream)
+			{
+				*stream << clouds[result.modelIndex]->getName() << ";"
+						<< clouds[result.dataIndex]->getName() << ";"
+						<< result.rms << ";"
+						<< result.pointCount << ";"
+						<< result.phi_deg << ";"
+						<< result.theta_deg << endl; //endl flushes the stream
+			}
+		}
+
+		if (finished)
+			break;
+
+		if (progressCb)
+		{
+			if (!cancelled && progressCb->isCancelRequested())
+			{
+				//the running registrations will stop at the next position
+				s_cancelRequested_MT.fetchAndStoreOrdered(1);
+				cancelled = true;
+			}
+			unsigned steps = static_cast<unsigned>(s_processedSteps_MT.fetchAndAddOrdered(0));
+			progressCb->update(static_cast<float>(steps) * 100.0f / totalSteps);
+		}
+
+		loop.exec();
+	}
+	timer.stop();
+
+	s_sampledClouds_MT = 0;
+	s_cloudCenters_MT = 0;
+	s_rotations_MT = 0;
+	s_rotationAngles_MT = 0;
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (cancelled)
+	{
+		ccLog::Warning("[BestICPRmsMatrix] Process cancelled by the user");
+		results.clear();
+		return false;
+	}
+
+	return true;
+}
+
+QString ccRegistrationTools::GetBestICPRmsPairsFilename(const QString& matrixFilename)
+{
+	QFileInfo matrixFileInfo(matrixFilename);
+	return matrixFileInfo.absoluteDir().absoluteFilePath(matrixFileInfo.completeBaseName() + "_pairs.csv");
+}
+
+bool ccRegistrationTools::SaveBestICPRmsMatrix(	const QString& filename,
+												const std::vector<ccPointCloud*>& clouds,
+												const std::vector<ICPPairResult>& results)
+{
+	size_t cloudCount = clouds.size();
+	std::vector<double> rmsMatrix;
+	try
+	{
+		rmsMatrix.resize(cloudCount*cloudCount,0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("Not enough memory!");
+		return false;
+	}
+
+	for (size_t i=0; i<results.size(); ++i)
+	{
+		const ICPPairResult& result = results[i];
+		assert(result.modelIndex < cloudCount && result.dataIndex < cloudCount);
+		rmsMatrix[result.modelIndex*cloudCount + result.dataIndex] = result.rms;
+	}
+
+	QFile fp(filename);
+	if (!fp.open(QFile::Text | QFile::WriteOnly))
+	{
+		ccLog::Error(QString("Failed to open file '%1' for writing!").arg(filename));
+		return false;
+	}
+
+	QTextStream stream(&fp);
+	//header
+	{
+		stream << "RMS";
+		for (size_t i=0; i<cloudCount; ++i)
+		{
+			stream << ";";
+			stream << clouds[i]->getName();
+		}
+		stream << endl;
+	}
+
+	//rows
+	for (size_t j=0; j<cloudCount; ++j)
+	{
+		stream << clouds[j]->getName();
+		stream << ";";
+		for (size_t i=0; i<cloudCount; ++i)
+		{
+			stream << rmsMatrix[j*cloudCount+i];
+			stream << ";";
+		}
+		stream << endl;
+	}
+
+	return true;
+}
@@ -24,9 +24,15 @@
 //qCC_db
 #include <ccGLMatrix.h>
 
+//system
+#include <vector>
+
 class QWidget;
+class QString;
 class QStringList;
+class QTextStream;
 class ccHObject;
+class ccPointCloud;
 
 //! Registration tools wrapper
 class ccRegistrationTools
@@ -55,6 +61,79 @@ public:
 					int transformationFilters = CCLib::ICPRegistrationTools::SKIP_NONE,
 					QWidget* parent = 0);
 
+	//! Best ICP RMS matrix parameters
+	struct BestICPRmsMatrixParams
+	{
+		//! Default constructor
+		BestICPRmsMatrixParams()
+			: angularStep_deg(45.0)
+			, randomSamplingLimit(20000)
+			, minRMSDecrease(1.0e-6)
+		{}
+
+		//! Angular step between the tested initial orientations (should divide 180)
+		double angularStep_deg;
+		//! Clouds are randomly subsampled (once and for all) below this limit
+		unsigned randomSamplingLimit;
+		//! ICP convergence criterion
+		double minRMSDecrease;
+	};
+
+	//! Best registration of a pair of clouds (see ComputeBestICPRmsMatrix)
+	struct ICPPairResult
+	{
+		ICPPairResult()
+			: modelIndex(0)
+			, dataIndex(0)
+			, rms(-1.0)
+			, pointCount(0)
+			, phi_deg(0)
+			, theta_deg(0)
+		{}
+
+		//! Model (reference) cloud index
+		unsigned modelIndex;
+		//! Data (registered) cloud index
+		unsigned dataIndex;
+		//! Minimum RMS (or -1 if the registration failed)
+		double rms;
+		//! Number of points used for the best registration
+		unsigned pointCount;
+		//! Initial orientation of the data cloud leading to the best RMS
+		double phi_deg, theta_deg;
+		//! Initial transformation of the data cloud leading to the best RMS
+		ccGLMatrix initialTrans;
+	};
+
+	//! Registers each pair of clouds starting from several initial orientations and keeps the best RMS
+	/** Pairs are registered concurrently. Each result is written (as a CSV line) to
+		the output stream (if any) as soon as the corresponding pair is done.
+		\param clouds input clouds
+		\param params parameters
+		\param results output results (one per pair, in the order of completion)
+		\param stream optional output stream (header: 'Model;Data;RMS;Points;Phi;Theta')
+		\param progressCb optional progress callback
+		\return false if the process failed or was cancelled
+	**/
+	static bool ComputeBestICPRmsMatrix(const std::vector<ccPointCloud*>& clouds,
+										const BestICPRmsMatrixParams& params,
+										std::vector<ICPPairResult>& results,
+										QTextStream* stream = 0,
+										CCLib::GenericProgressCallback* progressCb = 0);
+
+	//! Saves the RMS matrix (as computed by ComputeBestICPRmsMatrix) to a CSV file
+	/** Row = model cloud, column = data cloud.
+	**/
+	static bool SaveBestICPRmsMatrix(	const QString& filename,
+										const std::vector<ccPointCloud*>& clouds,
+										const std::vector<ICPPairResult>& results);
+
+	//! Returns the name of the file in which the pairs are streamed, next to the RMS matrix file
+	/** \param matrixFilename RMS matrix filename (see SaveBestICPRmsMatrix)
+		\return '<matrix file base name>_pairs.csv' (in the same folder)
+	**/
+	static QString GetBestICPRmsPairsFilename(const QString& matrixFilename);
+
 };
 
 #endif //CC_REGISTRATION_TOOLS_HEADER
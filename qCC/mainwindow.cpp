@@ -66,6 +66,7 @@
 #include <ccGlobalShiftManager.h>
 #include <ccShiftAndScaleCloudDlg.h>
 #include <BinFilter.h>
+#include <STLFilter.h>
 #include <DepthMapFileFilter.h>
 
 //QCC_glWindow
@@ -277,6 +278,36 @@ MainWindow::MainWindow()
 
 	connectActions();
 
+	//BIN files compression (persistent)
+	{
+		settings.beginGroup(ccPS::SaveFile());
+		int compression = settings.value(ccPS::BinCompression(), static_cast<int>(BinFilter::GetDefaultCompression())).toInt();
+		settings.endGroup();
+
+		QAction* action = actionBinCompressionNone;
+		if (compression == ccSerializationHelper::FAST_COMPRESSION)
+			action = actionBinCompressionFast;
+		else if (compression == ccSerializationHelper::HIGH_COMPRESSION)
+			action = actionBinCompressionHigh;
+		action->setChecked(true);
+		setBinCompression(action);
+	}
+
+	//STL vertex fusion (persistent)
+	{
+		settings.beginGroup(ccPS::LoadFile());
+		int fusion = settings.value(ccPS::StlVertexFusion(), static_cast<int>(STLFilter::GetVertexFusionMode())).toInt();
+		settings.endGroup();
+
+		QAction* action = actionStlFusionTolerance;
+		if (fusion == STLFilter::NO_FUSION)
+			action = actionStlFusionNone;
+		else if (fusion == STLFilter::EXACT_FUSION)
+			action = actionStlFusionExact;
+		action->setChecked(true);
+		setStlVertexFusion(action);
+	}
+
 	loadPlugins();
 
 #ifdef CC_3DXWARE_SUPPORT
@@ -648,6 +679,40 @@ void MainWindow::setup3DMouse(bool state)
 	enable3DMouse(state,false);
 }
 
+void MainWindow::setBinCompression(QAction* action)
+{
+	ccSerializationHelper::Compression compression = ccSerializationHelper::NO_COMPRESSION;
+	if (action == actionBinCompressionFast)
+		compression = ccSerializationHelper::FAST_COMPRESSION;
+	else if (action == actionBinCompressionHigh)
+		compression = ccSerializationHelper::HIGH_COMPRESSION;
+
+	BinFilter::SetDefaultCompression(compression);
+
+	//save it as the default choice
+	QSettings settings;
+	settings.beginGroup(ccPS::SaveFile());
+	settings.setValue(ccPS::BinCompression(), static_cast<int>(compression));
+	settings.endGroup();
+}
+
+void MainWindow::setStlVertexFusion(QAction* action)
+{
+	STLFilter::VertexFusionMode mode = STLFilter::TOLERANCE_FUSION;
+	if (action == actionStlFusionNone)
+		mode = STLFilter::NO_FUSION;
+	else if (action == actionStlFusionExact)
+		mode = STLFilter::EXACT_FUSION;
+
+	STLFilter::SetVertexFusionMode(mode);
+
+	//save it as the default choice
+	QSettings settings;
+	settings.beginGroup(ccPS::LoadFile());
+	settings.setValue(ccPS::StlVertexFusion(), static_cast<int>(mode));
+	settings.endGroup();
+}
+
 void MainWindow::enable3DMouse(bool state, bool silent)
 {
 #ifdef CC_3DXWARE_SUPPORT
@@ -823,6 +888,20 @@ void MainWindow::connectActions()
 	connect(actionSave,							SIGNAL(triggered()),	this,		SLOT(doActionSaveFile()));
 	connect(actionPrimitiveFactory,				SIGNAL(triggered()),	this,		SLOT(doShowPrimitiveFactory()));
 	connect(actionEnable3DMouse,				SIGNAL(toggled(bool)),	this,		SLOT(setup3DMouse(bool)));
+	{
+		QActionGroup* binCompressionGroup = new QActionGroup(this);
+		binCompressionGroup->addAction(actionBinCompressionNone);
+		binCompressionGroup->addAction(actionBinCompressionFast);
+		binCompressionGroup->addAction(actionBinCompressionHigh);
+		connect(binCompressionGroup,			SIGNAL(triggered(QAction*)),	this,	SLOT(setBinCompression(QAction*)));
+	}
+	{
+		QActionGroup* stlFusionGroup = new QActionGroup(this);
+		stlFusionGroup->addAction(actionStlFusionNone);
+		stlFusionGroup->addAction(actionStlFusionExact);
+		stlFusionGroup->addAction(actionStlFusionTolerance);
+		connect(stlFusionGroup,					SIGNAL(triggered(QAction*)),	this,	SLOT(setStlVertexFusion(QAction*)));
+	}
 	connect(actionCloseAll,						SIGNAL(triggered()),	this,		SLOT(closeAll()));
 	connect(actionQuit,							SIGNAL(triggered()),	this,		SLOT(close()));
 
@@ -9822,216 +9901,65 @@ void MainWindow::doActionComputeBestICPRmsMatrix()
 		return;
 	}
 
-	//init matrices
-	std::vector<double> rmsMatrix;
-	std::vector<ccGLMatrix> matrices;
-	std::vector< std::pair<double,double> > matrixAngles;
-	try
+	//output file (selected first, as the results are streamed to it during the process)
+	QString outputFilename;
 	{
-		rmsMatrix.resize(cloudCount*cloudCount,0);
-
-		//init all possible transformations
-		static const double angularStep_deg = 45.0;
-		unsigned phiSteps = static_cast<unsigned>(360.0/angularStep_deg);
-		assert(fabs(360.0 - phiSteps * angularStep_deg) < ZERO_TOLERANCE);
-		unsigned thetaSteps = static_cast<unsigned>(180.0/angularStep_deg);
-		assert(fabs(180.0 - thetaSteps * angularStep_deg) < ZERO_TOLERANCE);
-		unsigned rotCount = phiSteps * (thetaSteps-1) + 2;
-		matrices.reserve(rotCount);
-		matrixAngles.reserve(rotCount);
-
-		for (unsigned j=0; j<=thetaSteps; ++j)
-		{
-			//we want to cover the full [0-180] interval! ([-90;90] in fact)
-			double theta_deg = j * angularStep_deg - 90.0;
-			for (unsigned i=0; i<phiSteps; ++i)
-			{
-				double phi_deg = i * angularStep_deg;
-				ccGLMatrix trans;
-				trans.initFromParameters(	static_cast<float>(phi_deg * CC_DEG_TO_RAD),
-											static_cast<float>(theta_deg * CC_DEG_TO_RAD),
-											0,
-											CCVector3(0,0,0) );
-				matrices.push_back(trans);
-				matrixAngles.push_back( std::pair<double,double>(phi_deg,theta_deg) );
-
-				//for poles, no need to rotate!
-				if (j == 0 || j == thetaSteps)
-					break;
-			}
-		}
+		//persistent settings
+		QSettings settings;
+		settings.beginGroup(ccPS::SaveFile());
+		QString currentPath = settings.value(ccPS::CurrentPath(),QApplication::applicationDirPath()).toString();
+
+		outputFilename = QFileDialog::getSaveFileName(this, "Select output file", currentPath, "*.csv");
+		if (outputFilename.isEmpty())
+			return;
 	}
-	catch (const std::bad_alloc&)
+
+	//each pair is written to a second file as soon as it is processed
+	QString pairsFilename = ccRegistrationTools::GetBestICPRmsPairsFilename(outputFilename);
+	QFile pairsFile(pairsFilename);
+	if (!pairsFile.open(QFile::Text | QFile::WriteOnly))
 	{
-		ccLog::Error("Not enough memory!");
+		ccLog::Error(QString("Failed to open file '%1' for writing!").arg(pairsFilename));
 		return;
 	}
+	QTextStream pairsStream(&pairsFile);
 
 	//let's start!
+	ccRegistrationTools::BestICPRmsMatrixParams params;
+	std::vector<ccRegistrationTools::ICPPairResult> results;
 	{
 		ccProgressDialog pDlg(true,this);
-		pDlg.setMethodTitle("Testing all possible positions");
-		pDlg.setInfo(qPrintable(QString("%1 clouds and %2 positions").arg(cloudCount).arg(matrices.size())));
-		CCLib::NormalizedProgress nProgress(&pDlg,static_cast<unsigned>(((cloudCount*(cloudCount-1))/2)*matrices.size()));
-		pDlg.start();
-		QApplication::processEvents();
+		if (!ccRegistrationTools::ComputeBestICPRmsMatrix(clouds, params, results, &pairsStream, &pDlg))
+			return;
+	}
+	pairsFile.close();
 
-//#define TEST_GENERATION
-#ifdef TEST_GENERATION
-		ccPointCloud* testSphere = new ccPointCloud();
-		testSphere->reserve(matrices.size());
-#endif
+	//display the best case for each pair
+	for (size_t i=0; i<results.size(); ++i)
+	{
+		const ccRegistrationTools::ICPPairResult& result = results[i];
+		if (result.rms < 0)
+			continue;
 
-		for (size_t i=0; i<cloudCount-1; ++i)
+		ccPointCloud* bestB = clouds[result.dataIndex]->cloneThis();
+		if (!bestB)
 		{
-			ccPointCloud* A = clouds[i];
-			A->computeOctree();
-
-			for (size_t j=i+1; j<cloudCount; ++j)
-			{
-				ccGLMatrix transBToZero;
-				transBToZero.toIdentity();
-				transBToZero.setTranslation(-clouds[j]->getOwnBB().getCenter());
-				
-				ccGLMatrix transFromZeroToA;
-				transFromZeroToA.toIdentity();
-				transFromZeroToA.setTranslation(A->getOwnBB().getCenter());
-
-#ifndef TEST_GENERATION
-				double minRMS = -1.0;
-				int bestMatrixIndex = -1;
-				ccPointCloud* bestB = 0;
-#endif
-				for (size_t k=0; k<matrices.size(); ++k)
-				{
-					ccPointCloud* B = clouds[j]->cloneThis();
-					if (!B)
-					{
-						ccLog::Error("Not enough memory!");
-						return;
-					}
-
-					ccGLMatrix BtoA = transFromZeroToA * matrices[k] * transBToZero;
-					B->applyRigidTransformation(BtoA);
-
-#ifndef TEST_GENERATION
-					double finalRMS = 0;
-					unsigned finalPointCount = 0;
-					CCLib::ICPRegistrationTools::RESULT_TYPE result;
-					CCLib::ICPRegistrationTools::ScaledTransformation registerTrans;
-					result = CCLib::ICPRegistrationTools::RegisterClouds(A,B,registerTrans,CCLib::ICPRegistrationTools::MAX_ERROR_CONVERGENCE,1.0e-6,0,finalRMS,finalPointCount);
-
-					if (result == CCLib::ICPRegistrationTools::ICP_ERROR)
-					{
-						delete B;
-						if (bestB)
-							delete bestB;
-						ccLog::Error("An error occurred while performing ICP!");
-						return;
-					}
-
-					if (minRMS < 0 || finalRMS < minRMS)
-					{
-						minRMS = finalRMS;
-						bestMatrixIndex = static_cast<int>(k);
-						std::swap(bestB,B);
-					}
-
-					if (B)
-					{
-						delete B;
-						B = 0;
-					}
-#else
-					addToDB(B);
-
-					//Test sphere
-					CCVector3 Y(0,1,0);
-					matrices[k].apply(Y);
-					testSphere->addPoint(Y);
-#endif
-
-					if (!nProgress.oneStep())
-					{
-						//process cancelled by user
-						return;
-					}
-				}
-
-#ifndef TEST_GENERATION
-				if (bestMatrixIndex >= 0)
-				{
-					assert(bestB);
-					ccHObject* group = new ccHObject(QString("Best case #%1 / #%2 - RMS = %3").arg(i+1).arg(j+1).arg(minRMS));
-					group->addChild(bestB);
-					group->setDisplay_recursive(A->getDisplay());
-					addToDB(group);
-					ccLog::Print(QString("[doActionComputeBestICPRmsMatrix] Comparison #%1 / #%2: min RMS = %3 (phi = %4 / theta = %5 deg.)").arg(i+1).arg(j+1).arg(minRMS).arg(matrixAngles[bestMatrixIndex].first).arg(matrixAngles[bestMatrixIndex].second));
-				}
-				else
-				{
-					assert(!bestB);
-					ccLog::Warning(QString("[doActionComputeBestICPRmsMatrix] Comparison #%1 / #%2: INVALID").arg(i+1).arg(j+1));
-				}
-
-				rmsMatrix[i*cloudCount + j] = minRMS;
-#else
-				addToDB(testSphere);
-				i = cloudCount;
-				break;
-#endif
-			}
+			ccLog::Warning("Not enough memory to display the best cases!");
+			break;
 		}
+		ccGLMatrix BtoA = result.initialTrans;
+		bestB->applyRigidTransformation(BtoA);
+
+		ccHObject* group = new ccHObject(QString("Best case #%1 / #%2 - RMS = %3").arg(result.modelIndex+1).arg(result.dataIndex+1).arg(result.rms));
+		group->addChild(bestB);
+		group->setDisplay_recursive(clouds[result.modelIndex]->getDisplay());
+		addToDB(group);
 	}
 
-	//export result as a CSV file
-#ifdef TEST_GENERATION
-	if (false)
-#endif
+	//export the RMS matrix as a CSV file
+	if (ccRegistrationTools::SaveBestICPRmsMatrix(outputFilename, clouds, results))
 	{
-		//persistent settings
-		QSettings settings;
-		settings.beginGroup(ccPS::SaveFile());
-		QString currentPath = settings.value(ccPS::CurrentPath(),QApplication::applicationDirPath()).toString();
-
-		QString outputFilename = QFileDialog::getSaveFileName(this, "Select output file", currentPath, "*.csv");
-		if (outputFilename.isEmpty())
-			return;
-
-		QFile fp(outputFilename);
-		if (fp.open(QFile::Text | QFile::WriteOnly))
-		{
-			QTextStream stream(&fp);
-			//header
-			{
-				stream << "RMS";
-				for (size_t i=0; i<cloudCount; ++i)
-				{
-					stream << ";";
-					stream << clouds[i]->getName();
-				}
-				stream << endl;
-			}
-
-			//rows
-			for (size_t j=0; j<cloudCount; ++j)
-			{
-				stream << clouds[j]->getName();
-				stream << ";";
-				for (size_t i=0; i<cloudCount; ++i)
-				{
-					stream << rmsMatrix[j*cloudCount+i];
-					stream << ";";
-				}
-				stream << endl;
-			}
-			
-			ccLog::Print("[doActionComputeBestICPRmsMatrix] Job done");
-		}
-		else
-		{
-			ccLog::Error("Failed to save output file?!");
-		}
+		ccLog::Print("[doActionComputeBestICPRmsMatrix] Job done");
 	}
 }
 
@@ -459,6 +459,12 @@ protected slots:
 	//! Setups 3D mouse (if any)
 	void setup3DMouse(bool);
 
+	//! Sets the compression of the saved BIN files (see the 'File > BIN files compression' menu)
+	void setBinCompression(QAction*);
+
+	//! Sets how the duplicated vertices of the loaded STL files are merged (see the 'File > STL vertex fusion' menu)
+	void setStlVertexFusion(QAction*);
+
 	//! Removes all entiites currently loaded in the DB tree
 	void closeAll();
 